@@ -0,0 +1,256 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "HyperlinkStore.hpp"
+
+#include <til/hash.h>
+
+// 0 means "no hyperlink" in TextAttribute and doubles as the sentinel of our linked list.
+static constexpr size_t maxEntries = size_t{ UINT16_MAX } + 1;
+
+HyperlinkStore::HyperlinkStore(const HyperlinkStore& other)
+{
+    *this = other;
+}
+
+HyperlinkStore& HyperlinkStore::operator=(const HyperlinkStore& other)
+{
+    if (this != &other)
+    {
+        _entries = other._entries;
+        _freeHead = other._freeHead;
+        _uris = other._uris;
+        _customIds = other._customIds;
+        _size = other._size;
+
+        // The entries still point into other._uris. Rebind them to our own copy.
+        for (auto& entry : _entries)
+        {
+            if (entry.uri)
+            {
+                entry.uri = &*_uris.find(entry.uri->first);
+            }
+        }
+    }
+    return *this;
+}
+
+// Returns the ID for a new hyperlink. If customId is given and a hyperlink with
+// the same custom ID and URI already exists, its ID will be returned instead.
+// `row` is the absolute row the hyperlink is about to be written to.
+uint16_t HyperlinkStore::Acquire(std::wstring_view uri, std::wstring_view customId, int64_t row)
+{
+    std::wstring key;
+    if (!customId.empty())
+    {
+        // hash the URL and add it to the custom ID - GH#7698
+        key.reserve(customId.size() + 21);
+        key.append(customId);
+        key.append(L"%");
+        key.append(std::to_wstring(til::hash(uri)));
+
+        if (const auto it = _customIds.find(key); it != _customIds.end())
+        {
+            Touch(it->second, row);
+            return it->second;
+        }
+    }
+
+    const auto id = _allocate();
+    auto& entry = til::at(_entries, id);
+    _setUri(entry, uri);
+    entry.lastRow = row;
+    _append(id);
+    _size++;
+
+    if (!key.empty())
+    {
+        entry.customId = key;
+        _customIds.emplace(std::move(key), id);
+    }
+
+    return id;
+}
+
+// Changes the URI of an existing hyperlink.
+void HyperlinkStore::SetUri(uint16_t id, std::wstring_view uri)
+{
+    if (_isLive(id))
+    {
+        _setUri(til::at(_entries, id), uri);
+    }
+}
+
+void HyperlinkStore::Remove(uint16_t id) noexcept
+{
+    if (_isLive(id))
+    {
+        _release(id);
+    }
+}
+
+std::wstring_view HyperlinkStore::GetUri(uint16_t id) const noexcept
+{
+    return _isLive(id) ? std::wstring_view{ til::at(_entries, id).uri->first } : std::wstring_view{};
+}
+
+// Returns the custom ID (including the URI hash suffix) of the given hyperlink, if there is one.
+std::wstring_view HyperlinkStore::GetCustomId(uint16_t id) const noexcept
+{
+    return _isLive(id) ? std::wstring_view{ til::at(_entries, id).customId } : std::wstring_view{};
+}
+
+// Returns the number of hyperlink IDs that are currently in use.
+size_t HyperlinkStore::Size() const noexcept
+{
+    return _size;
+}
+
+// Returns the number of distinct URIs referenced by the hyperlink IDs in use.
+size_t HyperlinkStore::UniqueUris() const noexcept
+{
+    return _uris.size();
+}
+
+// Records that the given hyperlink was written to the given absolute row.
+// The last row an ID was written to determines when it can be pruned.
+void HyperlinkStore::Touch(uint16_t id, int64_t row) noexcept
+{
+    if (!_isLive(id))
+    {
+        return;
+    }
+
+    auto& entry = til::at(_entries, id);
+    entry.lastRow = std::max(entry.lastRow, row);
+
+    // Entries are pruned from the front of the list. Moving the entry to the back keeps the list
+    // roughly sorted by lastRow. It isn't strictly sorted (a link may be written above a newer one),
+    // but Prune() only ever frees the entries it checked, so at worst an ID is released a bit later.
+    if (entry.next != 0)
+    {
+        _unlink(id);
+        _append(id);
+    }
+}
+
+// Sets the last used row of all hyperlinks to the given one.
+// Used when the contents of the buffer moved around wholesale, for instance during reflow.
+void HyperlinkStore::ResetUsage(int64_t row) noexcept
+{
+    for (auto& entry : _entries)
+    {
+        entry.lastRow = row;
+    }
+}
+
+// Releases all hyperlinks that were last written at or above the given absolute row.
+// keepAlive is an ID that must not be released, because it's still used by the current attributes.
+// This is amortized O(1) per released ID, because the rows are recycled in order.
+void HyperlinkStore::Prune(int64_t row, uint16_t keepAlive) noexcept
+{
+    for (;;)
+    {
+        const auto id = _entries.front().next;
+        if (id == 0 || til::at(_entries, id).lastRow > row)
+        {
+            break;
+        }
+
+        if (id == keepAlive)
+        {
+            Touch(id, row + 1);
+            continue;
+        }
+
+        _release(id);
+    }
+}
+
+uint16_t HyperlinkStore::_allocate()
+{
+    if (_freeHead != 0)
+    {
+        const auto id = _freeHead;
+        _freeHead = til::at(_entries, id).next;
+        til::at(_entries, id).next = 0;
+        return id;
+    }
+
+    if (_entries.size() < maxEntries)
+    {
+        const auto id = gsl::narrow_cast<uint16_t>(_entries.size());
+        _entries.emplace_back();
+        return id;
+    }
+
+    // All 65535 IDs are in use. The best we can do is to recycle the least recently used one.
+    _release(_entries.front().next);
+    return _allocate();
+}
+
+void HyperlinkStore::_release(uint16_t id) noexcept
+{
+    auto& entry = til::at(_entries, id);
+
+    _unlink(id);
+
+    if (--entry.uri->second == 0)
+    {
+        _uris.erase(_uris.find(entry.uri->first));
+    }
+    entry.uri = nullptr;
+
+    if (!entry.customId.empty())
+    {
+        _customIds.erase(entry.customId);
+        entry.customId.clear();
+    }
+
+    // Released entries form a singly linked free list through their `next` member.
+    entry.next = _freeHead;
+    _freeHead = id;
+    _size--;
+}
+
+void HyperlinkStore::_setUri(Entry& entry, std::wstring_view uri)
+{
+    if (entry.uri && entry.uri->first == uri)
+    {
+        return;
+    }
+
+    const auto [it, inserted] = _uris.try_emplace(std::wstring{ uri }, 0);
+    it->second++;
+
+    if (entry.uri && --entry.uri->second == 0)
+    {
+        _uris.erase(_uris.find(entry.uri->first));
+    }
+    entry.uri = &*it;
+}
+
+void HyperlinkStore::_unlink(uint16_t id) noexcept
+{
+    auto& entry = til::at(_entries, id);
+    til::at(_entries, entry.prev).next = entry.next;
+    til::at(_entries, entry.next).prev = entry.prev;
+    entry.prev = 0;
+    entry.next = 0;
+}
+
+void HyperlinkStore::_append(uint16_t id) noexcept
+{
+    auto& sentinel = _entries.front();
+    auto& entry = til::at(_entries, id);
+    entry.prev = sentinel.prev;
+    entry.next = 0;
+    til::at(_entries, sentinel.prev).next = id;
+    sentinel.prev = id;
+}
+
+bool HyperlinkStore::_isLive(uint16_t id) const noexcept
+{
+    return id != 0 && id < _entries.size() && til::at(_entries, id).uri != nullptr;
+}
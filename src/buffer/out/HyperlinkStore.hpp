@@ -0,0 +1,72 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- HyperlinkStore.hpp
+
+Abstract:
+- Stores the URIs and custom IDs of OSC 8 hyperlinks for a TextBuffer.
+- Each hyperlink is identified by the 16-bit ID that's stored in TextAttribute.
+  IDs are handed out from a free list and released once the last row that
+  used them is recycled, so that the ID space never wraps around onto links
+  that are still visible.
+- URIs are interned and reference counted by the IDs that use them, because
+  tools that emit a link per line tend to repeat the same handful of URIs.
+--*/
+
+#pragma once
+
+class HyperlinkStore
+{
+public:
+    HyperlinkStore() = default;
+    HyperlinkStore(const HyperlinkStore& other);
+    HyperlinkStore(HyperlinkStore&& other) = default;
+    HyperlinkStore& operator=(const HyperlinkStore& other);
+    HyperlinkStore& operator=(HyperlinkStore&& other) = default;
+    ~HyperlinkStore() = default;
+
+    uint16_t Acquire(std::wstring_view uri, std::wstring_view customId, int64_t row);
+    void SetUri(uint16_t id, std::wstring_view uri);
+    void Remove(uint16_t id) noexcept;
+
+    std::wstring_view GetUri(uint16_t id) const noexcept;
+    std::wstring_view GetCustomId(uint16_t id) const noexcept;
+    size_t Size() const noexcept;
+    size_t UniqueUris() const noexcept;
+
+    void Touch(uint16_t id, int64_t row) noexcept;
+    void ResetUsage(int64_t row) noexcept;
+    void Prune(int64_t row, uint16_t keepAlive) noexcept;
+
+private:
+    using UriMap = std::unordered_map<std::wstring, size_t>;
+
+    struct Entry
+    {
+        // Points into _uris. nullptr if the ID isn't in use.
+        UriMap::value_type* uri = nullptr;
+        // The key in _customIds, if the link had an explicit ID.
+        std::wstring customId;
+        // The absolute row (see TextBuffer::_absoluteRow) this ID was last written to.
+        int64_t lastRow = 0;
+        // Intrusive doubly linked list in order of use. _entries[0] is the sentinel.
+        // Released entries are instead chained into a free list via `next`.
+        uint16_t prev = 0;
+        uint16_t next = 0;
+    };
+
+    uint16_t _allocate();
+    void _release(uint16_t id) noexcept;
+    void _setUri(Entry& entry, std::wstring_view uri);
+    void _unlink(uint16_t id) noexcept;
+    void _append(uint16_t id) noexcept;
+    bool _isLive(uint16_t id) const noexcept;
+
+    std::vector<Entry> _entries = std::vector<Entry>(1);
+    uint16_t _freeHead = 0;
+    UriMap _uris;
+    std::unordered_map<std::wstring, uint16_t> _customIds;
+    size_t _size = 0;
+};
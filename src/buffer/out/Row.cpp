@@ -225,17 +225,41 @@ til::CoordType ROW::GetReadableColumnCount() const noexcept
 // - <none>
 void ROW::Reset(const TextAttribute& attr) noexcept
 {
-    _charsHeap.reset();
-    _chars = { _charsBuffer, _columnCount };
+    ScheduleReset(attr);
+    FinishPendingReset();
+}
+
+// Like Reset(), but only the attributes are reset right away. Clearing the text and releasing
+// the image slice is deferred until FinishPendingReset() is called. TextBuffer uses this for
+// the rows it recycles while scrolling and finishes the reset once the row is accessed again.
+// This way rows that scroll past without anyone looking at them never need to be cleared.
+void ROW::ScheduleReset(const TextAttribute& attr) noexcept
+{
     // Constructing and then moving objects into place isn't free.
     // Modifying the existing object is _much_ faster.
     *_attr.runs().unsafe_shrink_to_size(1) = til::rle_pair{ attr, _columnCount };
+    _resetPending = true;
+}
+
+// TextBuffer checks this from const getters which may run concurrently (see TextBuffer::_getRow()).
+// The acquire load pairs with the release store in FinishPendingReset().
+bool ROW::IsResetPending() const noexcept
+{
+#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
+    return std::atomic_ref{ const_cast<bool&>(_resetPending) }.load(std::memory_order_acquire);
+}
+
+void ROW::FinishPendingReset() noexcept
+{
+    _charsHeap.reset();
+    _chars = { _charsBuffer, _columnCount };
     _imageSlice = nullptr;
     _lineRendition = LineRendition::SingleWidth;
     _wrapForced = false;
     _doubleBytePadded = false;
     _promptData = std::nullopt;
     _init();
+    std::atomic_ref{ _resetPending }.store(false, std::memory_order_release);
 }
 
 void ROW::_init() noexcept
@@ -437,6 +461,9 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
     uint16_t colorUses = 0;
     auto colorStarts = gsl::narrow_cast<uint16_t>(columnBegin);
     auto currentIndex = colorStarts;
+    // The color runs are collected and committed in a single pass at the end,
+    // because rows with lots of colors would otherwise be rebuilt once per color.
+    til::small_vector<RowAttributes::edit, 16> colorRuns;
 
     while (it && currentIndex <= finalColumnInRow)
     {
@@ -452,8 +479,7 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
             else
             {
                 // Otherwise, commit this color into the run and save off the new one.
-                // Now commit the new color runs into the attr row.
-                _attr.replace(colorStarts, currentIndex, currentColor);
+                colorRuns.push_back({ colorStarts, currentIndex, currentColor });
                 currentColor = it->TextAttr();
                 colorUses = 1;
                 colorStarts = currentIndex;
@@ -530,15 +556,251 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
         ++currentIndex;
     }
 
-    // Now commit the final color into the attr row
+    // Now commit the final color and all the previous ones into the attr row
     if (colorUses)
     {
-        _attr.replace(colorStarts, currentIndex, currentColor);
+        colorRuns.push_back({ colorStarts, currentIndex, currentColor });
     }
+    _attr.replace_ranges(colorRuns);
 
     return it;
 }
 
+// Writes the given CHAR_INFOs starting at columnBegin. The result is the same as calling WriteCells() with an
+// OutputCellIterator over them, except that runs of narrow characters and attributes are converted in bulk.
+void ROW::WriteCharInfos(const til::CoordType columnBegin, std::span<const CHAR_INFO> infos, const std::optional<bool> wrap)
+{
+    const auto colBeg = _clampedColumnInclusive(columnBegin);
+    infos = infos.first(std::min<size_t>(infos.size(), _columnCount - colBeg));
+
+    for (size_t i = 0; i < infos.size();)
+    {
+        const auto& info = til::at(infos, i);
+        const auto column = gsl::narrow_cast<til::CoordType>(colBeg + i);
+
+        if (WI_AreAllFlagsClear(info.Attributes, COMMON_LVB_SBCSDBCS))
+        {
+            auto end = i + 1;
+            while (end < infos.size() && WI_AreAllFlagsClear(til::at(infos, end).Attributes, COMMON_LVB_SBCSDBCS))
+            {
+                ++end;
+            }
+
+            _replaceCharInfos(column, infos.subspan(i, end - i));
+            i = end;
+            continue;
+        }
+
+        // The leading and trailing halves of wide glyphs are handled exactly like WriteCells() does.
+        const std::wstring_view chars{ &info.Char.UnicodeChar, 1 };
+        if (WI_IsFlagSet(info.Attributes, COMMON_LVB_LEADING_BYTE))
+        {
+            if (column == _columnCount - 1)
+            {
+                // The wide char doesn't fit. Pad with whitespace.
+                ClearCell(column);
+                SetDoubleBytePadded(true);
+            }
+            else
+            {
+                ReplaceCharacters(column, 2, chars);
+            }
+        }
+        else if (column == 0)
+        {
+            // The wide char doesn't fit. Pad with whitespace.
+            ClearCell(column);
+        }
+        else if (i == 0)
+        {
+            // Only a trailer at the start of the write is taken into account.
+            // See the corresponding comment in WriteCells() for more details.
+            ReplaceCharacters(column - 1, 2, chars);
+        }
+
+        ++i;
+    }
+
+    // TextAttribute ignores the COMMON_LVB_LEADING_BYTE/TRAILING_BYTE flags, so we do the same when finding runs.
+    static constexpr WORD attributesMask = ~WORD{ COMMON_LVB_SBCSDBCS };
+    til::small_vector<RowAttributes::edit, 16> attributeRuns;
+
+    for (size_t i = 0; i < infos.size();)
+    {
+        const auto attributes = til::at(infos, i).Attributes & attributesMask;
+        auto end = i + 1;
+        while (end < infos.size() && (til::at(infos, end).Attributes & attributesMask) == attributes)
+        {
+            ++end;
+        }
+
+        attributeRuns.push_back({ gsl::narrow_cast<uint16_t>(colBeg + i), gsl::narrow_cast<uint16_t>(colBeg + end), TextAttribute{ gsl::narrow_cast<WORD>(attributes) } });
+        i = end;
+    }
+
+    _attr.replace_ranges(attributeRuns);
+
+    // See the corresponding comment in WriteCells().
+    if (wrap.has_value() && !infos.empty() && colBeg + infos.size() == _columnCount)
+    {
+        SetWrapForced(*wrap);
+    }
+}
+
+// Writes a run of CHAR_INFOs without COMMON_LVB_LEADING_BYTE/TRAILING_BYTE flags. Like WriteCells(),
+// each of them occupies exactly 1 column, even if the character is actually a wide one.
+void ROW::_replaceCharInfos(const til::CoordType columnBegin, std::span<const CHAR_INFO> infos)
+try
+{
+    // CHAR_INFO interleaves the characters with their attributes. We extract them in chunks into a
+    // contiguous buffer on the stack, which is then written into the row via the usual WriteHelper.
+    static constexpr size_t chunkSize = 256;
+    wchar_t buffer[chunkSize];
+    auto column = columnBegin;
+
+    while (!infos.empty())
+    {
+        const auto count = std::min(infos.size(), chunkSize);
+        _extractChars(&buffer[0], infos.data(), count);
+
+        const std::wstring_view chars{ &buffer[0], count };
+        WriteHelper h{ *this, column, gsl::narrow_cast<til::CoordType>(column + count), chars };
+        if (!h.IsValid())
+        {
+            return;
+        }
+        h.ReplaceNarrowCharacters();
+        h.Finish();
+
+        infos = infos.subspan(count);
+        column += gsl::narrow_cast<til::CoordType>(count);
+    }
+}
+catch (...)
+{
+    // See ReplaceCharacters().
+    Reset(TextAttribute{});
+    throw;
+}
+
+#pragma warning(push)
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+// Copies the .Char.UnicodeChar of `count` many CHAR_INFOs into `dst`.
+void ROW::_extractChars(wchar_t* dst, const CHAR_INFO* src, size_t count) noexcept
+{
+    static_assert(sizeof(CHAR_INFO) == 4 && offsetof(CHAR_INFO, Char) == 0);
+
+#if defined(TIL_SSE_INTRINSICS)
+    for (; count >= 8; count -= 8, dst += 8, src += 8)
+    {
+        const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4));
+        // Sign-extend the lower 16 bits of each CHAR_INFO (= the character) to 32 bits,
+        // so that _mm_packs_epi32 narrows them back to 16 bits without saturating.
+        const auto lo = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        const auto hi = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+    for (; count >= 8; count -= 8, dst += 8, src += 8)
+    {
+        const auto v = vld2q_u16(reinterpret_cast<const uint16_t*>(src));
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst), v.val[0]);
+    }
+#endif
+
+    for (; count; --count, ++dst, ++src)
+    {
+        *dst = src->Char.UnicodeChar;
+    }
+}
+
+// The inverse of _extractChars(): Stores `count` many characters into the .Char.UnicodeChar of the given
+// CHAR_INFOs and resets their .Attributes to 0. The attributes are filled in by ReadCharInfos() afterwards.
+void ROW::_depositChars(CHAR_INFO* dst, const wchar_t* src, size_t count) noexcept
+{
+#if defined(TIL_SSE_INTRINSICS)
+    const auto zero = _mm_setzero_si128();
+    for (; count >= 8; count -= 8, dst += 8, src += 8)
+    {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi16(v, zero));
+    }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+    for (; count >= 8; count -= 8, dst += 8, src += 8)
+    {
+        const uint16x8x2_t v{ vld1q_u16(reinterpret_cast<const uint16_t*>(src)), vdupq_n_u16(0) };
+        vst2q_u16(reinterpret_cast<uint16_t*>(dst), v);
+    }
+#endif
+
+    for (; count; --count, ++dst, ++src)
+    {
+        dst->Char.UnicodeChar = *src;
+        dst->Attributes = 0;
+    }
+}
+
+#pragma warning(pop)
+
+// Reads the cells starting at columnBegin into the given CHAR_INFOs, the same way
+// CONSOLE_INFORMATION::AsCharInfo() converts them one by one, but in bulk.
+void ROW::ReadCharInfos(const til::CoordType columnBegin, std::span<CHAR_INFO> infos) const noexcept
+{
+    const auto colBeg = _clampedColumnInclusive(columnBegin);
+    infos = infos.first(std::min<size_t>(infos.size(), _columnCount - colBeg));
+
+    for (size_t i = 0; i < infos.size();)
+    {
+        const size_t col = colBeg + i;
+
+        // A column holds a single narrow character if the next column starts exactly 1 character later.
+        // This can't be true for any column that is part of a wide glyph, due to the CharOffsetsTrailer bit.
+        auto end = i;
+        while (end < infos.size() && _charOffsets[colBeg + end + 1] == _charOffsets[colBeg + end] + 1)
+        {
+            ++end;
+        }
+
+        if (end != i)
+        {
+            _depositChars(infos.data() + i, _chars.data() + _charOffsets[col], end - i);
+            i = end;
+            continue;
+        }
+
+        auto& info = til::at(infos, i);
+        const auto glyph = GlyphAt(gsl::narrow_cast<til::CoordType>(col));
+        info.Char.UnicodeChar = glyph.size() == 1 ? glyph.front() : UNICODE_REPLACEMENT;
+        info.Attributes = GeneratePublicApiAttributeFormat(DbcsAttrAt(gsl::narrow_cast<til::CoordType>(col)));
+        ++i;
+    }
+
+    // Convert the attributes once per run instead of once per cell.
+    size_t column = 0;
+    auto it = infos.begin();
+    for (const auto& run : _attr.runs())
+    {
+        const size_t runEnd = column + run.length;
+        if (runEnd > colBeg)
+        {
+            const auto count = std::min<size_t>(runEnd - std::max<size_t>(column, colBeg), infos.end() - it);
+            const auto attributes = run.value.GetLegacyAttributes();
+            for (const auto end = it + count; it != end; ++it)
+            {
+                it->Attributes |= attributes;
+            }
+            if (it == infos.end())
+            {
+                break;
+            }
+        }
+        column = runEnd;
+    }
+}
+
 void ROW::SetAttrToEnd(const til::CoordType columnBegin, const TextAttribute attr)
 {
     _attr.replace(_clampedColumnInclusive(columnBegin), _attr.size(), attr);
@@ -610,6 +872,17 @@ catch (...)
     }
 }
 
+// Writes each of the given characters into a column of its own, regardless of its actual width.
+// The WriteHelper must have been constructed with a columnLimit of columnBegin + chars.size().
+[[msvc::forceinline]] void ROW::WriteHelper::ReplaceNarrowCharacters() noexcept
+{
+    const auto count = std::min<size_t>(chars.size(), colLimit - colBeg);
+    iota_n(row._charOffsets.begin() + colBeg, count, chBeg);
+    colEnd = gsl::narrow_cast<uint16_t>(colBeg + count);
+    colEndDirty = colEnd;
+    charsConsumed = count;
+}
+
 void ROW::ReplaceText(RowWriteState& state)
 try
 {
@@ -957,19 +1230,6 @@ TextAttribute ROW::GetAttrByColumn(const til::CoordType column) const
     return _attr.at(_clampedColumn(column));
 }
 
-std::vector<uint16_t> ROW::GetHyperlinks() const
-{
-    std::vector<uint16_t> ids;
-    for (const auto& run : _attr.runs())
-    {
-        if (run.value.IsHyperlink())
-        {
-            ids.emplace_back(run.value.GetHyperlinkId());
-        }
-    }
-    return ids;
-}
-
 ImageSlice* ROW::SetImageSlice(ImageSlice::Pointer imageSlice) noexcept
 {
     _imageSlice = std::move(imageSlice);
@@ -139,6 +139,9 @@ public:
     til::CoordType GetReadableColumnCount() const noexcept;
 
     void Reset(const TextAttribute& attr) noexcept;
+    void ScheduleReset(const TextAttribute& attr) noexcept;
+    bool IsResetPending() const noexcept;
+    void FinishPendingReset() noexcept;
     void CopyFrom(const ROW& source);
 
     til::CoordType NavigateToPrevious(til::CoordType column) const noexcept;
@@ -148,6 +151,8 @@ public:
 
     void ClearCell(til::CoordType column);
     OutputCellIterator WriteCells(OutputCellIterator it, til::CoordType columnBegin, std::optional<bool> wrap = std::nullopt, std::optional<til::CoordType> limitRight = std::nullopt);
+    void WriteCharInfos(til::CoordType columnBegin, std::span<const CHAR_INFO> infos, std::optional<bool> wrap = std::nullopt);
+    void ReadCharInfos(til::CoordType columnBegin, std::span<CHAR_INFO> infos) const noexcept;
     void SetAttrToEnd(til::CoordType columnBegin, TextAttribute attr);
     void ReplaceAttributes(til::CoordType beginIndex, til::CoordType endIndex, const TextAttribute& newAttr);
     void ReplaceCharacters(til::CoordType columnBegin, til::CoordType width, const std::wstring_view& chars);
@@ -157,7 +162,6 @@ public:
     RowAttributes& Attributes() noexcept;
     const RowAttributes& Attributes() const noexcept;
     TextAttribute GetAttrByColumn(til::CoordType column) const;
-    std::vector<uint16_t> GetHyperlinks() const;
     ImageSlice* SetImageSlice(ImageSlice::Pointer imageSlice) noexcept;
     const ImageSlice* GetImageSlice() const noexcept;
     ImageSlice* GetMutableImageSlice() noexcept;
@@ -196,6 +200,7 @@ private:
         explicit WriteHelper(ROW& row, til::CoordType columnBegin, til::CoordType columnLimit, const std::wstring_view& chars) noexcept;
         bool IsValid() const noexcept;
         void ReplaceCharacters(til::CoordType width) noexcept;
+        void ReplaceNarrowCharacters() noexcept;
         void ReplaceText() noexcept;
         void _replaceTextUnicode(size_t ch, std::wstring_view::const_iterator it) noexcept;
         void CopyTextFrom(const std::span<const uint16_t>& charOffsets) noexcept;
@@ -259,6 +264,9 @@ private:
     T _adjustForward(T column) const noexcept;
 
     void _init() noexcept;
+    void _replaceCharInfos(til::CoordType columnBegin, std::span<const CHAR_INFO> infos);
+    static void _extractChars(wchar_t* dst, const CHAR_INFO* src, size_t count) noexcept;
+    static void _depositChars(CHAR_INFO* dst, const wchar_t* src, size_t count) noexcept;
     void _resizeChars(uint16_t colEndDirty, uint16_t chBegDirty, size_t chEndDirty, uint16_t chEndDirtyOld);
     CharToColumnMapper _createCharToColumnMapper(ptrdiff_t offset) const noexcept;
 
@@ -313,6 +321,8 @@ private:
     bool _wrapForced = false;
     // Occurs when the user runs out of text to support a double byte character and we're forced to the next line
     bool _doubleBytePadded = false;
+    // Set by ScheduleReset(). The text and everything but the attributes are stale until FinishPendingReset().
+    bool _resetPending = false;
 
     std::optional<ScrollbarData> _promptData = std::nullopt;
 
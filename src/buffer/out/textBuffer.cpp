@@ -129,7 +129,14 @@ void TextBuffer::_reserve(til::size screenBufferSize, const TextAttribute& defau
 // The compiler doesn't understand the likelihood of our branches. (PGO does, but that's imperfect.)
 __declspec(noinline) void TextBuffer::_commit(const std::byte* row)
 {
-    assert(row >= _commitWatermark);
+    // Const getters end up here too and they may run concurrently while the Terminal is only locked for reading.
+    const auto guard = _lazyInitLock.lock_exclusive();
+
+    // Someone else may have committed the row while we were waiting for the lock.
+    if (row < _commitWatermark)
+    {
+        return;
+    }
 
     const auto rowEnd = row + _bufferRowStride;
     const auto remaining = gsl::narrow_cast<uintptr_t>(_bufferEnd - _commitWatermark);
@@ -149,18 +156,33 @@ void TextBuffer::_decommit() noexcept
     _destroy();
     VirtualFree(_buffer.get(), 0, MEM_DECOMMIT);
     _commitWatermark = _buffer.get();
+    _markIndex.clear();
+    _dropDeferredReflow();
 }
 
 // Constructs ROWs between [_commitWatermark,until).
 void TextBuffer::_construct(const std::byte* until) noexcept
 {
-    for (; _commitWatermark < until; _commitWatermark += _bufferRowStride)
+    auto watermark = _commitWatermark;
+
+    for (; watermark < until; watermark += _bufferRowStride)
     {
-        const auto row = reinterpret_cast<ROW*>(_commitWatermark);
-        const auto chars = reinterpret_cast<wchar_t*>(_commitWatermark + _bufferOffsetChars);
-        const auto indices = reinterpret_cast<uint16_t*>(_commitWatermark + _bufferOffsetCharOffsets);
+        const auto row = reinterpret_cast<ROW*>(watermark);
+        const auto chars = reinterpret_cast<wchar_t*>(watermark + _bufferOffsetChars);
+        const auto indices = reinterpret_cast<uint16_t*>(watermark + _bufferOffsetCharOffsets);
         std::construct_at(row, chars, indices, _width, _initialAttributes);
     }
+
+    // Publish the new ROWs only once they're fully constructed. See _loadCommitWatermark().
+    std::atomic_ref{ _commitWatermark }.store(watermark, std::memory_order_release);
+}
+
+// Concurrent readers may commit more ROWs (see _commit()) and
+// so they need to read _commitWatermark with acquire semantics.
+std::byte* TextBuffer::_loadCommitWatermark() const noexcept
+{
+#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
+    return std::atomic_ref{ const_cast<std::byte*&>(_commitWatermark) }.load(std::memory_order_acquire);
 }
 
 // Destructs ROWs between [_buffer,_commitWatermark).
@@ -179,7 +201,7 @@ ROW& TextBuffer::_getRowByOffsetDirect(size_t offset)
     const auto row = _buffer.get() + _bufferRowStride * offset;
     THROW_HR_IF(E_UNEXPECTED, row < _buffer.get() || row >= _bufferEnd);
 
-    if (row >= _commitWatermark)
+    if (row >= _loadCommitWatermark())
     {
         _commit(row);
     }
@@ -203,7 +225,21 @@ ROW& TextBuffer::_getRow(til::CoordType y) const
     // We add 1 to the row offset, because row "0" is the one returned by GetScratchpadRow().
     // See GetScratchpadRow() for more explanation.
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
-    return const_cast<TextBuffer*>(this)->_getRowByOffsetDirect(gsl::narrow_cast<size_t>(offset) + 1);
+    auto& row = const_cast<TextBuffer*>(this)->_getRowByOffsetDirect(gsl::narrow_cast<size_t>(offset) + 1);
+
+    // IncrementCircularBuffer() only schedules the reset of the rows it recycles.
+    // The row's contents don't change from the caller's point of view, which is why this is fine in a const getter.
+    // Since other readers may get here at the same time, the reset is finished under _lazyInitLock.
+    if (row.IsResetPending()) [[unlikely]]
+    {
+        const auto guard = _lazyInitLock.lock_exclusive();
+        if (row.IsResetPending())
+        {
+            row.FinishPendingReset();
+        }
+    }
+
+    return row;
 }
 
 // Returns the "user-visible" index of the last committed row, which can be used
@@ -211,7 +247,7 @@ ROW& TextBuffer::_getRow(til::CoordType y) const
 // Returns 0 if no rows are committed in.
 til::CoordType TextBuffer::_estimateOffsetOfLastCommittedRow() const noexcept
 {
-    const auto lastRowOffset = (_commitWatermark - _buffer.get()) / _bufferRowStride;
+    const auto lastRowOffset = (_loadCommitWatermark() - _buffer.get()) / _bufferRowStride;
     // This subtracts 2 from the offset to account for the:
     // * scratchpad row at offset 0, whereas regular rows start at offset 1.
     // * fact that _commitWatermark points _past_ the last committed row,
@@ -227,7 +263,7 @@ bool TextBuffer::_isRowCommitted(til::CoordType y) const noexcept
         offset += _height;
     }
     const auto row = _buffer.get() + _bufferRowStride * offset;
-    return row < _commitWatermark;
+    return row < _loadCommitWatermark();
 }
 
 // Retrieves a row from the buffer by its offset from the first row of the text buffer
@@ -542,6 +578,7 @@ void TextBuffer::Replace(til::CoordType row, const TextAttribute& attributes, Ro
     r.ReplaceText(state);
     r.ReplaceAttributes(state.columnBegin, state.columnEnd, attributes);
     ImageSlice::EraseCells(r, state.columnBegin, state.columnEnd);
+    _hyperlinks.Touch(attributes.GetHyperlinkId(), _absoluteRow(row));
     TriggerRedraw(Viewport::FromExclusive({ state.columnBeginDirty, row, state.columnEndDirty, row + 1 }));
 }
 
@@ -554,6 +591,7 @@ void TextBuffer::Insert(til::CoordType row, const TextAttribute& attributes, Row
 
     r.ReplaceText(state);
     r.ReplaceAttributes(state.columnBegin, state.columnEnd, attributes);
+    _hyperlinks.Touch(attributes.GetHyperlinkId(), _absoluteRow(row));
 
     // Restore trailing text from our backup in scratch.
     RowWriteState restoreState{
@@ -630,6 +668,7 @@ void TextBuffer::FillRect(const til::rect& rect, const std::wstring_view& fill,
             r.CopyTextFrom(state);
             r.ReplaceAttributes(rect.left, rect.right, attributes);
             ImageSlice::EraseCells(r, rect.left, rect.right);
+            _hyperlinks.Touch(attributes.GetHyperlinkId(), _absoluteRow(y));
             TriggerRedraw(Viewport::FromExclusive({ state.columnBeginDirty, y, state.columnEndDirty, y + 1 }));
         }
     }
@@ -710,6 +749,9 @@ OutputCellIterator TextBuffer::WriteLine(const OutputCellIterator givenIt,
     //  Get the row and write the cells
     auto& row = GetMutableRowByOffset(target.y);
     const auto newIt = row.WriteCells(givenIt, target.x, wrap, limitRight);
+    // The cells may have been copied from elsewhere in the buffer (for instance when scrolling a
+    // rectangular area), in which case they can carry hyperlinks we need to keep alive.
+    _touchHyperlinks(row, target.y);
 
     // Take the cell distance written and notify that it needs to be repainted.
     const auto written = newIt.GetCellDistance(givenIt);
@@ -719,6 +761,43 @@ OutputCellIterator TextBuffer::WriteLine(const OutputCellIterator givenIt,
     return newIt;
 }
 
+// Routine Description:
+// - Writes a line of CHAR_INFOs to the output buffer. This is the same as calling WriteLine() with an
+//   OutputCellIterator over them, but considerably faster, because the row converts them in bulk.
+// Arguments:
+// - target - Coordinate targeted within output buffer
+// - infos - The cells to write. They're clipped to the end of the row.
+// - wrap - change the wrap flag if the write reaches the end of the row.
+void TextBuffer::WriteCharInfos(const til::point target, const std::span<const CHAR_INFO> infos, const std::optional<bool> wrap)
+{
+    if (infos.empty() || !GetSize().IsInBounds(target))
+    {
+        return;
+    }
+
+    auto& row = GetMutableRowByOffset(target.y);
+    row.WriteCharInfos(target.x, infos, wrap);
+
+    // CHAR_INFOs can't carry hyperlinks, so unlike WriteLine() there's nothing to _touchHyperlinks() here.
+    const auto written = std::min<til::CoordType>(gsl::narrow_cast<til::CoordType>(infos.size()), row.size() - target.x);
+    TriggerRedraw(Viewport::FromDimensions(target, { written, 1 }));
+}
+
+// Routine Description:
+// - Reads a line of cells as CHAR_INFOs, the same way CONSOLE_INFORMATION::AsCharInfo() converts them.
+// Arguments:
+// - target - Coordinate of the first cell to read
+// - infos - Receives the cells. Only as many are written as there are cells until the end of the row.
+void TextBuffer::ReadCharInfos(const til::point target, const std::span<CHAR_INFO> infos) const
+{
+    if (infos.empty() || !GetSize().IsInBounds(target))
+    {
+        return;
+    }
+
+    GetRowByOffset(target.y).ReadCharInfos(target.x, infos);
+}
+
 //Routine Description:
 // - Increments the circular buffer by one. Circular buffer is represented by FirstRow variable.
 //Arguments:
@@ -729,9 +808,19 @@ void TextBuffer::IncrementCircularBuffer(const TextAttribute& fillAttributes)
 {
     // Prune hyperlinks to delete obsolete references
     _PruneHyperlinks();
+    _recycledRowCount++;
 
     // Second, clean out the old "first row" as it will become the "last row" of the buffer after the circle is performed.
-    GetMutableRowByOffset(0).Reset(fillAttributes);
+    _unindexMarks(0, 0);
+    // The rows of a deferred reflow precede our first row. Recycling a row means that all of our rows are in use,
+    // so they would've been scrolled out by now, had they been reflowed right away. FinishDeferredReflow() with
+    // all rows in use keeps none of them either, which is why we can skip reflowing them and drop them instead.
+    _dropDeferredReflow();
+    // Clearing the row is deferred until it's accessed again (see _getRow()). While scrolling at full speed,
+    // for instance due to a run of empty lines or a multi-line scroll, many rows get recycled before they're used.
+    // We skip _getRow() here, so that a row whose reset is still pending from the last cycle doesn't get cleared twice.
+    _lastMutationId++;
+    _getRowByOffsetDirect(gsl::narrow_cast<size_t>(_firstRow) + 1).ScheduleReset(fillAttributes);
     {
         // Now proceed to increment.
         // Incrementing it will cause the next line down to become the new "top" of the window (the new "0" in logical coordinates)
@@ -879,6 +968,7 @@ void TextBuffer::CopyRow(const til::CoordType srcRowIndex, const til::CoordType
     const auto& srcRow = GetRowByOffset(srcRowIndex);
     dstRow.CopyFrom(srcRow);
     ImageSlice::CopyRow(srcRow, dstRow);
+    dstBuffer._touchHyperlinks(dstRow, dstRowIndex);
 }
 
 Cursor& TextBuffer::GetCursor() noexcept
@@ -998,6 +1088,9 @@ void TextBuffer::Reset() noexcept
 // - rowsToKeep: the number of rows to keep in the buffer.
 void TextBuffer::ClearScrollback(const til::CoordType newFirstRow, const til::CoordType rowsToKeep)
 {
+    // The rows of a deferred reflow are part of the scrollback, even if we don't have any ourselves.
+    _dropDeferredReflow();
+
     // We're already at the top? don't clear anything. There's no scrollback.
     if (newFirstRow <= 0)
     {
@@ -1020,6 +1113,8 @@ void TextBuffer::ClearScrollback(const til::CoordType newFirstRow, const til::Co
     // operates modulo the buffer height and so the possibly-too-large startAbsolute won't be an issue.
     const auto startAbsolute = _firstRow + newFirstRow;
     _firstRow = 0;
+    // The rows above newFirstRow are gone now, just like after IncrementCircularBuffer().
+    _recycledRowCount += newFirstRow;
     ScrollRows(startAbsolute, rowsToKeep, -startAbsolute);
 
     const auto end = _estimateOffsetOfLastCommittedRow();
@@ -1027,6 +1122,7 @@ void TextBuffer::ClearScrollback(const til::CoordType newFirstRow, const til::Co
     {
         GetMutableRowByOffset(y).Reset(_initialAttributes);
     }
+    _unindexMarks(rowsToKeep, end);
 }
 
 // Routine Description:
@@ -1052,6 +1148,9 @@ void TextBuffer::ResizeTraditional(til::size newSize)
         srcRow = cursorRow - newSize.height + 1;
     }
 
+    // The first srcRow rows get dropped, just like after IncrementCircularBuffer().
+    _recycledRowCount += srcRow;
+
     for (; dstRow < copyableRows; ++dstRow, ++srcRow)
     {
         CopyRow(srcRow, dstRow, newBuffer);
@@ -1067,6 +1166,9 @@ void TextBuffer::ResizeTraditional(til::size newSize)
     _bufferOffsetCharOffsets = newBuffer._bufferOffsetCharOffsets;
     _width = newBuffer._width;
     _height = newBuffer._height;
+    // CopyRow() doesn't copy ScrollbarData, so there are no marks left.
+    _markIndex.clear();
+    _dropDeferredReflow();
 
     _SetFirstRowIndex(0);
 }
@@ -1424,48 +1526,33 @@ til::point TextBuffer::_GetDelimiterClassRunEnd(til::point pos, const std::wstri
     return pos;
 }
 
-void TextBuffer::_PruneHyperlinks()
+void TextBuffer::_PruneHyperlinks() noexcept
 {
-    // Check the old first row for hyperlink references
-    // If there are any, search the entire buffer for the same reference
-    // If the buffer does not contain the same reference, we can remove that hyperlink from our map
-    // This way, obsolete hyperlink references are cleared from our hyperlink map instead of hanging around
-    // Get all the hyperlink references in the row we're erasing
-    const auto hyperlinks = GetRowByOffset(0).GetHyperlinks();
+    // The old first row is about to be recycled. Every hyperlink that wasn't written anywhere below it
+    // isn't referenced anymore, and _hyperlinks can find those without searching the buffer.
+    // The current attributes may hold a hyperlink that hasn't been written yet, so we need to keep that one alive.
+    _hyperlinks.Prune(_absoluteRow(0), _currentAttributes.GetHyperlinkId());
+}
 
-    if (!hyperlinks.empty())
-    {
-        // Move to unordered set so we can use hashed lookup of IDs instead of linear search.
-        // Only make it an unordered set now because set always heap allocates but vector
-        // doesn't when the set is empty (saving an allocation in the common case of no links.)
-        std::unordered_set<uint16_t> firstRowRefs{ hyperlinks.cbegin(), hyperlinks.cend() };
+int64_t TextBuffer::_absoluteRow(til::CoordType y) const noexcept
+{
+    return _recycledRowCount + y;
+}
 
-        const auto total = TotalRowCount();
-        // Loop through all the rows in the buffer except the first row -
-        // we have found all hyperlink references in the first row and put them in refs,
-        // now we need to search the rest of the buffer (i.e. all the rows except the first)
-        // to see if those references are anywhere else
-        for (til::CoordType i = 1; i < total; ++i)
-        {
-            const auto nextRowRefs = GetRowByOffset(i).GetHyperlinks();
-            for (auto id : nextRowRefs)
-            {
-                if (firstRowRefs.find(id) != firstRowRefs.end())
-                {
-                    firstRowRefs.erase(id);
-                }
-            }
-            if (firstRowRefs.empty())
-            {
-                // No more hyperlink references left to search for, terminate early
-                break;
-            }
-        }
+// Informs _hyperlinks that the hyperlinks in the given row are still in use.
+void TextBuffer::_touchHyperlinks(const ROW& row, til::CoordType y) noexcept
+{
+    if (_hyperlinks.Size() == 0)
+    {
+        return;
+    }
 
-        // Now delete obsolete references from our map
-        for (auto hyperlinkReference : firstRowRefs)
+    const auto absoluteRow = _absoluteRow(y);
+    for (const auto& run : row.Attributes().runs())
+    {
+        if (run.value.IsHyperlink())
         {
-            RemoveHyperlinkFromMap(hyperlinkReference);
+            _hyperlinks.Touch(run.value.GetHyperlinkId(), absoluteRow);
         }
     }
 }
@@ -1878,6 +1965,89 @@ std::tuple<til::CoordType, til::CoordType, bool> TextBuffer::_RowCopyHelper(cons
     return { rowBeg, rowEnd, addLineBreak };
 }
 
+// Routine Description:
+// - Appends the selected text of the given row to the output, followed by a line break if needed.
+// Arguments:
+// - req - the copy request
+// - iRow - the row index
+// - out - receives the text
+void TextBuffer::_AppendPlainTextRow(const CopyRequest& req, const til::CoordType iRow, std::wstring& out) const
+{
+    const auto& row = GetRowByOffset(iRow);
+    const auto& [rowBeg, rowEnd, addLineBreak] = _RowCopyHelper(req, iRow, row);
+
+    // save selected text (exclusive end)
+    out += row.GetText(rowBeg, rowEnd);
+
+    if (addLineBreak && iRow != req.end.y)
+    {
+        out += L"\r\n";
+    }
+}
+
+namespace
+{
+    // Accumulates the output of the TextBuffer::Serialize*() functions and hands it to their sink
+    // whenever it grows past SerializeChunkSize. The same buffer is reused for every chunk, so the
+    // peak memory usage is bounded by the chunk size and not by the size of the selection.
+    // The buffer grows on demand, so that small selections don't pay for an entire chunk up front.
+    template<typename T>
+    class SerializeChunker
+    {
+    public:
+        SerializeChunker(const TextBuffer& textBuffer, const TextBuffer::SerializeSink<T>& sink) :
+            _textBuffer{ textBuffer },
+            _sink{ sink },
+            _mutationId{ textBuffer.GetLastMutationId() }
+        {
+        }
+
+        std::basic_string<T>& Chunk() noexcept
+        {
+            return _chunk;
+        }
+
+        // Returns false if the serialization should be aborted.
+        bool Flush(const bool final)
+        {
+            if (_chunk.empty() || (!final && _chunk.size() < TextBuffer::SerializeChunkSize))
+            {
+                return true;
+            }
+
+            if (!_sink({ _chunk.data(), _chunk.size() }))
+            {
+                return false;
+            }
+
+            _chunk.clear();
+
+            // The chunk usually overshoots SerializeChunkSize by no more than a row. If a huge row
+            // blew up the capacity anyway, don't hold onto that memory for the remaining chunks.
+            if (_chunk.capacity() > 2 * TextBuffer::SerializeChunkSize)
+            {
+                _chunk = {};
+                _chunk.reserve(TextBuffer::SerializeChunkSize);
+            }
+
+            // The sink may have released the buffer lock. If someone modified the buffer
+            // in the meantime, the remaining rows aren't the ones the request referred to.
+            return final || _textBuffer.GetLastMutationId() == _mutationId;
+        }
+
+    private:
+        const TextBuffer& _textBuffer;
+        const TextBuffer::SerializeSink<T>& _sink;
+        std::basic_string<T> _chunk;
+        uint64_t _mutationId;
+    };
+
+    // The boilerplate around the HTML fragment required by the CF_HTML clipboard format.
+    // Their lengths determine the fragment offsets in the clipboard header.
+    constexpr std::string_view htmlDocumentHeader = "<!DOCTYPE><HTML><HEAD></HEAD><BODY>";
+    constexpr std::string_view htmlDocumentFooter = "</BODY></HTML>";
+}
+
 // Routine Description:
 // - Retrieves the text data from the buffer and presents it in a clipboard-ready format.
 // Arguments:
@@ -1885,29 +2055,50 @@ std::tuple<til::CoordType, til::CoordType, bool> TextBuffer::_RowCopyHelper(cons
 // Return Value:
 // - The text data from the selected region of the text buffer. Empty if the copy request is invalid.
 std::wstring TextBuffer::GetPlainText(const CopyRequest& req) const
+{
+    std::wstring selectedText;
+    if (req.beg > req.end)
+    {
+        return selectedText;
+    }
+
+    // Unlike SerializePlainText() this builds the result in place, without a chunk buffer in between.
+    for (auto iRow = req.beg.y; iRow <= req.end.y; ++iRow)
+    {
+        _AppendPlainTextRow(req, iRow, selectedText);
+    }
+
+    return selectedText;
+}
+
+// Routine Description:
+// - Same as GetPlainText(), but emits the text in chunks to the given sink.
+// Arguments:
+// - req - the copy request having the bounds of the selected region and other related configuration flags.
+// - sink - receives the text. May release the buffer lock while it's called.
+// Return Value:
+// - false if the serialization was aborted.
+bool TextBuffer::SerializePlainText(const CopyRequest& req, const SerializeSink<wchar_t>& sink) const
 {
     if (req.beg > req.end)
     {
-        return {};
+        return true;
     }
 
-    std::wstring selectedText;
+    SerializeChunker<wchar_t> chunker{ *this, sink };
+    auto& selectedText = chunker.Chunk();
 
     for (auto iRow = req.beg.y; iRow <= req.end.y; ++iRow)
     {
-        const auto& row = GetRowByOffset(iRow);
-        const auto& [rowBeg, rowEnd, addLineBreak] = _RowCopyHelper(req, iRow, row);
+        _AppendPlainTextRow(req, iRow, selectedText);
 
-        // save selected text (exclusive end)
-        selectedText += row.GetText(rowBeg, rowEnd);
-
-        if (addLineBreak && iRow != req.end.y)
+        if (!chunker.Flush(iRow == req.end.y))
         {
-            selectedText += L"\r\n";
+            return false;
         }
     }
 
-    return selectedText;
+    return true;
 }
 
 // Retrieves the text data from the buffer *with* ANSI escape code control sequences and presents it in
@@ -1918,13 +2109,29 @@ std::wstring TextBuffer::GetPlainText(const CopyRequest& req) const
 // - The text and control sequence data from the selected region of the text buffer. Empty if the copy request
 //      is invalid.
 std::wstring TextBuffer::GetWithControlSequences(const CopyRequest& req) const
+{
+    std::wstring selectedText;
+    SerializeWithControlSequences(req, [&](const std::wstring_view chunk) {
+        selectedText.append(chunk);
+        return true;
+    });
+    return selectedText;
+}
+
+// Same as GetWithControlSequences(), but emits the text in chunks to the given sink.
+// Arguments:
+// - req - the copy request having the bounds of the selected region and other related configuration flags.
+// - sink - receives the text. May release the buffer lock while it's called.
+// Return Value:
+// - false if the serialization was aborted.
+bool TextBuffer::SerializeWithControlSequences(const CopyRequest& req, const SerializeSink<wchar_t>& sink) const
 {
     if (req.beg > req.end)
     {
-        return {};
+        return true;
     }
 
-    std::wstring selectedText;
+    SerializeChunker<wchar_t> chunker{ *this, sink };
     std::optional<TextAttribute> previousTextAttr;
     bool delayedLineBreak = false;
 
@@ -1939,10 +2146,15 @@ std::wstring TextBuffer::GetWithControlSequences(const CopyRequest& req) const
         const bool isLastRow = currentRow == lastRow;
         const bool addLineBreak = reqAddLineBreak && !isLastRow;
 
-        _SerializeRow(row, startX, endX, addLineBreak, isLastRow, selectedText, previousTextAttr, delayedLineBreak);
+        _SerializeRow(row, startX, endX, addLineBreak, isLastRow, chunker.Chunk(), previousTextAttr, delayedLineBreak);
+
+        if (!chunker.Flush(isLastRow))
+        {
+            return false;
+        }
     }
 
-    return selectedText;
+    return true;
 }
 
 // Routine Description:
@@ -1963,10 +2175,6 @@ std::string TextBuffer::GenHTML(const CopyRequest& req,
                                 const bool isIntenseBold,
                                 std::function<std::tuple<COLORREF, COLORREF, COLORREF>(const TextAttribute&)> GetAttributeColors) const noexcept
 {
-    // GH#5347 - Don't provide a title for the generated HTML, as many
-    // web applications will paste the title first, followed by the HTML
-    // content, which is unexpected.
-
     if (req.beg > req.end)
     {
         return {};
@@ -1974,178 +2182,20 @@ std::string TextBuffer::GenHTML(const CopyRequest& req,
 
     try
     {
-        std::string htmlBuilder;
-
-        // First we have to add some standard HTML boiler plate required for
-        // CF_HTML as part of the HTML Clipboard format
-        constexpr std::string_view htmlHeader = "<!DOCTYPE><HTML><HEAD></HEAD><BODY>";
-        htmlBuilder += htmlHeader;
-
-        htmlBuilder += "<!--StartFragment -->";
-
-        // apply global style in div element
-        {
-            htmlBuilder += "<DIV STYLE=\"";
-            htmlBuilder += "display:inline-block;";
-            htmlBuilder += "white-space:pre;";
-            fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("background-color:{};"), Utils::ColorToHexString(backgroundColor));
-
-            // even with different font, add monospace as fallback
-            fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("font-family:'{}',monospace;"), til::u16u8(fontFaceName));
-
-            fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("font-size:{}pt;"), fontHeightPoints);
-
-            // note: MS Word doesn't support padding (in this way at least)
-            // todo: customizable padding
-            htmlBuilder += "padding:4px;";
-
-            htmlBuilder += "\">";
-        }
-
-        for (auto iRow = req.beg.y; iRow <= req.end.y; ++iRow)
-        {
-            const auto& row = GetRowByOffset(iRow);
-            const auto [rowBeg, rowEnd, addLineBreak] = _RowCopyHelper(req, iRow, row);
-            const auto rowBegU16 = gsl::narrow_cast<uint16_t>(rowBeg);
-            const auto rowEndU16 = gsl::narrow_cast<uint16_t>(rowEnd);
-            const auto runs = row.Attributes().slice(rowBegU16, rowEndU16).runs();
-
-            auto x = rowBegU16;
-            for (const auto& [attr, length] : runs)
-            {
-                const auto nextX = gsl::narrow_cast<uint16_t>(x + length);
-                const auto [fg, bg, ul] = GetAttributeColors(attr);
-                const auto fgHex = Utils::ColorToHexString(fg);
-                const auto bgHex = Utils::ColorToHexString(bg);
-                const auto ulHex = Utils::ColorToHexString(ul);
-                const auto ulStyle = attr.GetUnderlineStyle();
-                const auto isUnderlined = ulStyle != UnderlineStyle::NoUnderline;
-                const auto isCrossedOut = attr.IsCrossedOut();
-                const auto isOverlined = attr.IsOverlined();
-
-                htmlBuilder += "<SPAN STYLE=\"";
-                fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("color:{};"), fgHex);
-                fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("background-color:{};"), bgHex);
-
-                if (attr.IsBold(isIntenseBold))
-                {
-                    htmlBuilder += "font-weight:bold;";
-                }
-
-                if (attr.IsItalic())
-                {
-                    htmlBuilder += "font-style:italic;";
-                }
-
-                if (isCrossedOut || isOverlined)
-                {
-                    fmt::format_to(std::back_inserter(htmlBuilder),
-                                   FMT_COMPILE("text-decoration:{} {} {};"),
-                                   isCrossedOut ? "line-through" : "",
-                                   isOverlined ? "overline" : "",
-                                   fgHex);
-                }
-
-                if (isUnderlined)
-                {
-                    // Since underline, overline and strikethrough use the same css property,
-                    // we cannot apply different colors to them at the same time. However, we
-                    // can achieve the desired result by creating a nested <span> and applying
-                    // underline style and color to it.
-                    htmlBuilder += "\"><SPAN STYLE=\"";
-
-                    switch (ulStyle)
-                    {
-                    case UnderlineStyle::NoUnderline:
-                        break;
-                    case UnderlineStyle::DoublyUnderlined:
-                        fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline double {};"), ulHex);
-                        break;
-                    case UnderlineStyle::CurlyUnderlined:
-                        fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline wavy {};"), ulHex);
-                        break;
-                    case UnderlineStyle::DottedUnderlined:
-                        fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline dotted {};"), ulHex);
-                        break;
-                    case UnderlineStyle::DashedUnderlined:
-                        fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline dashed {};"), ulHex);
-                        break;
-                    case UnderlineStyle::SinglyUnderlined:
-                    default:
-                        fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline {};"), ulHex);
-                        break;
-                    }
-                }
-
-                htmlBuilder += "\">";
-
-                // text
-                std::string unescapedText;
-                THROW_IF_FAILED(til::u16u8(row.GetText(x, nextX), unescapedText));
-                for (const auto c : unescapedText)
-                {
-                    switch (c)
-                    {
-                    case '<':
-                        htmlBuilder += "&lt;";
-                        break;
-                    case '>':
-                        htmlBuilder += "&gt;";
-                        break;
-                    case '&':
-                        htmlBuilder += "&amp;";
-                        break;
-                    default:
-                        htmlBuilder += c;
-                    }
-                }
-
-                if (isUnderlined)
-                {
-                    // close the nested span we created for underline
-                    htmlBuilder += "</SPAN>";
-                }
-
-                htmlBuilder += "</SPAN>";
-
-                // advance to next run of text
-                x = nextX;
-            }
+        // The clipboard header contains the length of the document, which we only know at the end.
+        // Instead of prepending it (and copying the entire document once more), we reserve
+        // space for it upfront and overwrite it once we're done. Its length is fixed.
+        std::string html(HTMLClipboardHeaderSize, '\0');
 
-            // never add line break to the last row.
-            if (addLineBreak && iRow < req.end.y)
-            {
-                htmlBuilder += "<BR>";
-            }
-        }
-
-        htmlBuilder += "</DIV>";
-
-        htmlBuilder += "<!--EndFragment -->";
-
-        constexpr std::string_view HtmlFooter = "</BODY></HTML>";
-        htmlBuilder += HtmlFooter;
-
-        // once filled with values, there will be exactly 157 bytes in the clipboard header
-        constexpr size_t ClipboardHeaderSize = 157;
-
-        // these values are byte offsets from start of clipboard
-        const auto htmlStartPos = ClipboardHeaderSize;
-        const auto htmlEndPos = ClipboardHeaderSize + gsl::narrow<size_t>(htmlBuilder.length());
-        const auto fragStartPos = ClipboardHeaderSize + gsl::narrow<size_t>(htmlHeader.length());
-        const auto fragEndPos = htmlEndPos - HtmlFooter.length();
-
-        // header required by HTML 0.9 format
-        std::string clipHeaderBuilder;
-        clipHeaderBuilder += "Version:0.9\r\n";
-        fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("StartHTML:{:0>10}\r\n"), htmlStartPos);
-        fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("EndHTML:{:0>10}\r\n"), htmlEndPos);
-        fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("StartFragment:{:0>10}\r\n"), fragStartPos);
-        fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("EndFragment:{:0>10}\r\n"), fragEndPos);
-        fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("StartSelection:{:0>10}\r\n"), fragStartPos);
-        fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("EndSelection:{:0>10}\r\n"), fragEndPos);
+        SerializeHTML(req, fontHeightPoints, fontFaceName, backgroundColor, isIntenseBold, GetAttributeColors, [&](const std::string_view chunk) {
+            html.append(chunk);
+            return true;
+        });
 
-        return clipHeaderBuilder + htmlBuilder;
+        const auto header = GenHTMLClipboardHeader(html.size() - HTMLClipboardHeaderSize);
+        assert(header.size() == HTMLClipboardHeaderSize);
+        std::copy_n(header.data(), HTMLClipboardHeaderSize, html.data());
+        return html;
     }
     catch (...)
     {
@@ -2155,9 +2205,35 @@ std::string TextBuffer::GenHTML(const CopyRequest& req,
 }
 
 // Routine Description:
-// - Generates an RTF document from the selected region of the buffer
-//   RTF 1.5 Spec: https://www.biblioscape.com/rtf15_spec.htm
-//   RTF 1.9.1 Spec: https://msopenspecs.azureedge.net/files/Archive_References/[MSFT-RTF].pdf
+// - Generates the CF_HTML clipboard header for a document generated by SerializeHTML().
+// Arguments:
+// - htmlLength - the length of the entire document in bytes
+// Return Value:
+// - the header, which is always HTMLClipboardHeaderSize bytes long.
+std::string TextBuffer::GenHTMLClipboardHeader(const size_t htmlLength)
+{
+    // these values are byte offsets from start of clipboard
+    const auto htmlStartPos = HTMLClipboardHeaderSize;
+    const auto htmlEndPos = HTMLClipboardHeaderSize + htmlLength;
+    const auto fragStartPos = HTMLClipboardHeaderSize + htmlDocumentHeader.length();
+    const auto fragEndPos = htmlEndPos - htmlDocumentFooter.length();
+
+    // header required by HTML 0.9 format
+    std::string clipHeaderBuilder;
+    clipHeaderBuilder.reserve(HTMLClipboardHeaderSize);
+    clipHeaderBuilder += "Version:0.9\r\n";
+    fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("StartHTML:{:0>10}\r\n"), htmlStartPos);
+    fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("EndHTML:{:0>10}\r\n"), htmlEndPos);
+    fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("StartFragment:{:0>10}\r\n"), fragStartPos);
+    fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("EndFragment:{:0>10}\r\n"), fragEndPos);
+    fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("StartSelection:{:0>10}\r\n"), fragStartPos);
+    fmt::format_to(std::back_inserter(clipHeaderBuilder), FMT_COMPILE("EndSelection:{:0>10}\r\n"), fragEndPos);
+    return clipHeaderBuilder;
+}
+
+// Routine Description:
+// - Generates an HTML document from the selected region of the buffer and emits it in chunks to the given sink.
+//   The result lacks the CF_HTML clipboard header. See GenHTMLClipboardHeader().
 // Arguments:
 // - req - the copy request having the bounds of the selected region and other related configuration flags.
 // - fontHeightPoints - the unscaled font height
@@ -2165,183 +2241,215 @@ std::string TextBuffer::GenHTML(const CopyRequest& req,
 // - backgroundColor - default background color for characters, also used in padding
 // - isIntenseBold - true if being intense is treated as being bold
 // - GetAttributeColors - function to get the colors of the text attributes as they're rendered
+// - sink - receives the document. May release the buffer lock while it's called.
 // Return Value:
-// - string containing the generated RTF. Empty if the copy request is invalid.
-std::string TextBuffer::GenRTF(const CopyRequest& req,
+// - false if the serialization was aborted.
+bool TextBuffer::SerializeHTML(const CopyRequest& req,
                                const int fontHeightPoints,
                                const std::wstring_view fontFaceName,
                                const COLORREF backgroundColor,
                                const bool isIntenseBold,
-                               std::function<std::tuple<COLORREF, COLORREF, COLORREF>(const TextAttribute&)> GetAttributeColors) const noexcept
+                               const AttributeColorsFunc& GetAttributeColors,
+                               const SerializeSink<char>& sink) const
 {
+    // GH#5347 - Don't provide a title for the generated HTML, as many
+    // web applications will paste the title first, followed by the HTML
+    // content, which is unexpected.
+
     if (req.beg > req.end)
     {
-        return {};
+        return true;
     }
 
-    try
-    {
-        std::string rtfBuilder;
-
-        // start rtf
-        rtfBuilder += "{";
-
-        // Standard RTF header.
-        // This is similar to the header generated by WordPad.
-        // \ansi:
-        //   Specifies that the ANSI char set is used in the current doc.
-        // \ansicpg1252:
-        //   Represents the ANSI code page which is used to perform
-        //   the Unicode to ANSI conversion when writing RTF text.
-        // \deff0:
-        //   Specifies that the default font for the document is the one
-        //   at index 0 in the font table.
-        // \nouicompat:
-        //   Some features are blocked by default to maintain compatibility
-        //   with older programs (Eg. Word 97-2003). `nouicompat` disables this
-        //   behavior, and unblocks these features. See: Spec 1.9.1, Pg. 51.
-        rtfBuilder += "\\rtf1\\ansi\\ansicpg1252\\deff0\\nouicompat";
-
-        // font table
-        // Brace escape: add an extra brace (of same kind) after a brace to escape it within the format string.
-        fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("{{\\fonttbl{{\\f0\\fmodern\\fcharset0 {};}}}}"), til::u16u8(fontFaceName));
-
-        // map to keep track of colors:
-        // keys are colors represented by COLORREF
-        // values are indices of the corresponding colors in the color table
-        std::unordered_map<COLORREF, size_t> colorMap;
-
-        // RTF color table
-        std::string colorTableBuilder;
-        colorTableBuilder += "{\\colortbl ;";
-
-        const auto getColorTableIndex = [&](const COLORREF color) -> size_t {
-            // Exclude the 0 index for the default color, and start with 1.
-
-            const auto [it, inserted] = colorMap.emplace(color, colorMap.size() + 1);
-            if (inserted)
-            {
-                const auto red = static_cast<int>(GetRValue(color));
-                const auto green = static_cast<int>(GetGValue(color));
-                const auto blue = static_cast<int>(GetBValue(color));
-                fmt::format_to(std::back_inserter(colorTableBuilder), FMT_COMPILE("\\red{}\\green{}\\blue{};"), red, green, blue);
-            }
-            return it->second;
-        };
+    SerializeChunker<char> chunker{ *this, sink };
+    auto& htmlBuilder = chunker.Chunk();
 
-        // content
-        std::string contentBuilder;
+    // First we have to add some standard HTML boiler plate required for
+    // CF_HTML as part of the HTML Clipboard format
+    htmlBuilder += htmlDocumentHeader;
 
-        // \viewkindN: View mode of the document to be used. N=4 specifies that the document is in Normal view. (maybe unnecessary?)
-        // \ucN: Number of unicode fallback characters after each codepoint. (global)
-        contentBuilder += "\\viewkind4\\uc1";
+    htmlBuilder += "<!--StartFragment -->";
 
-        // paragraph styles
-        // \pard: paragraph description
-        // \slmultN: line-spacing multiple
-        // \fN: font to be used for the paragraph, where N is the font index in the font table
-        contentBuilder += "\\pard\\slmult1\\f0";
+    // apply global style in div element
+    {
+        htmlBuilder += "<DIV STYLE=\"";
+        htmlBuilder += "display:inline-block;";
+        htmlBuilder += "white-space:pre;";
+        fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("background-color:{};"), Utils::ColorToHexString(backgroundColor));
 
-        // \fsN: specifies font size in half-points. E.g. \fs20 results in a font
-        // size of 10 pts. That's why, font size is multiplied by 2 here.
-        fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\fs{}"), 2 * fontHeightPoints);
+        // even with different font, add monospace as fallback
+        fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("font-family:'{}',monospace;"), til::u16u8(fontFaceName));
 
-        // Set the background color for the page. But the standard way (\cbN) to do
-        // this isn't supported in Word. However, the following control words sequence
-        // works in Word (and other RTF editors also) for applying the text background
-        // color. See: Spec 1.9.1, Pg. 23.
-        fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\chshdng0\\chcbpat{}"), getColorTableIndex(backgroundColor));
+        fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("font-size:{}pt;"), fontHeightPoints);
 
-        for (auto iRow = req.beg.y; iRow <= req.end.y; ++iRow)
-        {
-            const auto& row = GetRowByOffset(iRow);
-            const auto [rowBeg, rowEnd, addLineBreak] = _RowCopyHelper(req, iRow, row);
-            const auto rowBegU16 = gsl::narrow_cast<uint16_t>(rowBeg);
-            const auto rowEndU16 = gsl::narrow_cast<uint16_t>(rowEnd);
-            const auto runs = row.Attributes().slice(rowBegU16, rowEndU16).runs();
+        // note: MS Word doesn't support padding (in this way at least)
+        // todo: customizable padding
+        htmlBuilder += "padding:4px;";
 
-            auto x = rowBegU16;
-            for (auto& [attr, length] : runs)
-            {
-                const auto nextX = gsl::narrow_cast<uint16_t>(x + length);
-                const auto [fg, bg, ul] = GetAttributeColors(attr);
-                const auto fgIdx = getColorTableIndex(fg);
-                const auto bgIdx = getColorTableIndex(bg);
-                const auto ulIdx = getColorTableIndex(ul);
-                const auto ulStyle = attr.GetUnderlineStyle();
+        htmlBuilder += "\">";
+    }
 
-                // start an RTF group that can be closed later to restore the
-                // default attribute.
-                contentBuilder += "{";
+    // Reused for every run of text, so that we don't allocate once per run.
+    std::string unescapedText;
 
-                fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\cf{}"), fgIdx);
-                fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\chshdng0\\chcbpat{}"), bgIdx);
+    for (auto iRow = req.beg.y; iRow <= req.end.y; ++iRow)
+    {
+        const auto& row = GetRowByOffset(iRow);
+        const auto [rowBeg, rowEnd, addLineBreak] = _RowCopyHelper(req, iRow, row);
+        const auto rowBegU16 = gsl::narrow_cast<uint16_t>(rowBeg);
+        const auto rowEndU16 = gsl::narrow_cast<uint16_t>(rowEnd);
+        const auto runs = row.Attributes().slice(rowBegU16, rowEndU16).runs();
 
-                if (attr.IsBold(isIntenseBold))
-                {
-                    contentBuilder += "\\b";
-                }
+        auto x = rowBegU16;
+        for (const auto& [attr, length] : runs)
+        {
+            const auto nextX = gsl::narrow_cast<uint16_t>(x + length);
+            const auto [fg, bg, ul] = GetAttributeColors(attr);
+            const auto fgHex = Utils::ColorToHexString(fg);
+            const auto bgHex = Utils::ColorToHexString(bg);
+            const auto ulHex = Utils::ColorToHexString(ul);
+            const auto ulStyle = attr.GetUnderlineStyle();
+            const auto isUnderlined = ulStyle != UnderlineStyle::NoUnderline;
+            const auto isCrossedOut = attr.IsCrossedOut();
+            const auto isOverlined = attr.IsOverlined();
+
+            htmlBuilder += "<SPAN STYLE=\"";
+            fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("color:{};"), fgHex);
+            fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("background-color:{};"), bgHex);
+
+            if (attr.IsBold(isIntenseBold))
+            {
+                htmlBuilder += "font-weight:bold;";
+            }
 
-                if (attr.IsItalic())
-                {
-                    contentBuilder += "\\i";
-                }
+            if (attr.IsItalic())
+            {
+                htmlBuilder += "font-style:italic;";
+            }
 
-                if (attr.IsCrossedOut())
-                {
-                    contentBuilder += "\\strike";
-                }
+            if (isCrossedOut || isOverlined)
+            {
+                fmt::format_to(std::back_inserter(htmlBuilder),
+                               FMT_COMPILE("text-decoration:{} {} {};"),
+                               isCrossedOut ? "line-through" : "",
+                               isOverlined ? "overline" : "",
+                               fgHex);
+            }
+
+            if (isUnderlined)
+            {
+                // Since underline, overline and strikethrough use the same css property,
+                // we cannot apply different colors to them at the same time. However, we
+                // can achieve the desired result by creating a nested <span> and applying
+                // underline style and color to it.
+                htmlBuilder += "\"><SPAN STYLE=\"";
 
                 switch (ulStyle)
                 {
                 case UnderlineStyle::NoUnderline:
                     break;
                 case UnderlineStyle::DoublyUnderlined:
-                    fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\uldb\\ulc{}"), ulIdx);
+                    fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline double {};"), ulHex);
                     break;
                 case UnderlineStyle::CurlyUnderlined:
-                    fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\ulwave\\ulc{}"), ulIdx);
+                    fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline wavy {};"), ulHex);
                     break;
                 case UnderlineStyle::DottedUnderlined:
-                    fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\uld\\ulc{}"), ulIdx);
+                    fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline dotted {};"), ulHex);
                     break;
                 case UnderlineStyle::DashedUnderlined:
-                    fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\uldash\\ulc{}"), ulIdx);
+                    fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline dashed {};"), ulHex);
                     break;
                 case UnderlineStyle::SinglyUnderlined:
                 default:
-                    fmt::format_to(std::back_inserter(contentBuilder), FMT_COMPILE("\\ul\\ulc{}"), ulIdx);
+                    fmt::format_to(std::back_inserter(htmlBuilder), FMT_COMPILE("text-decoration:underline {};"), ulHex);
                     break;
                 }
-
-                // RTF commands and the text data must be separated by a space.
-                // Otherwise, if the text begins with a space then that space will
-                // be interpreted as part of the last command, and will be lost.
-                contentBuilder += " ";
-
-                const auto unescapedText = row.GetText(x, nextX); // including character at nextX
-                _AppendRTFText(contentBuilder, unescapedText);
-
-                contentBuilder += "}"; // close RTF group
-
-                // advance to next run of text
-                x = nextX;
             }
 
-            // never add line break to the last row.
-            if (addLineBreak && iRow < req.end.y)
+            htmlBuilder += "\">";
+
+            // text
+            THROW_IF_FAILED(til::u16u8(row.GetText(x, nextX), unescapedText));
+            for (const auto c : unescapedText)
             {
-                contentBuilder += "\\line";
-            }
+                switch (c)
+                {
+                case '<':
+                    htmlBuilder += "&lt;";
+                    break;
+                case '>':
+                    htmlBuilder += "&gt;";
+                    break;
+                case '&':
+                    htmlBuilder += "&amp;";
+                    break;
+                default:
+                    htmlBuilder += c;
+                }
+            }
+
+            if (isUnderlined)
+            {
+                // close the nested span we created for underline
+                htmlBuilder += "</SPAN>";
+            }
+
+            htmlBuilder += "</SPAN>";
+
+            // advance to next run of text
+            x = nextX;
+        }
+
+        // never add line break to the last row.
+        if (addLineBreak && iRow < req.end.y)
+        {
+            htmlBuilder += "<BR>";
         }
 
-        // add color table to the final RTF
-        rtfBuilder += colorTableBuilder + "}";
+        if (!chunker.Flush(false))
+        {
+            return false;
+        }
+    }
+
+    htmlBuilder += "</DIV>";
 
-        // add the text content to the final RTF
-        rtfBuilder += contentBuilder + "}";
+    htmlBuilder += "<!--EndFragment -->";
 
-        return rtfBuilder;
+    htmlBuilder += htmlDocumentFooter;
+
+    return chunker.Flush(true);
+}
+
+// Routine Description:
+// - Generates an RTF document from the selected region of the buffer
+//   RTF 1.5 Spec: https://www.biblioscape.com/rtf15_spec.htm
+//   RTF 1.9.1 Spec: https://msopenspecs.azureedge.net/files/Archive_References/[MSFT-RTF].pdf
+// Arguments:
+// - req - the copy request having the bounds of the selected region and other related configuration flags.
+// - fontHeightPoints - the unscaled font height
+// - fontFaceName - the name of the font used
+// - backgroundColor - default background color for characters, also used in padding
+// - isIntenseBold - true if being intense is treated as being bold
+// - GetAttributeColors - function to get the colors of the text attributes as they're rendered
+// Return Value:
+// - string containing the generated RTF. Empty if the copy request is invalid.
+std::string TextBuffer::GenRTF(const CopyRequest& req,
+                               const int fontHeightPoints,
+                               const std::wstring_view fontFaceName,
+                               const COLORREF backgroundColor,
+                               const bool isIntenseBold,
+                               std::function<std::tuple<COLORREF, COLORREF, COLORREF>(const TextAttribute&)> GetAttributeColors) const noexcept
+{
+    try
+    {
+        std::string rtf;
+        SerializeRTF(req, fontHeightPoints, fontFaceName, backgroundColor, isIntenseBold, GetAttributeColors, [&](const std::string_view chunk) {
+            rtf.append(chunk);
+            return true;
+        });
+        return rtf;
     }
     catch (...)
     {
@@ -2350,6 +2458,221 @@ std::string TextBuffer::GenRTF(const CopyRequest& req,
     }
 }
 
+// Routine Description:
+// - Same as GenRTF(), but emits the document in chunks to the given sink.
+// Arguments:
+// - req - the copy request having the bounds of the selected region and other related configuration flags.
+// - fontHeightPoints - the unscaled font height
+// - fontFaceName - the name of the font used
+// - backgroundColor - default background color for characters, also used in padding
+// - isIntenseBold - true if being intense is treated as being bold
+// - GetAttributeColors - function to get the colors of the text attributes as they're rendered
+// - sink - receives the document. May release the buffer lock while it's called.
+// Return Value:
+// - false if the serialization was aborted.
+bool TextBuffer::SerializeRTF(const CopyRequest& req,
+                              const int fontHeightPoints,
+                              const std::wstring_view fontFaceName,
+                              const COLORREF backgroundColor,
+                              const bool isIntenseBold,
+                              const AttributeColorsFunc& GetAttributeColors,
+                              const SerializeSink<char>& sink) const
+{
+    if (req.beg > req.end)
+    {
+        return true;
+    }
+
+    // map to keep track of colors:
+    // keys are colors represented by COLORREF
+    // values are indices of the corresponding colors in the color table
+    std::unordered_map<COLORREF, size_t> colorMap;
+
+    // RTF color table
+    std::string colorTableBuilder;
+    colorTableBuilder += "{\\colortbl ;";
+
+    const auto addColor = [&](const COLORREF color) {
+        // Exclude the 0 index for the default color, and start with 1.
+
+        const auto [it, inserted] = colorMap.emplace(color, colorMap.size() + 1);
+        if (inserted)
+        {
+            const auto red = static_cast<int>(GetRValue(color));
+            const auto green = static_cast<int>(GetGValue(color));
+            const auto blue = static_cast<int>(GetBValue(color));
+            fmt::format_to(std::back_inserter(colorTableBuilder), FMT_COMPILE("\\red{}\\green{}\\blue{};"), red, green, blue);
+        }
+    };
+
+    // The color table precedes the content, but we don't want to hold onto the entire content until
+    // we know all colors. So we collect the colors in a separate, cheap pass over the attributes first.
+    addColor(backgroundColor);
+    for (auto iRow = req.beg.y; iRow <= req.end.y; ++iRow)
+    {
+        const auto& row = GetRowByOffset(iRow);
+        const auto [rowBeg, rowEnd, addLineBreak] = _RowCopyHelper(req, iRow, row);
+        const auto runs = row.Attributes().slice(gsl::narrow_cast<uint16_t>(rowBeg), gsl::narrow_cast<uint16_t>(rowEnd)).runs();
+
+        for (const auto& [attr, length] : runs)
+        {
+            const auto [fg, bg, ul] = GetAttributeColors(attr);
+            addColor(fg);
+            addColor(bg);
+            addColor(ul);
+        }
+    }
+
+    const auto getColorTableIndex = [&](const COLORREF color) -> size_t {
+        // The sink may release the buffer lock between chunks, during which the color scheme may change.
+        // The color table has already been emitted at that point, so fall back to index 0 (the default color).
+        const auto it = colorMap.find(color);
+        return it != colorMap.end() ? it->second : 0;
+    };
+
+    SerializeChunker<char> chunker{ *this, sink };
+    auto& rtfBuilder = chunker.Chunk();
+
+    // start rtf
+    rtfBuilder += "{";
+
+    // Standard RTF header.
+    // This is similar to the header generated by WordPad.
+    // \ansi:
+    //   Specifies that the ANSI char set is used in the current doc.
+    // \ansicpg1252:
+    //   Represents the ANSI code page which is used to perform
+    //   the Unicode to ANSI conversion when writing RTF text.
+    // \deff0:
+    //   Specifies that the default font for the document is the one
+    //   at index 0 in the font table.
+    // \nouicompat:
+    //   Some features are blocked by default to maintain compatibility
+    //   with older programs (Eg. Word 97-2003). `nouicompat` disables this
+    //   behavior, and unblocks these features. See: Spec 1.9.1, Pg. 51.
+    rtfBuilder += "\\rtf1\\ansi\\ansicpg1252\\deff0\\nouicompat";
+
+    // font table
+    // Brace escape: add an extra brace (of same kind) after a brace to escape it within the format string.
+    fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("{{\\fonttbl{{\\f0\\fmodern\\fcharset0 {};}}}}"), til::u16u8(fontFaceName));
+
+    // add color table to the final RTF
+    rtfBuilder += colorTableBuilder;
+    rtfBuilder += "}";
+
+    // \viewkindN: View mode of the document to be used. N=4 specifies that the document is in Normal view. (maybe unnecessary?)
+    // \ucN: Number of unicode fallback characters after each codepoint. (global)
+    rtfBuilder += "\\viewkind4\\uc1";
+
+    // paragraph styles
+    // \pard: paragraph description
+    // \slmultN: line-spacing multiple
+    // \fN: font to be used for the paragraph, where N is the font index in the font table
+    rtfBuilder += "\\pard\\slmult1\\f0";
+
+    // \fsN: specifies font size in half-points. E.g. \fs20 results in a font
+    // size of 10 pts. That's why, font size is multiplied by 2 here.
+    fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\fs{}"), 2 * fontHeightPoints);
+
+    // Set the background color for the page. But the standard way (\cbN) to do
+    // this isn't supported in Word. However, the following control words sequence
+    // works in Word (and other RTF editors also) for applying the text background
+    // color. See: Spec 1.9.1, Pg. 23.
+    fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\chshdng0\\chcbpat{}"), getColorTableIndex(backgroundColor));
+
+    for (auto iRow = req.beg.y; iRow <= req.end.y; ++iRow)
+    {
+        const auto& row = GetRowByOffset(iRow);
+        const auto [rowBeg, rowEnd, addLineBreak] = _RowCopyHelper(req, iRow, row);
+        const auto rowBegU16 = gsl::narrow_cast<uint16_t>(rowBeg);
+        const auto rowEndU16 = gsl::narrow_cast<uint16_t>(rowEnd);
+        const auto runs = row.Attributes().slice(rowBegU16, rowEndU16).runs();
+
+        auto x = rowBegU16;
+        for (auto& [attr, length] : runs)
+        {
+            const auto nextX = gsl::narrow_cast<uint16_t>(x + length);
+            const auto [fg, bg, ul] = GetAttributeColors(attr);
+            const auto fgIdx = getColorTableIndex(fg);
+            const auto bgIdx = getColorTableIndex(bg);
+            const auto ulIdx = getColorTableIndex(ul);
+            const auto ulStyle = attr.GetUnderlineStyle();
+
+            // start an RTF group that can be closed later to restore the
+            // default attribute.
+            rtfBuilder += "{";
+
+            fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\cf{}"), fgIdx);
+            fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\chshdng0\\chcbpat{}"), bgIdx);
+
+            if (attr.IsBold(isIntenseBold))
+            {
+                rtfBuilder += "\\b";
+            }
+
+            if (attr.IsItalic())
+            {
+                rtfBuilder += "\\i";
+            }
+
+            if (attr.IsCrossedOut())
+            {
+                rtfBuilder += "\\strike";
+            }
+
+            switch (ulStyle)
+            {
+            case UnderlineStyle::NoUnderline:
+                break;
+            case UnderlineStyle::DoublyUnderlined:
+                fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\uldb\\ulc{}"), ulIdx);
+                break;
+            case UnderlineStyle::CurlyUnderlined:
+                fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\ulwave\\ulc{}"), ulIdx);
+                break;
+            case UnderlineStyle::DottedUnderlined:
+                fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\uld\\ulc{}"), ulIdx);
+                break;
+            case UnderlineStyle::DashedUnderlined:
+                fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\uldash\\ulc{}"), ulIdx);
+                break;
+            case UnderlineStyle::SinglyUnderlined:
+            default:
+                fmt::format_to(std::back_inserter(rtfBuilder), FMT_COMPILE("\\ul\\ulc{}"), ulIdx);
+                break;
+            }
+
+            // RTF commands and the text data must be separated by a space.
+            // Otherwise, if the text begins with a space then that space will
+            // be interpreted as part of the last command, and will be lost.
+            rtfBuilder += " ";
+
+            const auto unescapedText = row.GetText(x, nextX); // including character at nextX
+            _AppendRTFText(rtfBuilder, unescapedText);
+
+            rtfBuilder += "}"; // close RTF group
+
+            // advance to next run of text
+            x = nextX;
+        }
+
+        // never add line break to the last row.
+        if (addLineBreak && iRow < req.end.y)
+        {
+            rtfBuilder += "\\line";
+        }
+
+        if (!chunker.Flush(false))
+        {
+            return false;
+        }
+    }
+
+    rtfBuilder += "}";
+
+    return chunker.Flush(true);
+}
+
 void TextBuffer::_AppendRTFText(std::string& contentBuilder, const std::wstring_view& text)
 {
     for (const auto codeUnit : text)
@@ -2386,6 +2709,26 @@ void TextBuffer::SerializeTo(HANDLE handle) const
     std::optional<TextAttribute> previousTextAttr;
     bool delayedLineBreak = false;
 
+    // The rows of a deferred reflow precede ours. They may not have our width yet,
+    // but that doesn't matter, because restoring the buffer reflows them anyway.
+    if (_deferredReflow)
+    {
+        for (til::CoordType currentRow = 0; currentRow < _deferredReflowRows; currentRow++)
+        {
+            const auto& row = _deferredReflow->GetRowByOffset(currentRow);
+            _deferredReflow->_SerializeRow(row, 0, row.GetReadableColumnCount(), !row.WasWrapForced(), false, buffer, previousTextAttr, delayedLineBreak);
+
+            if (buffer.size() >= writeThreshold)
+            {
+                const auto fileSize = gsl::narrow<DWORD>(buffer.size() * sizeof(wchar_t));
+                DWORD bytesWritten = 0;
+                THROW_IF_WIN32_BOOL_FALSE(WriteFile(handle, buffer.data(), fileSize, &bytesWritten, nullptr));
+                THROW_WIN32_IF_MSG(ERROR_WRITE_FAULT, bytesWritten != fileSize, "failed to write");
+                buffer.clear();
+            }
+        }
+    }
+
     const til::CoordType firstRow = 0;
     const til::CoordType lastRow = GetLastNonSpaceCharacter(nullptr).y;
 
@@ -2713,9 +3056,119 @@ void TextBuffer::_SerializeRow(const ROW& row, const til::CoordType startX, cons
 // - positionInfo - Optional. The caller can provide a pair of rows in this
 //   parameter and we'll calculate the position of the _end_ of those rows in
 //   the new buffer. The rows's new value is placed back into this parameter.
+// - firstRow - Optional. The rows above this one will be skipped. The caller
+//   is expected to pass the old buffer to DeferReflow() afterwards.
+//   This must be the start of a line (the row above must not be wrapped).
+void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Viewport* lastCharacterViewport, PositionInformation* positionInfo, til::CoordType firstRow)
+{
+    // There can only be one set of deferred rows, and they must directly precede the reflowed ones.
+    assert(firstRow == 0 || !oldBuffer._deferredReflow);
+
+    const auto newRows = _reflow(oldBuffer, newBuffer, lastCharacterViewport, positionInfo, firstRow, til::CoordTypeMax);
+
+    // If the old buffer had deferred rows, they still precede the rows we just reflowed,
+    // unless the new buffer was too small to fit all of them and some rows got dropped.
+    if (firstRow == 0 && newRows <= newBuffer._height)
+    {
+        newBuffer._deferredReflow = std::move(oldBuffer._deferredReflow);
+        newBuffer._deferredReflowRows = oldBuffer._deferredReflowRows;
+    }
+    oldBuffer._dropDeferredReflow();
+}
+
+// Routine Description:
+// - Makes the rows [0,rows) of oldBuffer precede the first row of this buffer. They're reflowed to the width of
+//   this buffer once FinishDeferredReflow() is called. Until then they aren't visible to any other method.
+// Arguments:
+// - oldBuffer - the buffer that was passed to Reflow()
+// - rows - the firstRow that was passed to Reflow()
+void TextBuffer::DeferReflow(std::unique_ptr<TextBuffer> oldBuffer, const til::CoordType rows) noexcept
+{
+    assert(!_deferredReflow && !oldBuffer->_deferredReflow);
+    oldBuffer->SetAsActiveBuffer(false);
+    _deferredReflow = std::move(oldBuffer);
+    _deferredReflowRows = rows;
+}
+
+bool TextBuffer::HasDeferredReflow() const noexcept
+{
+    return _deferredReflow != nullptr;
+}
+
+// Routine Description:
+// - Reflows the rows that were passed to DeferReflow() into newBuffer, followed by the rows of buffer.
+//   If they don't all fit, the oldest deferred rows are dropped, just like they would've been
+//   scrolled out of the buffer if they had been reflowed right away.
+// Arguments:
+// - buffer - the buffer with a deferred reflow
+// - newBuffer - an empty text buffer of the same size
+// - rowsInUse - the number of rows of buffer that must be retained. Usually the bottom of the viewport.
 // Return Value:
-// - S_OK if we successfully copied the contents to the new buffer; otherwise, an appropriate HRESULT.
-void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Viewport* lastCharacterViewport, PositionInformation* positionInfo)
+// - The offset by which the rows of buffer moved down in newBuffer.
+til::CoordType TextBuffer::FinishDeferredReflow(TextBuffer& buffer, TextBuffer& newBuffer, til::CoordType rowsInUse)
+{
+    assert(buffer._deferredReflow);
+    assert(buffer._width == newBuffer._width && buffer._height == newBuffer._height);
+
+    const auto height = newBuffer.GetSize().Height();
+    rowsInUse = std::clamp(rowsInUse, 0, height);
+
+    const auto copyRow = [&](const til::CoordType oldY, const til::CoordType newY) {
+        const auto& oldRow = buffer.GetRowByOffset(oldY);
+        auto& newRow = newBuffer.GetMutableRowByOffset(newY);
+        newRow.CopyFrom(oldRow);
+        ImageSlice::CopyRow(oldRow, newRow);
+        if (const auto& data = oldRow.GetScrollbarData())
+        {
+            newBuffer.SetScrollbarData(*data, newY);
+        }
+    };
+
+    const auto deferredRows = _reflow(*buffer._deferredReflow, newBuffer, nullptr, nullptr, 0, buffer._deferredReflowRows);
+    auto newY = std::min(deferredRows, height);
+
+    for (til::CoordType oldY = 0; oldY < rowsInUse; ++oldY, ++newY)
+    {
+        if (newY >= height)
+        {
+            newBuffer.IncrementCircularBuffer();
+            newY = height - 1;
+        }
+        copyRow(oldY, newY);
+    }
+
+    const auto offset = newY - rowsInUse;
+
+    // The rows below the ones in use are mostly blank, but may still carry attributes
+    // that we want to retain. See the similar loop at the end of _reflow().
+    const auto committedRows = buffer._estimateOffsetOfLastCommittedRow() + 1;
+    for (auto oldY = rowsInUse; oldY < committedRows && newY < height; ++oldY, ++newY)
+    {
+        copyRow(oldY, newY);
+    }
+
+    newBuffer.CopyProperties(buffer);
+    newBuffer.CopyHyperlinkMaps(buffer);
+
+    const auto& oldCursor = buffer.GetCursor();
+    auto& newCursor = newBuffer.GetCursor();
+    newCursor.SetSize(oldCursor.GetSize());
+    newCursor.SetPosition(oldCursor.GetPosition() + til::point{ 0, offset });
+
+    buffer._dropDeferredReflow();
+    return offset;
+}
+
+void TextBuffer::_dropDeferredReflow() noexcept
+{
+    _deferredReflow.reset();
+    _deferredReflowRows = 0;
+}
+
+// Reflows the rows [oldRowBegin,oldRowEnd) of oldBuffer into newBuffer. See Reflow().
+// Returns the number of rows that were written to newBuffer. If this exceeds its height,
+// only the last rows were retained and the first row is not the start of the old rows anymore.
+til::CoordType TextBuffer::_reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Viewport* lastCharacterViewport, PositionInformation* positionInfo, const til::CoordType oldRowBegin, const til::CoordType oldRowEnd)
 {
     const auto& oldCursor = oldBuffer.GetCursor();
     auto& newCursor = newBuffer.GetCursor();
@@ -2737,13 +3190,13 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
     auto mutableViewportTop = positionInfo ? positionInfo->mutableViewportTop : til::CoordTypeMax;
     auto visibleViewportTop = positionInfo ? positionInfo->visibleViewportTop : til::CoordTypeMax;
 
-    til::CoordType oldY = 0;
+    til::CoordType oldY = oldRowBegin;
     til::CoordType newY = 0;
     til::CoordType newX = 0;
     til::CoordType newWidth = newBuffer.GetSize().Width();
     til::CoordType newYLimit = til::CoordTypeMax;
 
-    const auto oldHeight = std::max(lastRowWithText, oldCursorPos.y) + 1;
+    const auto oldHeight = std::min(std::max(lastRowWithText, oldCursorPos.y) + 1, oldRowEnd);
     const auto newHeight = newBuffer.GetSize().Height();
     const auto newWidthU16 = gsl::narrow_cast<uint16_t>(newWidth);
 
@@ -2815,9 +3268,9 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
         //   mark on the row it started on.
         // * If the second row of a wrapped row had a mark, and it de-flows onto a
         //   single row, that's fine! The mark was on that logical row.
-        if (oldRow.GetScrollbarData().has_value())
+        if (const auto& data = oldRow.GetScrollbarData())
         {
-            newBuffer.GetMutableRowByOffset(newY).SetScrollbarData(oldRow.GetScrollbarData());
+            newBuffer.SetScrollbarData(*data, newY);
         }
 
         til::CoordType oldX = 0;
@@ -2924,7 +3377,7 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
     // printable character. This is to fix the `color 2f` scenario, where you
     // change the buffer colors then resize and everything below the last
     // printable char gets reset. See GH #12567
-    const auto initializedRowsEnd = oldBuffer._estimateOffsetOfLastCommittedRow() + 1;
+    const auto initializedRowsEnd = std::min(oldBuffer._estimateOffsetOfLastCommittedRow() + 1, oldRowEnd);
     for (; oldY < initializedRowsEnd && newY < newHeight; oldY++, newY++)
     {
         auto& oldRow = oldBuffer.GetRowByOffset(oldY);
@@ -2934,6 +3387,8 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
         newAttr.resize_trailing_extent(newWidthU16);
     }
 
+    const auto newRows = newY;
+
     // Since we didn't use IncrementCircularBuffer() we need to compute the proper
     // _firstRow offset now, in a way that replicates IncrementCircularBuffer().
     // We need to do the same for newCursorPos.y for basically the same reason.
@@ -2954,6 +3409,7 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
     assert(newCursorPos.y >= 0 && newCursorPos.y < newHeight);
     newCursor.SetSize(oldCursor.GetSize());
     newCursor.SetPosition(newCursorPos);
+    return newRows;
 }
 
 // Method Description:
@@ -2962,7 +3418,7 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
 // - The hyperlink URI, the hyperlink id (could be new or old)
 void TextBuffer::AddHyperlinkToMap(std::wstring_view uri, uint16_t id)
 {
-    _hyperlinkMap[id] = uri;
+    _hyperlinks.SetUri(id, uri);
 }
 
 // Method Description:
@@ -2970,10 +3426,10 @@ void TextBuffer::AddHyperlinkToMap(std::wstring_view uri, uint16_t id)
 // Arguments:
 // - The hyperlink ID
 // Return Value:
-// - The URI
+// - The URI, or an empty string if the ID is unknown
 std::wstring TextBuffer::GetHyperlinkUriFromId(uint16_t id) const
 {
-    return _hyperlinkMap.at(id);
+    return std::wstring{ _hyperlinks.GetUri(id) };
 }
 
 // Method description:
@@ -2984,33 +3440,8 @@ std::wstring TextBuffer::GetHyperlinkUriFromId(uint16_t id) const
 // - The internal hyperlink ID
 uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
 {
-    uint16_t numericId = 0;
-    if (id.empty())
-    {
-        // no custom id specified, return our internal count
-        numericId = _currentHyperlinkId;
-        ++_currentHyperlinkId;
-    }
-    else
-    {
-        // assign _currentHyperlinkId if the custom id does not already exist
-        std::wstring newId{ id };
-        // hash the URL and add it to the custom ID - GH#7698
-        newId += L"%" + std::to_wstring(til::hash(uri));
-        const auto result = _hyperlinkCustomIdMap.emplace(newId, _currentHyperlinkId);
-        if (result.second)
-        {
-            // the custom id did not already exist
-            ++_currentHyperlinkId;
-        }
-        numericId = (*(result.first)).second;
-    }
-    // _currentHyperlinkId could overflow, make sure its not 0
-    if (_currentHyperlinkId == 0)
-    {
-        ++_currentHyperlinkId;
-    }
-    return numericId;
+    // The hyperlink is going to be written at the cursor position.
+    return _hyperlinks.Acquire(uri, id, _absoluteRow(_cursor.GetPosition().y));
 }
 
 // Method Description:
@@ -3020,15 +3451,7 @@ uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
 // - The ID of the hyperlink to be removed
 void TextBuffer::RemoveHyperlinkFromMap(uint16_t id) noexcept
 {
-    _hyperlinkMap.erase(id);
-    for (const auto& customIdPair : _hyperlinkCustomIdMap)
-    {
-        if (customIdPair.second == id)
-        {
-            _hyperlinkCustomIdMap.erase(customIdPair.first);
-            break;
-        }
-    }
+    _hyperlinks.Remove(id);
 }
 
 // Method Description:
@@ -3040,26 +3463,27 @@ void TextBuffer::RemoveHyperlinkFromMap(uint16_t id) noexcept
 // - The custom ID if there was one, empty string otherwise
 std::wstring TextBuffer::GetCustomIdFromId(uint16_t id) const
 {
-    for (auto customIdPair : _hyperlinkCustomIdMap)
-    {
-        if (customIdPair.second == id)
-        {
-            return customIdPair.first;
-        }
-    }
-    return {};
+    return std::wstring{ _hyperlinks.GetCustomId(id) };
 }
 
 // Method Description:
-// - Copies the hyperlink/customID maps of the old buffer into this one,
-//   also copies currentHyperlinkId
+// - Copies the hyperlink/customID maps of the old buffer into this one
+// - Since the rows of this buffer don't necessarily correspond to those of the
+//   other buffer (e.g. after Reflow()), this rescans the rows for their hyperlinks.
 // Arguments:
 // - The other buffer
 void TextBuffer::CopyHyperlinkMaps(const TextBuffer& other)
 {
-    _hyperlinkMap = other._hyperlinkMap;
-    _hyperlinkCustomIdMap = other._hyperlinkCustomIdMap;
-    _currentHyperlinkId = other._currentHyperlinkId;
+    _hyperlinks = other._hyperlinks;
+
+    // Hyperlinks that we don't come across below are the ones that aren't referenced by any row anymore.
+    // Marking them as used above the first row ensures that the next IncrementCircularBuffer() prunes them.
+    _hyperlinks.ResetUsage(_absoluteRow(-1));
+    const auto bottom = _estimateOffsetOfLastCommittedRow();
+    for (til::CoordType y = 0; y <= bottom; ++y)
+    {
+        _touchHyperlinks(GetRowByOffset(y), y);
+    }
 }
 
 // Searches through the entire (committed) text buffer for `needle` and returns the coordinates in absolute coordinates.
@@ -3118,20 +3542,157 @@ std::optional<std::vector<til::point_span>> TextBuffer::SearchText(const std::ws
     return results;
 }
 
+// Maps the given row (relative to _firstRow) to the key used by _markIndex.
+til::CoordType TextBuffer::_markIndexKey(til::CoordType y) const noexcept
+{
+    auto key = (_firstRow + y) % _height;
+    if (key < 0)
+    {
+        key += _height;
+    }
+    return key;
+}
+
+// The inverse of _markIndexKey().
+til::CoordType TextBuffer::_markIndexRow(til::CoordType key) const noexcept
+{
+    return (key - _firstRow + _height) % _height;
+}
+
+// Records that the given row now has ScrollbarData.
+void TextBuffer::_indexMark(til::CoordType y)
+{
+    const auto key = _markIndexKey(y);
+    const auto it = std::lower_bound(_markIndex.begin(), _markIndex.end(), key);
+    if (it == _markIndex.end() || *it != key)
+    {
+        _markIndex.insert(it, key);
+    }
+}
+
+// Removes all entries for the rows between top and bottom (inclusive) from _markIndex.
+// This doesn't modify the ROWs themselves.
+void TextBuffer::_unindexMarks(til::CoordType top, til::CoordType bottom) noexcept
+{
+    top = std::max(0, top);
+    bottom = std::min(bottom, _height - 1);
+    if (top > bottom || _markIndex.empty())
+    {
+        return;
+    }
+
+    const auto erase = [&](til::CoordType lo, til::CoordType hi) noexcept {
+        const auto beg = std::lower_bound(_markIndex.begin(), _markIndex.end(), lo);
+        const auto end = std::upper_bound(beg, _markIndex.end(), hi);
+        _markIndex.erase(beg, end);
+    };
+
+    // The range [top, bottom] may wrap around the end of the underlying storage.
+    const auto lo = _markIndexKey(top);
+    const auto hi = _markIndexKey(bottom);
+    if (lo <= hi)
+    {
+        erase(lo, hi);
+    }
+    else
+    {
+        erase(lo, _height - 1);
+        erase(0, hi);
+    }
+}
+
+// Returns all rows between top and bottom (inclusive) that have ScrollbarData, in top-down order.
+// This costs O(log n + k) for k marks in the given range, instead of walking all rows.
+std::vector<til::CoordType> TextBuffer::_markRowsInRange(til::CoordType top, til::CoordType bottom) const
+{
+    std::vector<til::CoordType> rows;
+    top = std::max(0, top);
+    bottom = std::min(bottom, _height - 1);
+    if (top > bottom || _markIndex.empty())
+    {
+        return rows;
+    }
+
+    const auto collect = [&](til::CoordType lo, til::CoordType hi) {
+        for (auto it = std::lower_bound(_markIndex.begin(), _markIndex.end(), lo); it != _markIndex.end() && *it <= hi; ++it)
+        {
+            const auto y = _markIndexRow(*it);
+            // _markIndex may contain stale entries. See its declaration.
+            if (_isRowCommitted(y) && GetRowByOffset(y).GetScrollbarData().has_value())
+            {
+                rows.emplace_back(y);
+            }
+        }
+    };
+
+    // Since the keys are sorted by their physical offset, the logical top-down order
+    // starts at _firstRow, runs up to the end of the storage and then wraps around.
+    const auto lo = _markIndexKey(top);
+    const auto hi = _markIndexKey(bottom);
+    if (lo <= hi)
+    {
+        collect(lo, hi);
+    }
+    else
+    {
+        collect(lo, _height - 1);
+        collect(0, hi);
+    }
+    return rows;
+}
+
+// Returns the closest row at or above y that has ScrollbarData, if any.
+std::optional<til::CoordType> TextBuffer::_previousMarkRow(til::CoordType y) const
+{
+    y = std::min(y, _height - 1);
+    if (y < 0 || _markIndex.empty())
+    {
+        return std::nullopt;
+    }
+
+    // Walk backwards from y. The first pass covers the keys [_firstRow, key(y)] or
+    // [0, key(y)] if y wrapped around. The second pass covers the remaining wrapped part.
+    const auto walk = [&](til::CoordType lo, til::CoordType hi) -> std::optional<til::CoordType> {
+        auto it = std::upper_bound(_markIndex.begin(), _markIndex.end(), hi);
+        while (it != _markIndex.begin())
+        {
+            --it;
+            if (*it < lo)
+            {
+                break;
+            }
+            const auto row = _markIndexRow(*it);
+            if (_isRowCommitted(row) && GetRowByOffset(row).GetScrollbarData().has_value())
+            {
+                return row;
+            }
+        }
+        return std::nullopt;
+    };
+
+    const auto lo = _markIndexKey(0);
+    const auto hi = _markIndexKey(y);
+    if (lo <= hi)
+    {
+        return walk(lo, hi);
+    }
+    if (const auto row = walk(0, hi))
+    {
+        return row;
+    }
+    return walk(lo, _height - 1);
+}
+
 // Collect up all the rows that were marked, and the data marked on that row.
 // This is what should be used for hot paths, like updating the scrollbar.
 std::vector<ScrollMark> TextBuffer::GetMarkRows() const
 {
+    const auto rows = _markRowsInRange(0, _height - 1);
     std::vector<ScrollMark> marks;
-    const auto bottom = _estimateOffsetOfLastCommittedRow();
-    for (auto y = 0; y <= bottom; y++)
+    marks.reserve(rows.size());
+    for (const auto y : rows)
     {
-        const auto& row = GetRowByOffset(y);
-        const auto& data{ row.GetScrollbarData() };
-        if (data.has_value())
-        {
-            marks.emplace_back(y, *data);
-        }
+        marks.emplace_back(y, *GetRowByOffset(y).GetScrollbarData());
     }
     return marks;
 }
@@ -3139,8 +3700,9 @@ std::vector<ScrollMark> TextBuffer::GetMarkRows() const
 // Get all the regions for all the shell integration marks in the buffer.
 // Marks will be returned in top-down order.
 //
-// This possibly iterates over every run in the buffer, so don't do this on a
-// hot path. Just do this once per user input, if at all possible.
+// Finding the marks themselves is cheap thanks to _markIndex, but this possibly
+// iterates over every run between them, so don't do this on a hot path.
+// Just do this once per user input, if at all possible.
 //
 // Use `limit` to control how many you get, _starting from the bottom_. (e.g.
 // limit=1 will just give you the "most recent mark").
@@ -3153,16 +3715,12 @@ std::vector<MarkExtents> TextBuffer::GetMarkExtents(size_t limit) const
 
     std::vector<MarkExtents> marks{};
     const auto bottom = _estimateOffsetOfLastCommittedRow();
+    const auto promptRows = _markRowsInRange(0, bottom);
     auto lastPromptY = bottom;
-    for (auto promptY = bottom; promptY >= 0; promptY--)
+    for (auto it = promptRows.rbegin(); it != promptRows.rend(); ++it)
     {
-        const auto& currRow = GetRowByOffset(promptY);
-        auto& rowPromptData = currRow.GetScrollbarData();
-        if (!rowPromptData.has_value())
-        {
-            // This row didn't start a prompt, don't even look here.
-            continue;
-        }
+        const auto promptY = *it;
+        const auto& rowPromptData = GetRowByOffset(promptY).GetScrollbarData();
 
         // Future thought! In #11000 & #14792, we considered the possibility of
         // scrolling to only an error mark, or something like that. Perhaps in
@@ -3204,6 +3762,8 @@ void TextBuffer::ClearMarksInRange(
     auto top = std::clamp(std::min(start.y, end.y), 0, _height - 1);
     auto bottom = std::clamp(std::max(start.y, end.y), 0, _estimateOffsetOfLastCommittedRow());
 
+    _unindexMarks(top, bottom);
+
     for (auto y = top; y <= bottom; y++)
     {
         auto& row = GetMutableRowByOffset(y);
@@ -3381,21 +3941,12 @@ std::wstring TextBuffer::_commandForRow(const til::CoordType rowOffset,
 
 std::wstring TextBuffer::CurrentCommand() const
 {
-    auto promptY = GetCursor().GetPosition().y;
-    for (; promptY >= 0; promptY--)
+    if (const auto promptY = _previousMarkRow(GetCursor().GetPosition().y))
     {
-        const auto& currRow = GetRowByOffset(promptY);
-        auto& rowPromptData = currRow.GetScrollbarData();
-        if (!rowPromptData.has_value())
-        {
-            // This row didn't start a prompt, don't even look here.
-            continue;
-        }
-
         // This row did start a prompt! Find the prompt that starts here.
         // Presumably, no rows below us will have prompts, so pass in the last
         // row with text as the bottom
-        return _commandForRow(promptY, _estimateOffsetOfLastCommittedRow(), true);
+        return _commandForRow(*promptY, _estimateOffsetOfLastCommittedRow(), true);
     }
     return L"";
 }
@@ -3404,16 +3955,11 @@ std::vector<std::wstring> TextBuffer::Commands() const
 {
     std::vector<std::wstring> commands{};
     const auto bottom = _estimateOffsetOfLastCommittedRow();
+    const auto promptRows = _markRowsInRange(0, bottom);
     auto lastPromptY = bottom;
-    for (auto promptY = bottom; promptY >= 0; promptY--)
+    for (auto it = promptRows.rbegin(); it != promptRows.rend(); ++it)
     {
-        const auto& currRow = GetRowByOffset(promptY);
-        auto& rowPromptData = currRow.GetScrollbarData();
-        if (!rowPromptData.has_value())
-        {
-            // This row didn't start a prompt, don't even look here.
-            continue;
-        }
+        const auto promptY = *it;
 
         // This row did start a prompt! Find the prompt that starts here.
         // Presumably, no rows below us will have prompts, so pass in the last
@@ -3434,6 +3980,7 @@ void TextBuffer::StartPrompt()
     const auto currentRowOffset = GetCursor().GetPosition().y;
     auto& currentRow = GetMutableRowByOffset(currentRowOffset);
     currentRow.StartPrompt();
+    _indexMark(currentRowOffset);
 
     _currentAttributes.SetMarkAttributes(MarkKind::Prompt);
 }
@@ -3478,8 +4025,10 @@ bool TextBuffer::_createPromptMarkIfNeeded()
     //   --> add a new mark to this row, set all the attrs in this row
     //   to be Prompt, and set the current attrs to Output.
 
-    auto& row = GetMutableRowByOffset(GetCursor().GetPosition().y);
+    const auto y = GetCursor().GetPosition().y;
+    auto& row = GetMutableRowByOffset(y);
     row.StartPrompt();
+    _indexMark(y);
     return true;
 }
 
@@ -3502,15 +4051,9 @@ void TextBuffer::EndCurrentCommand(std::optional<unsigned int> error)
 {
     _currentAttributes.SetMarkAttributes(MarkKind::None);
 
-    for (auto y = GetCursor().GetPosition().y; y >= 0; y--)
+    if (const auto y = _previousMarkRow(GetCursor().GetPosition().y))
     {
-        auto& currRow = GetMutableRowByOffset(y);
-        auto& rowPromptData = currRow.GetScrollbarData();
-        if (rowPromptData.has_value())
-        {
-            currRow.EndOutput(error);
-            return;
-        }
+        GetMutableRowByOffset(*y).EndOutput(error);
     }
 }
 
@@ -3518,6 +4061,7 @@ void TextBuffer::SetScrollbarData(ScrollbarData mark, til::CoordType y)
 {
     auto& row = GetMutableRowByOffset(y);
     row.SetScrollbarData(mark);
+    _indexMark(y);
 }
 void TextBuffer::ManuallyMarkRowAsPrompt(til::CoordType y)
 {
@@ -50,6 +50,7 @@ filling in the last row, and updating the screen.
 #pragma once
 
 #include "cursor.h"
+#include "HyperlinkStore.hpp"
 #include "Row.hpp"
 #include "TextAttribute.hpp"
 #include "../types/inc/Viewport.hpp"
@@ -121,6 +122,9 @@ public:
                                  const std::optional<bool> setWrap = std::nullopt,
                                  const std::optional<til::CoordType> limitRight = std::nullopt);
 
+    void WriteCharInfos(til::point target, std::span<const CHAR_INFO> infos, std::optional<bool> wrap = std::nullopt);
+    void ReadCharInfos(til::point target, std::span<CHAR_INFO> infos) const;
+
     // Scroll needs access to this to quickly rotate around the buffer.
     void IncrementCircularBuffer(const TextAttribute& fillAttributes = {});
 
@@ -265,9 +269,21 @@ public:
         }
     };
 
+    // The Serialize*() functions hand their output to a sink in chunks of roughly SerializeChunkSize
+    // code units, instead of building the entire result in memory. The sink may release the buffer lock
+    // while it processes a chunk. If the buffer got modified in the meantime the serialization is aborted,
+    // because the CopyRequest coordinates may not be valid anymore. They return false if the serialization
+    // was aborted, either because of that, or because the sink returned false.
+    static constexpr size_t SerializeChunkSize = 64 * 1024;
+    template<typename T>
+    using SerializeSink = std::function<bool(std::basic_string_view<T>)>;
+    using AttributeColorsFunc = std::function<std::tuple<COLORREF, COLORREF, COLORREF>(const TextAttribute&)>;
+
     std::wstring GetPlainText(const CopyRequest& req) const;
+    bool SerializePlainText(const CopyRequest& req, const SerializeSink<wchar_t>& sink) const;
 
     std::wstring GetWithControlSequences(const CopyRequest& req) const;
+    bool SerializeWithControlSequences(const CopyRequest& req, const SerializeSink<wchar_t>& sink) const;
 
     std::string GenHTML(const CopyRequest& req,
                         const int fontHeightPoints,
@@ -276,6 +292,18 @@ public:
                         const bool isIntenseBold,
                         std::function<std::tuple<COLORREF, COLORREF, COLORREF>(const TextAttribute&)> GetAttributeColors) const noexcept;
 
+    // Unlike GenHTML() this doesn't include the CF_HTML clipboard header, because it depends on the length
+    // of the entire document. Prepend the result of GenHTMLClipboardHeader() once the document is complete.
+    bool SerializeHTML(const CopyRequest& req,
+                       const int fontHeightPoints,
+                       const std::wstring_view fontFaceName,
+                       const COLORREF backgroundColor,
+                       const bool isIntenseBold,
+                       const AttributeColorsFunc& GetAttributeColors,
+                       const SerializeSink<char>& sink) const;
+    static constexpr size_t HTMLClipboardHeaderSize = 157;
+    static std::string GenHTMLClipboardHeader(size_t htmlLength);
+
     std::string GenRTF(const CopyRequest& req,
                        const int fontHeightPoints,
                        const std::wstring_view fontFaceName,
@@ -283,6 +311,14 @@ public:
                        const bool isIntenseBold,
                        std::function<std::tuple<COLORREF, COLORREF, COLORREF>(const TextAttribute&)> GetAttributeColors) const noexcept;
 
+    bool SerializeRTF(const CopyRequest& req,
+                      const int fontHeightPoints,
+                      const std::wstring_view fontFaceName,
+                      const COLORREF backgroundColor,
+                      const bool isIntenseBold,
+                      const AttributeColorsFunc& GetAttributeColors,
+                      const SerializeSink<char>& sink) const;
+
     void SerializeTo(HANDLE handle) const;
 
     struct PositionInformation
@@ -291,7 +327,13 @@ public:
         til::CoordType visibleViewportTop{ 0 };
     };
 
-    static void Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Microsoft::Console::Types::Viewport* lastCharacterViewport = nullptr, PositionInformation* positionInfo = nullptr);
+    // Reflow() takes time proportional to the size of the scrollback. To keep resizing responsive, a caller may
+    // reflow only the rows starting at firstRow and then hand the old buffer to DeferReflow() of the new one.
+    // The rows above firstRow are reflowed by FinishDeferredReflow() once the size has settled down.
+    static void Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Microsoft::Console::Types::Viewport* lastCharacterViewport = nullptr, PositionInformation* positionInfo = nullptr, til::CoordType firstRow = 0);
+    void DeferReflow(std::unique_ptr<TextBuffer> oldBuffer, til::CoordType rows) noexcept;
+    bool HasDeferredReflow() const noexcept;
+    static til::CoordType FinishDeferredReflow(TextBuffer& buffer, TextBuffer& newBuffer, til::CoordType rowsInUse);
 
     std::optional<std::vector<til::point_span>> SearchText(const std::wstring_view& needle, SearchFlag flags) const;
     std::optional<std::vector<til::point_span>> SearchText(const std::wstring_view& needle, SearchFlag flags, til::CoordType rowBeg, til::CoordType rowEnd) const;
@@ -318,6 +360,7 @@ private:
     void _commit(const std::byte* row);
     void _decommit() noexcept;
     void _construct(const std::byte* until) noexcept;
+    std::byte* _loadCommitWatermark() const noexcept;
     void _destroy() const noexcept;
     ROW& _getRowByOffsetDirect(size_t offset);
     ROW& _getRow(til::CoordType y) const;
@@ -325,17 +368,28 @@ private:
     bool _isRowCommitted(til::CoordType y) const noexcept;
 
     void _SetFirstRowIndex(const til::CoordType FirstRowIndex) noexcept;
+    static til::CoordType _reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Microsoft::Console::Types::Viewport* lastCharacterViewport, PositionInformation* positionInfo, til::CoordType oldRowBegin, til::CoordType oldRowEnd);
+    void _dropDeferredReflow() noexcept;
     void _ExpandTextRow(til::inclusive_rect& selectionRow) const;
     DelimiterClass _GetDelimiterClassAt(const til::point pos, const std::wstring_view wordDelimiters) const;
     til::point _GetDelimiterClassRunStart(til::point pos, const std::wstring_view wordDelimiters, const bool accessibilityMode = false) const;
     til::point _GetDelimiterClassRunEnd(til::point pos, const std::wstring_view wordDelimiters, const bool accessibilityMode = false) const;
-    void _PruneHyperlinks();
+    void _PruneHyperlinks() noexcept;
+    int64_t _absoluteRow(til::CoordType y) const noexcept;
+    void _touchHyperlinks(const ROW& row, til::CoordType y) noexcept;
 
     std::wstring _commandForRow(const til::CoordType rowOffset, const til::CoordType bottomInclusive, const bool clipAtCursor = false) const;
     MarkExtents _scrollMarkExtentForRow(const til::CoordType rowOffset, const til::CoordType bottomInclusive) const;
     bool _createPromptMarkIfNeeded();
+    til::CoordType _markIndexKey(til::CoordType y) const noexcept;
+    til::CoordType _markIndexRow(til::CoordType key) const noexcept;
+    void _indexMark(til::CoordType y);
+    void _unindexMarks(til::CoordType top, til::CoordType bottom) noexcept;
+    std::vector<til::CoordType> _markRowsInRange(til::CoordType top, til::CoordType bottom) const;
+    std::optional<til::CoordType> _previousMarkRow(til::CoordType y) const;
 
     std::tuple<til::CoordType, til::CoordType, bool> _RowCopyHelper(const CopyRequest& req, const til::CoordType iRow, const ROW& row) const;
+    void _AppendPlainTextRow(const CopyRequest& req, const til::CoordType iRow, std::wstring& out) const;
 
     void _SerializeRow(const ROW& row, const til::CoordType startX, const til::CoordType endX, const bool addLineBreak, const bool isLastRow, std::wstring& buffer, std::optional<TextAttribute>& previousTextAttr, bool& delayedLineBreak) const;
 
@@ -343,9 +397,23 @@ private:
 
     Microsoft::Console::Render::Renderer* _renderer = nullptr;
 
-    std::unordered_map<uint16_t, std::wstring> _hyperlinkMap;
-    std::unordered_map<std::wstring, uint16_t> _hyperlinkCustomIdMap;
-    uint16_t _currentHyperlinkId = 1;
+    HyperlinkStore _hyperlinks;
+    // The number of rows that were recycled by IncrementCircularBuffer() (or otherwise scrolled out of the buffer).
+    // Adding it to a row offset yields a row number that stays stable while the circular buffer rotates,
+    // which is what _hyperlinks uses to figure out when a hyperlink isn't referenced anymore.
+    int64_t _recycledRowCount = 0;
+
+    // The sorted list of rows that (may) carry ScrollbarData. The entries are physical row offsets
+    // (= `(_firstRow + y) % _height`), because ROWs don't move in memory when the circular buffer
+    // rotates, which means that IncrementCircularBuffer() doesn't need to touch the other entries.
+    // It's allowed to contain stale entries (for instance for rows that got Reset() by a caller),
+    // which is why all readers verify that the ROW actually has ScrollbarData.
+    std::vector<til::CoordType> _markIndex;
+
+    // See DeferReflow(). The rows [0,_deferredReflowRows) of this old buffer logically precede our first row,
+    // but haven't been reflowed to our width yet. Anything that discards our scrollback discards them as well.
+    std::unique_ptr<TextBuffer> _deferredReflow;
+    til::CoordType _deferredReflowRows = 0;
 
     // This block describes the state of the underlying virtual memory buffer that holds all ROWs, text and attributes.
     // Initially memory is only allocated with MEM_RESERVE to reduce the private working set of conhost.
@@ -387,6 +455,9 @@ private:
     // There's probably a better metric than this. (This comment was written when ROW had both,
     // a _chars array containing text and a _charOffsets array contain column-to-text indices.)
     static constexpr size_t _commitReadAheadRowCount = 128;
+    // The Terminal allows multiple concurrent readers, but const getters like GetRowByOffset() lazily
+    // commit ROWs and finish pending resets. This lock serializes these (rare) slow paths.
+    mutable wil::srwlock _lazyInitLock;
     // Before TextBuffer was made to use virtual memory it initialized the entire memory arena with the initial
     // attributes right away. To ensure it continues to work the way it used to, this stores these initial attributes.
     TextAttribute _initialAttributes;
@@ -53,21 +53,22 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             nullptr));
 
         auto cmdline{ wil::ExpandEnvironmentStringsW<std::wstring>(_commandline.c_str()) }; // mutable copy -- required for CreateProcessW
-        auto environment = _initialEnv;
+        // The shared _initialEnv snapshot stays untouched. Our changes are stored on the side.
+        til::env_overlay environment{ _initialEnv };
 
         {
             // Ensure every connection has the unique identifier in the environment.
             // Convert connection Guid to string and ignore the enclosing '{}'.
-            environment.as_map().insert_or_assign(L"WT_SESSION", Utils::GuidToPlainString(_sessionId));
+            environment.set(L"WT_SESSION", Utils::GuidToPlainString(_sessionId));
 
             // The profile Guid does include the enclosing '{}'
-            environment.as_map().insert_or_assign(L"WT_PROFILE_ID", Utils::GuidToString(_profileGuid));
+            environment.set(L"WT_PROFILE_ID", Utils::GuidToString(_profileGuid));
 
             // WSLENV is a colon-delimited list of environment variables (+flags) that should appear inside WSL
             // https://devblogs.microsoft.com/commandline/share-environment-vars-between-wsl-and-windows/
 
-            // WSLENV.1: Get a handle to the WSLENV environment variable.
-            auto& wslEnv = environment.as_map()[L"WSLENV"];
+            // WSLENV.1: Get a copy of the WSLENV environment variable. It's written back in WSLENV.7.
+            std::wstring wslEnv{ environment.find(L"WSLENV").value_or(std::wstring_view{}) };
             std::wstring additionalWslEnv;
 
             // WSLENV.2: Figure out what variables are already in WSLENV.
@@ -125,6 +126,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 }
             }
 
+            // The custom environment variables above may have replaced WSLENV.
+            wslEnv = environment.find(L"WSLENV").value_or(std::wstring_view{});
+
             if (!additionalWslEnv.empty())
             {
                 // WSLENV.5: In the next step we'll prepend `additionalWslEnv` to `wslEnv`,
@@ -146,6 +150,9 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 // WSLENV.6: Prepend our additional environment variables to WSLENV.
                 wslEnv.insert(0, additionalWslEnv);
             }
+
+            // WSLENV.7: Store the updated WSLENV.
+            environment.set(L"WSLENV", std::move(wslEnv));
         }
 
         auto newEnvVars = environment.to_string();
@@ -297,22 +304,23 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             const auto& initialEnvironment{ unbox_prop_or<winrt::hstring>(settings, L"initialEnvironment", L"") };
             const bool reloadEnvironmentVariables = unbox_prop_or<bool>(settings, L"reloadEnvironmentVariables", false);
 
+            // These snapshots are cached and shared between all connections, as long as the environment doesn't change.
             if (reloadEnvironmentVariables)
             {
-                _initialEnv.regenerate();
+                _initialEnv = til::env_snapshot::regenerate();
             }
             else
             {
                 if (!initialEnvironment.empty())
                 {
-                    _initialEnv = til::env{ initialEnvironment.c_str() };
+                    _initialEnv = til::env_snapshot::from_block(initialEnvironment.c_str());
                 }
                 else
                 {
                     // If we were not explicitly provided an "initial" env block to
                     // treat as our original one, then just use our actual current
                     // env block.
-                    _initialEnv = til::env::from_current_environment();
+                    _initialEnv = til::env_snapshot::from_current_environment();
                 }
             }
         }
@@ -90,7 +90,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         DWORD _flags{ 0 };
 
-        til::env _initialEnv{};
+        std::shared_ptr<const til::env_snapshot> _initialEnv;
         guid _profileGuid{};
 
         struct StartupInfoFromDefTerm
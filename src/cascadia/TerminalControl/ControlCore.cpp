@@ -197,30 +197,52 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         const auto shared = _shared.lock();
         // Raises an OutputIdle event once there hasn't been any output for at least 100ms.
         // It also updates all regex patterns in the viewport.
+        // None of the timers below need to be precise. The slack lets them share a wakeup with
+        // other timers, for instance with those of other panes that received the same output.
+        // Since _refreshSizeUnderLock() triggers it as well, this is also where we usually
+        // finish reflowing the scrollback once the user stopped resizing the window.
         //
         // NOTE: Calling UpdatePatternLocations from a background
         // thread is a workaround for us to hit GH#12607 less often.
         shared->outputIdle = std::make_unique<til::throttled_func<>>(
             til::throttled_func_options{
                 .delay = std::chrono::milliseconds{ 100 },
+                .slack = std::chrono::milliseconds{ 50 },
                 .debounce = true,
                 .trailing = true,
             },
             [this, weakThis = get_weak(), dispatcher = _dispatcher]() {
+                // We can't use a `weak_ptr` to `_terminal` here, because it takes significant
+                // dependency on the lifetime of `this` (primarily on our `_renderer`).
+                // and a `weak_ptr` would allow it to outlive `this`.
+                // Theoretically `debounced_func_trailing` should call `WaitForThreadpoolTimerCallbacks()`
+                // with cancel=true on destruction, which should ensure that our use of `this` here is safe.
+                {
+                    const auto lock = _terminal->LockForWriting();
+                    _terminal->FinishDeferredReflow();
+                    _terminal->UpdatePatternsUnderLock();
+                }
+
+                // OutputIdle handlers search the buffer, so we raise it after the scrollback is complete again.
                 dispatcher.TryEnqueue(DispatcherQueuePriority::Normal, [weakThis]() {
                     if (const auto self = weakThis.get(); self && !self->_IsClosing())
                     {
                         self->OutputIdle.raise(*self, nullptr);
                     }
                 });
+            });
 
-                // We can't use a `weak_ptr` to `_terminal` here, because it takes significant
-                // dependency on the lifetime of `this` (primarily on our `_renderer`).
-                // and a `weak_ptr` would allow it to outlive `this`.
-                // Theoretically `debounced_func_trailing` should call `WaitForThreadpoolTimerCallbacks()`
-                // with cancel=true on destruction, which should ensure that our use of `this` here is safe.
+        // outputIdle never fires while the output keeps streaming in, which would leave the scrollback
+        // hidden indefinitely after a resize. This one isn't debounced and bounds that wait instead.
+        shared->finishReflow = std::make_unique<til::throttled_func<>>(
+            til::throttled_func_options{
+                .delay = std::chrono::milliseconds{ 500 },
+                .slack = std::chrono::milliseconds{ 250 },
+                .trailing = true,
+            },
+            [this]() {
                 const auto lock = _terminal->LockForWriting();
-                _terminal->UpdatePatternsUnderLock();
+                _terminal->FinishDeferredReflow();
             });
 
         // If you rapidly show/hide Windows Terminal, something about GotFocus()/LostFocus() gets broken.
@@ -228,6 +250,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         shared->focusChanged = std::make_unique<til::throttled_func<bool>>(
             til::throttled_func_options{
                 .delay = std::chrono::milliseconds{ 25 },
+                .slack = std::chrono::milliseconds{ 25 },
                 .debounce = true,
                 .trailing = true,
             },
@@ -242,6 +265,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             _dispatcher,
             til::throttled_func_options{
                 .delay = std::chrono::milliseconds{ 8 },
+                .slack = std::chrono::milliseconds{ 8 },
                 .trailing = true,
             },
             [weakThis = get_weak()](const auto& update) {
@@ -289,6 +313,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // we're re-attached to a new control (on a possibly new UI thread).
         const auto shared = _shared.lock();
         shared->outputIdle.reset();
+        shared->finishReflow.reset();
         shared->updateScrollBar.reset();
     }
 
@@ -554,7 +579,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         TerminalInput::OutputType out;
         {
-            const auto lock = _terminal->LockForReading();
+            const auto lock = _terminal->LockForWriting();
             out = _terminal->SendCharEvent(ch, scanCode, modifiers);
         }
         if (out)
@@ -731,7 +756,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     {
         TerminalInput::OutputType out;
         {
-            const auto lock = _terminal->LockForReading();
+            const auto lock = _terminal->LockForWriting();
             out = _terminal->SendMouseEvent(viewportPos, uiButton, states, wheelDelta, state);
         }
         if (out)
@@ -748,7 +773,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             // This is a scroll event that wasn't initiated by the terminal
             //      itself - it was initiated by the mouse wheel, or the scrollbar.
             const auto lock = _terminal->LockForWriting();
-            _terminal->UserScrollViewport(viewTop);
+            // The user may be scrolling up into the scrollback that a resize hasn't reflowed yet.
+            // Finishing the reflow moves the contents down, and viewTop along with them.
+            const auto offset = _terminal->FinishDeferredReflow();
+            _terminal->UserScrollViewport(viewTop + offset);
         }
 
         // GH#20219: re-evaluate if we're hovering over a hyperlink after scrolling
@@ -1044,7 +1072,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
     void ControlCore::ApplyPreviewColorScheme(const Core::ICoreScheme& scheme)
     {
-        const auto lock = _terminal->LockForReading();
+        const auto lock = _terminal->LockForWriting();
         auto& renderSettings = _terminal->GetRenderSettings();
         if (!_stashedColorScheme)
         {
@@ -1247,7 +1275,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         // If this function succeeds with S_FALSE, then the terminal didn't
         // actually change size. No need to notify the connection of this no-op.
-        const auto hr = _terminal->UserResize({ vp.Width(), vp.Height() });
+        // Reflowing a large scrollback on every step while the user drags the window border is slow.
+        // We defer it until the size has settled down. See the outputIdle and finishReflow callbacks.
+        const auto hr = _terminal->UserResize({ vp.Width(), vp.Height() }, true);
         if (FAILED(hr) || hr == S_FALSE)
         {
             return;
@@ -1266,6 +1296,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         {
             (*shared->outputIdle)();
         }
+        if (shared->finishReflow)
+        {
+            (*shared->finishReflow)();
+        }
     }
 
     void ControlCore::SizeChanged(const float width,
@@ -1311,6 +1345,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void ControlCore::SetSelectionAnchor(const til::point position)
     {
         const auto lock = _terminal->LockForWriting();
+        _terminal->FinishDeferredReflow();
         _terminal->SetSelectionAnchor(position);
     }
 
@@ -1406,6 +1441,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void ControlCore::SelectAll()
     {
         const auto lock = _terminal->LockForWriting();
+        _terminal->FinishDeferredReflow();
         _terminal->SelectAll();
         _updateSelectionUI();
     }
@@ -1435,6 +1471,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void ControlCore::ToggleMarkMode()
     {
         const auto lock = _terminal->LockForWriting();
+        _terminal->FinishDeferredReflow();
         _terminal->ToggleMarkMode();
         _updateSelectionUI();
     }
@@ -1776,6 +1813,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     SearchResults ControlCore::Search(const SearchRequest& request)
     {
         const auto lock = _terminal->LockForWriting();
+        _terminal->FinishDeferredReflow();
 
         SearchFlag flags{};
         WI_SetFlagIf(flags, SearchFlag::CaseInsensitive, !request.CaseSensitive);
@@ -2081,6 +2119,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                                           bool& selectionNeedsToBeCopied)
     {
         const auto lock = _terminal->LockForWriting();
+        _terminal->FinishDeferredReflow();
         // handle ALT key
         _terminal->SetBlockSelection(altEnabled);
 
@@ -2599,7 +2638,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
     void ControlCore::AddMark(const Control::ScrollMark& mark)
     {
-        const auto lock = _terminal->LockForReading();
+        const auto lock = _terminal->LockForWriting();
         ::ScrollbarData m{};
 
         if (mark.Color.HasValue)
@@ -2628,6 +2667,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void ControlCore::ScrollToMark(const Control::ScrollToMarkDirection& direction)
     {
         const auto lock = _terminal->LockForWriting();
+        _terminal->FinishDeferredReflow();
         const auto currentOffset = ScrollOffset();
         const auto& marks{ _terminal->GetMarkExtents() };
 
@@ -2738,6 +2778,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void ControlCore::SelectCommand(const bool goUp)
     {
         const auto lock = _terminal->LockForWriting();
+        _terminal->FinishDeferredReflow();
 
         const til::point start = _terminal->IsSelectionActive() ? (goUp ? _terminal->GetSelectionAnchor() : _terminal->GetSelectionEnd()) :
                                                                   _terminal->GetTextBuffer().GetCursor().GetPosition();
@@ -2780,6 +2821,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     void ControlCore::SelectOutput(const bool goUp)
     {
         const auto lock = _terminal->LockForWriting();
+        _terminal->FinishDeferredReflow();
 
         const til::point start = _terminal->IsSelectionActive() ? (goUp ? _terminal->GetSelectionAnchor() : _terminal->GetSelectionEnd()) :
                                                                   _terminal->GetTextBuffer().GetCursor().GetPosition();
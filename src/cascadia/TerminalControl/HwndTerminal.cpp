@@ -825,7 +825,7 @@ try
 
     TerminalInput::OutputType out;
     {
-        const auto lock = _terminal->LockForReading();
+        const auto lock = _terminal->LockForWriting();
         out = _terminal->SendMouseEvent(cursorPosition / fontSize, uMsg, getControlKeyState(), wheelDelta, state);
     }
     if (out)
@@ -861,7 +861,7 @@ try
 
     TerminalInput::OutputType out;
     {
-        const auto lock = _terminal->LockForReading();
+        const auto lock = _terminal->LockForWriting();
         out = _terminal->SendKeyEvent(vkey, scanCode, modifiers, keyDown);
     }
     if (out)
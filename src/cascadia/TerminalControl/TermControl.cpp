@@ -4038,7 +4038,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         VisualStateManager::GoToState(*this, !_quickFixButtonCollapsible ? StateNormal : StateCollapsed, false);
 
         const auto rd = get_self<ControlCore>(_core)->GetRenderData();
-        rd->LockConsole();
+        rd->LockConsoleShared();
         const auto viewportBufferPosition = rd->GetViewport();
         rd->UnlockConsole();
         if (_quickFixBufferPos < viewportBufferPosition.Top() || _quickFixBufferPos > viewportBufferPosition.BottomInclusive())
@@ -24,6 +24,10 @@ using namespace Microsoft::Console::VirtualTerminal;
 
 using PointTree = interval_tree::IntervalTree<til::point, size_t>;
 
+// UserResize() only defers the reflow of the scrollback if it's at least this long.
+// Anything shorter reflows in well under a millisecond.
+static constexpr til::CoordType minDeferredReflowRows = 1000;
+
 #pragma warning(suppress : 26455) // default constructor is throwing, too much effort to rearrange at this time.
 Terminal::Terminal()
 {
@@ -290,6 +294,22 @@ std::wstring_view Terminal::GetWorkingDirectory() noexcept
 //      nothing to do (the viewportSize is the same as our current size), or an
 //      appropriate HRESULT for failing to resize.
 [[nodiscard]] HRESULT Terminal::UserResize(const til::size viewportSize) noexcept
+{
+    return UserResize(viewportSize, false);
+}
+
+// Method Description:
+// - Same as UserResize(viewportSize), but optionally only reflows the visible part of the buffer.
+//   This keeps resizing responsive with a large scrollback, for instance while the user drags the
+//   window border. The caller must call FinishDeferredReflow() once the size has settled down,
+//   as well as before anything that needs the scrollback, like scrolling, searching or selecting.
+//   Until then the scrollback above the viewport is missing.
+// Arguments:
+// - viewportSize: the new size of the viewport, in chars
+// - deferScrollbackReflow: if true, the reflow of the scrollback may be deferred.
+// Return Value:
+// - See UserResize(viewportSize).
+[[nodiscard]] HRESULT Terminal::UserResize(const til::size viewportSize, const bool deferScrollbackReflow) noexcept
 try
 {
     const auto oldDimensions = _GetMutableViewport().Dimensions();
@@ -347,7 +367,25 @@ try
         .visibleViewportTop = _VisibleStartIndex(),
     };
 
-    TextBuffer::Reflow(*_mainBuffer.get(), *newTextBuffer.get(), &_mutableViewport, &positionInfo);
+    // If we're asked to defer the reflow of the scrollback, we only reflow the rows starting at the top of the
+    // viewport. They must begin on a new line, which is why we may have to go up a bit further. Below a certain
+    // size of the scrollback a full reflow is fast enough. The same applies if there are rows whose reflow is
+    // still pending from a previous call: Since they precede the rows in our buffer, we simply keep them pending.
+    til::CoordType deferredRows = 0;
+    if (deferScrollbackReflow && !_mainBuffer->HasDeferredReflow())
+    {
+        deferredRows = std::min({ positionInfo.mutableViewportTop, positionInfo.visibleViewportTop, _mainBuffer->GetCursor().GetPosition().y });
+        while (deferredRows > 0 && _mainBuffer->GetRowByOffset(deferredRows - 1).WasWrapForced())
+        {
+            deferredRows--;
+        }
+        if (deferredRows < minDeferredReflowRows)
+        {
+            deferredRows = 0;
+        }
+    }
+
+    TextBuffer::Reflow(*_mainBuffer.get(), *newTextBuffer.get(), &_mutableViewport, &positionInfo, deferredRows);
 
     // Restore the active text attributes
     newTextBuffer->SetCurrentAttributes(_mainBuffer->GetCurrentAttributes());
@@ -456,6 +494,11 @@ try
 
     _mainBuffer.swap(newTextBuffer);
 
+    if (deferredRows > 0)
+    {
+        _mainBuffer->DeferReflow(std::move(newTextBuffer), deferredRows);
+    }
+
     // GH#3494: Maintain scrollbar position during resize
     // Make sure that we don't scroll past the mutableViewport at the bottom of the buffer
     auto newVisibleTop = std::min(positionInfo.visibleViewportTop, _mutableViewport.Top());
@@ -472,6 +515,54 @@ try
 }
 CATCH_RETURN()
 
+// Method Description:
+// - Reflows the scrollback that UserResize() deferred, if any.
+//   Output may be written in the meantime. If it recycles rows before this gets called,
+//   TextBuffer::IncrementCircularBuffer() drops the deferred rows the same way we'd drop them here.
+// Return Value:
+// - The number of rows by which the contents of the main buffer moved down.
+til::CoordType Terminal::FinishDeferredReflow()
+{
+    _assertLocked();
+
+    if (!_mainBuffer->HasDeferredReflow())
+    {
+        return 0;
+    }
+
+    auto newTextBuffer = std::make_unique<TextBuffer>(_mainBuffer->GetSize().Dimensions(),
+                                                      TextAttribute{},
+                                                      0,
+                                                      _mainBuffer->IsActiveBuffer(),
+                                                      _mainBuffer->GetRenderer());
+
+    // Everything up to the bottom of the viewport must be retained, just like UserResize() does.
+    const auto rowsInUse = std::max(_mutableViewport.BottomExclusive(), _mainBuffer->GetCursor().GetPosition().y + 1);
+    const auto offset = TextBuffer::FinishDeferredReflow(*_mainBuffer, *newTextBuffer, rowsInUse);
+    newTextBuffer->SetCurrentAttributes(_mainBuffer->GetCurrentAttributes());
+    _mainBuffer.swap(newTextBuffer);
+
+    // The scrollback grew above us, so everything moved down by `offset` rows.
+    // _scrollOffset is relative to the mutable viewport and remains unchanged.
+    _mutableViewport = Viewport::FromDimensions({ 0, _mutableViewport.Top() + offset }, _mutableViewport.Dimensions());
+
+    if (!_inAltBuffer())
+    {
+        if (_selection->active)
+        {
+            auto selection = _selection.write();
+            selection->start.y += offset;
+            selection->end.y += offset;
+            selection->pivot.y += offset;
+        }
+
+        _mainBuffer->TriggerRedrawAll();
+        _NotifyScrollEvent();
+    }
+
+    return offset;
+}
+
 void Terminal::Write(std::wstring_view stringView)
 {
     _stateMachine->ProcessString(stringView);
@@ -955,7 +1046,7 @@ WORD Terminal::_TakeVirtualKeyFromLastKeyEvent(const WORD scanCode) noexcept
 void Terminal::_assertLocked() const noexcept
 {
 #ifndef NDEBUG
-    if (!_suppressLockChecks && !_readWriteLock.is_locked())
+    if (!_suppressLockChecks && !_readWriteLock.is_locked_shared())
     {
         // __debugbreak() has the benefit over assert() that the debugger jumps right here to this line.
         // That way there's no need to first click any dialogues, etc. The disadvantage of course is that the
@@ -968,7 +1059,7 @@ void Terminal::_assertLocked() const noexcept
 void Terminal::_assertUnlocked() const noexcept
 {
 #ifndef NDEBUG
-    if (!_suppressLockChecks && _readWriteLock.is_locked())
+    if (!_suppressLockChecks && _readWriteLock.is_locked_shared())
     {
         __debugbreak();
     }
@@ -976,15 +1067,16 @@ void Terminal::_assertUnlocked() const noexcept
 }
 
 // Method Description:
-// - Acquire a read lock on the terminal.
+// - Acquire a read lock on the terminal. Multiple readers may hold it at the same time,
+//   so only call const methods (or those that are otherwise safe to call concurrently).
 // Return Value:
 // - a shared_lock which can be used to unlock the terminal. The shared_lock
 //      will release this lock when it's destructed.
-[[nodiscard]] std::unique_lock<til::recursive_ticket_lock> Terminal::LockForReading() const noexcept
+[[nodiscard]] til::lock_stats::shared_lock<til::recursive_shared_ticket_lock> Terminal::LockForReading(til::lock_stats::site site) const noexcept
 {
-#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'recursive_ticket_lock>()' which may throw exceptions (f.6).
+#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'recursive_shared_ticket_lock>()' which may throw exceptions (f.6).
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile
-    return std::unique_lock{ const_cast<til::recursive_ticket_lock&>(_readWriteLock) };
+    return til::lock_stats::shared_lock{ const_cast<til::recursive_shared_ticket_lock&>(_readWriteLock), site };
 }
 
 // Method Description:
@@ -992,17 +1084,17 @@ void Terminal::_assertUnlocked() const noexcept
 // Return Value:
 // - a unique_lock which can be used to unlock the terminal. The unique_lock
 //      will release this lock when it's destructed.
-[[nodiscard]] std::unique_lock<til::recursive_ticket_lock> Terminal::LockForWriting() noexcept
+[[nodiscard]] til::lock_stats::unique_lock<til::recursive_shared_ticket_lock> Terminal::LockForWriting(til::lock_stats::site site) noexcept
 {
-#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'recursive_ticket_lock>()' which may throw exceptions (f.6).
-    return std::unique_lock{ _readWriteLock };
+#pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'recursive_shared_ticket_lock>()' which may throw exceptions (f.6).
+    return til::lock_stats::unique_lock{ _readWriteLock, site };
 }
 
 // Method Description:
 // - Get a reference to the terminal's read/write lock.
 // Return Value:
 // - a ticket_lock which can be used to manually lock or unlock the terminal.
-til::recursive_ticket_lock_suspension Terminal::SuspendLock() noexcept
+til::recursive_shared_ticket_lock_suspension Terminal::SuspendLock() noexcept
 {
     return _readWriteLock.suspend();
 }
@@ -16,6 +16,7 @@
 #include "../../cascadia/terminalcore/ITerminalInput.hpp"
 
 #include <til/generational.h>
+#include <til/lock_stats.h>
 #include <til/ticket_lock.h>
 #include <til/winrt.h>
 
@@ -48,6 +49,7 @@ namespace TerminalCoreUnitTests
     class TerminalBufferTests;
     class TerminalApiTest;
     class ScrollTest;
+    class RendererTest;
 };
 #endif
 
@@ -102,14 +104,17 @@ public:
 
     til::point GetViewportRelativeCursorPosition() const noexcept;
 
+    [[nodiscard]] HRESULT UserResize(const til::size viewportSize, const bool deferScrollbackReflow) noexcept;
+    til::CoordType FinishDeferredReflow();
+
     // Write comes from the PTY and goes to our parser to be stored in the output buffer
     void Write(std::wstring_view stringView);
 
     void _assertLocked() const noexcept;
     void _assertUnlocked() const noexcept;
-    [[nodiscard]] std::unique_lock<til::recursive_ticket_lock> LockForReading() const noexcept;
-    [[nodiscard]] std::unique_lock<til::recursive_ticket_lock> LockForWriting() noexcept;
-    til::recursive_ticket_lock_suspension SuspendLock() noexcept;
+    [[nodiscard]] til::lock_stats::shared_lock<til::recursive_shared_ticket_lock> LockForReading(til::lock_stats::site site = til::lock_stats::site::current()) const noexcept;
+    [[nodiscard]] til::lock_stats::unique_lock<til::recursive_shared_ticket_lock> LockForWriting(til::lock_stats::site site = til::lock_stats::site::current()) noexcept;
+    til::recursive_shared_ticket_lock_suspension SuspendLock() noexcept;
 
     til::CoordType GetBufferHeight() const noexcept;
 
@@ -200,8 +205,10 @@ public:
     TextBuffer& GetTextBuffer() const noexcept override;
     const FontInfo& GetFontInfo() const noexcept override;
 
-    void LockConsole() noexcept override;
+    void LockConsole(til::lock_stats::site site = til::lock_stats::site::current()) noexcept override;
     void UnlockConsole() noexcept override;
+    void LockConsoleShared(til::lock_stats::site site = til::lock_stats::site::current()) noexcept override;
+    void UnlockConsoleShared() noexcept override;
 
     // These methods are defined in TerminalRenderData.cpp
     Microsoft::Console::Render::TimerDuration GetBlinkInterval() noexcept override;
@@ -209,7 +216,8 @@ public:
     bool IsGridLineDrawingAllowed() noexcept override;
     std::wstring GetHyperlinkUri(uint16_t id) const override;
     std::wstring GetHyperlinkCustomId(uint16_t id) const override;
-    std::vector<size_t> GetPatternId(const til::point viewportPos) const override;
+    std::pmr::vector<size_t> GetPatternId(const til::point viewportPos, std::pmr::memory_resource* resource) const override;
+    bool HasPatternAt(const til::point viewportPos) const noexcept override;
 
     std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& attr) const noexcept override;
     std::span<const til::point_span> GetSelectionSpans() const noexcept override;
@@ -336,7 +344,13 @@ private:
     //
     // But we can abuse the fact that the surrounding members rarely change and are huge
     // (std::function is like 64 bytes) to create some natural padding without wasting space.
-    til::recursive_ticket_lock _readWriteLock;
+    til::recursive_shared_ticket_lock _readWriteLock;
+#if TIL_LOCK_STATS
+    // Tracks the hold time between LockConsole() and UnlockConsole().
+    til::lock_stats::exclusive_hold _lockConsoleHold;
+    // Same for LockConsoleShared() and UnlockConsoleShared().
+    til::lock_stats::shared_hold _lockConsoleSharedHold;
+#endif
 
     std::function<void(const int, const int, const int)> _pfnScrollPositionChanged;
     std::function<void()> _pfnTaskbarProgressChanged;
@@ -478,6 +492,7 @@ private:
     std::vector<til::point_span> _GetSelectionSpans() const noexcept;
     std::pair<til::point, til::point> _PivotSelection(const til::point targetPos, bool& targetStart) const noexcept;
     std::pair<til::point, til::point> _ExpandSelectionAnchors(std::pair<til::point, til::point> anchors) const;
+    bool _RetrieveSelectedTextFromBuffer(TextCopyData& data, const bool singleLine, const bool withControlSequences, const bool html, const bool rtf, const bool yieldLock) const;
     til::point _ConvertToBufferCell(const til::point viewportPos, bool allowRightExclusive) const;
     void _ScrollToPoint(const til::point pos);
     void _MoveByChar(SelectionDirection direction, til::point& pos);
@@ -491,5 +506,6 @@ private:
     friend class TerminalCoreUnitTests::TerminalBufferTests;
     friend class TerminalCoreUnitTests::TerminalApiTest;
     friend class TerminalCoreUnitTests::ScrollTest;
+    friend class TerminalCoreUnitTests::RendererTest;
 #endif
 };
@@ -935,9 +935,30 @@ Terminal::TextCopyData Terminal::RetrieveSelectedTextFromBuffer(const bool singl
 {
     TextCopyData data;
 
+    // Copying a large selection can take a while. We release the lock between chunks,
+    // so that the output thread doesn't stall in the meantime. If the buffer changed
+    // while we didn't hold the lock, we start over, but this time without releasing it.
+    if (!_RetrieveSelectedTextFromBuffer(data, singleLine, withControlSequences, html, rtf, true))
+    {
+        data = {};
+        _RetrieveSelectedTextFromBuffer(data, singleLine, withControlSequences, html, rtf, false);
+    }
+
+    return data;
+}
+
+// Method Description:
+// - Implements RetrieveSelectedTextFromBuffer().
+// Arguments:
+// - data: receives the text.
+// - yieldLock: if true, the lock will be released between chunks of text.
+// Return Value:
+// - false if the buffer was modified while the lock was released. The contents of data are unusable then.
+bool Terminal::_RetrieveSelectedTextFromBuffer(TextCopyData& data, const bool singleLine, const bool withControlSequences, const bool html, const bool rtf, const bool yieldLock) const
+{
     if (!IsSelectionActive())
     {
-        return data;
+        return true;
     }
 
     const auto GetAttributeColors = [&](const auto& attr) {
@@ -948,14 +969,28 @@ Terminal::TextCopyData Terminal::RetrieveSelectedTextFromBuffer(const bool singl
 
     const auto& textBuffer = _activeBuffer();
 
+    // Called by the sinks below after each chunk. The TextBuffer functions check whether
+    // the buffer was modified in the meantime, but we have to check whether it still exists,
+    // because the alternate buffer may have been destroyed while we didn't hold the lock.
+    const auto yield = [&]() {
+        if (yieldLock)
+        {
+#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile
+            const auto suspension = const_cast<til::recursive_shared_ticket_lock&>(_readWriteLock).suspend();
+        }
+        return &_activeBuffer() == &textBuffer;
+    };
+
     const auto req = TextBuffer::CopyRequest::FromConfig(textBuffer, _selection->start, _selection->end, singleLine, _selection->blockSelection, _trimBlockSelection);
-    if (withControlSequences)
-    {
-        data.plainText = textBuffer.GetWithControlSequences(req);
-    }
-    else
+    const auto appendPlainText = [&](const std::wstring_view chunk) {
+        data.plainText.append(chunk);
+        return yield();
+    };
+    const auto ok = withControlSequences ? textBuffer.SerializeWithControlSequences(req, appendPlainText) :
+                                           textBuffer.SerializePlainText(req, appendPlainText);
+    if (!ok)
     {
-        data.plainText = textBuffer.GetPlainText(req);
+        return false;
     }
 
     if (html || rtf)
@@ -965,17 +1000,45 @@ Terminal::TextCopyData Terminal::RetrieveSelectedTextFromBuffer(const bool singl
         const auto fontSizePt = _fontInfo.GetUnscaledSize().height; // already in points
         const auto& fontName = _fontInfo.GetFaceName();
 
-        if (html)
+        try
         {
-            data.html = textBuffer.GenHTML(req, fontSizePt, fontName, bgColor, isIntenseBold, GetAttributeColors);
+            if (html && req.beg <= req.end)
+            {
+                // Same as TextBuffer::GenHTML(): Reserve space for the clipboard header and fill it in at the end.
+                data.html.assign(TextBuffer::HTMLClipboardHeaderSize, '\0');
+                const auto appendHtml = [&](const std::string_view chunk) {
+                    data.html.append(chunk);
+                    return yield();
+                };
+                if (!textBuffer.SerializeHTML(req, fontSizePt, fontName, bgColor, isIntenseBold, GetAttributeColors, appendHtml))
+                {
+                    return false;
+                }
+                const auto header = TextBuffer::GenHTMLClipboardHeader(data.html.size() - TextBuffer::HTMLClipboardHeaderSize);
+                std::copy_n(header.data(), TextBuffer::HTMLClipboardHeaderSize, data.html.data());
+            }
+            if (rtf)
+            {
+                const auto appendRtf = [&](const std::string_view chunk) {
+                    data.rtf.append(chunk);
+                    return yield();
+                };
+                if (!textBuffer.SerializeRTF(req, fontSizePt, fontName, bgColor, isIntenseBold, GetAttributeColors, appendRtf))
+                {
+                    return false;
+                }
+            }
         }
-        if (rtf)
+        catch (...)
         {
-            data.rtf = textBuffer.GenRTF(req, fontSizePt, fontName, bgColor, isIntenseBold, GetAttributeColors);
+            // Like GenHTML() and GenRTF(), failing to generate the formatted text isn't fatal.
+            LOG_CAUGHT_EXCEPTION();
+            data.html.clear();
+            data.rtf.clear();
         }
     }
 
-    return data;
+    return true;
 }
 
 // Method Description:
@@ -77,27 +77,33 @@ std::wstring Microsoft::Terminal::Core::Terminal::GetHyperlinkCustomId(uint16_t
 // - The viewport-relative location
 // Return value:
 // - The pattern IDs of the location
-std::vector<size_t> Terminal::GetPatternId(const til::point viewportPos) const
+std::pmr::vector<size_t> Terminal::GetPatternId(const til::point viewportPos, std::pmr::memory_resource* resource) const
 {
     _assertLocked();
 
     // Convert viewport-relative (y=0 at visible start) to buffer-absolute
     const til::point bufferPos{ viewportPos.x, viewportPos.y + _VisibleStartIndex() };
-    const auto intervals = _patternIntervalTree.findOverlapping({ bufferPos.x + 1, bufferPos.y }, bufferPos);
-    if (intervals.size() == 0)
-    {
-        return {};
-    }
-    else
-    {
-        std::vector<size_t> result{};
-        for (const auto& interval : intervals)
-        {
-            result.emplace_back(interval.value);
-        }
-        return result;
-    }
-    return {};
+
+    // This gets called for every cell in every frame, so we visit the intervals
+    // directly instead of having findOverlapping() collect them in a temporary vector.
+    std::pmr::vector<size_t> result{ resource };
+    _patternIntervalTree.visit_overlapping({ bufferPos.x + 1, bufferPos.y }, bufferPos, [&](const auto& interval) {
+        result.emplace_back(interval.value);
+    });
+    return result;
+}
+
+bool Terminal::HasPatternAt(const til::point viewportPos) const noexcept
+{
+    _assertLocked();
+
+    const til::point bufferPos{ viewportPos.x, viewportPos.y + _VisibleStartIndex() };
+
+    auto found = false;
+    _patternIntervalTree.visit_overlapping({ bufferPos.x + 1, bufferPos.y }, bufferPos, [&](const auto&) {
+        found = true;
+    });
+    return found;
 }
 
 std::pair<COLORREF, COLORREF> Terminal::GetAttributeColors(const TextAttribute& attr) const noexcept
@@ -204,18 +210,67 @@ std::wstring_view Terminal::GetConsoleTitle() const noexcept
 //      operation.
 //   Callers should make sure to also call Terminal::UnlockConsole once
 //      they're done with any querying they need to do.
-void Terminal::LockConsole() noexcept
+void Terminal::LockConsole([[maybe_unused]] til::lock_stats::site site) noexcept
 {
+#if TIL_LOCK_STATS
+    const auto waitStart = til::lock_stats::clock::now();
+    _readWriteLock.lock();
+    // Nested acquisitions are covered by the outermost one.
+    if (_readWriteLock.recursion_depth() == 1)
+    {
+        _lockConsoleHold.acquired(site, waitStart);
+    }
+#else
     _readWriteLock.lock();
+#endif
 }
 
 // Method Description:
 // - Unlocks the terminal after a call to Terminal::LockConsole.
 void Terminal::UnlockConsole() noexcept
 {
+#if TIL_LOCK_STATS
+    if (_readWriteLock.recursion_depth() == 1)
+    {
+        _lockConsoleHold.released();
+    }
+#endif
     _readWriteLock.unlock();
 }
 
+// Method Description:
+// - Lock the terminal for reading, just like Terminal::LockConsole, but
+//      without blocking other readers, like the renderer or UIA clients.
+//   Callers should make sure to also call Terminal::UnlockConsoleShared once
+//      they're done with any querying they need to do.
+void Terminal::LockConsoleShared([[maybe_unused]] til::lock_stats::site site) noexcept
+{
+#if TIL_LOCK_STATS
+    const auto waitStart = til::lock_stats::clock::now();
+    _readWriteLock.lock_shared();
+    // Nested acquisitions are covered by the outermost one.
+    if (_readWriteLock.recursion_depth() == 1)
+    {
+        _lockConsoleSharedHold.acquired(site, waitStart);
+    }
+#else
+    _readWriteLock.lock_shared();
+#endif
+}
+
+// Method Description:
+// - Unlocks the terminal after a call to Terminal::LockConsoleShared.
+void Terminal::UnlockConsoleShared() noexcept
+{
+#if TIL_LOCK_STATS
+    if (_readWriteLock.recursion_depth() == 1)
+    {
+        _lockConsoleSharedHold.released();
+    }
+#endif
+    _readWriteLock.unlock_shared();
+}
+
 bool Terminal::IsUiaDataInitialized() const noexcept
 {
     // GH#11135: Windows Terminal needs to create and return an automation peer
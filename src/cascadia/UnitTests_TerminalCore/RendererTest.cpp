@@ -0,0 +1,197 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../renderer/inc/DummyRenderer.hpp"
+#include "../renderer/inc/RenderEngineBase.hpp"
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+// Counts the heap allocations made by the current thread while an AllocationCounter is alive.
+// Replacing the global operator new only affects this test binary.
+static thread_local size_t* allocationCounter = nullptr;
+
+void* operator new(size_t size)
+{
+    if (allocationCounter)
+    {
+        ++*allocationCounter;
+    }
+    if (const auto p = malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+namespace
+{
+    struct AllocationCounter
+    {
+        AllocationCounter() noexcept
+        {
+            allocationCounter = &count;
+        }
+
+        ~AllocationCounter()
+        {
+            allocationCounter = nullptr;
+        }
+
+        size_t count = 0;
+    };
+
+    class MockPaintRenderEngine final : public RenderEngineBase
+    {
+    public:
+        size_t paintedLines = 0;
+        til::rect dirty;
+        // If set, Invalidate() appends the rects it's given to it.
+        std::vector<til::rect>* invalidated = nullptr;
+
+        HRESULT StartPaint() noexcept { return S_OK; }
+        HRESULT EndPaint() noexcept { return S_OK; }
+        HRESULT Present() noexcept { return S_OK; }
+        HRESULT ScrollFrame() noexcept { return S_OK; }
+        HRESULT Invalidate(const til::rect* psrRegion) noexcept
+        {
+            if (invalidated)
+            {
+                invalidated->emplace_back(*psrRegion);
+            }
+            return S_OK;
+        }
+        HRESULT InvalidateCursor(const til::rect* /*psrRegion*/) noexcept { return S_OK; }
+        HRESULT InvalidateSystem(const til::rect* /*prcDirtyClient*/) noexcept { return S_OK; }
+        HRESULT InvalidateScroll(const til::point* /*pcoordDelta*/) noexcept { return S_OK; }
+        HRESULT InvalidateAll() noexcept { return S_OK; }
+        HRESULT InvalidateCircling(_Out_ bool* /*pForcePaint*/) noexcept { return S_OK; }
+        HRESULT PaintBackground() noexcept { return S_OK; }
+        HRESULT PaintBufferLine(std::span<const Cluster> /*clusters*/, til::point /*coord*/, bool /*fTrimLeft*/) noexcept
+        {
+            ++paintedLines;
+            return S_OK;
+        }
+        HRESULT PaintBufferGridLines(GridLineSet /*lines*/, COLORREF /*gridlineColor*/, COLORREF /*underlineColor*/, size_t /*cchLine*/, til::point /*coordTarget*/) noexcept { return S_OK; }
+        HRESULT PaintSelection(const til::rect& /*rect*/) noexcept { return S_OK; }
+        HRESULT PaintCursor(const CursorOptions& /*options*/) noexcept { return S_OK; }
+        HRESULT UpdateDrawingBrushes(const TextAttribute& /*textAttributes*/, const RenderSettings& /*renderSettings*/, gsl::not_null<IRenderData*> /*pData*/, bool /*usingSoftFont*/, bool /*isSettingDefaultBrushes*/) noexcept { return S_OK; }
+        HRESULT UpdateFont(const FontInfoDesired& /*FontInfoDesired*/, _Out_ FontInfo& /*FontInfo*/) noexcept { return S_OK; }
+        HRESULT UpdateDpi(int /*iDpi*/) noexcept { return S_OK; }
+        HRESULT UpdateViewport(const til::inclusive_rect& /*srNewViewport*/) noexcept { return S_OK; }
+        HRESULT GetProposedFont(const FontInfoDesired& /*FontInfoDesired*/, _Out_ FontInfo& /*FontInfo*/, int /*iDpi*/) noexcept { return S_OK; }
+        HRESULT GetDirtyArea(std::span<const til::rect>& area) noexcept
+        {
+            area = { &dirty, 1 };
+            return S_OK;
+        }
+        HRESULT GetFontSize(_Out_ til::size* /*pFontSize*/) noexcept { return S_OK; }
+        HRESULT IsGlyphWideByFont(std::wstring_view /*glyph*/, _Out_ bool* /*pResult*/) noexcept { return S_OK; }
+
+    protected:
+        HRESULT _DoUpdateTitle(const std::wstring_view /*newTitle*/) noexcept { return S_OK; }
+    };
+}
+
+namespace TerminalCoreUnitTests
+{
+    class RendererTest;
+};
+using namespace TerminalCoreUnitTests;
+
+class TerminalCoreUnitTests::RendererTest final
+{
+    TEST_CLASS(RendererTest);
+
+    TEST_METHOD(SteadyStatePaintDoesNotAllocate);
+    TEST_METHOD(InvalidationsAreCoalesced);
+};
+
+void RendererTest::SteadyStatePaintDoesNotAllocate()
+{
+    MockPaintRenderEngine engine;
+    engine.dirty = { 0, 0, 80, 32 };
+    Terminal term{ Terminal::TestDummyMarker{} };
+    DummyRenderer renderer{ &term };
+    renderer.AddRenderEngine(&engine);
+    term.Create({ 80, 32 }, 0, renderer);
+
+    // Lots of color runs, wide glyphs and a URL, which turns into pattern IDs.
+    for (auto i = 0; i < 32; ++i)
+    {
+        for (auto j = 0; j < 20; ++j)
+        {
+            term.Write(fmt::format(FMT_COMPILE(L"\x1b[3{}m\x1b[4{}m\u732B\x1b[{}mab"), j % 8, (i + j) % 8, j % 2 ? 4 : 24));
+        }
+    }
+    term.Write(L"\x1b[Hhttps://example.com/a/b/c");
+    term._detectURLs = true;
+    term.UpdatePatternsUnderLock();
+
+    // The first frames may still grow the buffers that are reused across frames.
+    for (auto i = 0; i < 3; ++i)
+    {
+        VERIFY_SUCCEEDED(renderer.PaintFrame());
+    }
+
+    // Don't VERIFY anything while counting, because TAEF allocates to log the result.
+    engine.paintedLines = 0;
+    auto hr = S_OK;
+    size_t allocations = 0;
+    {
+        AllocationCounter counter;
+        hr = renderer.PaintFrame();
+        allocations = counter.count;
+    }
+
+    VERIFY_SUCCEEDED(hr);
+    VERIFY_ARE_EQUAL(0u, allocations);
+    VERIFY_IS_GREATER_THAN(engine.paintedLines, size_t{ 32 });
+}
+
+void RendererTest::InvalidationsAreCoalesced()
+{
+    MockPaintRenderEngine engine;
+    Terminal term{ Terminal::TestDummyMarker{} };
+    DummyRenderer renderer{ &term };
+    renderer.AddRenderEngine(&engine);
+    term.Create({ 80, 32 }, 0, renderer);
+    VERIFY_SUCCEEDED(renderer.PaintFrame());
+
+    std::vector<til::rect> invalidated;
+    engine.invalidated = &invalidated;
+
+    // A TUI redrawing the borders on the left and right of each row.
+    for (til::CoordType y = 0; y < 32; ++y)
+    {
+        renderer.TriggerRedraw(Viewport::FromDimensions({ 0, y }, { 2, 1 }));
+        renderer.TriggerRedraw(Viewport::FromDimensions({ 78, y }, { 2, 1 }));
+    }
+
+    // The damage is only handed to the engines once the next frame is painted...
+    VERIFY_ARE_EQUAL(0u, invalidated.size());
+    VERIFY_SUCCEEDED(renderer.PaintFrame());
+
+    // ...and then it's 2 narrow columns instead of 64 tiny rects or the entire viewport.
+    VERIFY_ARE_EQUAL(2u, invalidated.size());
+    VERIFY_ARE_EQUAL((til::rect{ 0, 0, 2, 32 }), invalidated[0]);
+    VERIFY_ARE_EQUAL((til::rect{ 78, 0, 80, 32 }), invalidated[1]);
+}
@@ -53,6 +53,18 @@ class TerminalCoreUnitTests::TerminalBufferTests final
 
     TEST_METHOD(TestURLPatternDetection);
 
+    TEST_METHOD(TestDeferredReflow);
+    TEST_METHOD(TestDeferredReflowWithOutput);
+
+    BEGIN_TEST_METHOD(TestResizePerformance)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        TEST_METHOD_PROPERTY(L"Data:scrollback", L"{1000, 10000, 30000}")
+    END_TEST_METHOD()
+
+    BEGIN_TEST_METHOD(TestScrollingPerformance)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD()
+
     TEST_METHOD_SETUP(MethodSetup)
     {
         // STEP 1: Set up the Terminal
@@ -72,6 +84,7 @@ class TerminalCoreUnitTests::TerminalBufferTests final
 private:
     void _SetTabStops(std::list<til::CoordType> columns, bool replace);
     std::list<til::CoordType> _GetTabStops();
+    void _VerifySameContents(const Terminal& expected, const Terminal& actual);
 
     std::unique_ptr<DummyRenderer> emptyRenderer;
     std::unique_ptr<Terminal> term;
@@ -705,3 +718,205 @@ void TerminalBufferTests::TestURLPatternDetection()
         VERIFY_ARE_EQUAL(interval->start.x, 0, L"Interval starts at column 0.");
     }
 }
+
+// Writes `lines` lines of varying length, none of which exceed the default width of 80 columns.
+static void _FillWithLines(Terminal& terminal, const til::CoordType lines)
+{
+    std::wstring line;
+    for (til::CoordType i = 0; i < lines; i++)
+    {
+        line.assign(gsl::narrow_cast<size_t>((i * 7) % 80), gsl::narrow_cast<wchar_t>(L'A' + i % 26));
+        line.append(L"\r\n");
+        terminal.Write(line);
+    }
+}
+
+void TerminalBufferTests::TestDeferredReflow()
+{
+    static constexpr til::CoordType historySize = 5000;
+    static constexpr til::CoordType lineCount = 3000;
+
+    DummyRenderer deferredRenderer;
+    Terminal deferred{ Terminal::TestDummyMarker{} };
+    deferred.Create({ TerminalViewWidth, TerminalViewHeight }, historySize, deferredRenderer);
+
+    DummyRenderer eagerRenderer;
+    Terminal eager{ Terminal::TestDummyMarker{} };
+    eager.Create({ TerminalViewWidth, TerminalViewHeight }, historySize, eagerRenderer);
+
+    auto deferredLock = deferred.LockForWriting();
+    auto eagerLock = eager.LockForWriting();
+
+    _FillWithLines(deferred, lineCount);
+    _FillWithLines(eager, lineCount);
+
+    Log::Comment(L"Resize twice, once with a deferred reflow and once without.");
+    VERIFY_SUCCEEDED(deferred.UserResize({ 50, TerminalViewHeight }, true));
+    VERIFY_IS_TRUE(deferred._mainBuffer->HasDeferredReflow());
+    VERIFY_SUCCEEDED(deferred.UserResize({ 65, TerminalViewHeight }, true));
+    VERIFY_IS_TRUE(deferred._mainBuffer->HasDeferredReflow());
+
+    VERIFY_SUCCEEDED(eager.UserResize({ 50, TerminalViewHeight }, false));
+    VERIFY_IS_FALSE(eager._mainBuffer->HasDeferredReflow());
+    VERIFY_SUCCEEDED(eager.UserResize({ 65, TerminalViewHeight }, false));
+
+    Log::Comment(L"Finishing the deferred reflow should result in the same buffer contents.");
+    deferred.FinishDeferredReflow();
+    VERIFY_IS_FALSE(deferred._mainBuffer->HasDeferredReflow());
+    _VerifySameContents(eager, deferred);
+}
+
+void TerminalBufferTests::TestDeferredReflowWithOutput()
+{
+    static constexpr til::CoordType historySize = 5000;
+    static constexpr til::CoordType bufferHeight = historySize + TerminalViewHeight;
+    static constexpr til::CoordType lineCount = 3000;
+
+    DummyRenderer deferredRenderer;
+    Terminal deferred{ Terminal::TestDummyMarker{} };
+    deferred.Create({ TerminalViewWidth, TerminalViewHeight }, historySize, deferredRenderer);
+
+    DummyRenderer eagerRenderer;
+    Terminal eager{ Terminal::TestDummyMarker{} };
+    eager.Create({ TerminalViewWidth, TerminalViewHeight }, historySize, eagerRenderer);
+
+    auto deferredLock = deferred.LockForWriting();
+    auto eagerLock = eager.LockForWriting();
+
+    _FillWithLines(deferred, lineCount);
+    _FillWithLines(eager, lineCount);
+
+    Log::Comment(L"Write enough output after a deferred resize to push parts of the old scrollback out of the buffer.");
+    VERIFY_SUCCEEDED(deferred.UserResize({ 50, TerminalViewHeight }, true));
+    VERIFY_IS_TRUE(deferred._mainBuffer->HasDeferredReflow());
+    VERIFY_SUCCEEDED(eager.UserResize({ 50, TerminalViewHeight }, false));
+
+    // The old scrollback takes up more than 3000 rows at a width of 50 columns.
+    static constexpr til::CoordType outputLines = bufferHeight - lineCount;
+    for (til::CoordType i = 0; i < outputLines; i++)
+    {
+        deferred.Write(L"output\r\n");
+        eager.Write(L"output\r\n");
+    }
+
+    // Only the oldest rows got pushed out, so the first row is from the old scrollback.
+    VERIFY_IS_FALSE(eager._mainBuffer->GetRowByOffset(0).GetText().starts_with(L"output"));
+
+    deferred.FinishDeferredReflow();
+    _VerifySameContents(eager, deferred);
+
+    Log::Comment(L"Write past the end of the buffer while a reflow is still deferred.");
+    VERIFY_SUCCEEDED(deferred.UserResize({ 65, TerminalViewHeight }, true));
+    VERIFY_IS_TRUE(deferred._mainBuffer->HasDeferredReflow());
+    VERIFY_SUCCEEDED(eager.UserResize({ 65, TerminalViewHeight }, false));
+
+    for (til::CoordType i = 0; i < bufferHeight; i++)
+    {
+        deferred.Write(L"more output\r\n");
+        eager.Write(L"more output\r\n");
+    }
+
+    // All rows are in use now and none of the old scrollback fits anymore, deferred or not.
+    VERIFY_IS_FALSE(deferred._mainBuffer->HasDeferredReflow());
+    deferred.FinishDeferredReflow();
+    _VerifySameContents(eager, deferred);
+}
+
+void TerminalBufferTests::_VerifySameContents(const Terminal& expected, const Terminal& actual)
+{
+    const auto& expectedBuffer = *expected._mainBuffer;
+    const auto& actualBuffer = *actual._mainBuffer;
+    VERIFY_ARE_EQUAL(expectedBuffer.GetCursor().GetPosition(), actualBuffer.GetCursor().GetPosition());
+    VERIFY_ARE_EQUAL(expected._mutableViewport.Top(), actual._mutableViewport.Top());
+
+    const auto rows = expectedBuffer.GetCursor().GetPosition().y + 1;
+    for (til::CoordType y = 0; y < rows; y++)
+    {
+        const auto& expectedRow = expectedBuffer.GetRowByOffset(y);
+        const auto& actualRow = actualBuffer.GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(expectedRow.GetText(), actualRow.GetText(), NoThrowString().Format(L"row %d", y));
+        VERIFY_ARE_EQUAL(expectedRow.WasWrapForced(), actualRow.WasWrapForced(), NoThrowString().Format(L"row %d", y));
+    }
+}
+
+void TerminalBufferTests::TestResizePerformance()
+{
+    til::CoordType scrollback;
+    VERIFY_SUCCEEDED(TestData::TryGetValue(L"scrollback", scrollback));
+
+    // Simulates dragging the window border across a range of widths.
+    static constexpr std::array widths{ 79, 75, 70, 64, 57, 50, 57, 64, 70, 75, 79, 80 };
+
+    for (const auto defer : { false, true })
+    {
+        DummyRenderer renderer;
+        Terminal terminal{ Terminal::TestDummyMarker{} };
+        terminal.Create({ TerminalViewWidth, TerminalViewHeight }, scrollback * 2, renderer);
+        auto lock = terminal.LockForWriting();
+        _FillWithLines(terminal, scrollback);
+
+        std::chrono::steady_clock::duration longestStep{};
+        const auto beg = std::chrono::steady_clock::now();
+        for (const auto width : widths)
+        {
+            const auto stepBeg = std::chrono::steady_clock::now();
+            VERIFY_SUCCEEDED(terminal.UserResize({ width, TerminalViewHeight }, defer));
+            longestStep = std::max(longestStep, std::chrono::steady_clock::now() - stepBeg);
+        }
+        const auto finishBeg = std::chrono::steady_clock::now();
+        terminal.FinishDeferredReflow();
+        const auto end = std::chrono::steady_clock::now();
+
+        using us = std::chrono::microseconds;
+        Log::Comment(String().Format(L"%s, %d lines: longest resize step %lldus, finish %lldus, total %lldus",
+                                     defer ? L"deferred" : L"eager",
+                                     scrollback,
+                                     std::chrono::duration_cast<us>(longestStep).count(),
+                                     std::chrono::duration_cast<us>(end - finishBeg).count(),
+                                     std::chrono::duration_cast<us>(end - beg).count()));
+    }
+}
+
+void TerminalBufferTests::TestScrollingPerformance()
+{
+    static constexpr til::CoordType lineCount = 200000;
+
+    struct Workload
+    {
+        const wchar_t* name;
+        std::wstring_view line;
+    };
+    static constexpr std::array workloads{
+        Workload{ L"empty lines", L"\r\n" },
+        Workload{ L"short lines", L"Lorem ipsum dolor sit amet\r\n" },
+        Workload{ L"full lines", L"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor i\r\n" },
+    };
+
+    for (const auto& workload : workloads)
+    {
+        DummyRenderer renderer;
+        Terminal terminal{ Terminal::TestDummyMarker{} };
+        terminal.Create({ TerminalViewWidth, TerminalViewHeight }, 9001, renderer);
+        auto lock = terminal.LockForWriting();
+
+        // Each write should scroll the buffer, so start out with a full buffer.
+        for (til::CoordType i = 0; i < 9001 + TerminalViewHeight; i++)
+        {
+            terminal.Write(L"\r\n");
+        }
+
+        const auto beg = std::chrono::steady_clock::now();
+        for (til::CoordType i = 0; i < lineCount; i++)
+        {
+            terminal.Write(workload.line);
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - beg).count();
+        Log::Comment(String().Format(L"%s: %d lines in %lldus, %.0f lines/s",
+                                     workload.name,
+                                     lineCount,
+                                     us,
+                                     lineCount * 1e6 / std::max(1ll, us)));
+    }
+}
@@ -18,6 +18,7 @@ public:
     //
     // Options:
     // * delay: The minimum time between invocations
+    // * slack: How much later than `delay` the trailing invocation may occur
     // * leading: If true, `func` will be invoked immediately on first call
     // * trailing: If true, `func` will be invoked after the delay
     // * debounce: If true, resets the timer on each call
@@ -26,26 +27,26 @@ public:
     ThrottledFunc(winrt::Windows::System::DispatcherQueue dispatcher, til::throttled_func_options opts, function func) :
         _dispatcher{ std::move(dispatcher) },
         _func{ std::move(func) },
-        _timer{ _create_timer() },
+        _delay{ opts.delay },
+        _slack{ opts.slack },
         _debounce{ opts.debounce },
         _leading{ opts.leading },
-        _trailing{ opts.trailing }
+        _trailing{ opts.trailing },
+        _timer{ [this]() { _timer_callback(); } }
     {
         if (!_leading && !_trailing)
         {
             throw std::invalid_argument("neither leading nor trailing");
         }
 
-        const auto d = -opts.delay.count();
-        if (d >= 0)
+        if (_delay.count() <= 0)
         {
             throw std::invalid_argument("non-positive delay specified");
         }
-        memcpy(&_delay, &d, sizeof(d));
     }
 
     // ThrottledFunc uses its `this` pointer when creating _timer.
-    // Since the timer cannot be recreated, instances cannot be moved either.
+    // Since the timer cannot be rebound, instances cannot be moved either.
     ThrottledFunc(const ThrottledFunc&) = delete;
     ThrottledFunc& operator=(const ThrottledFunc&) = delete;
     ThrottledFunc(ThrottledFunc&&) = delete;
@@ -72,20 +73,13 @@ public:
     }
 
 private:
-    static void __stdcall _timer_callback(PTP_CALLBACK_INSTANCE /*instance*/, PVOID context, PTP_TIMER /*timer*/) noexcept
+    void _timer_callback() noexcept
     try
     {
-        static_cast<ThrottledFunc*>(context)->_trail();
+        _trail();
     }
     CATCH_LOG()
 
-    wil::unique_threadpool_timer _create_timer()
-    {
-        wil::unique_threadpool_timer timer{ CreateThreadpoolTimer(&_timer_callback, this, nullptr) };
-        THROW_LAST_ERROR_IF(!timer);
-        return timer;
-    }
-
     void _lead(std::tuple<Args...> args)
     {
         bool timerRunning = false;
@@ -116,7 +110,7 @@ private:
         }
         else if (schedule)
         {
-            SetThreadpoolTimer(_timer.get(), &_delay, 0, 0);
+            _timer.schedule(_delay, _slack);
         }
     }
 
@@ -152,7 +146,7 @@ private:
 
                     if (schedule)
                     {
-                        SetThreadpoolTimer(self->_timer.get(), &self->_delay, 0, 0);
+                        self->_timer.schedule(self->_delay, self->_slack);
                     }
                 }
             });
@@ -163,8 +157,8 @@ private:
     // Everything below this point is just like til::throttled_func.
 
     function _func;
-    wil::unique_threadpool_timer _timer;
-    FILETIME _delay;
+    filetime_duration _delay;
+    filetime_duration _slack;
 
     wil::srwlock _lock;
     std::optional<std::tuple<Args...>> _pendingRunArgs;
@@ -173,4 +167,7 @@ private:
     bool _debounce;
     bool _leading;
     bool _trailing;
+
+    // Declared last, so that it's destroyed (and any running callback finished) before the other members.
+    til::timer_service::timer _timer;
 };
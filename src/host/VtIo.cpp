@@ -101,6 +101,7 @@ using namespace Microsoft::Console::Interactivity;
         {
             _overlappedBuf.hEvent = _overlappedEvent.get();
             _overlapped = &_overlappedBuf;
+            _flushWait.reset(CreateThreadpoolWait(&_flushWaitCallback, this, nullptr));
         }
     }
 
@@ -249,6 +250,9 @@ void VtIo::Shutdown() noexcept
         return;
     }
 
+    // We're about to exit, so any output that _flushNow() would hold back might get lost.
+    _flushLatencyBudget = {};
+
     // The reverse of what we did in StartIfNeeded.
     try
     {
@@ -274,6 +278,18 @@ til::enumset<DeviceAttribute, uint64_t> VtIo::GetDeviceAttributes() const noexce
     return _deviceAttributes;
 }
 
+// While the terminal is still reading our previous output, new output may be held back for up to
+// this long, so that it can be sent in a single write. Zero disables this.
+void VtIo::SetFlushLatencyBudget(const std::chrono::steady_clock::duration budget) noexcept
+{
+    _flushLatencyBudget = budget;
+}
+
+const VtIo::FlushStatistics& VtIo::GetFlushStatistics() const noexcept
+{
+    return _flushStats;
+}
+
 // Method Description:
 // - Create our pseudo window. This is exclusively called by
 //   ConsoleInputThreadProcWin32 on the console input thread.
@@ -333,48 +349,232 @@ static constexpr bool IsControlCharacter(wchar_t wch) noexcept
     return (wch <= 0x1f) | (static_cast<wchar_t>(wch - 0x7f) <= 0x20);
 }
 
+// Maps the 16 legacy console colors to their SGR foreground parameter. Add 10 for the background.
+static constexpr uint8_t legacyColorToSgr[] = { 30, 31, 32, 33, 34, 35, 36, 37, 90, 91, 92, 93, 94, 95, 96, 97 };
+
+// Returns the index of the given color in the xterm 256-color palette or -1 if there's none.
+// Only entries 16-255 are considered, because unlike the first 16 they're the same in practically every terminal.
+static int xterm256Index(const TextColor& color) noexcept
+{
+    static constexpr auto cube = [](uint8_t v) noexcept {
+        switch (v)
+        {
+        case 0x00:
+            return 0;
+        case 0x5f:
+            return 1;
+        case 0x87:
+            return 2;
+        case 0xaf:
+            return 3;
+        case 0xd7:
+            return 4;
+        case 0xff:
+            return 5;
+        default:
+            return -1;
+        }
+    };
+
+    const auto r = color.GetR();
+    const auto g = color.GetG();
+    const auto b = color.GetB();
+
+    if (const auto cr = cube(r), cg = cube(g), cb = cube(b); (cr | cg | cb) >= 0)
+    {
+        return 16 + cr * 36 + cg * 6 + cb;
+    }
+    if (r == g && g == b && r >= 8 && r <= 238 && (r - 8) % 10 == 0)
+    {
+        return 232 + (r - 8) / 10;
+    }
+    return -1;
+}
+
+// Appends ";<param>" for the given color. `base` is 30 for the foreground, 40 for the background and 50 for the
+// underline color. The latter has no 16-color form and uses colons for its subparameters, just like TextBuffer::Serialize.
+// Colors are encoded in the shortest form that still results in the exact same color: 16-color, 256-color and then RGB.
+static char* formatColor(char* out, const TextColor& color, uint8_t base) noexcept
+{
+    const auto underline = base == 50;
+
+    // 3 bytes (";39").
+    if (color.IsDefault())
+    {
+        return fmt::format_to(out, FMT_COMPILE(";{}"), base + 9);
+    }
+
+    // 4 bytes (";107").
+    if (color.IsLegacy() && !underline)
+    {
+        return fmt::format_to(out, FMT_COMPILE(";{}"), legacyColorToSgr[color.GetIndex() & 15] + base - 30);
+    }
+
+    // 9 bytes (";38;5;255").
+    const auto index = color.IsRgb() ? xterm256Index(color) : color.GetIndex();
+    if (index >= 0)
+    {
+        return underline ? fmt::format_to(out, FMT_COMPILE(";58:5:{}"), index) : fmt::format_to(out, FMT_COMPILE(";{};5;{}"), base + 8, index);
+    }
+
+    // 17 bytes (";38;2;255;255;255").
+    return underline ? fmt::format_to(out, FMT_COMPILE(";58:2::{}:{}:{}"), color.GetR(), color.GetG(), color.GetB()) :
+                       fmt::format_to(out, FMT_COMPILE(";{};2;{};{};{}"), base + 8, color.GetR(), color.GetG(), color.GetB());
+}
+
+// Appends the SGR parameters that turn the `previous` attributes into `attributes`, each prefixed with a ";".
+// Attributes that have no SGR equivalent (hyperlinks, the protected flag, most grid lines) are ignored.
+// Returns `out` if the two look the same on a terminal.
+static char* formatAttributeParams(char* out, const TextAttribute& previous, const TextAttribute& attributes) noexcept
+{
+    struct Mapping
+    {
+        CharacterAttributes attr;
+        uint8_t change[2]; // [0] = off, [1] = on
+    };
+    static constexpr Mapping mappings[] = {
+        { CharacterAttributes::Italics, { 23, 3 } },
+        { CharacterAttributes::Blinking, { 25, 5 } },
+        { CharacterAttributes::Invisible, { 28, 8 } },
+        { CharacterAttributes::CrossedOut, { 29, 9 } },
+    };
+    static constexpr std::string_view underlineMappings[] = {
+        ";24", // UnderlineStyle::NoUnderline
+        ";4", // UnderlineStyle::SinglyUnderlined
+        ";21", // UnderlineStyle::DoublyUnderlined
+        ";4:3", // UnderlineStyle::CurlyUnderlined
+        ";4:4", // UnderlineStyle::DottedUnderlined
+        ";4:5", // UnderlineStyle::DashedUnderlined
+    };
+    static constexpr auto intenseOrFaint = CharacterAttributes::Intense | CharacterAttributes::Faint;
+
+    const auto append = [&](std::string_view str) noexcept {
+        memcpy(out, str.data(), str.size());
+        out += str.size();
+    };
+
+    const auto previousAttrs = previous.GetCharacterAttributes();
+    const auto attrs = attributes.GetCharacterAttributes();
+
+    // SGR 22 turns off both intense and faint. If either of them needs to be turned off,
+    // we have to turn both off and then turn the remaining one back on.
+    if (auto intensity = previousAttrs & intenseOrFaint; intensity != (attrs & intenseOrFaint))
+    {
+        if (WI_IsAnyFlagSet(intensity, ~attrs))
+        {
+            append(";22");
+            intensity = CharacterAttributes::Normal;
+        }
+        if (WI_IsFlagSet(attrs, CharacterAttributes::Intense) && WI_IsFlagClear(intensity, CharacterAttributes::Intense))
+        {
+            append(";1");
+        }
+        if (WI_IsFlagSet(attrs, CharacterAttributes::Faint) && WI_IsFlagClear(intensity, CharacterAttributes::Faint))
+        {
+            append(";2");
+        }
+    }
+
+    for (const auto& mapping : mappings)
+    {
+        const auto on = WI_IsAnyFlagSet(attrs, mapping.attr);
+        if (on != WI_IsAnyFlagSet(previousAttrs, mapping.attr))
+        {
+            out = fmt::format_to(out, FMT_COMPILE(";{}"), til::at(mapping.change, on));
+        }
+    }
+
+    if (const auto style = attributes.GetUnderlineStyle(); style != previous.GetUnderlineStyle())
+    {
+        auto idx = WI_EnumValue(style);
+        if (idx >= std::size(underlineMappings))
+        {
+            idx = 1; // UnderlineStyle::SinglyUnderlined
+        }
+        append(til::at(underlineMappings, idx));
+    }
+
+    if (const auto on = attributes.IsOverlined(); on != previous.IsOverlined())
+    {
+        append(on ? ";53" : ";55");
+    }
+
+    if (const auto on = attributes.IsReverseVideo(); on != previous.IsReverseVideo())
+    {
+        append(on ? ";7" : ";27");
+    }
+
+    if (const auto color = attributes.GetForeground(); color != previous.GetForeground())
+    {
+        out = formatColor(out, color, 30);
+    }
+
+    if (const auto color = attributes.GetBackground(); color != previous.GetBackground())
+    {
+        out = formatColor(out, color, 40);
+    }
+
+    if (const auto color = attributes.GetUnderlineColor(); color != previous.GetUnderlineColor())
+    {
+        out = formatColor(out, color, 50);
+    }
+
+    return out;
+}
+
 // Formats the given console attributes to their closest VT equivalent.
 // `out` must refer to at least `formatAttributesMaxLen` characters of valid memory.
 // Returns a pointer past the end.
-static constexpr size_t formatAttributesMaxLen = 16;
+static constexpr size_t formatAttributesMaxLen = 128;
 static char* formatAttributes(char* out, const TextAttribute& attributes) noexcept
 {
-    static uint8_t sgr[] = { 30, 31, 32, 33, 34, 35, 36, 37, 90, 91, 92, 93, 94, 95, 96, 97 };
-
     // Applications expect that SetConsoleTextAttribute() completely replaces whatever attributes are currently set,
     // including any potential VT-exclusive attributes. Since we don't know what those are, we must always emit a SGR 0.
     // Copying 4 bytes instead of the correct 3 means we need just 1 DWORD mov. Neat.
-    //
-    // 3 bytes.
     memcpy(out, "\x1b[0", 4);
     out += 3;
+    out = formatAttributeParams(out, TextAttribute{}, attributes);
+    *out++ = 'm';
+    return out;
+}
 
-    // 2 bytes.
-    if (attributes.IsReverseVideo())
+// Like formatAttributes(), but assumes that the terminal already uses the `previous` attributes,
+// because they were set by formatAttributes() or formatAttributesDelta() before.
+// Emits whichever is shorter: Only the parameters that changed or a SGR 0 followed by all of them.
+// Returns `out` if nothing changed.
+static char* formatAttributesDelta(char* out, const TextAttribute& previous, const TextAttribute& attributes) noexcept
+{
+    char delta[formatAttributesMaxLen];
+    const auto deltaLen = formatAttributeParams(&delta[0], previous, attributes) - &delta[0];
+    if (deltaLen == 0)
     {
-        memcpy(out, ";7", 2);
-        out += 2;
+        return out;
     }
 
-    // 3 bytes (";97").
-    if (attributes.GetForeground().IsLegacy())
-    {
-        const uint8_t index = sgr[attributes.GetForeground().GetIndex()];
-        out = fmt::format_to(out, FMT_COMPILE(";{}"), index);
-    }
+    char full[formatAttributesMaxLen];
+    const auto fullLen = formatAttributes(&full[0], attributes) - &full[0];
 
-    // 4 bytes (";107").
-    if (attributes.GetBackground().IsLegacy())
+    // The delta still lacks the "\x1b[" and "m" and has a leading ";" that we'll skip.
+    if (deltaLen + 2 > fullLen)
     {
-        const uint8_t index = sgr[attributes.GetBackground().GetIndex()] + 10;
-        out = fmt::format_to(out, FMT_COMPILE(";{}"), index);
+        memcpy(out, &full[0], fullLen);
+        return out + fullLen;
     }
 
-    // 1 byte.
+    memcpy(out, "\x1b[", 2);
+    out += 2;
+    memcpy(out, &delta[1], deltaLen - 1);
+    out += deltaLen - 1;
     *out++ = 'm';
     return out;
 }
 
+// Packs a cell the way WriteInfos() emitted it into a non-zero InfoShadow::cells entry.
+static constexpr uint64_t infoShadowKey(wchar_t ch, WORD attributes) noexcept
+{
+    return (uint64_t{ 1 } << 32) | (uint64_t{ attributes } << 16) | uint64_t{ ch };
+}
+
 void VtIo::FormatAttributes(std::string& target, const TextAttribute& attributes)
 {
     char buf[formatAttributesMaxLen];
@@ -435,6 +635,11 @@ VtIo::Writer::Writer(VtIo* io) noexcept :
 {
     if (_io)
     {
+        if (_io->_corked == 0)
+        {
+            // If this writer gets tainted, _flushNow() discards everything from here on.
+            _io->_writerStart = _io->_back.size();
+        }
         _io->_corked += 1;
     }
 }
@@ -446,6 +651,7 @@ VtIo::Writer::~Writer() noexcept
     if (_io)
     {
         _io->_writerTainted = true;
+        _io->_invalidateInfoShadow();
         _io->_uncork();
     }
 }
@@ -470,19 +676,88 @@ void VtIo::_uncork()
     }
 }
 
+// Called whenever we write something to the terminal that may modify its cells (besides WriteInfos()).
+void VtIo::_invalidateInfoShadow() noexcept
+{
+    _infoShadow.buffer = nullptr;
+    _infoShadow.active = false;
+}
+
+// Called whenever we write something to the terminal that may change its attributes in ways we can't track.
+// This includes a DECSC, which would overwrite the attributes that our own DECRC restores.
+void VtIo::_invalidateAttributes() noexcept
+{
+    _attributes.reset();
+    _savedAttributes.reset();
+}
+
 void VtIo::_flushNow()
 {
-    size_t minSize = 0;
+    const auto now = std::chrono::steady_clock::now();
 
     if (_writerRestoreCursor)
     {
-        minSize = 4;
         _writerRestoreCursor = false;
-        _back.append("\x1b\x38"); // DECRC: DEC Restore Cursor (+ attributes)
+
+        // If nothing was written since the DECSC in BackupCursor(), we can simply drop it.
+        if (_back.size() == _writerBackupEnd)
+        {
+            _back.resize(_writerBackupEnd - 2);
+        }
+        else
+        {
+            _back.append("\x1b\x38"); // DECRC: DEC Restore Cursor (+ attributes)
+        }
+
+        _attributes = _savedAttributes;
+    }
+
+    // We encountered an exception and shouldn't flush the broken pieces.
+    // Anything that previous writers queued up is fine, however.
+    if (_writerTainted)
+    {
+        _writerTainted = false;
+        _invalidateAttributes();
+        _back.resize(std::min(_back.size(), _writerStart));
+    }
+
+    if (_back.empty())
+    {
+        return;
+    }
+
+    // No point in calling WriteFile if we already encountered ERROR_BROKEN_PIPE.
+    // We check this here, so that _back doesn't grow indefinitely.
+    if (!_hOutput)
+    {
+        _back.clear();
+        return;
     }
 
+    const auto queuedSince = _flushDeferred ? _flushDeferredSince : now;
+    _flushStats.flushes++;
+
     if (_overlappedPending)
     {
+        // While the terminal is still busy reading our previous write, we'll keep appending to _back
+        // and send it all at once later, instead of blocking this thread and following up with a tiny write.
+        // _flushWaitCallback() takes care of the flush if nothing else comes in the meantime.
+        // Once we exceed the latency budget or queued up a lot, we block like usual to apply backpressure.
+        if (!HasOverlappedIoCompleted(_overlapped) &&
+            _flushWait &&
+            _back.size() < maxDeferredFlushSize &&
+            now - queuedSince < _flushLatencyBudget)
+        {
+            if (!_flushDeferred)
+            {
+                _flushDeferred = true;
+                _flushDeferredSince = now;
+                SetThreadpoolWait(_flushWait.get(), _overlapped->hEvent, nullptr);
+            }
+            _flushStats.deferrals++;
+            return;
+        }
+
         _overlappedPending = false;
 
         DWORD written;
@@ -490,10 +765,15 @@ void VtIo::_flushNow()
         {
             // Not much we can do here. Let's treat this like a ERROR_BROKEN_PIPE.
             _hOutput.reset();
+            _back.clear();
+            _flushDeferred = false;
             SendCloseEvent();
+            return;
         }
     }
 
+    _flushDeferred = false;
+
     _front.clear();
     _front.swap(_back);
 
@@ -504,33 +784,19 @@ void VtIo::_flushNow()
         _back = std::string{};
     }
 
-    // We encountered an exception and shouldn't flush the broken pieces.
-    if (_writerTainted)
-    {
-        _writerTainted = false;
-        return;
-    }
-
-    // If _back (now _front) was empty, we can return early. If all _front contains is
-    // DECSC/DECRC that was added by BackupCursor & us, we can also return early.
-    if (_front.size() <= minSize)
-    {
-        return;
-    }
-
-    // No point in calling WriteFile if we already encountered ERROR_BROKEN_PIPE.
-    // We do this after the above, so that _back doesn't grow indefinitely.
-    if (!_hOutput)
-    {
-        return;
-    }
-
     const auto write = gsl::narrow_cast<DWORD>(_front.size());
+    const auto queueDelay = std::chrono::steady_clock::now() - queuedSince;
+
+    _flushStats.writes++;
+    _flushStats.bytes += write;
+    _flushStats.queueDelay += queueDelay;
+    _flushStats.maxQueueDelay = std::max(_flushStats.maxQueueDelay, queueDelay);
 
     TraceLoggingWrite(
         g_hConhostV2EventTraceProvider,
         "ConPTY WriteFile",
         TraceLoggingCountedUtf8String(_front.data(), write, "buffer"),
+        TraceLoggingInt64(std::chrono::duration_cast<std::chrono::microseconds>(queueDelay).count(), "queueDelayUs"),
         TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
         TraceLoggingKeyword(TIL_KEYWORD_TRACE));
 
@@ -557,17 +823,45 @@ void VtIo::_flushNow()
     }
 }
 
+// Called on a threadpool thread once the terminal finished reading our previous write,
+// if _flushNow() held back some output in the meantime.
+void NTAPI VtIo::_flushWaitCallback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WAIT, TP_WAIT_RESULT) noexcept
+{
+    const auto self = static_cast<VtIo*>(context);
+
+    LockConsole();
+    const auto unlock = wil::scope_exit([] { UnlockConsole(); });
+
+    // If a writer is still active, it'll flush once it's done.
+    if (self->_flushDeferred && self->_corked <= 0)
+    {
+        try
+        {
+            self->_flushNow();
+        }
+        CATCH_LOG();
+    }
+}
+
 void VtIo::Writer::BackupCursor() const
 {
     if (!_io->_writerRestoreCursor)
     {
         _io->_writerRestoreCursor = true;
         _io->_back.append("\x1b\x37"); // DECSC: DEC Save Cursor (+ attributes)
+        _io->_writerBackupEnd = _io->_back.size();
+        _io->_savedAttributes = _io->_attributes;
     }
 }
 
 void VtIo::Writer::WriteUTF8(std::string_view str) const
 {
+    _io->_invalidateInfoShadow();
+    // Plain text can't change the attributes, but ESC and CSI (U+009B = C2 9B in UTF-8) sequences can.
+    if (str.find_first_of("\x1b\x9b") != std::string_view::npos)
+    {
+        _io->_invalidateAttributes();
+    }
     _io->_back.append(str);
 }
 
@@ -578,6 +872,12 @@ void VtIo::Writer::WriteUTF16(std::wstring_view str) const
         return;
     }
 
+    _io->_invalidateInfoShadow();
+    if (str.find_first_of(L"\x1b\x9b") != std::wstring_view::npos)
+    {
+        _io->_invalidateAttributes();
+    }
+
     const auto existingUTF8Len = _io->_back.size();
     const auto incomingUTF16Len = str.size();
 
@@ -670,6 +970,16 @@ void VtIo::Writer::WriteUTF16StripControlChars(std::wstring_view str) const
 }
 
 void VtIo::Writer::WriteUCS2(wchar_t ch) const
+{
+    _io->_invalidateInfoShadow();
+    if (ch == L'\x1b' || ch == L'\x9b')
+    {
+        _io->_invalidateAttributes();
+    }
+    _writeUCS2(ch);
+}
+
+void VtIo::Writer::_writeUCS2(wchar_t ch) const
 {
     char buf[4];
     size_t len = 0;
@@ -731,6 +1041,10 @@ void VtIo::Writer::WriteDECAWM(bool enabled) const
 // ASB: Alternate Screen Buffer
 void VtIo::Writer::WriteASB(bool enabled) const
 {
+    // Switching to the alternate screen buffer implies a DECSC and switching back a DECRC.
+    _io->_invalidateInfoShadow();
+    _io->_invalidateAttributes();
+
     char buf[] = "\x1b[?1049h";
     buf[std::size(buf) - 2] = enabled ? 'h' : 'l';
     _io->_back.append(&buf[0], std::size(buf) - 1);
@@ -763,73 +1077,259 @@ void VtIo::Writer::WriteWindowTitle(std::wstring_view title) const
     WriteUTF8("\x1b\\");
 }
 
+// Unlike FormatAttributes(), this only emits what changed, if we know which attributes the terminal uses.
 void VtIo::Writer::WriteAttributes(const TextAttribute& attributes) const
 {
-    FormatAttributes(_io->_back, attributes);
+    auto& current = _io->_attributes;
+    char buf[formatAttributesMaxLen];
+    const auto end = current ? formatAttributesDelta(&buf[0], *current, attributes) : formatAttributes(&buf[0], attributes);
+    _io->_back.append(&buf[0], end - &buf[0]);
+    current = attributes;
+}
+
+// Allows the following WriteInfos() calls to skip cells that didn't change since a previous
+// WriteInfos() emitted them. The caller must call EndInfos() after it modified the buffer.
+void VtIo::Writer::BeginInfos(const TextBuffer& buffer) const
+{
+    auto& shadow = _io->_infoShadow;
+    const auto size = buffer.GetSize().Dimensions();
+
+    // If someone else wrote to the buffer since the last EndInfos(), we can't know what the terminal shows anymore.
+    // Writes to the terminal that bypass the buffer are caught by _invalidateInfoShadow().
+    if (shadow.buffer != &buffer || shadow.mutationId != buffer.GetLastMutationId() || shadow.size != size)
+    {
+        shadow.buffer = &buffer;
+        shadow.size = size;
+        shadow.cells.assign(size.area<size_t>(), 0);
+    }
+
+    shadow.cursor.reset();
+    shadow.active = true;
+}
+
+void VtIo::Writer::EndInfos(const TextBuffer& buffer) const
+{
+    auto& shadow = _io->_infoShadow;
+    shadow.mutationId = buffer.GetLastMutationId();
+    shadow.cursor.reset();
+    shadow.active = false;
+}
+
+// Moves the cursor to the given position with the shortest sequence we can think of.
+void VtIo::Writer::_writeCursorMove(til::point position) const
+{
+    auto& cursor = _io->_infoShadow.cursor;
+
+    if (!cursor || cursor->y != position.y)
+    {
+        WriteCUP(position);
+    }
+    else if (cursor->x < position.x)
+    {
+        // CUF: Cursor Forward
+        fmt::format_to(std::back_inserter(_io->_back), FMT_COMPILE("\x1b[{}C"), position.x - cursor->x);
+    }
+    else if (cursor->x > position.x)
+    {
+        // CHA: Cursor Horizontal Absolute
+        fmt::format_to(std::back_inserter(_io->_back), FMT_COMPILE("\x1b[{}G"), position.x + 1);
+    }
+
+    cursor = position;
 }
 
 void VtIo::Writer::WriteInfos(til::point target, std::span<const CHAR_INFO> infos) const
 {
-    const auto beg = infos.begin();
-    const auto end = infos.end();
-    const auto last = end - 1;
-    WORD attributes = 0xffff;
+    // If two changed spans are separated by at most this many unchanged cells, we emit them as one.
+    // It's about the cost of a CUF sequence and saves us from repeating the SGR sequence as well.
+    static constexpr size_t maxGap = 4;
+
+    struct Cell
+    {
+        wchar_t ch;
+        WORD attributes;
+        bool wide;
+        // Trailing halves of glyphs are ignored within the run. We only emit the leading half.
+        bool skip;
+    };
+
+    if (infos.empty())
+    {
+        return;
+    }
 
-    WriteCUP(target);
+    auto& shadow = _io->_infoShadow;
+    const auto size = infos.size();
+    const auto width = gsl::narrow_cast<size_t>(shadow.size.width);
+    const auto useShadow = shadow.active && shadow.buffer &&
+                           target.x >= 0 && target.y >= 0 && target.y < shadow.size.height &&
+                           gsl::narrow_cast<size_t>(target.x) + size <= width;
+    const auto old = useShadow ? &shadow.cells[gsl::narrow_cast<size_t>(target.y) * width + gsl::narrow_cast<size_t>(target.x)] : nullptr;
 
-    for (auto it = beg; it != end; ++it)
+    til::small_vector<Cell, 256> cells;
+    til::small_vector<uint8_t, 256> dirty;
+    cells.resize(size);
+    dirty.resize(size, 1);
+
+    for (size_t i = 0; i < size; ++i)
     {
-        const auto& ci = *it;
-        auto ch = ci.Char.UnicodeChar;
-        auto wide = WI_IsAnyFlagSet(ci.Attributes, COMMON_LVB_LEADING_BYTE | COMMON_LVB_TRAILING_BYTE);
+        const auto& ci = til::at(infos, i);
+        auto& cell = til::at(cells, i);
+        cell = { ci.Char.UnicodeChar, ci.Attributes, WI_IsAnyFlagSet(ci.Attributes, COMMON_LVB_LEADING_BYTE | COMMON_LVB_TRAILING_BYTE), false };
 
-        if (wide)
+        if (cell.wide)
         {
             if (WI_IsAnyFlagSet(ci.Attributes, COMMON_LVB_LEADING_BYTE))
             {
-                if (it == last)
+                if (i == size - 1)
                 {
                     // The leading half of a wide glyph won't fit into the last remaining column.
                     // --> Replace it with a space.
-                    ch = L' ';
-                    wide = false;
+                    cell.ch = L' ';
+                    cell.wide = false;
                 }
             }
             else
             {
-                if (it == beg)
+                if (i == 0)
                 {
                     // The trailing half of a wide glyph won't fit into the first column. It's incomplete.
                     // --> Replace it with a space.
-                    ch = L' ';
-                    wide = false;
+                    cell.ch = L' ';
+                    cell.wide = false;
                 }
                 else
                 {
-                    // Trailing halves of glyphs are ignored within the run. We only emit the leading half.
-                    continue;
+                    cell.skip = true;
                 }
             }
         }
+    }
+
+    if (old)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            const auto& cell = til::at(cells, i);
+            til::at(dirty, i) = infoShadowKey(cell.ch, cell.attributes) != old[i];
+        }
+
+        // A wide glyph must be written as a whole. This applies to the glyphs we write, as well as to the ones
+        // we overwrite, because the terminal will erase the other half of a wide glyph if we overwrite one half.
+        // We can only fix up the run's own cells, but that's no different from what the application asked for.
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (!til::at(dirty, i))
+            {
+                continue;
+            }
+
+            const auto attr = til::at(cells, i).attributes | static_cast<WORD>(old[i] >> 16);
+            if (WI_IsFlagSet(attr, COMMON_LVB_LEADING_BYTE) && i + 1 < size)
+            {
+                til::at(dirty, i + 1) = 1;
+            }
+            if (WI_IsFlagSet(attr, COMMON_LVB_TRAILING_BYTE) && i > 0)
+            {
+                til::at(dirty, i - 1) = 1;
+            }
+        }
+    }
+    else
+    {
+        // The terminal's cursor position is unrelated to our previous WriteInfos() call.
+        shadow.cursor.reset();
+    }
+
+    // WriteAttributes() skips redundant SGRs by itself. This just avoids constructing a TextAttribute for every cell.
+    std::optional<WORD> attributes;
+
+    for (size_t beg = 0; beg < size;)
+    {
+        if (!til::at(dirty, beg))
+        {
+            ++beg;
+            continue;
+        }
 
-        if (attributes != ci.Attributes)
+        // Extend the span up to the next unchanged cell, skipping over short gaps.
+        auto end = beg + 1;
+        for (;;)
         {
-            attributes = ci.Attributes;
-            WriteAttributes(TextAttribute{ attributes });
+            while (end < size && til::at(dirty, end))
+            {
+                ++end;
+            }
+
+            auto next = end;
+            while (next < size && next - end <= maxGap && !til::at(dirty, next))
+            {
+                ++next;
+            }
+
+            if (next >= size || next - end > maxGap)
+            {
+                break;
+            }
+
+            end = next;
         }
 
-        int repeat = 1;
-        if (wide && (til::is_surrogate(ch) || IsControlCharacter(ch)))
+        _writeCursorMove({ target.x + gsl::narrow_cast<til::CoordType>(beg), target.y });
+
+        for (auto i = beg; i < end; ++i)
         {
-            // Control characters, U+FFFD, etc. are narrow characters, so if the caller
-            // asked for a wide glyph we need to repeat the replacement character twice.
-            repeat++;
+            const auto& cell = til::at(cells, i);
+
+            if (old)
+            {
+                old[i] = infoShadowKey(cell.ch, cell.attributes);
+            }
+
+            if (cell.skip)
+            {
+                continue;
+            }
+
+            if (attributes != cell.attributes)
+            {
+                WriteAttributes(TextAttribute{ cell.attributes });
+                attributes = cell.attributes;
+            }
+
+            int repeat = 1;
+            if (cell.wide && (til::is_surrogate(cell.ch) || IsControlCharacter(cell.ch)))
+            {
+                // Control characters, U+FFFD, etc. are narrow characters, so if the caller
+                // asked for a wide glyph we need to repeat the replacement character twice.
+                repeat++;
+            }
+
+            do
+            {
+                _writeUCS2(SanitizeUCS2(cell.ch));
+            } while (--repeat);
         }
 
-        do
+        // If we wrote up to the right edge of the screen, the cursor is in the "delayed wrap" state.
+        // Its position is ambiguous then, so we just forget it.
+        const auto x = target.x + gsl::narrow_cast<til::CoordType>(end);
+        if (old && x < shadow.size.width)
+        {
+            shadow.cursor = til::point{ x, target.y };
+        }
+        else
         {
-            WriteUCS2(SanitizeUCS2(ch));
-        } while (--repeat);
+            shadow.cursor.reset();
+        }
+
+        beg = end;
+    }
+
+    if (!shadow.active)
+    {
+        // Outside of BeginInfos() and EndInfos() the cursor is only valid during a single call.
+        shadow.cursor.reset();
     }
 }
 
@@ -7,6 +7,7 @@
 #include "PtySignalInputThread.hpp"
 
 class ConsoleArguments;
+class TextBuffer;
 
 namespace Microsoft::Console::VirtualTerminal
 {
@@ -44,10 +45,15 @@ namespace Microsoft::Console::VirtualTerminal
             void WriteWindowVisibility(bool visible) const;
             void WriteWindowTitle(std::wstring_view title) const;
             void WriteAttributes(const TextAttribute& attributes) const;
+            void BeginInfos(const TextBuffer& buffer) const;
             void WriteInfos(til::point target, std::span<const CHAR_INFO> infos) const;
+            void EndInfos(const TextBuffer& buffer) const;
             void WriteScreenInfo(SCREEN_INFORMATION& newContext, til::size oldSize) const;
 
         private:
+            void _writeUCS2(wchar_t ch) const;
+            void _writeCursorMove(til::point position) const;
+
             VtIo* _io = nullptr;
         };
 
@@ -62,8 +68,25 @@ namespace Microsoft::Console::VirtualTerminal
         [[nodiscard]] HRESULT StartIfNeeded();
         void Shutdown() noexcept;
 
+        // Counters for the writes to the output pipe.
+        // Rates like writes per second or bytes per write can be derived from two snapshots.
+        struct FlushStatistics
+        {
+            // Number of times we had something to write. Each one may turn into a WriteFile() or be merged with the next.
+            uint64_t flushes = 0;
+            // Of those, the number of times that we held back the output, because the terminal was still busy reading.
+            uint64_t deferrals = 0;
+            uint64_t writes = 0;
+            uint64_t bytes = 0;
+            // The time between having something to write and the WriteFile() call, summed up over all writes.
+            std::chrono::steady_clock::duration queueDelay{};
+            std::chrono::steady_clock::duration maxQueueDelay{};
+        };
+
         void SetDeviceAttributes(til::enumset<DeviceAttribute, uint64_t> attributes) noexcept;
         til::enumset<DeviceAttribute, uint64_t> GetDeviceAttributes() const noexcept;
+        void SetFlushLatencyBudget(std::chrono::steady_clock::duration budget) noexcept;
+        const FlushStatistics& GetFlushStatistics() const noexcept;
         void SendCloseEvent();
         void CreatePseudoWindow();
 
@@ -79,8 +102,29 @@ namespace Microsoft::Console::VirtualTerminal
 
         [[nodiscard]] HRESULT _Initialize(const HANDLE InHandle, const HANDLE OutHandle, _In_opt_ const HANDLE SignalHandle);
 
+        // WriteInfos() keeps a copy of the cells it emitted, so that applications which redraw their
+        // entire screen via WriteConsoleOutput() every frame only cost us the cells that changed.
+        struct InfoShadow
+        {
+            // The buffer the cells belong to and its last mutation ID after EndInfos().
+            // If either changed by the next BeginInfos(), someone else wrote to the buffer.
+            const TextBuffer* buffer = nullptr;
+            uint64_t mutationId = 0;
+            til::size size;
+            // One entry per cell of the buffer in the format of infoShadowKey(). 0 if unknown.
+            std::vector<uint64_t> cells;
+            // Where the terminal's cursor is, if known.
+            // Only valid between BeginInfos() and EndInfos(), since the callers restore it via DECRC.
+            std::optional<til::point> cursor;
+            // True between BeginInfos() and EndInfos().
+            bool active = false;
+        };
+
         void _uncork();
         void _flushNow();
+        static void NTAPI _flushWaitCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_WAIT wait, TP_WAIT_RESULT waitResult) noexcept;
+        void _invalidateInfoShadow() noexcept;
+        void _invalidateAttributes() noexcept;
 
         // After CreateIoHandlers is called, these will be invalid.
         wil::unique_hfile _hInput;
@@ -103,6 +147,23 @@ namespace Microsoft::Console::VirtualTerminal
         bool _overlappedPending = false;
         bool _writerRestoreCursor = false;
         bool _writerTainted = false;
+        // The size of _back when the outermost Writer was created and right after its DECSC.
+        size_t _writerStart = 0;
+        size_t _writerBackupEnd = 0;
+        // See _flushNow(). _flushDeferred is true while _back holds output that we didn't write yet,
+        // because the terminal was still reading our previous write. _flushWait fires when it's done.
+        // Beyond maxDeferredFlushSize there's little to gain from batching up even more output.
+        static constexpr size_t maxDeferredFlushSize = 128 * 1024;
+        wil::unique_threadpool_wait _flushWait;
+        std::chrono::steady_clock::duration _flushLatencyBudget = std::chrono::milliseconds{ 2 };
+        std::chrono::steady_clock::time_point _flushDeferredSince;
+        bool _flushDeferred = false;
+        FlushStatistics _flushStats;
+        InfoShadow _infoShadow;
+        // The attributes the terminal uses, if known, because we were the last to set them.
+        // _savedAttributes are the ones that the DECSC in BackupCursor() saved and the DECRC in _flushNow() restores.
+        std::optional<TextAttribute> _attributes;
+        std::optional<TextAttribute> _savedAttributes;
 
         State _state = State::Uninitialized;
         bool _lookingForCursorPosition = false;
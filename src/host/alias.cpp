@@ -44,9 +44,90 @@ struct case_insensitive_equality
     }
 };
 
+// Doskey macros are expanded every time a command line is entered, so their targets are compiled
+// once when they're added: Into the literal text with $L, $G, $B and $T already substituted,
+// plus a list of the positions at which the $1-$9 and $* arguments need to be spliced in.
+struct AliasTarget
+{
+    // An argument index of 0 stands for $*, which is all arguments.
+    struct Splice
+    {
+        size_t offset = 0;
+        size_t arg = 0;
+    };
+
+    explicit AliasTarget(std::wstring target);
+
+    // The target as it was given to AddConsoleAlias(), which is what GetConsoleAlias(es) returns.
+    std::wstring text;
+    std::wstring literals;
+    std::vector<Splice> splices;
+    // The number of \r\n terminated lines the expansion consists of.
+    size_t lines = 0;
+    // The highest argument index any of the splices refers to.
+    size_t maxArg = 0;
+};
+
+AliasTarget::AliasTarget(std::wstring target) :
+    text{ std::move(target) }
+{
+    for (auto it = text.begin(), end = text.end(); it != end;)
+    {
+        auto ch = *it++;
+        if (ch != L'$' || it == end)
+        {
+            literals.push_back(ch);
+            continue;
+        }
+
+        // $ is our "escape character" and this code handles the escape
+        // sequence consisting of a single subsequent character.
+        ch = *it++;
+        const auto chLower = til::tolower_ascii(ch);
+        if (chLower >= L'1' && chLower <= L'9')
+        {
+            // $1-9 = append the given parameter
+            const size_t idx = chLower - L'0';
+            splices.push_back({ literals.size(), idx });
+            maxArg = std::max(maxArg, idx);
+        }
+        else if (chLower == L'*')
+        {
+            // $* = append all parameters
+            splices.push_back({ literals.size(), 0 });
+            maxArg = std::max<size_t>(maxArg, 1);
+        }
+        else if (chLower == L'l')
+        {
+            literals.push_back(L'<');
+        }
+        else if (chLower == L'g')
+        {
+            literals.push_back(L'>');
+        }
+        else if (chLower == L'b')
+        {
+            literals.push_back(L'|');
+        }
+        else if (chLower == L't')
+        {
+            literals.append(L"\r\n");
+            lines++;
+        }
+        else
+        {
+            literals.push_back(L'$');
+            literals.push_back(ch);
+        }
+    }
+
+    literals.append(L"\r\n");
+    lines++;
+}
+
 std::unordered_map<std::wstring,
                    std::unordered_map<std::wstring,
-                                      std::wstring,
+                                      AliasTarget,
                                       case_insensitive_hash,
                                       case_insensitive_equality>,
                    case_insensitive_hash,
@@ -118,7 +199,7 @@ std::unordered_map<std::wstring,
         else
         {
             // Map will auto-create each level as necessary
-            g_aliasData[exeNameString][sourceString] = targetString;
+            g_aliasData[exeNameString].insert_or_assign(std::move(sourceString), AliasTarget{ std::move(targetString) });
         }
     }
     CATCH_RETURN();
@@ -163,7 +244,7 @@ std::unordered_map<std::wstring,
     const auto& exeData = exeIter->second;
     const auto sourceIter = exeData.find(sourceString);
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), sourceIter == exeData.end());
-    const auto& targetString = sourceIter->second;
+    const auto& targetString = sourceIter->second.text;
     RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_GEN_FAILURE), targetString.size() == 0);
 
     // TargetLength is a byte count, convert to characters.
@@ -342,13 +423,13 @@ static std::wstring aliasesSeparator(L"=");
             {
                 // Alias stores lengths in bytes.
                 auto cchSource = pair.first.size();
-                auto cchTarget = pair.second.size();
+                auto cchTarget = pair.second.text.size();
 
                 // If we're counting how much multibyte space will be needed, trial convert the source and target strings before we add.
                 if (!countInUnicode)
                 {
                     cchSource = GetALengthFromW(codepage, pair.first);
-                    cchTarget = GetALengthFromW(codepage, pair.second);
+                    cchTarget = GetALengthFromW(codepage, pair.second.text);
                 }
 
                 // Accumulate all sizes to the final string count.
@@ -473,7 +554,7 @@ void Alias::s_ClearCmdExeAliases()
         {
             // Alias stores lengths in bytes.
             const auto cchSource = pair.first.size();
-            const auto cchTarget = pair.second.size();
+            const auto cchTarget = pair.second.text.size();
 
             // Add up how many characters we will need for the full alias data.
             size_t cchNeeded = 0;
@@ -503,7 +584,7 @@ void Alias::s_ClearCmdExeAliases()
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, aliasesSeparator.size(), &cchAliasBufferRemaining));
                 AliasesBufferPtrW += aliasesSeparator.size();
 
-                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, pair.second.data(), cchTarget));
+                RETURN_IF_FAILED(StringCchCopyNW(AliasesBufferPtrW, cchAliasBufferRemaining, pair.second.text.data(), cchTarget));
                 RETURN_IF_FAILED(SizeTSub(cchAliasBufferRemaining, cchTarget, &cchAliasBufferRemaining));
                 AliasesBufferPtrW += cchTarget;
 
@@ -847,126 +928,82 @@ std::wstring Alias::s_MatchAndCopyAlias(std::wstring_view sourceText, std::wstri
         return {};
     }
 
-    std::wstring_view args[10];
-    size_t argc = 0;
-
-    // Split the source string into whitespace delimited arguments.
-    for (size_t argBegIdx = 0; argBegIdx < sourceText.size();)
-    {
-        // Find the end of the current word (= argument).
-        const auto argEndIdx = sourceText.find_first_of(L' ', argBegIdx);
-        const auto str = til::safe_slice_abs(sourceText, argBegIdx, argEndIdx);
-
-        // str is empty if the text starting at argBegIdx is whitespace.
-        // This can only occur if either the source text starts with whitespace or past
-        // an argument there's only whitespace text left until the end of sourceText.
-        if (str.empty())
-        {
-            break;
-        }
-
-        args[argc] = str;
-        argc++;
-
-        if (argc >= std::size(args))
-        {
-            break;
-        }
-
-        // Find the start of the next word (= argument).
-        // If the rest of the text is only whitespace, argBegIdx will be npos
-        // and the for() loop condition will make us exit.
-        argBegIdx = sourceText.find_first_not_of(L' ', argEndIdx);
-    }
-
-    // As mentioned above, argc will be 0 if the source text starts with whitespace or only consists of whitespace.
-    if (argc == 0)
+    // The text up to the first space is the alias name. It's empty if the source text starts
+    // with whitespace or only consists of whitespace, which bypasses alias expansion.
+    const auto nameEnd = std::min(sourceText.find(L' '), sourceText.size());
+    const auto name = sourceText.substr(0, nameEnd);
+    if (name.empty())
     {
         return {};
     }
 
-    // The text up to the first space is the alias name.
-    const auto aliasIter = exeList.find(args[0]);
+    const auto aliasIter = exeList.find(name);
     if (aliasIter == exeList.end())
     {
         return {};
     }
 
     const auto& target = aliasIter->second;
-    if (target.size() == 0)
+    if (target.text.empty())
     {
         return {};
     }
 
-    std::wstring buffer;
-    size_t lines = 0;
+    std::wstring_view args[10];
+    size_t argc = 1;
+    args[0] = name;
 
-    for (auto it = target.begin(), end = target.end(); it != end;)
+    // Split the rest of the source text into whitespace delimited arguments,
+    // but only as many as the target actually refers to.
+    for (auto argBegIdx = sourceText.find_first_not_of(L' ', nameEnd); argBegIdx != std::wstring_view::npos && argc <= target.maxArg;)
     {
-        auto ch = *it++;
-        if (ch != L'$' || it == end)
-        {
-            buffer.push_back(ch);
-            continue;
-        }
+        // Find the end of the current word (= argument).
+        const auto argEndIdx = sourceText.find_first_of(L' ', argBegIdx);
+        args[argc] = til::safe_slice_abs(sourceText, argBegIdx, argEndIdx);
+        argc++;
 
-        // $ is our "escape character" and this code handles the escape
-        // sequence consisting of a single subsequent character.
-        ch = *it++;
-        const auto chLower = til::tolower_ascii(ch);
-        if (chLower >= L'1' && chLower <= L'9')
-        {
-            // $1-9 = append the given parameter
-            const size_t idx = chLower - L'0';
-            if (idx < argc)
-            {
-                buffer.append(args[idx]);
-            }
-        }
-        else if (chLower == L'*')
-        {
-            // $* = append all parameters
-            if (argc > 1)
-            {
-                // args[] is an array of slices into the source text. This appends the text
-                // starting at first argument up to the end of the source to the buffer.
-                buffer.append(args[1].data(), sourceText.data() + sourceText.size());
-            }
-        }
-        else if (chLower == L'l')
-        {
-            buffer.push_back(L'<');
-        }
-        else if (chLower == L'g')
-        {
-            buffer.push_back(L'>');
-        }
-        else if (chLower == L'b')
-        {
-            buffer.push_back(L'|');
-        }
-        else if (chLower == L't')
-        {
-            buffer.append(L"\r\n");
-            lines++;
-        }
-        else
+        // Find the start of the next word (= argument).
+        // If the rest of the text is only whitespace, argBegIdx will be npos
+        // and the for() loop condition will make us exit.
+        argBegIdx = sourceText.find_first_not_of(L' ', argEndIdx);
+    }
+
+    const auto argText = [&](size_t idx) noexcept -> std::wstring_view {
+        if (idx == 0)
         {
-            buffer.push_back(L'$');
-            buffer.push_back(ch);
+            // args[] is an array of slices into the source text. $* is the text
+            // starting at first argument up to the end of the source text.
+            return argc > 1 ? std::wstring_view{ args[1].data(), sourceText.data() + sourceText.size() } : std::wstring_view{};
         }
+        return idx < argc ? til::at(args, idx) : std::wstring_view{};
+    };
+
+    // Compute the exact length up front, so that the expansion is a single allocation and pass.
+    auto length = target.literals.size();
+    for (const auto& splice : target.splices)
+    {
+        length += argText(splice.arg).size();
     }
 
-    buffer.append(L"\r\n");
-    lines++;
+    std::wstring buffer;
+    buffer.reserve(length);
+
+    size_t literalsBeg = 0;
+    for (const auto& splice : target.splices)
+    {
+        buffer.append(target.literals, literalsBeg, splice.offset - literalsBeg);
+        buffer.append(argText(splice.arg));
+        literalsBeg = splice.offset;
+    }
+    buffer.append(target.literals, literalsBeg);
 
-    lineCount = lines;
+    lineCount = target.lines;
     return buffer;
 }
 
 void Alias::s_TestAddAlias(std::wstring exe, std::wstring alias, std::wstring target)
 {
-    g_aliasData[std::move(exe)][std::move(alias)] = std::move(target);
+    g_aliasData[std::move(exe)].insert_or_assign(std::move(alias), AliasTarget{ std::move(target) });
 }
 
 void Alias::s_TestClearAliases()
@@ -418,7 +418,6 @@ CATCH_RETURN();
 {
     try
     {
-        const auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
         auto& storageBuffer = context.GetActiveBuffer();
         const auto storageRectangle = storageBuffer.GetBufferSize();
         const auto clippedRectangle = storageRectangle.Clamp(requestRectangle);
@@ -444,16 +443,11 @@ CATCH_RETURN();
             return E_INVALIDARG;
         }
 
+        const auto& textBuffer = storageBuffer.GetTextBuffer();
+
         for (til::CoordType y = clippedRectangle.Top(); y <= clippedRectangle.BottomInclusive(); y++)
         {
-            auto it = storageBuffer.GetCellDataAt({ clippedRectangle.Left(), y });
-
-            for (size_t i = 0; i < width; i++)
-            {
-                targetBuffer[totalOffset + i] = gci.AsCharInfo(*it);
-                ++it;
-            }
-
+            textBuffer.ReadCharInfos({ clippedRectangle.Left(), y }, targetBuffer.subspan(totalOffset, width));
             totalOffset += bufferStride;
         }
 
@@ -539,14 +533,22 @@ CATCH_RETURN();
 
         auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
         auto writer = gci.GetVtWriterForBuffer(&context);
+        auto& textBuffer = storageBuffer.GetTextBuffer();
+
+        if (writer)
+        {
+            // Applications like to redraw their entire screen every frame, even if little changed.
+            // This allows WriteInfos() to only emit the cells that differ from what it wrote previously.
+            writer.BeginInfos(textBuffer);
+        }
 
         for (til::CoordType y = clippedRectangle.Top(); y <= clippedRectangle.BottomInclusive(); y++)
         {
             const auto charInfos = buffer.subspan(totalOffset, width);
             const til::point target{ clippedRectangle.Left(), y };
 
-            // Make the iterator and write to the target position.
-            storageBuffer.Write(OutputCellIterator(charInfos), target);
+            // Like SCREEN_INFORMATION::Write(), this marks the row as wrapped if we write up to its end.
+            textBuffer.WriteCharInfos(target, charInfos, true);
 
             if (writer)
             {
@@ -557,13 +559,14 @@ CATCH_RETURN();
         }
 
         // If we've overwritten image content, it needs to be erased.
-        ImageSlice::EraseBlock(storageBuffer.GetTextBuffer(), clippedRectangle.ToExclusive());
+        ImageSlice::EraseBlock(textBuffer, clippedRectangle.ToExclusive());
 
         // Since we've managed to write part of the request, return the clamped part that we actually used.
         writtenRectangle = clippedRectangle;
 
         if (writer)
         {
+            writer.EndInfos(textBuffer);
             writer.Submit();
         }
 
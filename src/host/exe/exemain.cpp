@@ -5,6 +5,7 @@
 
 #include "ConsoleArguments.hpp"
 #include "srvinit.h"
+#include "../server/ApiStats.h"
 #include "../server/Entrypoints.h"
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../inc/conint.h"
@@ -222,7 +223,7 @@ int CALLBACK wWinMain(
     _In_ PWSTR /*pwszCmdLine*/,
     _In_ int /*nCmdShow*/)
 {
-    TraceLoggingRegister(g_hConhostV2EventTraceProvider);
+    TraceLoggingRegisterEx(g_hConhostV2EventTraceProvider, &ApiStats::s_TraceProviderCallback, nullptr);
     wil::SetResultLoggingCallback(&Tracing::TraceFailure);
     Microsoft::Console::Interactivity::ServiceLocator::LocateGlobals().hInstance = hInstance;
 
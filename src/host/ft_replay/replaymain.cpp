@@ -0,0 +1,521 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Replays a console API recording (see ApiRecorder.h) against an in-process console
+// without a driver and reports how long the server took for each API.
+//
+//   OpenConsoleReplay.exe [--vt] <recording.conapi>
+//
+// The console is always headless. With --vt it runs in ConPTY mode and emits VT into NUL,
+// which allows comparing the cost of the VT emission against the plain buffer operations.
+
+#include "precomp.h"
+
+#include "../ConsoleArguments.hpp"
+#include "../history.h"
+#include "../srvinit.h"
+#include "../../interactivity/inc/ServiceLocator.hpp"
+#include "../../server/ApiRecorder.h"
+#include "../../server/ApiSorter.h"
+#include "../../server/IoSorter.h"
+
+using namespace ApiRecording;
+using Microsoft::Console::Interactivity::ServiceLocator;
+
+namespace
+{
+    struct Input
+    {
+        ULONG offset = 0;
+        std::span<const BYTE> data;
+    };
+
+    struct Request
+    {
+        CD_IO_DESCRIPTOR descriptor{};
+        const BYTE* packet = nullptr;
+        int64_t timestamp = 0;
+        std::vector<Input> inputs;
+
+        bool completed = false;
+        int64_t completedAt = 0;
+        NTSTATUS status = 0;
+        ULONG_PTR information = 0;
+        std::span<const BYTE> write;
+    };
+
+    struct Recording
+    {
+        std::vector<BYTE> data;
+        std::vector<Request> requests;
+        int64_t frequency = 0;
+    };
+
+    struct Stats
+    {
+        size_t calls = 0;
+        int64_t recorded = 0;
+        int64_t replayed = 0;
+    };
+
+    uint64_t key(const LUID& luid) noexcept
+    {
+        return (uint64_t{ static_cast<uint32_t>(luid.HighPart) } << 32) | luid.LowPart;
+    }
+
+    std::vector<BYTE> loadFile(const wchar_t* path)
+    {
+        wil::unique_hfile file{ CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+        THROW_LAST_ERROR_IF(!file);
+
+        LARGE_INTEGER size;
+        THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(file.get(), &size));
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE), size.QuadPart > UINT32_MAX);
+
+        std::vector<BYTE> data(gsl::narrow_cast<size_t>(size.QuadPart));
+        DWORD read = 0;
+        THROW_IF_WIN32_BOOL_FALSE(ReadFile(file.get(), data.data(), gsl::narrow_cast<DWORD>(data.size()), &read, nullptr));
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_HANDLE_EOF), read != data.size());
+        return data;
+    }
+
+    Recording parse(std::vector<BYTE> data)
+    {
+        static constexpr auto invalid = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        Recording recording;
+        recording.data = std::move(data);
+        const std::span<const BYTE> bytes{ recording.data };
+
+        FileHeader fileHeader;
+        THROW_HR_IF(invalid, bytes.size() < sizeof(fileHeader));
+        memcpy(&fileHeader, bytes.data(), sizeof(fileHeader));
+        THROW_HR_IF_MSG(invalid, memcmp(&fileHeader.magic[0], &Magic[0], sizeof(Magic)) != 0, "not a console API recording");
+        THROW_HR_IF_MSG(invalid, fileHeader.pointerSize != sizeof(void*) || fileHeader.packetSize != PacketSize, "recorded on a different architecture");
+        recording.frequency = fileHeader.frequency;
+
+        // Inputs and completions belong to the latest request with the same identifier.
+        std::unordered_map<uint64_t, size_t> latest;
+
+        for (auto offset = sizeof(fileHeader); offset < bytes.size();)
+        {
+            EventHeader header;
+            THROW_HR_IF(invalid, bytes.size() - offset < sizeof(header));
+            memcpy(&header, bytes.data() + offset, sizeof(header));
+            offset += sizeof(header);
+
+            THROW_HR_IF(invalid, bytes.size() - offset < header.size);
+            const auto payload = bytes.subspan(offset, header.size);
+            offset += header.size;
+
+            if (header.type == EventType::Request)
+            {
+                THROW_HR_IF(invalid, payload.size() != PacketSize);
+                auto& request = recording.requests.emplace_back();
+                memcpy(&request.descriptor, payload.data(), sizeof(request.descriptor));
+                request.packet = payload.data();
+                request.timestamp = header.timestamp;
+                latest.insert_or_assign(key(header.identifier), recording.requests.size() - 1);
+                continue;
+            }
+
+            const auto it = latest.find(key(header.identifier));
+            if (it == latest.end())
+            {
+                continue;
+            }
+
+            auto& request = til::at(recording.requests, it->second);
+
+            if (header.type == EventType::Input)
+            {
+                InputEvent event;
+                THROW_HR_IF(invalid, payload.size() < sizeof(event));
+                memcpy(&event, payload.data(), sizeof(event));
+                request.inputs.push_back({ event.offset, payload.subspan(sizeof(event)) });
+            }
+            else if (header.type == EventType::Completion)
+            {
+                CompletionEvent event;
+                THROW_HR_IF(invalid, payload.size() < sizeof(event));
+                memcpy(&event, payload.data(), sizeof(event));
+                request.completed = true;
+                request.completedAt = header.timestamp;
+                request.status = event.status;
+                request.information = event.information;
+                request.write = payload.subspan(sizeof(event));
+            }
+        }
+
+        return recording;
+    }
+
+    // Stands in for the driver. It serves the recorded input of each request and
+    // translates the handle values of the recording into the replay's objects.
+    class ReplayDeviceComm : public IDeviceComm
+    {
+    public:
+        HRESULT SetServerInformation(CD_IO_SERVER_INFORMATION* const) const override
+        {
+            return S_OK;
+        }
+        HRESULT ReadIo(PCONSOLE_API_MSG const, CONSOLE_API_MSG* const) const override
+        {
+            // The requests are dispatched by the replay loop on the main thread.
+            // The easiest way to get the IO thread out of the way is to suspend it.
+            SuspendThread(GetCurrentThread());
+            return S_FALSE;
+        }
+        HRESULT CompleteIo(CD_IO_COMPLETE* const pCompletion) const override
+        {
+            // CONSOLE_IO_CREATE_OBJECT completes its own requests. The new handle is the information.
+            const auto request = _find(pCompletion->Identifier);
+            if (request &&
+                request->descriptor.Function == CONSOLE_IO_CREATE_OBJECT &&
+                request->completed &&
+                NT_SUCCESS(request->status) &&
+                NT_SUCCESS(pCompletion->IoStatus.Status))
+            {
+                _handles->insert_or_assign(request->information, reinterpret_cast<void*>(pCompletion->IoStatus.Information));
+            }
+            return S_OK;
+        }
+        HRESULT ReadInput(CD_IO_OPERATION* const pIoOperation) const override
+        {
+            const auto request = _find(pIoOperation->Identifier);
+            RETURN_HR_IF_NULL(E_UNEXPECTED, request);
+
+            const auto offset = pIoOperation->Buffer.Offset;
+            const auto size = pIoOperation->Buffer.Size;
+            for (const auto& input : request->inputs)
+            {
+                if (input.offset <= offset && size_t{ offset } + size <= input.offset + input.data.size())
+                {
+                    memcpy(pIoOperation->Buffer.Data, input.data.data() + (offset - input.offset), size);
+                    return S_OK;
+                }
+            }
+
+            RETURN_HR(E_BOUNDS);
+        }
+        HRESULT WriteOutput(CD_IO_OPERATION* const pIoOperation) const override
+        {
+            *_outputBytes += pIoOperation->Buffer.Size;
+            return S_OK;
+        }
+        HRESULT AllowUIAccess() const override
+        {
+            return S_OK;
+        }
+        ULONG_PTR PutHandle(const void* handle) override
+        {
+            return reinterpret_cast<ULONG_PTR>(handle);
+        }
+        void* GetHandle(ULONG_PTR handle) const override
+        {
+            const auto it = _handles->find(handle);
+            return it != _handles->end() ? it->second : nullptr;
+        }
+        HRESULT GetServerHandle(HANDLE* pHandle) const override
+        {
+            *pHandle = nullptr;
+            return E_NOTIMPL;
+        }
+
+        void Begin(const Request& request)
+        {
+            _inflight->insert_or_assign(key(request.descriptor.Identifier), &request);
+        }
+
+        // Maps a handle value of the recording to an object of the replay.
+        void Map(ULONG_PTR recorded, void* replayed)
+        {
+            _handles->insert_or_assign(recorded, replayed);
+        }
+
+        void Unmap(ULONG_PTR recorded)
+        {
+            _handles->erase(recorded);
+        }
+
+        bool IsMapped(ULONG_PTR recorded) const
+        {
+            return _handles->contains(recorded);
+        }
+
+        uint64_t OutputBytes() const noexcept
+        {
+            return *_outputBytes;
+        }
+
+    private:
+        const Request* _find(const LUID& identifier) const
+        {
+            const auto it = _inflight->find(key(identifier));
+            return it != _inflight->end() ? it->second : nullptr;
+        }
+
+        // IDeviceComm is all const, but the callbacks of the server need to update our state.
+        std::unique_ptr<std::unordered_map<ULONG_PTR, void*>> _handles = std::make_unique<std::unordered_map<ULONG_PTR, void*>>();
+        std::unique_ptr<std::unordered_map<uint64_t, const Request*>> _inflight = std::make_unique<std::unordered_map<uint64_t, const Request*>>();
+        std::unique_ptr<uint64_t> _outputBytes = std::make_unique<uint64_t>(0);
+    };
+
+    class Replayer
+    {
+    public:
+        explicit Replayer(Recording recording) :
+            _recording{ std::move(recording) }
+        {
+        }
+
+        void Start(bool vt)
+        {
+            auto& globals = ServiceLocator::LocateGlobals();
+            globals.hInstance = wil::GetModuleInstanceHandle();
+            globals.pDeviceComm = &_comm; // before ConsoleServerInitialization() creates a ConDrvDeviceComm
+
+            // In ConPTY mode the VT output goes into NUL and the VT input is a pipe nobody writes to.
+            if (vt)
+            {
+                wil::unique_hfile input;
+                THROW_IF_WIN32_BOOL_FALSE(CreatePipe(input.addressof(), _vtInputWriter.addressof(), nullptr, 0));
+                wil::unique_hfile output{ CreateFileW(L"NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr) };
+                THROW_LAST_ERROR_IF(!output);
+                _args = ConsoleArguments{ L"OpenConsoleReplay.exe --headless", input.release(), output.release() };
+            }
+            else
+            {
+                _args = ConsoleArguments{ L"OpenConsoleReplay.exe --headless", nullptr, nullptr };
+            }
+
+            THROW_IF_FAILED(_args.ParseCommandline());
+
+            // It's safe to pass INVALID_HANDLE_VALUE here, because we've set our own device comm above.
+            THROW_IF_NTSTATUS_FAILED(ConsoleCreateIoThreadLegacy(INVALID_HANDLE_VALUE, &_args));
+        }
+
+        void Run()
+        {
+            for (const auto& request : _recording.requests)
+            {
+                switch (request.descriptor.Function)
+                {
+                case CONSOLE_IO_CONNECT:
+                    _connect(request);
+                    break;
+                case CONSOLE_IO_DISCONNECT:
+                    // Disconnecting the last client would tear down the console. Just forget the handles instead.
+                    _comm.Unmap(request.descriptor.Process);
+                    break;
+                default:
+                    _dispatch(request);
+                    break;
+                }
+            }
+        }
+
+        void PrintSummary() const
+        {
+            const auto ms = [](int64_t ticks, int64_t frequency) {
+                return static_cast<double>(ticks) * 1000.0 / static_cast<double>(frequency);
+            };
+
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+
+            fmt::print(FMT_COMPILE("{:<32} {:>8} {:>14} {:>14}\n"), "API", "Calls", "Recorded [ms]", "Replayed [ms]");
+
+            Stats total;
+            for (const auto& [name, stats] : _stats)
+            {
+                fmt::print(FMT_COMPILE("{:<32} {:>8} {:>14.3f} {:>14.3f}\n"), name, stats.calls, ms(stats.recorded, _recording.frequency), ms(stats.replayed, frequency.QuadPart));
+                total.calls += stats.calls;
+                total.recorded += stats.recorded;
+                total.replayed += stats.replayed;
+            }
+
+            fmt::print(FMT_COMPILE("{:<32} {:>8} {:>14.3f} {:>14.3f}\n"), "Total", total.calls, ms(total.recorded, _recording.frequency), ms(total.replayed, frequency.QuadPart));
+            fmt::print(FMT_COMPILE("\n{} requests skipped (unknown process), {} still waiting, {} bytes of output\n"), _skipped, _pending, _comm.OutputBytes());
+        }
+
+    private:
+        // The real connect routine deals with process handles, policies, handoff and the console window.
+        // We only need the bookkeeping: a process with an input and output handle each.
+        void _connect(const Request& request)
+        {
+            CD_CONNECTION_INFORMATION info;
+            if (!request.completed || !NT_SUCCESS(request.status) || request.write.size() < sizeof(info))
+            {
+                return;
+            }
+            memcpy(&info, request.write.data(), sizeof(info));
+
+            CONSOLE_API_MSG message;
+            memcpy(&message.Descriptor, request.packet, PacketSize);
+            message._pDeviceComm = &_comm;
+            message._pApiRoutines = ServiceLocator::LocateGlobals().api;
+            _comm.Begin(request);
+
+            CONSOLE_API_CONNECTINFO cac;
+            THROW_IF_NTSTATUS_FAILED(ConsoleInitializeConnectInfo(&message, &cac));
+
+            auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+            gci.LockConsole();
+            const auto unlock = wil::scope_exit([&]() { gci.UnlockConsole(); });
+
+            // Made-up process IDs, so that we don't accidentally open an unrelated process.
+            const auto processId = 0x80000000 | gsl::narrow_cast<DWORD>(++_connects * 4);
+            ConsoleProcessHandle* process = nullptr;
+            THROW_IF_FAILED(gci.ProcessHandleList.AllocProcessData(processId, 0, cac.ProcessGroupId, &process));
+            process->fRootProcess = WI_IsFlagClear(gci.Flags, CONSOLE_INITIALIZED);
+
+            // The first client determines the console's initial state, just like with the real thing.
+            if (WI_IsFlagClear(gci.Flags, CONSOLE_INITIALIZED))
+            {
+                THROW_IF_NTSTATUS_FAILED(ConsoleAllocateConsole(&cac));
+                WI_SetFlag(gci.Flags, CONSOLE_INITIALIZED);
+            }
+
+            CommandHistory::s_Allocate({ cac.AppName, cac.AppNameLength / sizeof(wchar_t) }, (HANDLE)process);
+
+            THROW_IF_FAILED(gci.pInputBuffer->AllocateIoHandle(ConsoleHandleData::HandleType::Input,
+                                                               GENERIC_READ | GENERIC_WRITE,
+                                                               FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                                               process->pInputHandle));
+            THROW_IF_FAILED(gci.GetActiveOutputBuffer().GetMainBuffer().AllocateIoHandle(ConsoleHandleData::HandleType::Output,
+                                                                                         GENERIC_READ | GENERIC_WRITE,
+                                                                                         FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                                                                         process->pOutputHandle));
+
+            _comm.Map(info.Process, process);
+            _comm.Map(info.Input, process->pInputHandle.get());
+            _comm.Map(info.Output, process->pOutputHandle.get());
+        }
+
+        void _dispatch(const Request& request)
+        {
+            // Without a process, most dispatchers would dereference nullptr.
+            if (!_comm.IsMapped(request.descriptor.Process))
+            {
+                _skipped++;
+                return;
+            }
+
+            CONSOLE_API_MSG message;
+            memcpy(&message.Descriptor, request.packet, PacketSize);
+            message._pDeviceComm = &_comm;
+            message._pApiRoutines = ServiceLocator::LocateGlobals().api;
+            _comm.Begin(request);
+
+            PCONSOLE_API_MSG reply = nullptr;
+
+            LARGE_INTEGER begin;
+            LARGE_INTEGER end;
+            QueryPerformanceCounter(&begin);
+            IoSorter::ServiceIoOperation(&message, &reply);
+            if (reply)
+            {
+                reply->ReleaseMessageBuffers();
+            }
+            QueryPerformanceCounter(&end);
+
+            // A read that waited for the user's input would wait forever here,
+            // unless the recording happens to contain a WriteConsoleInput that satisfies it.
+            if (!reply && request.descriptor.Function != CONSOLE_IO_CREATE_OBJECT)
+            {
+                _pending++;
+            }
+
+            if (request.descriptor.Function == CONSOLE_IO_CLOSE_OBJECT)
+            {
+                _comm.Unmap(request.descriptor.Object);
+            }
+
+            auto& stats = _stats[_name(request)];
+            stats.calls++;
+            stats.replayed += end.QuadPart - begin.QuadPart;
+            if (request.completed)
+            {
+                stats.recorded += request.completedAt - request.timestamp;
+            }
+        }
+
+        static std::string_view _name(const Request& request)
+        {
+            switch (request.descriptor.Function)
+            {
+            case CONSOLE_IO_USER_DEFINED:
+            {
+                CONSOLE_MSG_HEADER header;
+                memcpy(&header, request.packet + sizeof(CD_IO_DESCRIPTOR), sizeof(header));
+                const auto name = ApiSorter::GetApiName(header.ApiNumber);
+                return name ? name : "Invalid";
+            }
+            case CONSOLE_IO_CREATE_OBJECT:
+                return "CreateObject";
+            case CONSOLE_IO_CLOSE_OBJECT:
+                return "CloseObject";
+            case CONSOLE_IO_RAW_WRITE:
+                return "RawWrite";
+            case CONSOLE_IO_RAW_READ:
+                return "RawRead";
+            case CONSOLE_IO_RAW_FLUSH:
+                return "RawFlush";
+            default:
+                return "Unknown";
+            }
+        }
+
+        Recording _recording;
+        ReplayDeviceComm _comm;
+        ConsoleArguments _args;
+        wil::unique_hfile _vtInputWriter;
+        std::map<std::string_view, Stats> _stats;
+        size_t _connects = 0;
+        size_t _skipped = 0;
+        size_t _pending = 0;
+    };
+}
+
+int __cdecl wmain(int argc, wchar_t* argv[])
+{
+    auto vt = false;
+    const wchar_t* path = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (wcscmp(argv[i], L"--vt") == 0)
+        {
+            vt = true;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    if (!path)
+    {
+        fmt::print(FMT_COMPILE("usage: OpenConsoleReplay.exe [--vt] <recording.conapi>\n"));
+        return 1;
+    }
+
+    try
+    {
+        // The replayer is referenced by the console's globals until we exit. Leak it.
+        const auto replayer = new Replayer{ parse(loadFile(path)) };
+        replayer->Start(vt);
+        replayer->Run();
+        replayer->PrintSummary();
+    }
+    catch (...)
+    {
+        const auto hr = wil::ResultFromCaughtException();
+        fmt::print(FMT_COMPILE("replay failed: {:#010x}\n"), static_cast<uint32_t>(hr));
+        return 1;
+    }
+
+    fflush(stdout);
+    ServiceLocator::RundownAndExit(S_OK);
+}
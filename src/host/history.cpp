@@ -120,7 +120,7 @@ void CommandHistory::_Reset()
             // find free record.  if all records are used, free the lru one.
             if (GetNumberOfCommands() == _maxCommands)
             {
-                _commands.erase(_commands.cbegin());
+                _Erase(0);
                 // move LastDisplayed back one in order to stay synced with the
                 // command it referred to before erasing the lru one
                 --LastDisplayed;
@@ -129,11 +129,11 @@ void CommandHistory::_Reset()
             // add newCommand to array
             if (!reuse.empty())
             {
-                _commands.emplace_back(reuse);
+                _Append(std::move(reuse));
             }
             else
             {
-                _commands.emplace_back(newCommand);
+                _Append(std::wstring{ newCommand });
             }
 
             if (LastDisplayed == -1 ||
@@ -210,7 +210,7 @@ std::wstring_view CommandHistory::GetLastCommand() const
 
 void CommandHistory::Empty()
 {
-    _commands.clear();
+    _Clear();
     LastDisplayed = -1;
     WI_SetFlag(Flags, CLE_RESET);
 }
@@ -243,7 +243,13 @@ void CommandHistory::Realloc(const Index commands)
         return;
     }
 
-    _commands.resize(std::min(_commands.size(), gsl::narrow_cast<size_t>(std::max(0, commands))));
+    const auto size = std::min(_commands.size(), gsl::narrow_cast<size_t>(std::max(0, commands)));
+    if (size != _commands.size())
+    {
+        _commands.resize(size);
+        _sequences.resize(size);
+        _RebuildSorted();
+    }
 
     WI_SetFlag(Flags, CLE_RESET);
     LastDisplayed = GetNumberOfCommands() - 1;
@@ -348,7 +354,7 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
     {
         if (!SameApp)
         {
-            BestCandidate->_commands.clear();
+            BestCandidate->_Clear();
             BestCandidate->LastDisplayed = -1;
             BestCandidate->_appName = appName;
         }
@@ -364,6 +370,64 @@ CommandHistory* CommandHistory::s_Allocate(const std::wstring_view appName, cons
     return nullptr;
 }
 
+void CommandHistory::_Clear() noexcept
+{
+    _commands.clear();
+    _sequences.clear();
+    _sorted.clear();
+}
+
+void CommandHistory::_Append(std::wstring&& command)
+{
+    _commands.emplace_back(std::move(command));
+    _sequences.emplace_back(_nextSequence++);
+    _InsertSorted(GetNumberOfCommands() - 1);
+}
+
+std::wstring CommandHistory::_Erase(const Index index)
+{
+    _sorted.erase(_FindSorted(index));
+    auto command = std::move(til::at(_commands, index));
+    _commands.erase(_commands.begin() + index);
+    _sequences.erase(_sequences.begin() + index);
+    return command;
+}
+
+// Returns the index of the command with the given sequence number.
+// This works, because _sequences is sorted in ascending order.
+CommandHistory::Index CommandHistory::_IndexOf(const uint64_t sequence) const noexcept
+{
+    const auto it = std::lower_bound(_sequences.begin(), _sequences.end(), sequence);
+    return gsl::narrow_cast<Index>(it - _sequences.begin());
+}
+
+std::wstring_view CommandHistory::_CommandOf(const uint64_t sequence) const noexcept
+{
+    return til::at(_commands, _IndexOf(sequence));
+}
+
+// Returns the position in _sorted at which the command at the given index is (or would be) stored.
+std::vector<uint64_t>::const_iterator CommandHistory::_FindSorted(const Index index) const noexcept
+{
+    const std::pair key{ std::wstring_view{ til::at(_commands, index) }, til::at(_sequences, index) };
+    return std::lower_bound(_sorted.begin(), _sorted.end(), key, [&](const uint64_t sequence, const auto& k) {
+        return std::pair{ _CommandOf(sequence), sequence } < k;
+    });
+}
+
+void CommandHistory::_InsertSorted(const Index index)
+{
+    _sorted.insert(_FindSorted(index), til::at(_sequences, index));
+}
+
+void CommandHistory::_RebuildSorted()
+{
+    _sorted = _sequences;
+    std::sort(_sorted.begin(), _sorted.end(), [&](const uint64_t lhs, const uint64_t rhs) {
+        return std::pair{ _CommandOf(lhs), lhs } < std::pair{ _CommandOf(rhs), rhs };
+    });
+}
+
 CommandHistory::Index CommandHistory::GetNumberOfCommands() const
 {
     return gsl::narrow_cast<Index>(_commands.size());
@@ -412,8 +476,7 @@ std::wstring CommandHistory::Remove(const Index iDel)
         return {};
     }
 
-    const auto str = std::move(_commands.at(iDel));
-    _commands.erase(_commands.begin() + iDel);
+    auto str = _Erase(iDel);
 
     if (LastDisplayed == iDel)
     {
@@ -455,25 +518,45 @@ std::wstring CommandHistory::Remove(const Index iDel)
         return true;
     }
 
-    try
+    if (indexFound < 0 || indexFound >= GetNumberOfCommands())
     {
-        for (size_t i = 0; i < _commands.size(); i++)
-        {
-            const auto& storedCommand = _commands.at(indexFound);
-            if ((WI_IsFlagClear(options, MatchOptions::ExactMatch) && (givenCommand.size() <= storedCommand.size())) || (givenCommand.size() == storedCommand.size()))
-            {
-                if (til::starts_with(storedCommand, givenCommand))
-                {
-                    return true;
-                }
-            }
+        return false;
+    }
+
+    const auto exactMatch = WI_IsFlagSet(options, MatchOptions::ExactMatch);
+
+    // All commands that start with (or are equal to) givenCommand form a contiguous range in _sorted.
+    const auto beg = std::lower_bound(_sorted.begin(), _sorted.end(), givenCommand, [&](const uint64_t sequence, const std::wstring_view& command) {
+        return _CommandOf(sequence) < command;
+    });
+    const auto end = std::partition_point(beg, _sorted.end(), [&](const uint64_t sequence) {
+        const auto command = _CommandOf(sequence);
+        return exactMatch ? command == givenCommand : til::starts_with(command, givenCommand);
+    });
 
-            _Prev(indexFound);
+    // We're looking for the most recent match at or before indexFound.
+    // If there's none, we wrap around and look for the most recent match overall.
+    const auto startingSequence = til::at(_sequences, indexFound);
+    std::optional<uint64_t> before;
+    std::optional<uint64_t> after;
+
+    for (auto it = beg; it != end; ++it)
+    {
+        auto& best = *it <= startingSequence ? before : after;
+        if (!best || *it > *best)
+        {
+            best = *it;
         }
     }
-    CATCH_LOG();
 
-    return false;
+    const auto found = before ? before : after;
+    if (!found)
+    {
+        return false;
+    }
+
+    indexFound = _IndexOf(*found);
+    return true;
 }
 
 #ifdef UNIT_TESTING
@@ -495,7 +578,12 @@ void CommandHistory::Swap(const Index indexA, const Index indexB)
         indexA >= 0 && indexA < num &&
         indexB >= 0 && indexB < num)
     {
+        // The sequence numbers stay in place, but their position in _sorted depends on the strings.
+        _sorted.erase(_FindSorted(indexA));
+        _sorted.erase(_FindSorted(indexB));
         std::swap(_commands.at(indexA), _commands.at(indexB));
+        _InsertSorted(indexA);
+        _InsertSorted(indexB);
     }
 }
 
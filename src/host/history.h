@@ -64,6 +64,15 @@ public:
 
 private:
     void _Reset();
+    void _Clear() noexcept;
+    void _Append(std::wstring&& command);
+    std::wstring _Erase(Index index);
+
+    Index _IndexOf(uint64_t sequence) const noexcept;
+    std::wstring_view _CommandOf(uint64_t sequence) const noexcept;
+    std::vector<uint64_t>::const_iterator _FindSorted(Index index) const noexcept;
+    void _InsertSorted(Index index);
+    void _RebuildSorted();
 
     // _Next and _Prev go to the next and prev command
     // _Inc  and _Dec go to the next and prev slots
@@ -78,6 +87,14 @@ private:
     std::vector<std::wstring> _commands;
     Index _maxCommands = 0;
 
+    // Each command gets a sequence number, which is strictly increasing in the order of _commands.
+    // Unlike indices into _commands they remain stable when older commands get removed.
+    std::vector<uint64_t> _sequences;
+    // The sequence numbers of all commands sorted by their string (and then by sequence number).
+    // This allows FindMatchingCommand() to binary search for prefixes and duplicates.
+    std::vector<uint64_t> _sorted;
+    uint64_t _nextSequence = 0;
+
     std::wstring _appName;
     HANDLE _processHandle = nullptr;
 
@@ -167,16 +167,15 @@ size_t InputBuffer::ConsumeCached(bool isUnicode, size_t count, InputEventQueue&
 {
     _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
 
-    size_t i = 0;
+    const auto n = std::min(count, _cachedInputEvents.size());
 
-    while (i < count && !_cachedInputEvents.empty())
+    for (const auto& slice : _cachedInputEvents.slices(0, n))
     {
-        target.push_back(std::move(_cachedInputEvents.front()));
-        _cachedInputEvents.pop_front();
-        i++;
+        target.insert(target.end(), slice.begin(), slice.end());
     }
 
-    return i;
+    _cachedInputEvents.pop_front(n);
+    return n;
 }
 
 // Copies up to `count`, previously cached events into `target`.
@@ -184,20 +183,14 @@ size_t InputBuffer::PeekCached(bool isUnicode, size_t count, InputEventQueue& ta
 {
     _switchReadingMode(isUnicode ? ReadingMode::InputEventsW : ReadingMode::InputEventsA);
 
-    size_t i = 0;
+    const auto n = std::min(count, _cachedInputEvents.size());
 
-    for (const auto& e : _cachedInputEvents)
+    for (const auto& slice : _cachedInputEvents.slices(0, n))
     {
-        if (i >= count)
-        {
-            break;
-        }
-
-        target.push_back(e);
-        i++;
+        target.insert(target.end(), slice.begin(), slice.end());
     }
 
-    return i;
+    return n;
 }
 
 // Trims `source` to have a size below or equal to `expectedSourceSize` by
@@ -208,10 +201,7 @@ void InputBuffer::Cache(bool isUnicode, InputEventQueue& source, size_t expected
 
     if (source.size() > expectedSourceSize)
     {
-        _cachedInputEvents.insert(
-            _cachedInputEvents.end(),
-            std::make_move_iterator(source.begin() + expectedSourceSize),
-            std::make_move_iterator(source.end()));
+        _cachedInputEvents.append({ source.data() + expectedSourceSize, source.size() - expectedSourceSize });
         source.resize(expectedSourceSize);
     }
 }
@@ -232,7 +222,7 @@ void InputBuffer::_switchReadingModeSlowPath(ReadingMode mode)
     _cachedTextW = std::wstring{};
     _cachedTextReaderW = {};
 
-    _cachedInputEvents = std::deque<INPUT_RECORD>{};
+    _cachedInputEvents = til::ring_buffer<INPUT_RECORD>{};
 
     _readingMode = mode;
 }
@@ -333,6 +323,7 @@ size_t InputBuffer::GetNumberOfReadyEvents() const noexcept
 void InputBuffer::Flush()
 {
     _storage.clear();
+    _releaseStorageIfLarge();
     ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
 }
 
@@ -346,10 +337,9 @@ void InputBuffer::Flush()
 // - The console lock must be held when calling this routine.
 void InputBuffer::FlushAllButKeys()
 {
-    auto newEnd = std::remove_if(_storage.begin(), _storage.end(), [](const INPUT_RECORD& event) {
+    _storage.remove_if([](const INPUT_RECORD& event) {
         return event.EventType != KEY_EVENT;
     });
-    _storage.erase(newEnd, _storage.end());
 }
 
 // Routine Description:
@@ -390,14 +380,29 @@ try
         ConsumeCached(Unicode, AmountToRead, OutEvents);
     }
 
-    auto it = _storage.begin();
-    const auto end = _storage.end();
+    const auto size = _storage.size();
+    size_t i = 0;
 
-    while (it != end && OutEvents.size() < AmountToRead)
+    if (Unicode && !Stream)
     {
-        if (it->EventType == KEY_EVENT)
+        // Fast path: Without stream reads and A/W conversion each record is returned as-is.
+        // This allows us to copy them over in bulk, which is a lot faster for large pastes.
+        i = std::min(AmountToRead - OutEvents.size(), size);
+        OutEvents.reserve(OutEvents.size() + i);
+
+        for (const auto& slice : _storage.slices(0, i))
         {
-            auto event = *it;
+            OutEvents.insert(OutEvents.end(), slice.begin(), slice.end());
+        }
+    }
+
+    while (i < size && OutEvents.size() < AmountToRead)
+    {
+        auto& record = _storage[i];
+
+        if (record.EventType == KEY_EVENT)
+        {
+            auto event = record;
             WORD repeat = 1;
 
             // for stream reads we need to split any key events that have been coalesced
@@ -440,21 +445,21 @@ try
 
             if (repeat && !Peek)
             {
-                it->Event.KeyEvent.wRepeatCount = repeat;
+                record.Event.KeyEvent.wRepeatCount = repeat;
                 break;
             }
         }
         else
         {
-            OutEvents.push_back(*it);
+            OutEvents.push_back(record);
         }
 
-        ++it;
+        ++i;
     }
 
     if (!Peek)
     {
-        _storage.erase(_storage.begin(), it);
+        _storage.pop_front(i);
     }
 
     Cache(Unicode, OutEvents, AmountToRead);
@@ -465,6 +470,7 @@ try
     }
     if (_storage.empty())
     {
+        _releaseStorageIfLarge();
         ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
     }
     return STATUS_SUCCESS;
@@ -499,16 +505,16 @@ size_t InputBuffer::Prepend(const std::span<const INPUT_RECORD>& inEvents)
         // this way to handle any coalescing that might occur.
 
         // get all of the existing records, "emptying" the buffer
-        std::deque<INPUT_RECORD> existingStorage;
+        til::ring_buffer<INPUT_RECORD> existingStorage;
         existingStorage.swap(_storage);
 
         // write the prepend records
         size_t prependEventsWritten;
         _WriteBuffer(inEvents, prependEventsWritten);
 
-        for (const auto& event : existingStorage)
+        for (const auto& slice : existingStorage.slices(0, existingStorage.size()))
         {
-            _storage.push_back(event);
+            _storage.append(slice);
         }
 
         return prependEventsWritten;
@@ -681,19 +687,34 @@ void InputBuffer::_WriteBuffer(const std::span<const INPUT_RECORD>& inEvents, _O
     const auto initialInEventsSize = inEvents.size();
     const auto vtInputMode = IsInVirtualTerminalInputMode();
 
-    for (const auto& inEvent : inEvents)
+    // Events that are neither intercepted, nor coalesced, nor processed by VT are stored as-is.
+    // Instead of pushing them one by one, we accumulate them in the range [runBeg, i) and
+    // append them in bulk whenever we encounter an event that needs special treatment.
+    size_t runBeg = 0;
+    // Stores the current run up to (but excluding) `end` and starts the next one after it.
+    const auto flushRun = [&](size_t end) {
+        _storage.append(inEvents.subspan(runBeg, end - runBeg));
+        eventsWritten += end - runBeg;
+        runBeg = end + 1;
+    };
+
+    for (size_t i = 0; i < initialInEventsSize; ++i)
     {
+        const auto& inEvent = til::at(inEvents, i);
+
         if (inEvent.EventType == KEY_EVENT && inEvent.Event.KeyEvent.bKeyDown)
         {
             // if output is suspended, any keyboard input releases it.
             if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) && !IsSystemKey(inEvent.Event.KeyEvent.wVirtualKeyCode))
             {
+                flushRun(i);
                 UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
                 continue;
             }
             // intercept control-s
             if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && IsPauseKey(inEvent.Event.KeyEvent))
             {
+                flushRun(i);
                 WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
                 continue;
             }
@@ -708,6 +729,7 @@ void InputBuffer::_WriteBuffer(const std::span<const INPUT_RECORD>& inEvents, _O
             // GH#11682: TerminalInput::HandleKey can handle both KeyEvents and Focus events seamlessly
             if (const auto out = _termInput.HandleKey(inEvent))
             {
+                flushRun(i);
                 _writeString(*out);
                 eventsWritten++;
                 continue;
@@ -725,8 +747,21 @@ void InputBuffer::_WriteBuffer(const std::span<const INPUT_RECORD>& inEvents, _O
         }
 
         // At this point, the event was neither coalesced, nor processed by VT.
-        _storage.push_back(inEvent);
-        ++eventsWritten;
+        // It'll be stored by the next flushRun() as part of the current run.
+    }
+
+    flushRun(initialInEventsSize);
+}
+
+// Large pastes may grow _storage to many MB. Once they've been read we release that memory,
+// while small buffers are kept around, since they'd just be allocated again on the next keystroke.
+void InputBuffer::_releaseStorageIfLarge() noexcept
+{
+    static constexpr size_t maxRetainedCapacity = 4096;
+
+    if (_storage.empty() && _storage.capacity() > maxRetainedCapacity)
+    {
+        _storage = til::ring_buffer<INPUT_RECORD>{};
     }
 }
 
@@ -10,7 +10,7 @@
 #include "../server/ObjectHeader.h"
 #include "../terminal/input/terminalInput.hpp"
 
-#include <deque>
+#include <til/ring_buffer.h>
 
 namespace Microsoft::Console::Render
 {
@@ -76,10 +76,10 @@ private:
     std::string_view _cachedTextReaderA;
     std::wstring _cachedTextW;
     std::wstring_view _cachedTextReaderW;
-    std::deque<INPUT_RECORD> _cachedInputEvents;
+    til::ring_buffer<INPUT_RECORD> _cachedInputEvents;
     ReadingMode _readingMode = ReadingMode::StringA;
 
-    std::deque<INPUT_RECORD> _storage;
+    til::ring_buffer<INPUT_RECORD> _storage;
     INPUT_RECORD _writePartialByteSequence{};
     bool _writePartialByteSequenceAvailable = false;
     Microsoft::Console::VirtualTerminal::TerminalInput _termInput;
@@ -97,6 +97,7 @@ private:
     void _switchReadingMode(ReadingMode mode);
     void _switchReadingModeSlowPath(ReadingMode mode);
     void _WriteBuffer(const std::span<const INPUT_RECORD>& inRecords, _Out_ size_t& eventsWritten);
+    void _releaseStorageIfLarge() noexcept;
     bool _CoalesceEvent(const INPUT_RECORD& inEvent) noexcept;
     void _writeString(const std::wstring_view& text);
 
@@ -924,14 +924,38 @@ void COOKED_READ_DATA::_redisplay()
     {
         cursorPositionFinal = { originInViewport.x, 0 };
 
+        // Lines that lie entirely before the dirty part of the buffer and the cursor haven't changed
+        // and so we can reuse their previous layout. We step back one more line, because the first
+        // changed character may still affect where the preceding line wraps (e.g. if it turns the
+        // previous grapheme cluster into a wide glyph that doesn't fit onto the line anymore).
+        size_t reuse = 0;
+        if (_lineLayoutsWidth == size.width && _lineLayoutsOriginX == originInViewport.x)
+        {
+            const auto firstChange = std::min(_bufferDirtyBeg, _bufferCursor);
+            const auto it = std::lower_bound(_lineLayouts.begin(), _lineLayouts.end(), firstChange, [](const LineLayout& layout, size_t offset) {
+                return layout.offset < offset;
+            });
+            reuse = gsl::narrow_cast<size_t>(std::max<ptrdiff_t>(0, it - _lineLayouts.begin() - 2));
+        }
+
+        const auto start = reuse < _lineLayouts.size() ? til::at(_lineLayouts, reuse) : LineLayout{ .columnBegin = originInViewport.x };
+        _lineLayouts.resize(reuse);
+
+        for (const auto& layout : _lineLayouts)
+        {
+            // The text of these lines is only needed if they need to be redrawn. See _materializeLine().
+            lines.push_back({ .dirtyBegColumn = layout.columnEnd, .columns = layout.columnEnd, .materialized = false });
+        }
+
         // Construct the first line manually so that it starts at the correct horizontal position.
-        LayoutResult res{ .column = cursorPositionFinal.x };
-        lines.emplace_back(std::wstring{}, 0, cursorPositionFinal.x, cursorPositionFinal.x);
+        LayoutResult res{ .column = start.columnBegin };
+        lines.emplace_back(std::wstring{}, 0, start.columnBegin, start.columnBegin);
+        _lineLayouts.push_back(start);
 
         // Split the buffer into 3 segments, so that we can find the row/column coordinates of
         // the cursor within the buffer, as well as the start of the dirty parts of the buffer.
         const size_t offsets[]{
-            0,
+            start.offset,
             std::min(_bufferDirtyBeg, _bufferCursor),
             std::max(_bufferDirtyBeg, _bufferCursor),
             npos,
@@ -953,11 +977,13 @@ void COOKED_READ_DATA::_redisplay()
                 if (res.column >= size.width)
                 {
                     lines.emplace_back();
+                    _lineLayouts.push_back({ .offset = offsets[i] + beg });
                 }
 
                 auto& line = lines.back();
                 res = _layoutLine(line.text, segment, beg, line.columns, size.width);
                 line.columns = res.column;
+                _lineLayouts.back().columnEnd = res.column;
 
                 if (!dirty)
                 {
@@ -975,6 +1001,9 @@ void COOKED_READ_DATA::_redisplay()
             }
         }
 
+        _lineLayoutsWidth = size.width;
+        _lineLayoutsOriginX = originInViewport.x;
+
         pagerPromptEnd = { res.column, gsl::narrow_cast<til::CoordType>(lines.size() - 1) };
 
         // If the content got a little shorter than it was before, we need to erase the tail end.
@@ -1189,7 +1218,9 @@ void COOKED_READ_DATA::_redisplay()
         {
             // We may not be scrolling with VT, because we're scrolling by more rows than the pagerHeight.
             // Since no one is now clearing the scrolled in rows for us anymore, we need to do it ourselves.
-            auto& lastLine = lines.at(pagerHeight - 1 + pagerContentTop);
+            const auto lastIndex = gsl::narrow_cast<size_t>(pagerHeight - 1 + pagerContentTop);
+            _materializeLine(lines, lastIndex, size.width);
+            auto& lastLine = lines.at(lastIndex);
             if (lastLine.columns < size.width)
             {
                 lastLine.text.append(L"\x1b[K");
@@ -1199,6 +1230,7 @@ void COOKED_READ_DATA::_redisplay()
         // Mark each row that has been uncovered by the scroll as dirty.
         for (auto i = beg; i < end; i++)
         {
+            _materializeLine(lines, gsl::narrow_cast<size_t>(i + pagerContentTop), size.width);
             auto& line = lines.at(i + pagerContentTop);
             line.dirtyBegOffset = 0;
             line.dirtyBegColumn = 0;
@@ -1392,6 +1424,23 @@ outerLoopExit:
     };
 }
 
+// Lines that were reused from _lineLayouts don't have any text, because usually they don't need to be redrawn.
+// If they do, for instance because they got scrolled back into view, this lays them out again.
+void COOKED_READ_DATA::_materializeLine(std::vector<Line>& lines, const size_t index, const til::CoordType columnLimit) const
+{
+    auto& line = lines.at(index);
+    if (line.materialized)
+    {
+        return;
+    }
+
+    const auto& layout = til::at(_lineLayouts, index);
+    line.text.clear();
+    _layoutLine(line.text, _buffer, layout.offset, layout.columnBegin, columnLimit);
+    line.dirtyBegOffset = line.text.size();
+    line.materialized = true;
+}
+
 void COOKED_READ_DATA::_appendCUP(std::wstring& output, til::point pos)
 {
     fmt::format_to(std::back_inserter(output), FMT_COMPILE(L"\x1b[{};{}H"), pos.y + 1, pos.x + 1);
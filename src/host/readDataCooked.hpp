@@ -119,6 +119,16 @@ private:
         size_t dirtyBegOffset = 0;
         til::CoordType dirtyBegColumn = 0;
         til::CoordType columns = 0;
+        // false if the line was reused from _lineLayouts and `text` is still empty.
+        bool materialized = true;
+    };
+
+    // Where a line of _buffer starts and ends, as computed by _redisplay().
+    struct LineLayout
+    {
+        size_t offset = 0;
+        til::CoordType columnBegin = 0;
+        til::CoordType columnEnd = 0;
     };
 
     static size_t _wordPrev(const std::wstring_view& chars, size_t position);
@@ -137,6 +147,7 @@ private:
     void _setCursorPosition(size_t position) noexcept;
     void _redisplay();
     LayoutResult _layoutLine(std::wstring& output, const std::wstring_view& input, size_t inputOffset, til::CoordType columnBegin, til::CoordType columnLimit) const;
+    void _materializeLine(std::vector<Line>& lines, size_t index, til::CoordType columnLimit) const;
     static void _appendCUP(std::wstring& output, til::point pos);
     void _appendPopupAttr(std::wstring& output) const;
 
@@ -168,6 +179,13 @@ private:
     bool _redrawPending = false;
     bool _clearPending = false;
 
+    // The layout of each line of _buffer from the previous _redisplay(). The lines before the first dirty
+    // one are reused, so that typing into a long prompt doesn't require laying out all of it each time.
+    // It's only valid for the viewport width and origin column it was computed with.
+    std::vector<LineLayout> _lineLayouts;
+    til::CoordType _lineLayoutsWidth = 0;
+    til::CoordType _lineLayoutsOriginX = 0;
+
     std::optional<til::point> _originInViewport;
     // This value is in the pager coordinate space. (0,0) is the first character of the
     // first line, independent on where the prompt actually appears on the screen.
@@ -87,7 +87,7 @@ std::span<const til::point_span> RenderData::GetSearchHighlights() const noexcep
 //      operation.
 //   Callers should make sure to also call RenderData::UnlockConsole once
 //      they're done with any querying they need to do.
-void RenderData::LockConsole() noexcept
+void RenderData::LockConsole(til::lock_stats::site /*site*/) noexcept
 {
     auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
     gci.LockConsole();
@@ -101,6 +101,20 @@ void RenderData::UnlockConsole() noexcept
     gci.UnlockConsole();
 }
 
+// Method Description:
+// - The console lock has no shared mode, so this is the same as RenderData::LockConsole.
+void RenderData::LockConsoleShared(til::lock_stats::site site) noexcept
+{
+    LockConsole(site);
+}
+
+// Method Description:
+// - Unlocks the console after a call to RenderData::LockConsoleShared.
+void RenderData::UnlockConsoleShared() noexcept
+{
+    UnlockConsole();
+}
+
 TimerDuration RenderData::GetBlinkInterval() noexcept
 {
     if (!_cursorBlinkInterval)
@@ -187,9 +201,14 @@ std::wstring RenderData::GetHyperlinkCustomId(uint16_t id) const
 }
 
 // For now, we ignore regex patterns in conhost
-std::vector<size_t> RenderData::GetPatternId(const til::point /*location*/) const
+std::pmr::vector<size_t> RenderData::GetPatternId(const til::point /*location*/, std::pmr::memory_resource* resource) const
 {
-    return {};
+    return std::pmr::vector<size_t>{ resource };
+}
+
+bool RenderData::HasPatternAt(const til::point /*location*/) const noexcept
+{
+    return false;
 }
 
 // Routine Description:
@@ -22,8 +22,10 @@ public:
     std::span<const til::point_span> GetSearchHighlights() const noexcept override;
     const til::point_span* GetSearchHighlightFocused() const noexcept override;
     std::span<const til::point_span> GetSelectionSpans() const noexcept override;
-    void LockConsole() noexcept override;
+    void LockConsole(til::lock_stats::site site = til::lock_stats::site::current()) noexcept override;
     void UnlockConsole() noexcept override;
+    void LockConsoleShared(til::lock_stats::site site = til::lock_stats::site::current()) noexcept override;
+    void UnlockConsoleShared() noexcept override;
 
     Microsoft::Console::Render::TimerDuration GetBlinkInterval() noexcept override;
     ULONG GetCursorPixelWidth() const noexcept override;
@@ -31,7 +33,8 @@ public:
     std::wstring_view GetConsoleTitle() const noexcept override;
     std::wstring GetHyperlinkUri(uint16_t id) const override;
     std::wstring GetHyperlinkCustomId(uint16_t id) const override;
-    std::vector<size_t> GetPatternId(const til::point location) const override;
+    std::pmr::vector<size_t> GetPatternId(const til::point location, std::pmr::memory_resource* resource) const override;
+    bool HasPatternAt(const til::point location) const noexcept override;
 
     std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& attr) const noexcept override;
     bool IsSelectionActive() const override;
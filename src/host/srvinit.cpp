@@ -11,6 +11,7 @@
 #include "../interactivity/base/ApiDetector.hpp"
 #include "../interactivity/base/RemoteConsoleControl.hpp"
 #include "../interactivity/inc/ServiceLocator.hpp"
+#include "../server/ApiRecorder.h"
 #include "../server/ConDrvDeviceComm.h"
 #include "../server/DeviceHandle.h"
 #include "../server/IoSorter.h"
@@ -36,7 +37,7 @@ try
     if (!Globals.pDeviceComm)
     {
         // in rare circumstances (such as in the fuzzing harness), there will already be a device comm
-        Globals.pDeviceComm = new ConDrvDeviceComm(Server);
+        Globals.pDeviceComm = ApiRecorder::s_Wrap(new ConDrvDeviceComm(Server));
     }
 
     Globals.launchArgs = *args;
@@ -509,7 +510,7 @@ try
     // message. Usually, we'd create the ConDrvDeviceComm later, in
     // ConsoleServerInitialization, but we can set it up early here.
     // ConsoleServerInitialization will safely no-op if it already finds one.
-    g.pDeviceComm = new ConDrvDeviceComm(Server);
+    g.pDeviceComm = ApiRecorder::s_Wrap(new ConDrvDeviceComm(Server));
     // load bearing: if you don't set this, the ConsoleInitializeConnectInfo will fail.
     connectMessage->_pDeviceComm = g.pDeviceComm;
     CONSOLE_API_CONNECTINFO Cac;
@@ -968,6 +969,13 @@ DWORD WINAPI ConsoleIoThread(LPVOID lpParameter)
         ReceiveMsg = *capturedMessage.get();
         ReceiveMsg._pApiRoutines = globals.api;
         ReceiveMsg._pDeviceComm = globals.pDeviceComm;
+
+        // This message was read from the driver by the console server that handed off to us.
+        if (const auto recorder = ApiRecorder::s_Get())
+        {
+            recorder->RecordRequest(ReceiveMsg);
+        }
+
         IoSorter::ServiceIoOperation(&ReceiveMsg, &ReplyMsg);
     }
 
@@ -24,7 +24,7 @@ enum TraceKeywords
     Output = 0x008, // _DBGOUTPUT
     General = 0x100,
     Input = 0x200,
-    //API = 0x400, // No longer used
+    API = 0x400, // ApiStats (server/ApiStats.cpp)
     UIA = 0x800,
     CookedRead = 0x1000,
     ConsoleAttachDetach = 0x2000,
@@ -180,4 +180,22 @@ class AliasTests
         VERIFY_IS_TRUE(buffer.empty());
         VERIFY_ARE_EQUAL(1u, dwLines);
     }
+
+    TEST_METHOD(TestMatchAndCopyMissingArguments)
+    {
+        std::wstring exe(L"exe.exe");
+        std::wstring source(L"source");
+        std::wstring target(L"x $*$t$1 $5 y");
+        Alias::s_TestAddAlias(exe, source, target);
+
+        // Arguments that weren't given expand to nothing. The alias name is matched case-insensitively.
+        size_t dwLines = 0;
+        auto buffer = Alias::s_MatchAndCopyAlias(L"SOURCE", exe, dwLines);
+        VERIFY_ARE_EQUAL(String(L"x \r\n  y\r\n"), String(buffer.c_str()));
+        VERIFY_ARE_EQUAL(2u, dwLines);
+
+        buffer = Alias::s_MatchAndCopyAlias(L"Source a   b", exe, dwLines);
+        VERIFY_ARE_EQUAL(String(L"x a   b\r\na  y\r\n"), String(buffer.c_str()));
+        VERIFY_ARE_EQUAL(2u, dwLines);
+    }
 };
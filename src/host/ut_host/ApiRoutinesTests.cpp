@@ -15,6 +15,7 @@
 #include "../interactivity/inc/ServiceLocator.hpp"
 
 using namespace Microsoft::Console::Types;
+using namespace WEX::Common;
 using namespace WEX::Logging;
 using namespace WEX::TestExecution;
 using Microsoft::Console::Interactivity::ServiceLocator;
@@ -169,6 +170,61 @@ class ApiRoutinesTests
         VerifySetConsoleInputModeImpl(S_OK, ENABLE_EXTENDED_FLAGS);
     }
 
+    BEGIN_TEST_METHOD(CookedReadTypingPerformance)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD()
+
+    void CookedReadTypingPerformance()
+    {
+        // The prompt is long enough to wrap across hundreds of lines, so that a
+        // full relayout on every keystroke would be clearly visible in the timings.
+        static constexpr size_t pasteSize = 64 * 1024;
+        static constexpr size_t typedChars = 1000;
+
+        m_state->PrepareReadHandle();
+        auto cleanupReadHandle = wil::scope_exit([&]() { m_state->CleanupReadHandle(); });
+        m_state->PrepareCookedReadData();
+        auto cleanupCookedRead = wil::scope_exit([&]() { m_state->CleanupCookedReadData(); });
+
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto& readData = gci.CookedReadData();
+        auto& inputBuffer = *gci.pInputBuffer;
+
+        gci.LockConsole();
+        auto Unlock = wil::scope_exit([&] { gci.UnlockConsole(); });
+
+        size_t numBytes = 0;
+        ULONG controlKeyState = 0;
+
+        std::wstring paste(pasteSize, L'a');
+        for (size_t i = 0; i < paste.size(); ++i)
+        {
+            paste[i] = static_cast<wchar_t>(L'a' + i % 26);
+        }
+
+        const auto beg = std::chrono::steady_clock::now();
+
+        inputBuffer.WriteString(paste);
+        VERIFY_IS_FALSE(readData.Read(true, numBytes, controlKeyState));
+
+        const auto pasted = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < typedChars; ++i)
+        {
+            const wchar_t wch = L'x';
+            inputBuffer.WriteString({ &wch, 1 });
+            VERIFY_IS_FALSE(readData.Read(true, numBytes, controlKeyState));
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        Log::Comment(String().Format(L"paste: %.3fms, %zu keystrokes: %.3fms (%.3fus each)",
+                                     std::chrono::duration<double, std::milli>(pasted - beg).count(),
+                                     typedChars,
+                                     std::chrono::duration<double, std::milli>(end - pasted).count(),
+                                     std::chrono::duration<double, std::micro>(end - pasted).count() / typedChars));
+    }
+
     TEST_METHOD(ApiSetConsoleInputModeImplEchoOnLineOff)
     {
         Log::Comment(L"Set ECHO on with LINE off. It's invalid, but it should get set anyway and return an error code.");
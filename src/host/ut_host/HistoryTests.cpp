@@ -242,6 +242,43 @@ class HistoryTests
         VERIFY_ARE_EQUAL(2, history->GetNumberOfCommands());
     }
 
+    TEST_METHOD(FindMatchingCommand)
+    {
+        auto history = CommandHistory::s_Allocate(_manyApps[0], _MakeHandle(0));
+        VERIFY_IS_NOT_NULL(history);
+
+        VERIFY_SUCCEEDED(history->Add(L"dir", false));
+        VERIFY_SUCCEEDED(history->Add(L"cd foo", false));
+        VERIFY_SUCCEEDED(history->Add(L"dir /w", false));
+        VERIFY_SUCCEEDED(history->Add(L"cd bar", false));
+
+        const auto prefix = CommandHistory::MatchOptions::JustLooking;
+        const auto exact = CommandHistory::MatchOptions::JustLooking | CommandHistory::MatchOptions::ExactMatch;
+        CommandHistory::Index index = 0;
+
+        // Prefix searches walk backwards from the starting index and wrap around.
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"dir", 3, index, prefix));
+        VERIFY_ARE_EQUAL(2, index);
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"dir", 2, index, prefix));
+        VERIFY_ARE_EQUAL(0, index);
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"dir", 0, index, prefix));
+        VERIFY_ARE_EQUAL(2, index);
+        VERIFY_IS_FALSE(history->FindMatchingCommand(L"dir /p", 3, index, prefix));
+
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"dir", 3, index, exact));
+        VERIFY_ARE_EQUAL(0, index);
+
+        // The index must keep up with commands moving around.
+        history->Swap(0, 1);
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"dir", 3, index, exact));
+        VERIFY_ARE_EQUAL(1, index);
+
+        VERIFY_ARE_EQUAL(String(L"dir"), String(history->Remove(1).c_str()));
+        VERIFY_IS_FALSE(history->FindMatchingCommand(L"dir", 2, index, exact));
+        VERIFY_IS_TRUE(history->FindMatchingCommand(L"dir", 2, index, prefix));
+        VERIFY_ARE_EQUAL(1, index);
+    }
+
 private:
     const std::array<std::wstring, 5> _manyApps = {
         L"foo.exe",
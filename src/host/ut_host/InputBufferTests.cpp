@@ -9,6 +9,7 @@
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../types/inc/IInputEvent.hpp"
 
+using namespace WEX::Common;
 using namespace WEX::Logging;
 using Microsoft::Console::Interactivity::ServiceLocator;
 
@@ -614,4 +615,98 @@ class InputBufferTests
         VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount);
         VERIFY_ARE_EQUAL(outEvents.front().Event.KeyEvent.wRepeatCount, 1u);
     }
+
+    BEGIN_TEST_METHOD(PastePerformance)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD()
+
+    void PastePerformance()
+    {
+        // A 1MB paste turns into 2 records (key down and up) per character.
+        static constexpr size_t pasteSize = 1024 * 1024;
+        // The typical buffer size used by clients calling ReadConsoleInputW.
+        static constexpr size_t readSize = 4096;
+
+        InputBuffer inputBuffer;
+        InputEventQueue events;
+        for (size_t i = 0; i < pasteSize; ++i)
+        {
+            const auto wch = static_cast<WCHAR>(L'a' + i % 26);
+            events.push_back(MakeKeyEvent(TRUE, 1, wch, 0, wch, 0));
+            events.push_back(MakeKeyEvent(FALSE, 1, wch, 0, wch, 0));
+        }
+
+        const auto beg = std::chrono::steady_clock::now();
+
+        VERIFY_ARE_EQUAL(events.size(), inputBuffer.Write(events));
+
+        const auto written = std::chrono::steady_clock::now();
+
+        size_t read = 0;
+        InputEventQueue outEvents;
+        while (inputBuffer.GetNumberOfReadyEvents() != 0)
+        {
+            outEvents.clear();
+            VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, readSize, false, false, true, false));
+            read += outEvents.size();
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        Log::Comment(String().Format(L"records: %zu, write: %.3fms, read: %.3fms",
+                                     read,
+                                     std::chrono::duration<double, std::milli>(written - beg).count(),
+                                     std::chrono::duration<double, std::milli>(end - written).count()));
+
+        VERIFY_ARE_EQUAL(events.size(), read);
+    }
+
+    BEGIN_TEST_METHOD(MouseMovePerformance)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD()
+
+    void MouseMovePerformance()
+    {
+        static constexpr size_t iterations = 1000000;
+
+        InputBuffer inputBuffer;
+        INPUT_RECORD mouseRecord{};
+        mouseRecord.EventType = MOUSE_EVENT;
+        mouseRecord.Event.MouseEvent.dwEventFlags = MOUSE_MOVED;
+
+        INPUT_RECORD keyRecord = MakeKeyEvent(FALSE, 1, L'a', 0, L'a', 0);
+
+        // A high rate stream of mouse moves, which are coalesced as long as the
+        // client doesn't read them, occasionally interrupted by other records
+        // and a client that reads in small batches, like most TUIs do.
+        const auto beg = std::chrono::steady_clock::now();
+
+        size_t read = 0;
+        InputEventQueue outEvents;
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            mouseRecord.Event.MouseEvent.dwMousePosition.X = static_cast<SHORT>(i % 120);
+            mouseRecord.Event.MouseEvent.dwMousePosition.Y = static_cast<SHORT>(i % 30);
+            inputBuffer.Write(mouseRecord);
+
+            if (i % 8 == 0)
+            {
+                inputBuffer.Write(keyRecord);
+            }
+            if (i % 64 == 0)
+            {
+                outEvents.clear();
+                VERIFY_NT_SUCCESS(inputBuffer.Read(outEvents, 16, false, false, true, false));
+                read += outEvents.size();
+            }
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        Log::Comment(String().Format(L"writes: %zu, records read: %zu, pending: %zu, %.0f writes/s",
+                                     iterations,
+                                     read,
+                                     inputBuffer.GetNumberOfReadyEvents(),
+                                     iterations / std::chrono::duration<double>(end - beg).count()));
+    }
 };
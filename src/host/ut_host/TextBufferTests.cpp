@@ -97,6 +97,7 @@ class TextBufferTests
     TEST_METHOD(TestGetLastNonSpaceCharacter);
 
     TEST_METHOD(TestIncrementCircularBuffer);
+    TEST_METHOD(TestIncrementCircularBufferDefersReset);
 
     TEST_METHOD(TestMixedRgbAndLegacyForeground);
     TEST_METHOD(TestMixedRgbAndLegacyBackground);
@@ -148,11 +149,17 @@ class TextBufferTests
 
     TEST_METHOD(GetTextRects);
     TEST_METHOD(GetPlainText);
+    TEST_METHOD(SerializeInChunks);
 
     TEST_METHOD(HyperlinkTrim);
     TEST_METHOD(NoHyperlinkTrim);
+    TEST_METHOD(HyperlinkStress);
 
     TEST_METHOD(ReflowPromptRegions);
+
+    TEST_METHOD(MarkIndexFollowsCircularBuffer);
+
+    TEST_METHOD(CharInfosMatchCellIterators);
 };
 
 void TextBufferTests::TestBufferCreate()
@@ -461,11 +468,48 @@ void TextBufferTests::TestIncrementCircularBuffer()
         VERIFY_ARE_EQUAL(textBuffer._firstRow, iNextRowIndex); // first row has incremented
         VERIFY_ARE_NOT_EQUAL(textBuffer.GetRowByOffset(0), FirstRow); // the old first row is no longer the first
 
-        // ensure old first row has been emptied
+        // ensure old first row has been emptied once it's accessed again
+        VERIFY_IS_TRUE(FirstRow.IsResetPending());
+        VERIFY_ARE_EQUAL(&FirstRow, &textBuffer.GetRowByOffset(sBufferHeight - 1));
+        VERIFY_IS_FALSE(FirstRow.IsResetPending());
         VERIFY_IS_FALSE(FirstRow.ContainsText());
     }
 }
 
+void TextBufferTests::TestIncrementCircularBufferDefersReset()
+{
+    TextBuffer buffer{ { 10, 3 }, {}, 0, false, &_renderer };
+
+    TextAttribute fill;
+    fill.SetIndexedBackground(TextColor::DARK_RED);
+
+    auto& row = buffer.GetMutableRowByOffset(0);
+    row.ReplaceCharacters(0, 2, L"\U0001F600");
+    row.SetWrapForced(true);
+    row.SetLineRendition(LineRendition::DoubleWidth);
+
+    Log::Comment(L"Recycling a row only resets its attributes right away.");
+    buffer.IncrementCircularBuffer(fill);
+    VERIFY_IS_TRUE(row.IsResetPending());
+    VERIFY_ARE_EQUAL(fill, row.GetAttrByColumn(0));
+
+    Log::Comment(L"Recycling it again before it was accessed keeps the reset pending with the new attributes.");
+    buffer.IncrementCircularBuffer(fill);
+    buffer.IncrementCircularBuffer(fill);
+    buffer.IncrementCircularBuffer(TextAttribute{});
+    VERIFY_IS_TRUE(row.IsResetPending());
+    VERIFY_ARE_EQUAL(TextAttribute{}, row.GetAttrByColumn(0));
+
+    Log::Comment(L"Accessing the row finishes the reset.");
+    const auto& accessed = buffer.GetRowByOffset(2);
+    VERIFY_ARE_EQUAL(&row, &accessed);
+    VERIFY_IS_FALSE(accessed.IsResetPending());
+    VERIFY_IS_FALSE(accessed.ContainsText());
+    VERIFY_IS_FALSE(accessed.WasWrapForced());
+    VERIFY_ARE_EQUAL(LineRendition::SingleWidth, accessed.GetLineRendition());
+    VERIFY_ARE_EQUAL(std::wstring_view{ L"          " }, accessed.GetText());
+}
+
 void TextBufferTests::TestMixedRgbAndLegacyForeground()
 {
     auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
@@ -2604,6 +2648,71 @@ void TextBufferTests::GetPlainText()
     }
 }
 
+void TextBufferTests::SerializeInChunks()
+{
+    const til::size bufferSize{ 80, 2000 };
+    TextBuffer buffer{ bufferSize, TextAttribute{ 0x7 }, 0, false, &_renderer };
+
+    for (til::CoordType y = 0; y < bufferSize.height; ++y)
+    {
+        RowWriteState state{ .text = fmt::format(L"{:0>80}", y) };
+        buffer.Replace(y, TextAttribute{ gsl::narrow_cast<WORD>(y % 16) }, state);
+    }
+
+    const auto req = TextBuffer::CopyRequest::FromConfig(buffer, { 0, 0 }, { 79, bufferSize.height - 1 }, false, false, false);
+    const auto getColors = [](const TextAttribute&) { return std::tuple<COLORREF, COLORREF, COLORREF>{}; };
+
+    Log::Comment(L"The chunks add up to the same text as GetPlainText()");
+    {
+        std::wstring text;
+        size_t chunks = 0;
+        const auto ok = buffer.SerializePlainText(req, [&](const std::wstring_view chunk) {
+            VERIFY_IS_LESS_THAN(chunk.size(), 2 * TextBuffer::SerializeChunkSize);
+            text.append(chunk);
+            chunks++;
+            return true;
+        });
+        VERIFY_IS_TRUE(ok);
+        VERIFY_IS_GREATER_THAN(chunks, 1u);
+        VERIFY_ARE_EQUAL(buffer.GetPlainText(req), text);
+    }
+
+    Log::Comment(L"GenHTML() patches in a clipboard header that matches the document");
+    {
+        const auto html = buffer.GenHTML(req, 12, L"Consolas", 0, false, getColors);
+        VERIFY_IS_TRUE(html.starts_with("Version:0.9\r\nStartHTML:0000000157\r\n"));
+        VERIFY_IS_TRUE(html.substr(35).starts_with("EndHTML:"));
+        VERIFY_ARE_EQUAL(html.size(), std::stoull(html.substr(43, 10)));
+        VERIFY_IS_TRUE(html.substr(TextBuffer::HTMLClipboardHeaderSize).starts_with("<!DOCTYPE>"));
+    }
+
+    Log::Comment(L"Modifying the buffer from within the sink aborts the serialization");
+    {
+        size_t chunks = 0;
+        const auto ok = buffer.SerializeRTF(req, 12, L"Consolas", 0, false, getColors, [&](const std::string_view) {
+            buffer.GetMutableRowByOffset(0);
+            chunks++;
+            return true;
+        });
+        VERIFY_IS_FALSE(ok);
+        VERIFY_ARE_EQUAL(1u, chunks);
+    }
+
+    Log::Comment(L"A color scheme change between two RTF chunks doesn't abort the serialization");
+    {
+        COLORREF color = 0;
+        const auto getChangingColors = [&](const TextAttribute&) { return std::tuple<COLORREF, COLORREF, COLORREF>{ color, color, color }; };
+        size_t chunks = 0;
+        const auto ok = buffer.SerializeRTF(req, 12, L"Consolas", 0, false, getChangingColors, [&](const std::string_view) {
+            color = RGB(0x12, 0x34, 0x56);
+            chunks++;
+            return true;
+        });
+        VERIFY_IS_TRUE(ok);
+        VERIFY_IS_GREATER_THAN(chunks, 1u);
+    }
+}
+
 // This tests that when we increment the circular buffer, obsolete hyperlink references
 // are removed from the hyperlink map
 void TextBufferTests::HyperlinkTrim()
@@ -2624,30 +2733,35 @@ void TextBufferTests::HyperlinkTrim()
     const auto id = _buffer->GetHyperlinkId(url, customId);
     TextAttribute newAttr{ 0x7f };
     newAttr.SetHyperlinkId(id);
-    _buffer->GetMutableRowByOffset(pos.y).SetAttrToEnd(pos.x, newAttr);
     _buffer->AddHyperlinkToMap(url, id);
+    RowWriteState state{ .text = L"link", .columnBegin = pos.x };
+    _buffer->Replace(pos.y, newAttr, state);
 
     // Set a different hyperlink id somewhere else in the buffer
     const til::point otherPos{ 70, 5 };
     const auto otherId = _buffer->GetHyperlinkId(otherUrl, otherCustomId);
     newAttr.SetHyperlinkId(otherId);
-    _buffer->GetMutableRowByOffset(otherPos.y).SetAttrToEnd(otherPos.x, newAttr);
     _buffer->AddHyperlinkToMap(otherUrl, otherId);
+    state = { .text = L"link", .columnBegin = otherPos.x };
+    _buffer->Replace(otherPos.y, newAttr, state);
+
+    // The current attributes don't refer to either hyperlink.
+    _buffer->SetCurrentAttributes(attr);
 
     // Increment the circular buffer
     _buffer->IncrementCircularBuffer();
 
-    const auto finalCustomId = fmt::format(L"{}%{}", customId, til::hash(url));
     const auto finalOtherCustomId = fmt::format(L"{}%{}", otherCustomId, til::hash(otherUrl));
 
     // The hyperlink reference that was only in the first row should be deleted from the map
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkMap.find(id), _buffer->_hyperlinkMap.end());
+    VERIFY_ARE_EQUAL(L"", _buffer->GetHyperlinkUriFromId(id));
     // Since there was a custom id, that should be deleted as well
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap.find(finalCustomId), _buffer->_hyperlinkCustomIdMap.end());
+    VERIFY_ARE_EQUAL(L"", _buffer->GetCustomIdFromId(id));
+    VERIFY_ARE_EQUAL(1u, _buffer->_hyperlinks.Size());
 
     // The other hyperlink reference should not be deleted
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkMap[otherId], otherUrl);
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap[finalOtherCustomId], otherId);
+    VERIFY_ARE_EQUAL(otherUrl, _buffer->GetHyperlinkUriFromId(otherId));
+    VERIFY_ARE_EQUAL(finalOtherCustomId, _buffer->GetCustomIdFromId(otherId));
 }
 
 // This tests that when we increment the circular buffer, non-obsolete hyperlink references
@@ -2668,12 +2782,14 @@ void TextBufferTests::NoHyperlinkTrim()
     const auto id = _buffer->GetHyperlinkId(url, customId);
     TextAttribute newAttr{ 0x7f };
     newAttr.SetHyperlinkId(id);
-    _buffer->GetMutableRowByOffset(pos.y).SetAttrToEnd(pos.x, newAttr);
     _buffer->AddHyperlinkToMap(url, id);
+    RowWriteState state{ .text = L"link", .columnBegin = pos.x };
+    _buffer->Replace(pos.y, newAttr, state);
 
     // Set the same hyperlink id somewhere else in the buffer
     const til::point otherPos{ 70, 5 };
-    _buffer->GetMutableRowByOffset(otherPos.y).SetAttrToEnd(otherPos.x, newAttr);
+    state = { .text = L"link", .columnBegin = otherPos.x };
+    _buffer->Replace(otherPos.y, newAttr, state);
 
     // Increment the circular buffer
     _buffer->IncrementCircularBuffer();
@@ -2681,8 +2797,57 @@ void TextBufferTests::NoHyperlinkTrim()
     const auto finalCustomId = fmt::format(L"{}%{}", customId, til::hash(url));
 
     // The hyperlink reference should not be deleted from the map since it is still present in the buffer
-    VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(id), url);
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap[finalCustomId], id);
+    VERIFY_ARE_EQUAL(url, _buffer->GetHyperlinkUriFromId(id));
+    VERIFY_ARE_EQUAL(finalCustomId, _buffer->GetCustomIdFromId(id));
+}
+
+// Emulates a tool that prints a distinct hyperlink on every line, like `ls --hyperlink`.
+// The number of hyperlinks we keep track of must stay bounded by the buffer height.
+void TextBufferTests::HyperlinkStress()
+{
+    const til::size bufferSize{ 80, 100 };
+    const TextAttribute attr{ 0x7f };
+    TextBuffer buffer{ bufferSize, attr, 12, false, &_renderer };
+    auto& cursor = buffer.GetCursor();
+
+    for (auto i = 0; i < 1'000'000; ++i)
+    {
+        const auto y = cursor.GetPosition().y;
+        // Every line gets a URI of its own, so that any URI that isn't released once its row is gone piles up.
+        const auto uri = fmt::format(L"file:///tmp/{}", i);
+        const auto id = buffer.GetHyperlinkId(uri, {});
+        buffer.AddHyperlinkToMap(uri, id);
+
+        auto linkAttr = attr;
+        linkAttr.SetHyperlinkId(id);
+        buffer.SetCurrentAttributes(linkAttr);
+        RowWriteState state{ .text = L"link" };
+        buffer.Replace(y, linkAttr, state);
+        buffer.SetCurrentAttributes(attr);
+
+        if (y + 1 < bufferSize.height)
+        {
+            cursor.SetYPosition(y + 1);
+        }
+        else
+        {
+            buffer.IncrementCircularBuffer(attr);
+        }
+
+        // Each row holds exactly one hyperlink and with it one URI.
+        const auto rows = gsl::narrow_cast<size_t>(bufferSize.height);
+        if (buffer._hyperlinks.Size() > rows || buffer._hyperlinks.UniqueUris() > rows)
+        {
+            VERIFY_FAIL(NoThrowString().Format(L"%zu hyperlinks and %zu URIs alive after %d lines", buffer._hyperlinks.Size(), buffer._hyperlinks.UniqueUris(), i));
+        }
+    }
+
+    // The URIs are interned and released along with the last ID that refers to them.
+    VERIFY_ARE_EQUAL(buffer._hyperlinks.Size(), buffer._hyperlinks.UniqueUris());
+
+    // The most recent hyperlink must still be resolvable. The last iteration scrolled it up by one row.
+    const auto lastId = buffer.GetRowByOffset(bufferSize.height - 2).GetAttrByColumn(0).GetHyperlinkId();
+    VERIFY_ARE_EQUAL(L"file:///tmp/999999", buffer.GetHyperlinkUriFromId(lastId));
 }
 
 #define FTCS_A L"\x1b]133;A\x1b\\"
@@ -2816,3 +2981,110 @@ void TextBufferTests::ReflowPromptRegions()
     Log::Comment(L"========== Checking the host buffer state (after) ==========");
     verifyBuffer(*newBuffer, si.GetViewport().ToExclusive(), false, true);
 }
+
+void TextBufferTests::MarkIndexFollowsCircularBuffer()
+{
+    TextBuffer buffer{ { 80, 10 }, TextAttribute{ 0x7 }, 0, false, &_renderer };
+
+    const auto markRows = [&]() {
+        std::vector<til::CoordType> rows;
+        for (const auto& mark : buffer.GetMarkRows())
+        {
+            rows.emplace_back(mark.row);
+        }
+        return rows;
+    };
+
+    buffer.SetScrollbarData({}, 2);
+    buffer.SetScrollbarData({}, 5);
+    buffer.SetScrollbarData({}, 9);
+    VERIFY_ARE_EQUAL((std::vector<til::CoordType>{ 2, 5, 9 }), markRows());
+
+    Log::Comment(L"Rotating the buffer moves the marks up and drops the recycled row's mark");
+    buffer.IncrementCircularBuffer();
+    buffer.IncrementCircularBuffer();
+    buffer.IncrementCircularBuffer();
+    VERIFY_ARE_EQUAL((std::vector<til::CoordType>{ 2, 6 }), markRows());
+
+    Log::Comment(L"Marks on either side of the wrap-around are returned in top-down order");
+    buffer.SetScrollbarData({}, 9);
+    buffer.SetScrollbarData({}, 0);
+    VERIFY_ARE_EQUAL((std::vector<til::CoordType>{ 0, 2, 6, 9 }), markRows());
+
+    buffer.ClearMarksInRange({ 0, 6 }, { 79, 6 });
+    VERIFY_ARE_EQUAL((std::vector<til::CoordType>{ 0, 2, 9 }), markRows());
+
+    Log::Comment(L"Rows reset behind the buffer's back must not be reported");
+    buffer.GetMutableRowByOffset(2).Reset(TextAttribute{ 0x7 });
+    VERIFY_ARE_EQUAL((std::vector<til::CoordType>{ 0, 9 }), markRows());
+
+    buffer.ClearAllMarks();
+    VERIFY_ARE_EQUAL(0u, buffer.GetMarkRows().size());
+}
+
+void TextBufferTests::CharInfosMatchCellIterators()
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+    // The bulk CHAR_INFO conversion must produce the same results as the OutputCellIterator and
+    // TextBufferCellIterator it replaces, including for wide glyphs and partially overwritten ones.
+    TextBuffer expected{ { 20, 3 }, TextAttribute{ 0x7 }, 0, false, &_renderer };
+    TextBuffer actual{ { 20, 3 }, TextAttribute{ 0x7 }, 0, false, &_renderer };
+
+    for (auto buffer : { &expected, &actual })
+    {
+        buffer->Write(OutputCellIterator{ L"ab\u732Bcd\u732B\U0001F600ef\u732B", TextAttribute{ 0x1e } }, { 0, 0 }, false);
+        buffer->Write(OutputCellIterator{ L"\u732Bx\u732Bx\u732B", TextAttribute{ 0x2f } }, { 0, 1 }, false);
+    }
+
+    const CHAR_INFO infos[]{
+        { L'1', 0x07 },
+        { L'2', 0x07 },
+        { L'\u732B', 0x4a | COMMON_LVB_LEADING_BYTE },
+        { L'\u732B', 0x4a | COMMON_LVB_TRAILING_BYTE },
+        { L'3', 0x4a },
+        { L'\u732B', 0x07 },
+        { L'\u732B', 0x07 | COMMON_LVB_TRAILING_BYTE },
+        { L'4', 0x9c },
+        { L'5', 0x9c },
+        { L'6', 0x9c },
+    };
+    const std::span<const CHAR_INFO> span{ infos };
+
+    const auto write = [&](til::point target, std::span<const CHAR_INFO> cells) {
+        expected.Write(OutputCellIterator{ cells }, target, true);
+        actual.WriteCharInfos(target, cells, true);
+    };
+
+    write({ 1, 0 }, span);
+    write({ 3, 1 }, span.subspan(3));
+    write({ 12, 2 }, span.first(8));
+
+    for (til::CoordType y = 0; y < 3; y++)
+    {
+        const auto& expectedRow = expected.GetRowByOffset(y);
+        const auto& actualRow = actual.GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(expectedRow.GetText(), actualRow.GetText());
+        VERIFY_ARE_EQUAL(expectedRow.WasWrapForced(), actualRow.WasWrapForced());
+        VERIFY_ARE_EQUAL(expectedRow.WasDoubleBytePadded(), actualRow.WasDoubleBytePadded());
+
+        for (til::CoordType x = 0; x < 20; x++)
+        {
+            VERIFY_IS_TRUE(expectedRow.DbcsAttrAt(x) == actualRow.DbcsAttrAt(x));
+            VERIFY_IS_TRUE(expectedRow.GetAttrByColumn(x) == actualRow.GetAttrByColumn(x));
+        }
+
+        for (const auto x : { 0, 5, 19 })
+        {
+            std::vector<CHAR_INFO> cells(20 - x);
+            actual.ReadCharInfos({ x, y }, cells);
+
+            auto it = expected.GetCellDataAt({ x, y });
+            for (const auto& cell : cells)
+            {
+                VERIFY_ARE_EQUAL(gci.AsCharInfo(*it), cell);
+                ++it;
+            }
+        }
+    }
+}
@@ -5,6 +5,7 @@
 
 #include "CommonState.hpp"
 #include "../../terminal/parser/InputStateMachineEngine.hpp"
+#include "../../types/inc/utils.hpp"
 
 using namespace WEX::Common;
 using namespace WEX::Logging;
@@ -39,6 +40,9 @@ constexpr CHAR_INFO ci_blu(wchar_t ch) noexcept
 // The escape sequences that ci_red() / ci_blu() result in.
 #define sgr_red(s) "\x1b[0;31;42m" s
 #define sgr_blu(s) "\x1b[0;34;42m" s
+// The escape sequences that ci_red() / ci_blu() result in, if the other one was written right before.
+#define sgr_to_red(s) "\x1b[31m" s
+#define sgr_to_blu(s) "\x1b[34m" s
 // What the default attributes `FOREGROUND_BLUE | FOREGROUND_GREEN | FOREGROUND_RED` result in.
 #define sgr_rst() "\x1b[0m"
 
@@ -113,6 +117,14 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         return true;
     }
 
+    TEST_METHOD_SETUP(MethodSetup)
+    {
+        // VtIo tracks the attributes it emitted across calls. Start each test as if an application wrote
+        // something we can't follow, so that the first SGR of every test is a complete one.
+        ServiceLocator::LocateGlobals().getConsoleInformation().GetVtIo()->_invalidateAttributes();
+        return true;
+    }
+
     TEST_METHOD(SetConsoleCursorPosition)
     {
         THROW_IF_FAILED(routines.SetConsoleCursorPositionImpl(*screenInfo, { 2, 3 }));
@@ -204,46 +216,135 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
 
         const auto expected =
             // 16 foreground colors
-            "\x1b[0;30;41m"
-            "\x1b[0;34;41m"
-            "\x1b[0;32;41m"
-            "\x1b[0;36;41m"
-            "\x1b[0;31;41m"
-            "\x1b[0;35;41m"
-            "\x1b[0;33;41m"
-            "\x1b[0;41m" // <-- default foreground (FOREGROUND_BLUE | FOREGROUND_GREEN | FOREGROUND_RED)
-            "\x1b[0;90;41m"
-            "\x1b[0;94;41m"
-            "\x1b[0;92;41m"
-            "\x1b[0;96;41m"
-            "\x1b[0;91;41m"
-            "\x1b[0;95;41m"
-            "\x1b[0;93;41m"
-            "\x1b[0;97;41m"
+            "\x1b[0;30;41m" // <-- the initial attributes are unknown
+            "\x1b[34m" // <-- afterwards only the changes are emitted
+            "\x1b[32m"
+            "\x1b[36m"
+            "\x1b[31m"
+            "\x1b[35m"
+            "\x1b[33m"
+            "\x1b[39m" // <-- default foreground (FOREGROUND_BLUE | FOREGROUND_GREEN | FOREGROUND_RED)
+            "\x1b[90m"
+            "\x1b[94m"
+            "\x1b[92m"
+            "\x1b[96m"
+            "\x1b[91m"
+            "\x1b[95m"
+            "\x1b[93m"
+            "\x1b[97m"
             // 16 background colors
-            "\x1b[0;31m" // <-- default background (0)
-            "\x1b[0;31;44m"
-            "\x1b[0;31;42m"
-            "\x1b[0;31;46m"
-            "\x1b[0;31;41m"
-            "\x1b[0;31;45m"
-            "\x1b[0;31;43m"
-            "\x1b[0;31;47m"
-            "\x1b[0;31;100m"
-            "\x1b[0;31;104m"
-            "\x1b[0;31;102m"
-            "\x1b[0;31;106m"
-            "\x1b[0;31;101m"
-            "\x1b[0;31;105m"
-            "\x1b[0;31;103m"
-            "\x1b[0;31;107m"
+            "\x1b[0;31m" // <-- default background (0), shorter than "\x1b[31;49m"
+            "\x1b[44m"
+            "\x1b[42m"
+            "\x1b[46m"
+            "\x1b[41m"
+            "\x1b[45m"
+            "\x1b[43m"
+            "\x1b[47m"
+            "\x1b[100m"
+            "\x1b[104m"
+            "\x1b[102m"
+            "\x1b[106m"
+            "\x1b[101m"
+            "\x1b[105m"
+            "\x1b[103m"
+            "\x1b[107m"
             // The remaining two calls
-            "\x1b[0;7;95;42m"
+            "\x1b[7;95;42m"
             "\x1b[0;7m";
         const auto actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
     }
 
+    TEST_METHOD(WriteAttributesRoundTrip)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        const auto& colorTable = gci.GetRenderSettings().GetColorTable();
+        auto& sm = screenInfo->GetStateMachine();
+
+        // RGB colors that exist in the 256-color palette are parsed back as indexed colors. They still look the same.
+        const auto color = [&](const TextColor& c) {
+            return c.IsDefault() ? INVALID_COLOR : c.GetColor(colorTable, 0);
+        };
+
+        struct Step
+        {
+            std::string_view expected;
+            TextAttribute attributes;
+        };
+        std::vector<Step> steps;
+        TextAttribute attr;
+
+        const auto step = [&](std::string_view expected) {
+            steps.push_back({ expected, attr });
+        };
+
+        attr.SetIntense(true);
+        step("\x1b[0;1m"); // The initial attributes are unknown.
+        attr.SetIntense(false);
+        attr.SetFaint(true);
+        step("\x1b[0;2m"); // Shorter than "\x1b[22;2m".
+        attr.SetIntense(true);
+        step("\x1b[1m");
+        attr.SetItalic(true);
+        attr.SetUnderlineStyle(UnderlineStyle::CurlyUnderlined);
+        step("\x1b[3;4:3m");
+        attr.SetIntense(false);
+        step("\x1b[22;2m"); // SGR 22 turns off faint as well.
+        attr.SetIndexedForeground256(200);
+        step("\x1b[38;5;200m");
+        attr.SetForeground(RGB(0x5f, 0x87, 0xaf));
+        step("\x1b[38;5;67m"); // Part of the 6x6x6 color cube.
+        attr.SetBackground(RGB(0x76, 0x76, 0x76));
+        step("\x1b[48;5;243m"); // Part of the grayscale ramp.
+        attr.SetBackground(RGB(1, 2, 3));
+        step("\x1b[48;2;1;2;3m");
+        attr.SetUnderlineColor(TextColor{ RGB(0xff, 0x00, 0x87) });
+        step("\x1b[58:5:198m");
+        attr.SetUnderlineColor(TextColor{ RGB(10, 20, 30) });
+        step("\x1b[58:2::10:20:30m");
+        attr.SetIndexedForeground(TextColor::DARK_RED);
+        step("\x1b[31m");
+        attr.SetIndexedForeground256(TextColor::BRIGHT_RED);
+        step("\x1b[91m"); // The first 16 entries of the 256-color palette are the 16 ANSI colors.
+        attr.SetBlinking(true);
+        attr.SetInvisible(true);
+        attr.SetCrossedOut(true);
+        attr.SetOverlined(true);
+        attr.SetReverseVideo(true);
+        step("\x1b[5;8;9;53;7m");
+        attr = {};
+        attr.SetBackground(RGB(1, 2, 3));
+        step("\x1b[0;48;2;1;2;3m"); // Much shorter than turning everything off individually.
+        attr = {};
+        step("\x1b[0m");
+        step(""); // Nothing changed.
+
+        sm.ProcessString(L"\x1b[m");
+
+        for (const auto& s : steps)
+        {
+            if (auto writer = gci.GetVtWriter())
+            {
+                writer.WriteAttributes(s.attributes);
+                writer.Submit();
+            }
+
+            const auto actual = readOutput();
+            VERIFY_ARE_EQUAL(s.expected, actual);
+
+            sm.ProcessString(std::wstring{ actual.begin(), actual.end() });
+
+            const auto parsed = screenInfo->GetAttributes();
+            VERIFY_ARE_EQUAL(WI_EnumValue(s.attributes.GetCharacterAttributes()), WI_EnumValue(parsed.GetCharacterAttributes()));
+            VERIFY_ARE_EQUAL(color(s.attributes.GetForeground()), color(parsed.GetForeground()));
+            VERIFY_ARE_EQUAL(color(s.attributes.GetBackground()), color(parsed.GetBackground()));
+            VERIFY_ARE_EQUAL(color(s.attributes.GetUnderlineColor()), color(parsed.GetUnderlineColor()));
+        }
+
+        sm.ProcessString(L"\x1b[m");
+    }
+
     TEST_METHOD(WriteConsoleW)
     {
         resetContents();
@@ -279,11 +380,83 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         Viewport written;
         THROW_IF_FAILED(routines.WriteConsoleOutputWImpl(*screenInfo, payload, target, written));
 
-        const auto expected = decsc() cup(2, 2) sgr_red("ab") sgr_blu("AB") decrc();
+        const auto expected = decsc() cup(2, 2) sgr_red("ab") sgr_to_blu("AB") decrc();
         const auto actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
     }
 
+    TEST_METHOD(WriteConsoleOutputWDamage)
+    {
+        resetContents();
+
+        std::array<CHAR_INFO, 8 * 4> payload;
+        for (size_t i = 0; i < payload.size(); ++i)
+        {
+            payload[i] = ci_red(static_cast<wchar_t>(L'a' + i % 8));
+        }
+
+        const auto target = Viewport::FromDimensions({}, { 8, 4 });
+        Viewport written;
+        std::string_view expected;
+        std::string_view actual;
+        size_t firstFrameSize = 0;
+
+        const auto writeFrame = [&](const char* description) {
+            THROW_IF_FAILED(routines.WriteConsoleOutputWImpl(*screenInfo, payload, target, written));
+            actual = readOutput();
+            Log::Comment(NoThrowString().Format(L"%hs: %zu bytes", description, actual.size()));
+        };
+
+        // The first frame has to be written in full.
+        writeFrame("initial frame");
+        expected =
+            decsc() //
+            cup(1, 1) sgr_red("abcdefgh") //
+            cup(2, 1) "abcdefgh" //
+            cup(3, 1) "abcdefgh" //
+            cup(4, 1) "abcdefgh" //
+            decrc();
+        VERIFY_ARE_EQUAL(expected, actual);
+        firstFrameSize = actual.size();
+
+        // Nothing changed, so nothing should be written.
+        writeFrame("unchanged frame");
+        VERIFY_IS_TRUE(actual.empty());
+
+        // A single changed cell.
+        payload[1 * 8 + 2] = ci_blu(L'X');
+        writeFrame("1 changed cell");
+        expected = decsc() cup(2, 3) sgr_blu("X") decrc();
+        VERIFY_ARE_EQUAL(expected, actual);
+        VERIFY_IS_LESS_THAN(actual.size(), firstFrameSize);
+
+        // Two changed cells that are far apart are connected via CUF.
+        payload[2 * 8 + 0] = ci_blu(L'Y');
+        payload[2 * 8 + 7] = ci_blu(L'Z');
+        writeFrame("2 distant changed cells");
+        expected = decsc() cup(3, 1) sgr_blu("Y") "\x1b[6C" "Z" decrc();
+        VERIFY_ARE_EQUAL(expected, actual);
+
+        // Two changed cells that are close together are written as one run.
+        payload[3 * 8 + 1] = ci_blu(L'U');
+        payload[3 * 8 + 4] = ci_blu(L'V');
+        writeFrame("2 nearby changed cells");
+        expected = decsc() cup(4, 2) sgr_blu("U") sgr_to_red("cd") sgr_to_blu("V") decrc();
+        VERIFY_ARE_EQUAL(expected, actual);
+
+        // Writing to the buffer by other means invalidates what we know about the terminal.
+        resetContents();
+        writeFrame("frame after reset");
+        expected =
+            decsc() //
+            cup(1, 1) sgr_red("abcdefgh") //
+            cup(2, 1) "ab" sgr_to_blu("X") sgr_to_red("defgh") //
+            cup(3, 1) sgr_to_blu("Y") sgr_to_red("bcdefg") sgr_to_blu("Z") //
+            cup(4, 1) sgr_to_red("a") sgr_to_blu("U") sgr_to_red("cd") sgr_to_blu("V") sgr_to_red("fgh") //
+            decrc();
+        VERIFY_ARE_EQUAL(expected, actual);
+    }
+
     TEST_METHOD(WriteConsoleOutputAttribute)
     {
         setupInitialContents(false);
@@ -295,8 +468,8 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
 
         const auto expected =
             decsc() //
-            cup(2, 7) sgr_red("g") sgr_blu("h") //
-            cup(3, 1) sgr_red("i") sgr_blu("j") //
+            cup(2, 7) sgr_red("g") sgr_to_blu("h") //
+            cup(3, 1) sgr_to_red("i") sgr_to_blu("j") //
             decrc();
         const auto actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -313,8 +486,8 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         THROW_IF_FAILED(routines.WriteConsoleOutputCharacterWImpl(*screenInfo, L"foobar", { 5, 1 }, written));
         expected =
             decsc() //
-            cup(2, 6) sgr_red("f") sgr_blu("oo") //
-            cup(3, 1) sgr_blu("ba") sgr_red("r") //
+            cup(2, 6) sgr_red("f") sgr_to_blu("oo") //
+            cup(3, 1) "ba" sgr_to_red("r") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(6u, written);
@@ -324,7 +497,7 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         THROW_IF_FAILED(routines.WriteConsoleOutputCharacterWImpl(*screenInfo, L"foobar", { 5, 3 }, written));
         expected =
             decsc() //
-            cup(4, 6) sgr_blu("f") sgr_red("oo") //
+            cup(4, 6) sgr_blu("f") sgr_to_red("oo") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(3u, written);
@@ -334,8 +507,8 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         THROW_IF_FAILED(routines.WriteConsoleOutputCharacterWImpl(*screenInfo, L"✨✅❌", { 5, 1 }, written));
         expected =
             decsc() //
-            cup(2, 6) sgr_red("✨") sgr_blu(" ") //
-            cup(3, 1) sgr_blu("✅") sgr_red("❌") //
+            cup(2, 6) sgr_red("✨") sgr_to_blu(" ") //
+            cup(3, 1) "✅" sgr_to_red("❌") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(3u, written);
@@ -390,7 +563,7 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         expected =
             decsc() //
             cup(2, 5) sgr_blu("GHgh") //
-            cup(3, 1) sgr_blu("ijIJ") //
+            cup(3, 1) "ijIJ" //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(8u, cellsModified);
@@ -441,7 +614,7 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         THROW_IF_FAILED(routines.FillConsoleOutputCharacterWImpl(*screenInfo, L'a', 3, { 0, 0 }, cellsModified, false));
         expected =
             decsc() //
-            cup(1, 1) sgr_red("aa") sgr_blu("a") //
+            cup(1, 1) sgr_red("aa") sgr_to_blu("a") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -450,7 +623,7 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         THROW_IF_FAILED(routines.FillConsoleOutputCharacterWImpl(*screenInfo, L'b', 3, { 5, 0 }, cellsModified, false));
         expected =
             decsc() //
-            cup(1, 6) sgr_red("b") sgr_blu("bb") //
+            cup(1, 6) sgr_red("b") sgr_to_blu("bb") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -459,8 +632,8 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         THROW_IF_FAILED(routines.FillConsoleOutputCharacterWImpl(*screenInfo, L'c', 8, { 4, 1 }, cellsModified, false));
         expected =
             decsc() //
-            cup(2, 5) sgr_red("cc") sgr_blu("cc") //
-            cup(3, 1) sgr_blu("cc") sgr_red("cc") //
+            cup(2, 5) sgr_red("cc") sgr_to_blu("cc") //
+            cup(3, 1) "cc" sgr_to_red("cc") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -469,8 +642,8 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         THROW_IF_FAILED(routines.FillConsoleOutputCharacterWImpl(*screenInfo, L'✨', 3, { 5, 1 }, cellsModified, false));
         expected =
             decsc() //
-            cup(2, 6) sgr_red("✨") sgr_blu(" ") //
-            cup(3, 1) sgr_blu("✨") sgr_red("✨") //
+            cup(2, 6) sgr_red("✨") sgr_to_blu(" ") //
+            cup(3, 1) "✨" sgr_to_red("✨") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -495,7 +668,7 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         expected =
             decsc() //
             cup(1, 1) sgr_red("  ") //
-            cup(2, 1) sgr_red("  ") //
+            cup(2, 1) "  " //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -532,9 +705,9 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         expected =
             decsc() //
             cup(1, 2) sgr_red("ZZ") //
-            cup(2, 2) sgr_red("ZZ") //
-            cup(3, 6) sgr_red("B") sgr_blu("a") //
-            cup(4, 6) sgr_red("F") sgr_blu("e") //
+            cup(2, 2) "ZZ" //
+            cup(3, 6) "B" sgr_to_blu("a") //
+            cup(4, 6) sgr_to_red("F") sgr_to_blu("e") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -555,9 +728,9 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         expected =
             decsc() //
             cup(2, 2) sgr_blu("zz") //
-            cup(3, 2) sgr_blu("zz") //
-            cup(3, 7) sgr_red("E") //
-            cup(4, 7) sgr_blu("i") //
+            cup(3, 2) "zz" //
+            cup(3, 7) sgr_to_red("E") //
+            cup(4, 7) sgr_to_blu("i") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -578,9 +751,9 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         expected =
             decsc() //
             cup(1, 8) sgr_red("Y") //
-            cup(2, 8) sgr_red("Y") //
-            cup(3, 5) sgr_blu("d") //
-            cup(4, 5) sgr_blu("h") //
+            cup(2, 8) "Y" //
+            cup(3, 5) sgr_to_blu("d") //
+            cup(4, 5) "h" //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -620,12 +793,12 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
         expected =
             decsc() //
             cup(1, 4) sgr_blu("yy") //
-            cup(2, 4) sgr_blu("yy") //
-            cup(3, 4) sgr_blu("yy") //
-            cup(4, 4) sgr_blu("yy") //
-            cup(2, 4) sgr_blu("y") sgr_red("AZZ") sgr_blu("b") //
-            cup(3, 4) sgr_blu("y") sgr_red("E") sgr_blu("zzf") //
-            cup(4, 4) sgr_blu("yizz") sgr_red("J") //
+            cup(2, 4) "yy" //
+            cup(3, 4) "yy" //
+            cup(4, 4) "yy" //
+            cup(2, 5) sgr_to_red("AZZ") sgr_to_blu("b") //
+            cup(3, 5) sgr_to_red("E") sgr_to_blu("zzf") //
+            cup(4, 5) "izz" sgr_to_red("J") //
             decrc();
         actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
@@ -833,14 +1006,214 @@ class ::Microsoft::Console::VirtualTerminal::VtIoTests
 
         const auto expected =
             "\x1b[?1049l" // ASB (Alternate Screen Buffer)
-            cup(1, 1) sgr_red("AB") sgr_blu("ab") sgr_red("CD") sgr_blu("cd") //
-            cup(2, 1) sgr_red("EF") sgr_blu("ef") sgr_red("GH") sgr_blu("gh") //
-            cup(3, 1) sgr_blu("ij") sgr_red("IJ") sgr_blu("kl") sgr_red("KL") //
-            cup(4, 1) sgr_blu("mn") sgr_red("MN") sgr_blu("op") sgr_red("OP") //
+            cup(1, 1) sgr_red("AB") sgr_to_blu("ab") sgr_to_red("CD") sgr_to_blu("cd") //
+            cup(2, 1) sgr_to_red("EF") sgr_to_blu("ef") sgr_to_red("GH") sgr_to_blu("gh") //
+            cup(3, 1) "ij" sgr_to_red("IJ") sgr_to_blu("kl") sgr_to_red("KL") //
+            cup(4, 1) sgr_to_blu("mn") sgr_to_red("MN") sgr_to_blu("op") sgr_to_red("OP") //
             cup(1, 1) sgr_rst() //
             "\x1b[?25h" // DECTCEM (Text Cursor Enable)
             "\x1b[?7h"; // DECAWM (Autowrap Mode)
         const auto actual = readOutput();
         VERIFY_ARE_EQUAL(expected, actual);
     }
+
+    TEST_METHOD(FlushDeferredWhileWritePending)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto pipe = Utils::CreateOverlappedPipe(PIPE_ACCESS_INBOUND, 4096);
+
+        // The terminal only reads while `reading` is set. That way we control when our writes stay pending.
+        wil::unique_event reading{ wil::EventOptions::ManualReset };
+        std::atomic<size_t> receivedSize{ 0 };
+        std::string received;
+
+        std::thread reader{ [&]() {
+            wil::unique_event event{ wil::EventOptions::ManualReset };
+            char buf[4096];
+
+            for (;;)
+            {
+                reading.wait();
+
+                OVERLAPPED overlapped{};
+                overlapped.hEvent = event.get();
+                DWORD read = 0;
+
+                if (!ReadFile(pipe.server.get(), &buf[0], sizeof(buf), nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+                {
+                    break;
+                }
+                if (!GetOverlappedResult(pipe.server.get(), &overlapped, &read, TRUE) || read == 0)
+                {
+                    break;
+                }
+
+                received.append(&buf[0], read);
+                receivedSize.fetch_add(read, std::memory_order_release);
+            }
+        } };
+
+        VtIo io;
+        THROW_IF_FAILED(io._Initialize(nullptr, pipe.client.release(), nullptr));
+        // Long enough that only the terminal catching up or the size limit can end a deferral.
+        io.SetFlushLatencyBudget(std::chrono::minutes{ 1 });
+
+        const auto write = [&](std::string_view str) {
+            gci.LockConsole();
+            {
+                VtIo::Writer writer{ &io };
+                writer.WriteUTF8(str);
+                writer.Submit();
+            }
+            gci.UnlockConsole();
+        };
+        const auto waitForReceived = [&](size_t size) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+            while (receivedSize.load(std::memory_order_acquire) < size && std::chrono::steady_clock::now() < deadline)
+            {
+                Sleep(1);
+            }
+            VERIFY_ARE_EQUAL(size, receivedSize.load(std::memory_order_acquire));
+        };
+
+        const std::string large1(64 * 1024, 'a');
+        const std::string large2(64 * 1024, 'c');
+        const std::string huge(VtIo::maxDeferredFlushSize, 'e');
+        std::string expected;
+
+        // The pipe can't hold all of this, so the write stays pending, and the next one is held back.
+        write(large1);
+        expected.append(large1);
+        VERIFY_IS_TRUE(io._overlappedPending);
+
+        write("b");
+        expected.append("b");
+        VERIFY_IS_TRUE(io._flushDeferred);
+        VERIFY_ARE_EQUAL(uint64_t{ 1 }, io.GetFlushStatistics().deferrals);
+        VERIFY_ARE_EQUAL(uint64_t{ 1 }, io.GetFlushStatistics().writes);
+
+        // Once the terminal caught up, _flushWaitCallback() writes what was held back, without anyone calling _flushNow().
+        reading.SetEvent();
+        waitForReceived(expected.size());
+        reading.ResetEvent();
+
+        gci.LockConsole();
+        VERIFY_IS_FALSE(io._flushDeferred);
+        VERIFY_ARE_EQUAL(uint64_t{ 2 }, io.GetFlushStatistics().writes);
+        gci.UnlockConsole();
+
+        write(large2);
+        expected.append(large2);
+        VERIFY_IS_TRUE(io._overlappedPending);
+
+        write("d");
+        expected.append("d");
+        VERIFY_IS_TRUE(io._flushDeferred);
+        VERIFY_ARE_EQUAL(uint64_t{ 2 }, io.GetFlushStatistics().deferrals);
+
+        // Once too much piled up, _flushNow() stops deferring and waits for the pending write instead.
+        reading.SetEvent();
+        write(huge);
+        expected.append(huge);
+        VERIFY_IS_FALSE(io._flushDeferred);
+        VERIFY_ARE_EQUAL(uint64_t{ 2 }, io.GetFlushStatistics().deferrals);
+        VERIFY_ARE_EQUAL(uint64_t{ 4 }, io.GetFlushStatistics().writes);
+
+        waitForReceived(expected.size());
+
+        gci.LockConsole();
+        io._hOutput.reset();
+        gci.UnlockConsole();
+        reader.join();
+
+        VERIFY_IS_TRUE(expected == received);
+    }
+
+    BEGIN_TEST_METHOD(FlushCoalescingPerformance)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        TEST_METHOD_PROPERTY(L"Data:budgetMs", L"{0, 1, 4}")
+    END_TEST_METHOD()
+
+    void FlushCoalescingPerformance()
+    {
+        static constexpr size_t iterations = 20000;
+        static constexpr std::string_view payload{ "hello world\r\n" };
+
+        int budgetMs = 0;
+        VERIFY_SUCCEEDED(TestData::TryGetValue(L"budgetMs", budgetMs));
+
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto pipe = Utils::CreateOverlappedPipe(PIPE_ACCESS_INBOUND, 4096);
+        std::atomic<size_t> received{ 0 };
+
+        // Simulates a terminal that's slower than us: It reads at most 4KiB per millisecond.
+        std::thread reader{ [&]() {
+            wil::unique_event event{ wil::EventOptions::ManualReset };
+            char buf[4096];
+
+            for (;;)
+            {
+                OVERLAPPED overlapped{};
+                overlapped.hEvent = event.get();
+                DWORD read = 0;
+
+                if (!ReadFile(pipe.server.get(), &buf[0], sizeof(buf), nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+                {
+                    break;
+                }
+                if (!GetOverlappedResult(pipe.server.get(), &overlapped, &read, TRUE) || read == 0)
+                {
+                    break;
+                }
+
+                received.fetch_add(read, std::memory_order_relaxed);
+                Sleep(1);
+            }
+        } };
+
+        VtIo io;
+        THROW_IF_FAILED(io._Initialize(nullptr, pipe.client.release(), nullptr));
+        io.SetFlushLatencyBudget(std::chrono::milliseconds{ budgetMs });
+
+        // Lots of tiny console API calls, like an application that prints line by line.
+        const auto beg = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            gci.LockConsole();
+            {
+                VtIo::Writer writer{ &io };
+                writer.WriteUTF8(payload);
+                writer.Submit();
+            }
+            gci.UnlockConsole();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        while (received.load(std::memory_order_relaxed) < iterations * payload.size())
+        {
+            Sleep(1);
+        }
+
+        gci.LockConsole();
+        const auto stats = io.GetFlushStatistics();
+        io._hOutput.reset();
+        gci.UnlockConsole();
+        reader.join();
+
+        const auto seconds = std::chrono::duration<double>(end - beg).count();
+        const auto writes = std::max<uint64_t>(stats.writes, 1);
+        const auto avgDelayUs = std::chrono::duration<double, std::micro>(stats.queueDelay).count() / writes;
+        const auto maxDelayUs = std::chrono::duration<double, std::micro>(stats.maxQueueDelay).count();
+
+        Log::Comment(String().Format(L"budget: %dms, calls/s: %.0f, writes: %llu, writes/s: %.0f, bytes/write: %.1f, queue delay: avg %.0fus, max %.0fus",
+                                     budgetMs,
+                                     iterations / seconds,
+                                     stats.writes,
+                                     stats.writes / seconds,
+                                     static_cast<double>(stats.bytes) / writes,
+                                     avgDelayUs,
+                                     maxDelayUs));
+
+        VERIFY_ARE_EQUAL(iterations * payload.size(), stats.bytes);
+    }
 };
@@ -3,16 +3,113 @@
 
 #pragma once
 
+// atomic_wait() and friends are the one place where til's synchronization primitives
+// (til::spsc, til::latch, til::ticket_lock, ...) block and wake up threads.
+// * Windows: WaitOnAddress/WakeByAddress, which support timeouts and all sizes up to 8 bytes.
+// * Linux: A private futex for 4 byte atomics. Other sizes use the fallback.
+// * Fallback: std::atomic<T>::wait/notify. Timeouts are implemented by polling.
+// The wait and notify functions of one atomic always pick the same implementation,
+// but you shouldn't mix them with std::atomic<T>::wait/notify on the same atomic.
+#if defined(_WIN32)
+#define _TIL_ATOMIC_WAIT_IMPL_WIN 1
+#elif defined(__linux__)
+#define _TIL_ATOMIC_WAIT_IMPL_LINUX 1
+#else
+#define _TIL_ATOMIC_WAIT_IMPL_FALLBACK 1
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if _TIL_ATOMIC_WAIT_IMPL_LINUX
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace til
 {
+    // The same value as INFINITE on Windows.
+    inline constexpr uint32_t atomic_wait_infinite = 0xFFFFFFFF;
+
+    namespace details
+    {
+        template<typename T>
+        bool atomic_wait_fallback(const std::atomic<T>& atomic, const T& current, uint32_t waitMilliseconds) noexcept
+        {
+            if (waitMilliseconds == atomic_wait_infinite)
+            {
+                atomic.wait(current, std::memory_order_relaxed);
+                return true;
+            }
+
+            // std::atomic<T>::wait doesn't support timeouts. Poll instead, since
+            // this path is only taken by platforms we don't ship on anyways.
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds{ waitMilliseconds };
+            while (atomic.load(std::memory_order_relaxed) == current)
+            {
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+#if _TIL_ATOMIC_WAIT_IMPL_LINUX
+        // See: https://man7.org/linux/man-pages/man2/futex.2.html
+        template<typename T>
+        inline constexpr bool atomic_wait_uses_futex = sizeof(std::atomic<T>) == 4 && sizeof(T) == 4;
+
+        inline long futex(const void* address, int op, uint32_t val, const timespec* timeout) noexcept
+        {
+            return syscall(SYS_futex, address, op, val, timeout, nullptr, 0);
+        }
+#endif
+    }
+
     // Similar to std::atomic<T>::wait, but slightly faster and with the ability to specify a timeout.
     // Returns false on failure, which is pretty much always a timeout. (We prevent invalid arguments by taking references.)
+    // Like std::atomic<T>::wait it may return spuriously, so callers need to re-check the value in a loop.
     template<typename T>
-    bool atomic_wait(const std::atomic<T>& atomic, const T& current, DWORD waitMilliseconds = INFINITE) noexcept
+    bool atomic_wait(const std::atomic<T>& atomic, const T& current, uint32_t waitMilliseconds = atomic_wait_infinite) noexcept
     {
         static_assert(sizeof(atomic) == sizeof(current));
+#if _TIL_ATOMIC_WAIT_IMPL_WIN
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile
         return WaitOnAddress(const_cast<std::atomic<T>*>(&atomic), const_cast<T*>(&current), sizeof(current), waitMilliseconds);
+#elif _TIL_ATOMIC_WAIT_IMPL_LINUX
+        if constexpr (details::atomic_wait_uses_futex<T>)
+        {
+            uint32_t expected;
+            memcpy(&expected, &current, sizeof(expected));
+
+            timespec timeout{};
+            const timespec* pTimeout = nullptr;
+            if (waitMilliseconds != atomic_wait_infinite)
+            {
+                timeout.tv_sec = waitMilliseconds / 1000;
+                timeout.tv_nsec = (waitMilliseconds % 1000) * 1'000'000L;
+                pTimeout = &timeout;
+            }
+
+            // EAGAIN (the value already changed) and EINTR count as a successful wake-up, just like with WaitOnAddress.
+            return details::futex(&atomic, FUTEX_WAIT_PRIVATE, expected, pTimeout) == 0 || errno != ETIMEDOUT;
+        }
+        else
+        {
+            return details::atomic_wait_fallback(atomic, current, waitMilliseconds);
+        }
+#else
+        return details::atomic_wait_fallback(atomic, current, waitMilliseconds);
+#endif
     }
 
     // Wakes at most one of the threads waiting on the atomic via atomic_wait().
@@ -20,8 +117,21 @@ namespace til
     template<typename T>
     void atomic_notify_one(const std::atomic<T>& atomic) noexcept
     {
+#if _TIL_ATOMIC_WAIT_IMPL_WIN
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile
         WakeByAddressSingle(const_cast<std::atomic<T>*>(&atomic));
+#elif _TIL_ATOMIC_WAIT_IMPL_LINUX
+        if constexpr (details::atomic_wait_uses_futex<T>)
+        {
+            details::futex(&atomic, FUTEX_WAKE_PRIVATE, 1, nullptr);
+        }
+        else
+        {
+            const_cast<std::atomic<T>&>(atomic).notify_one();
+        }
+#else
+        const_cast<std::atomic<T>&>(atomic).notify_one();
+#endif
     }
 
     // Wakes all threads waiting on the atomic via atomic_wait().
@@ -29,7 +139,20 @@ namespace til
     template<typename T>
     void atomic_notify_all(const std::atomic<T>& atomic) noexcept
     {
+#if _TIL_ATOMIC_WAIT_IMPL_WIN
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile
         WakeByAddressAll(const_cast<std::atomic<T>*>(&atomic));
+#elif _TIL_ATOMIC_WAIT_IMPL_LINUX
+        if constexpr (details::atomic_wait_uses_futex<T>)
+        {
+            details::futex(&atomic, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+        }
+        else
+        {
+            const_cast<std::atomic<T>&>(atomic).notify_all();
+        }
+#else
+        const_cast<std::atomic<T>&>(atomic).notify_all();
+#endif
     }
 }
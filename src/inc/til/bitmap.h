@@ -0,0 +1,490 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "rect.h"
+
+#pragma warning(push)
+#pragma warning(disable : 26446) // Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+namespace til
+{
+    namespace details
+    {
+        // The helpers below process 128 bits at a time, which is why til::bitmap pads its rows to a multiple of 2 words.
+        // `count` is the number of uint64_t words and must be a multiple of 2.
+
+        inline void bitmap_or(uint64_t* dst, const uint64_t* src, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; i += 2)
+            {
+#if defined(TIL_SSE_INTRINSICS)
+                const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+                const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(a, b));
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+                vst1q_u64(dst + i, vorrq_u64(vld1q_u64(dst + i), vld1q_u64(src + i)));
+#else
+                dst[i + 0] |= src[i + 0];
+                dst[i + 1] |= src[i + 1];
+#endif
+            }
+        }
+
+        inline void bitmap_and(uint64_t* dst, const uint64_t* src, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; i += 2)
+            {
+#if defined(TIL_SSE_INTRINSICS)
+                const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+                const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(a, b));
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+                vst1q_u64(dst + i, vandq_u64(vld1q_u64(dst + i), vld1q_u64(src + i)));
+#else
+                dst[i + 0] &= src[i + 0];
+                dst[i + 1] &= src[i + 1];
+#endif
+            }
+        }
+
+        // Returns true if all bits are clear.
+        inline bool bitmap_none(const uint64_t* data, size_t count) noexcept
+        {
+#if defined(TIL_SSE_INTRINSICS)
+            auto acc = _mm_setzero_si128();
+            for (size_t i = 0; i < count; i += 2)
+            {
+                acc = _mm_or_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+            }
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) == 0xffff;
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+            auto acc = vdupq_n_u64(0);
+            for (size_t i = 0; i < count; i += 2)
+            {
+                acc = vorrq_u64(acc, vld1q_u64(data + i));
+            }
+            return (vgetq_lane_u64(acc, 0) | vgetq_lane_u64(acc, 1)) == 0;
+#else
+            uint64_t acc = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                acc |= data[i];
+            }
+            return acc == 0;
+#endif
+        }
+    }
+
+    // A dense bitmap with 1 bit per cell. The renderer uses it to accumulate invalidated ("dirty")
+    // cells between frames, because unioning thousands of small rectangles into a single one
+    // quickly degrades into redrawing the entire viewport.
+    //
+    // Bits are stored row by row, with the lowest bit of each word being the leftmost column.
+    // Bits outside of the bitmap's size are always kept clear, which allows the bulk operations to ignore the width.
+    class bitmap
+    {
+    public:
+        bitmap() = default;
+
+        explicit bitmap(til::size size)
+        {
+            resize(size);
+        }
+
+        bool operator==(const bitmap& rhs) const noexcept
+        {
+            return _width == rhs._width && _height == rhs._height && _words == rhs._words;
+        }
+
+        bool operator!=(const bitmap& rhs) const noexcept
+        {
+            return !(*this == rhs);
+        }
+
+        til::size size() const noexcept
+        {
+            return { _width, _height };
+        }
+
+        // Changes the size of the bitmap and clears all bits.
+        void resize(til::size size)
+        {
+            _width = std::max(0, size.width);
+            _height = std::max(0, size.height);
+            // Round the width up to a multiple of 128 bits.
+            _stride = ((static_cast<size_t>(_width) + 127) / 128) * 2;
+            _words.assign(_stride * _height, 0);
+        }
+
+        bool any() const noexcept
+        {
+            return !none();
+        }
+
+        bool none() const noexcept
+        {
+            return details::bitmap_none(_words.data(), _words.size());
+        }
+
+        // Returns the number of set bits.
+        size_t count() const noexcept
+        {
+            size_t n = 0;
+            for (const auto w : _words)
+            {
+                n += static_cast<size_t>(std::popcount(w));
+            }
+            return n;
+        }
+
+        bool test(til::point pt) const noexcept
+        {
+            if (pt.x < 0 || pt.y < 0 || pt.x >= _width || pt.y >= _height)
+            {
+                return false;
+            }
+            const auto x = static_cast<size_t>(pt.x);
+            return ((_row(pt.y)[x / 64] >> (x % 64)) & 1) != 0;
+        }
+
+        // Sets all bits in the given rectangle. Parts outside of the bitmap are ignored.
+        void set(const til::rect& rc) noexcept
+        {
+            _fill(rc, true);
+        }
+
+        // Clears all bits in the given rectangle. Parts outside of the bitmap are ignored.
+        void reset(const til::rect& rc) noexcept
+        {
+            _fill(rc, false);
+        }
+
+        void set_all() noexcept
+        {
+            set(til::rect{ size() });
+        }
+
+        void reset_all() noexcept
+        {
+            std::fill(_words.begin(), _words.end(), uint64_t{ 0 });
+        }
+
+        // Union with another bitmap of the same size.
+        bitmap& operator|=(const bitmap& other)
+        {
+            _check_size(other);
+            details::bitmap_or(_words.data(), other._words.data(), _words.size());
+            return *this;
+        }
+
+        // Intersection with another bitmap of the same size.
+        bitmap& operator&=(const bitmap& other)
+        {
+            _check_size(other);
+            details::bitmap_and(_words.data(), other._words.data(), _words.size());
+            return *this;
+        }
+
+        // Moves all bits by the given offset, the same way `rect + point` would move a rectangle.
+        // Bits that are moved out of the bitmap are lost and the vacated area is cleared.
+        void translate(til::point delta) noexcept
+        {
+            if (delta.x == 0 && delta.y == 0)
+            {
+                return;
+            }
+            if (delta.x <= -_width || delta.x >= _width || delta.y <= -_height || delta.y >= _height)
+            {
+                reset_all();
+                return;
+            }
+
+            if (delta.y != 0)
+            {
+                const auto shift = static_cast<size_t>(std::abs(delta.y)) * _stride;
+                const auto data = _words.data();
+                const auto total = _words.size();
+                if (delta.y > 0)
+                {
+                    memmove(data + shift, data, (total - shift) * sizeof(uint64_t));
+                    std::fill_n(data, shift, uint64_t{ 0 });
+                }
+                else
+                {
+                    memmove(data, data + shift, (total - shift) * sizeof(uint64_t));
+                    std::fill_n(data + total - shift, shift, uint64_t{ 0 });
+                }
+            }
+
+            if (delta.x != 0)
+            {
+                for (CoordType y = 0; y < _height; ++y)
+                {
+                    const auto row = _row(y);
+                    if (!details::bitmap_none(row, _stride))
+                    {
+                        _shift_row(row, delta.x);
+                    }
+                }
+            }
+        }
+
+        // Returns the smallest rectangle that contains all set bits, or an empty one if there are none.
+        til::rect bounding_rect() const noexcept
+        {
+            til::rect rc{ _width, _height, 0, 0 };
+
+            for (CoordType y = 0; y < _height; ++y)
+            {
+                const auto row = _row(y);
+                if (details::bitmap_none(row, _stride))
+                {
+                    continue;
+                }
+
+                rc.left = std::min(rc.left, _find(row, 0, true));
+                rc.right = std::max(rc.right, _find_last(row) + 1);
+                rc.top = std::min(rc.top, y);
+                rc.bottom = y + 1;
+            }
+
+            return rc.empty() ? til::rect{} : rc;
+        }
+
+        // Calls func(const til::rect&) for each horizontal run of set bits, from top to bottom
+        // and left to right. Each rectangle is 1 row tall.
+        template<typename F>
+        void for_each_run(F&& func) const
+        {
+            for (CoordType y = 0; y < _height; ++y)
+            {
+                _for_each_run_in_row(y, y + 1, func);
+            }
+        }
+
+        // Like for_each_run(), but consecutive rows with identical contents are coalesced
+        // into taller rectangles, which is what you'd want to pass to IRenderEngine::Invalidate().
+        template<typename F>
+        void for_each_rect(F&& func) const
+        {
+            if (_words.empty())
+            {
+                return;
+            }
+
+            CoordType y = 0;
+            while (y < _height)
+            {
+                const auto row = _row(y);
+                auto end = y + 1;
+                while (end < _height && memcmp(row, _row(end), _stride * sizeof(uint64_t)) == 0)
+                {
+                    ++end;
+                }
+
+                _for_each_run_in_row(y, end, func);
+                y = end;
+            }
+        }
+
+    private:
+        static constexpr uint64_t _ones = ~uint64_t{ 0 };
+
+        void _check_size(const bitmap& other) const
+        {
+            if (_width != other._width || _height != other._height)
+            {
+                throw std::invalid_argument{ "til::bitmap size mismatch" };
+            }
+        }
+
+        uint64_t* _row(CoordType y) noexcept
+        {
+            return _words.data() + static_cast<size_t>(y) * _stride;
+        }
+
+        const uint64_t* _row(CoordType y) const noexcept
+        {
+            return _words.data() + static_cast<size_t>(y) * _stride;
+        }
+
+        void _fill(const til::rect& rc, bool value) noexcept
+        {
+            const auto clipped = rc & til::rect{ size() };
+            if (clipped.empty())
+            {
+                return;
+            }
+
+            const auto beg = static_cast<size_t>(clipped.left);
+            const auto end = static_cast<size_t>(clipped.right);
+            const auto first = beg / 64;
+            const auto last = (end - 1) / 64;
+            auto firstMask = _ones << (beg % 64);
+            const auto lastMask = _ones >> (63 - (end - 1) % 64);
+            if (first == last)
+            {
+                firstMask &= lastMask;
+            }
+
+            for (auto y = clipped.top; y < clipped.bottom; ++y)
+            {
+                const auto row = _row(y);
+                if (value)
+                {
+                    row[first] |= firstMask;
+                    if (first != last)
+                    {
+                        std::fill(row + first + 1, row + last, _ones);
+                        row[last] |= lastMask;
+                    }
+                }
+                else
+                {
+                    row[first] &= ~firstMask;
+                    if (first != last)
+                    {
+                        std::fill(row + first + 1, row + last, uint64_t{ 0 });
+                        row[last] &= ~lastMask;
+                    }
+                }
+            }
+        }
+
+        // Moves the bits in a row to the right (positive dx) or left (negative dx). |dx| must be less than _width.
+        void _shift_row(uint64_t* row, CoordType dx) noexcept
+        {
+            const auto n = static_cast<ptrdiff_t>(_stride);
+            const auto words = static_cast<ptrdiff_t>(std::abs(dx) / 64);
+            const auto bits = std::abs(dx) % 64;
+
+            if (dx > 0)
+            {
+                for (auto i = n - 1; i >= 0; --i)
+                {
+                    const auto src = i - words;
+                    auto w = src >= 0 ? row[src] << bits : 0;
+                    if (bits && src >= 1)
+                    {
+                        w |= row[src - 1] >> (64 - bits);
+                    }
+                    row[i] = w;
+                }
+
+                // Clear the bits that were moved past the right edge.
+                const auto width = static_cast<size_t>(_width);
+                if (width % 64)
+                {
+                    row[width / 64] &= _ones >> (64 - width % 64);
+                }
+                std::fill(row + (width + 63) / 64, row + n, uint64_t{ 0 });
+            }
+            else
+            {
+                for (ptrdiff_t i = 0; i < n; ++i)
+                {
+                    const auto src = i + words;
+                    auto w = src < n ? row[src] >> bits : 0;
+                    if (bits && src + 1 < n)
+                    {
+                        w |= row[src + 1] << (64 - bits);
+                    }
+                    row[i] = w;
+                }
+            }
+        }
+
+        // Returns the first column at or after `x` whose bit equals `value`, or _width if there's none.
+        CoordType _find(const uint64_t* row, CoordType x, bool value) const noexcept
+        {
+            const auto flip = value ? 0 : _ones;
+            auto i = static_cast<size_t>(x) / 64;
+            auto w = (row[i] ^ flip) & (_ones << (x % 64));
+
+            while (!w)
+            {
+                if (++i >= _stride)
+                {
+                    return _width;
+                }
+                w = row[i] ^ flip;
+            }
+
+            return std::min(_width, static_cast<CoordType>(i * 64 + std::countr_zero(w)));
+        }
+
+        // Returns the last column with a set bit. The row mustn't be empty.
+        CoordType _find_last(const uint64_t* row) const noexcept
+        {
+            auto i = _stride - 1;
+            while (!row[i])
+            {
+                --i;
+            }
+            return static_cast<CoordType>(i * 64 + 63 - std::countl_zero(row[i]));
+        }
+
+        template<typename F>
+        void _for_each_run_in_row(CoordType top, CoordType bottom, F& func) const
+        {
+            const auto row = _row(top);
+            if (details::bitmap_none(row, _stride))
+            {
+                return;
+            }
+
+            CoordType x = 0;
+            for (;;)
+            {
+                const auto beg = _find(row, x, true);
+                if (beg >= _width)
+                {
+                    break;
+                }
+                const auto end = _find(row, beg, false);
+                func(til::rect{ beg, top, end, bottom });
+                if (end >= _width)
+                {
+                    break;
+                }
+                x = end;
+            }
+        }
+
+        std::vector<uint64_t> _words;
+        size_t _stride = 0;
+        CoordType _width = 0;
+        CoordType _height = 0;
+    };
+}
+
+#ifdef __WEX_COMMON_H__
+namespace WEX::TestExecution
+{
+    template<>
+    class VerifyOutputTraits<til::bitmap>
+    {
+    public:
+        static WEX::Common::NoThrowString ToString(const til::bitmap& bitmap)
+        {
+            const auto size = bitmap.size();
+            std::wstring str = wil::str_printf<std::wstring>(L"%dx%d\r\n", size.width, size.height);
+            for (til::CoordType y = 0; y < size.height; ++y)
+            {
+                for (til::CoordType x = 0; x < size.width; ++x)
+                {
+                    str.push_back(bitmap.test({ x, y }) ? L'#' : L'.');
+                }
+                str.append(L"\r\n");
+            }
+            return WEX::Common::NoThrowString(str.c_str());
+        }
+    };
+}
+#endif
+
+#pragma warning(pop)
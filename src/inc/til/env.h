@@ -29,7 +29,10 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     //      https://docs.microsoft.com/en-us/windows/desktop/ProcThread/changing-environment-variables
     struct env_key_sorter
     {
-        [[nodiscard]] bool operator()(const std::wstring& lhs, const std::wstring& rhs) const noexcept
+        // Allows looking up std::wstring keys with a std::wstring_view.
+        using is_transparent = void;
+
+        [[nodiscard]] bool operator()(const std::wstring_view& lhs, const std::wstring_view& rhs) const noexcept
         {
             return compare_ordinal_insensitive(lhs, rhs) < 0;
         }
@@ -37,6 +40,68 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
     namespace details
     {
+        // Expands %VAR% references in `input`. `lookup(name)` must return a std::optional<std::wstring_view>.
+        template<typename Lookup>
+        std::wstring expand_environment_strings(std::wstring_view input, Lookup&& lookup)
+        {
+            std::wstring expanded;
+            expanded.reserve(input.size());
+            bool isInEnvVarName = false;
+            std::wstring currentEnvVarName;
+            for (const auto character : input)
+            {
+                if (character == L'%')
+                {
+                    if (isInEnvVarName)
+                    {
+                        if (const auto envVarValue = lookup(currentEnvVarName))
+                        {
+                            expanded.append(*envVarValue);
+                        }
+                        else
+                        {
+                            expanded.push_back(L'%');
+                            expanded.append(currentEnvVarName);
+                            expanded.push_back(L'%');
+                        }
+                        isInEnvVarName = false;
+                        currentEnvVarName.clear();
+                    }
+                    else
+                    {
+                        isInEnvVarName = true;
+                    }
+                }
+                else
+                {
+                    if (isInEnvVarName)
+                    {
+                        currentEnvVarName.push_back(character);
+                    }
+                    else
+                    {
+                        expanded.push_back(character);
+                    }
+                }
+            }
+            if (isInEnvVarName)
+            {
+                expanded.push_back('%');
+                expanded.append(currentEnvVarName);
+            }
+            return expanded;
+        }
+
+        // Returns the length of an environment block ("name=value\0...\0"), excluding the final terminator.
+        inline size_t env_block_length(const wchar_t* block) noexcept
+        {
+            auto it = block;
+            while (*it)
+            {
+                it += wcslen(it) + 1;
+            }
+            return gsl::narrow_cast<size_t>(it - block);
+        }
 
         namespace vars
         {
@@ -175,6 +240,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 #ifdef UNIT_TESTING
         friend class ::EnvTests;
 #endif
+        friend class env_overlay;
 
         std::map<std::wstring, std::wstring, til::env_key_sorter> _envMap{};
 
@@ -285,52 +351,13 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
         std::wstring expand_environment_strings(std::wstring_view input)
         {
-            std::wstring expanded;
-            expanded.reserve(input.size());
-            bool isInEnvVarName = false;
-            std::wstring currentEnvVarName;
-            for (const auto character : input)
-            {
-                if (character == L'%')
+            return details::expand_environment_strings(input, [&](const std::wstring& name) -> std::optional<std::wstring_view> {
+                if (const auto it = _envMap.find(name); it != _envMap.end())
                 {
-                    if (isInEnvVarName)
-                    {
-                        if (const auto envVarValue = _envMap.find(currentEnvVarName); envVarValue != _envMap.end())
-                        {
-                            expanded.append(envVarValue->second);
-                        }
-                        else
-                        {
-                            expanded.push_back(L'%');
-                            expanded.append(currentEnvVarName);
-                            expanded.push_back(L'%');
-                        }
-                        isInEnvVarName = false;
-                        currentEnvVarName.clear();
-                    }
-                    else
-                    {
-                        isInEnvVarName = true;
-                    }
-                }
-                else
-                {
-                    if (isInEnvVarName)
-                    {
-                        currentEnvVarName.push_back(character);
-                    }
-                    else
-                    {
-                        expanded.push_back(character);
-                    }
+                    return it->second;
                 }
-            }
-            if (isInEnvVarName)
-            {
-                expanded.push_back('%');
-                expanded.append(currentEnvVarName);
-            }
-            return expanded;
+                return std::nullopt;
+            });
         }
 
         void concat_var(std::wstring var, std::wstring value)
@@ -359,7 +386,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             }
         }
 
-        std::wstring check_for_temp(std::wstring_view var, std::wstring_view value)
+        static std::wstring check_for_temp(std::wstring_view var, std::wstring_view value)
         {
             static constexpr std::wstring_view temp{ L"temp" };
             static constexpr std::wstring_view tmp{ L"tmp" };
@@ -493,6 +520,340 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
             return _envMap;
         }
+
+        const auto& as_map() const noexcept
+        {
+            return _envMap;
+        }
+    };
+
+    // An immutable, serialized environment block with a sorted index into it.
+    //
+    // Spawning a process needs the environment as a block of sorted "name=value\0" strings.
+    // Building it via til::env means parsing, sorting, expanding and serializing the entire
+    // environment into a std::map and back for every new tab or pane. Snapshots on the other hand
+    // are built once, cached and shared. Use an env_overlay to apply per-process changes on top.
+    class env_snapshot
+    {
+    public:
+        explicit env_snapshot(const env& environment)
+        {
+            const auto& map = environment.as_map();
+            size_t length = 1;
+            for (const auto& [k, v] : map)
+            {
+                length += k.size() + v.size() + 2;
+            }
+
+            _block.reserve(length);
+            _entries.reserve(map.size());
+
+            for (const auto& [k, v] : map)
+            {
+                _entries.push_back({ _block.size(), k.size(), v.size() });
+                _block.append(k);
+                _block.push_back(L'=');
+                _block.append(v);
+                _block.push_back(L'\0');
+            }
+            _block.push_back(L'\0');
+        }
+
+        // Parses an environment block, like the one returned by GetEnvironmentStringsW().
+        // The most recent result is cached and returned again if the block is the same.
+        static std::shared_ptr<const env_snapshot> from_block(const wchar_t* block)
+        {
+            static block_cache cache;
+            return cache.get({ block, details::env_block_length(block) });
+        }
+
+        // Like til::env::from_current_environment(). The result is cached
+        // and only rebuilt if the process environment has changed.
+        static std::shared_ptr<const env_snapshot> from_current_environment()
+        {
+            const wil::unique_environstrings_ptr block{ GetEnvironmentStringsW() };
+            THROW_HR_IF_NULL(E_OUTOFMEMORY, block.get());
+
+            static block_cache cache;
+            return cache.get({ block.get(), details::env_block_length(block.get()) });
+        }
+
+        // Like til::env::regenerate(). The result is cached until the registry keys it was built from,
+        // or the process environment (which it gets some of the variables from) change.
+        static std::shared_ptr<const env_snapshot> regenerate()
+        {
+            static regenerate_cache cache;
+            return cache.get();
+        }
+
+        // The number of variables.
+        size_t size() const noexcept
+        {
+            return _entries.size();
+        }
+
+        std::wstring_view key(size_t index) const noexcept
+        {
+            const auto& e = til::at(_entries, index);
+            return { _block.data() + e.offset, e.key_length };
+        }
+
+        std::wstring_view value(size_t index) const noexcept
+        {
+            const auto& e = til::at(_entries, index);
+            return { _block.data() + e.offset + e.key_length + 1, e.value_length };
+        }
+
+        // The "name=value\0" string of the given variable, including the terminator.
+        std::wstring_view entry(size_t index) const noexcept
+        {
+            const auto& e = til::at(_entries, index);
+            return { _block.data() + e.offset, e.key_length + e.value_length + 2 };
+        }
+
+        // Returns the value of the given variable (case-insensitive), if it exists.
+        std::optional<std::wstring_view> find(std::wstring_view name) const noexcept
+        {
+            const auto it = std::lower_bound(_entries.begin(), _entries.end(), name, [&](const entry_info& e, const std::wstring_view& n) {
+                return compare_ordinal_insensitive({ _block.data() + e.offset, e.key_length }, n) < 0;
+            });
+            if (it == _entries.end())
+            {
+                return std::nullopt;
+            }
+
+            const auto index = gsl::narrow_cast<size_t>(it - _entries.begin());
+            if (compare_ordinal_insensitive(key(index), name) != 0)
+            {
+                return std::nullopt;
+            }
+            return value(index);
+        }
+
+        // The entire block, including the final terminator.
+        std::wstring_view block() const noexcept
+        {
+            return _block;
+        }
+
+    private:
+        struct entry_info
+        {
+            size_t offset;
+            size_t key_length;
+            size_t value_length;
+        };
+
+        // Caches the snapshot of the most recently seen environment block.
+        struct block_cache
+        {
+            std::shared_ptr<const env_snapshot> get(std::wstring_view block)
+            {
+                {
+                    const auto guard = lock.lock_shared();
+                    if (snapshot && source == block)
+                    {
+                        return snapshot;
+                    }
+                }
+
+                const auto s = std::make_shared<const env_snapshot>(env{ block.data() });
+
+                const auto guard = lock.lock_exclusive();
+                source = block;
+                snapshot = s;
+                return s;
+            }
+
+            wil::srwlock lock;
+            std::wstring source;
+            std::shared_ptr<const env_snapshot> snapshot;
+        };
+
+        struct regenerate_cache
+        {
+            struct watch
+            {
+                wil::unique_hkey key;
+                wil::unique_event event;
+            };
+
+            std::shared_ptr<const env_snapshot> get()
+            {
+                const wil::unique_environstrings_ptr block{ GetEnvironmentStringsW() };
+                THROW_HR_IF_NULL(E_OUTOFMEMORY, block.get());
+                const std::wstring_view processBlock{ block.get(), details::env_block_length(block.get()) };
+
+                const auto guard = lock.lock_exclusive();
+
+                if (snapshot && processBlock == source && !changed())
+                {
+                    return snapshot;
+                }
+
+                // Watch the keys before reading them, so that we can't miss any changes in between.
+                watches.clear();
+                // We only read values directly off of the CurrentVersion key, but it has
+                // countless subkeys (like Run, Uninstall, etc.) that change all the time.
+                auto watching = watch_key(HKEY_LOCAL_MACHINE, details::vars::reg::program_files_root, false) &&
+                                watch_key(HKEY_LOCAL_MACHINE, details::vars::reg::system_env_var_root, true) &&
+                                watch_key(HKEY_CURRENT_USER, details::vars::reg::user_env_var_root, true) &&
+                                // This includes the per-session "Volatile Environment\<id>" subkey.
+                                watch_key(HKEY_CURRENT_USER, details::vars::reg::user_volatile_env_var_root, true);
+
+                env environment;
+                environment.regenerate();
+                auto s = std::make_shared<const env_snapshot>(environment);
+
+                if (watching)
+                {
+                    source = processBlock;
+                    snapshot = s;
+                }
+                else
+                {
+                    // Without the notifications we can't know when to invalidate the cache.
+                    snapshot.reset();
+                }
+                return s;
+            }
+
+            bool watch_key(HKEY root, wil::zwstring_view subkey, bool subtree)
+            {
+                auto& w = watches.emplace_back();
+                if (RegOpenKeyExW(root, subkey.c_str(), 0, KEY_NOTIFY, w.key.addressof()) != ERROR_SUCCESS)
+                {
+                    return false;
+                }
+                w.event.reset(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+                return w.event && RegNotifyChangeKeyValue(w.key.get(), subtree, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC, w.event.get(), TRUE) == ERROR_SUCCESS;
+            }
+
+            bool changed() const noexcept
+            {
+                return std::any_of(watches.begin(), watches.end(), [](const watch& w) {
+                    return w.event.is_signaled();
+                });
+            }
+
+            wil::srwlock lock;
+            std::wstring source;
+            std::vector<watch> watches;
+            std::shared_ptr<const env_snapshot> snapshot;
+        };
+
+        std::wstring _block;
+        std::vector<entry_info> _entries;
+    };
+
+    // A copy-on-write view of an env_snapshot: Changes are stored on the side and
+    // merged with the (already sorted and serialized) snapshot by to_string().
+    class env_overlay
+    {
+    public:
+        explicit env_overlay(std::shared_ptr<const env_snapshot> base) noexcept :
+            _base{ std::move(base) }
+        {
+        }
+
+        // Returns the value of the given variable (case-insensitive), if it exists.
+        std::optional<std::wstring_view> find(std::wstring_view name) const
+        {
+            if (const auto it = _overrides.find(name); it != _overrides.end())
+            {
+                return it->second;
+            }
+            if (_base)
+            {
+                return _base->find(name);
+            }
+            return std::nullopt;
+        }
+
+        // Like env::as_map().insert_or_assign().
+        void set(std::wstring_view name, std::wstring value)
+        {
+            if (const auto it = _overrides.find(name); it != _overrides.end())
+            {
+                it->second = std::move(value);
+            }
+            else
+            {
+                _overrides.emplace(name, std::move(value));
+            }
+        }
+
+        // Like env::set_user_environment_var(). %VAR% references are expanded and empty values are ignored.
+        void set_user_environment_var(std::wstring_view name, std::wstring_view value)
+        {
+            auto valueString = details::expand_environment_strings(value, [&](const std::wstring& n) {
+                return find(n);
+            });
+            valueString = env::check_for_temp(name, valueString);
+            if (!name.empty() && !valueString.empty())
+            {
+                set(name, std::move(valueString));
+            }
+        }
+
+        // Like env::to_string(), but unchanged variables are copied straight out of the snapshot.
+        std::wstring to_string() const
+        {
+            const auto baseSize = _base ? _base->size() : 0;
+
+            size_t capacity = _base ? _base->block().size() : 1;
+            for (const auto& [k, v] : _overrides)
+            {
+                capacity += k.size() + v.size() + 2;
+            }
+
+            std::wstring result;
+            result.reserve(capacity);
+
+            const auto append = [&](std::wstring_view k, std::wstring_view v) {
+                result.append(k);
+                result.push_back(L'=');
+                result.append(v);
+                result.push_back(L'\0');
+            };
+
+            auto it = _overrides.begin();
+            const auto end = _overrides.end();
+            const env_key_sorter less;
+
+            for (size_t i = 0; i < baseSize; ++i)
+            {
+                const auto key = _base->key(i);
+
+                for (; it != end && less(it->first, key); ++it)
+                {
+                    append(it->first, it->second);
+                }
+
+                if (it != end && !less(key, it->first))
+                {
+                    // Just like std::map::insert_or_assign() this retains the spelling of the existing name.
+                    append(key, it->second);
+                    ++it;
+                }
+                else
+                {
+                    result.append(_base->entry(i));
+                }
+            }
+
+            for (; it != end; ++it)
+            {
+                append(it->first, it->second);
+            }
+
+            result.push_back(L'\0');
+            return result;
+        }
+
+    private:
+        std::shared_ptr<const env_snapshot> _base;
+        std::map<std::wstring, std::wstring, env_key_sorter> _overrides;
     };
 };
 
@@ -19,11 +19,14 @@ namespace til
         // These two multipliers are the same as used by the PCG family of random number generators.
         // The 32-Bit version is described in https://doi.org/10.1090/S0025-5718-99-00996-5, Table 5.
         // The 64-Bit version is the multiplier as used by Donald Knuth for MMIX and found by C. E. Haynes.
-#ifdef _WIN64
-        return v * UINT64_C(6364136223846793005);
-#else
-        return v * UINT32_C(747796405);
-#endif
+        if constexpr (sizeof(size_t) == 8)
+        {
+            return v * static_cast<size_t>(UINT64_C(6364136223846793005));
+        }
+        else
+        {
+            return v * UINT32_C(747796405);
+        }
     }
 
     // A basic, hashmap with linear probing. A `LoadFactor` of 2 equals
@@ -202,6 +205,265 @@ namespace til
         size_t _shift = initialShift;
         size_t _mask = 0;
     };
+
+    namespace details
+    {
+        // Control bytes of swiss_flat_set slots that are empty have their high bit set.
+        // The control bytes of occupied slots contain 7 bits of the item's hash instead.
+        inline constexpr uint8_t swiss_flat_set_empty = 0x80;
+        inline constexpr size_t swiss_flat_set_group_size = 16;
+
+#if defined(TIL_ARM_NEON_INTRINSICS)
+        // NEON has no movemask instruction. Instead, we narrow the 16 compare results down to 4 bits each.
+        inline constexpr int swiss_flat_set_mask_stride = 4;
+#else
+        inline constexpr int swiss_flat_set_mask_stride = 1;
+#endif
+
+        // Returns a mask with one bit set for each of the 16 control bytes that's equal to value.
+        // The index of a set bit divided by swiss_flat_set_mask_stride is the index of the slot.
+        inline uint64_t swiss_flat_set_match(const uint8_t* ctrl, uint8_t value) noexcept
+        {
+#if defined(TIL_SSE_INTRINSICS)
+            const auto group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+            const auto eq = _mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(value)));
+            return static_cast<uint32_t>(_mm_movemask_epi8(eq));
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+            const auto eq = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(value));
+            const auto narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+            return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & UINT64_C(0x8888888888888888);
+#else
+            uint64_t mask = 0;
+            for (size_t i = 0; i < swiss_flat_set_group_size; ++i)
+            {
+                mask |= uint64_t{ ctrl[i] == value } << i;
+            }
+            return mask;
+#endif
+        }
+
+        inline size_t swiss_flat_set_index(uint64_t mask) noexcept
+        {
+            return static_cast<size_t>(std::countr_zero(mask) / swiss_flat_set_mask_stride);
+        }
+    }
+
+    // A hashmap in the style of Abseil's SwissTable with the same interface and Traits as linear_flat_set.
+    // Next to the slots it keeps one control byte per slot, which contains 7 bits of the item's hash.
+    // Lookups compare an entire group of 16 control bytes at once (using SSE2 or NEON) and only call
+    // Traits::equals() for the few slots whose control byte matches. This makes probing cheap enough
+    // that the set can be filled up to `MaxLoadPercent` and still perform well, whereas linear_flat_set's
+    // lookups get significantly slower beyond a load of 50%. Traits::occupied() is only used by callers.
+    //
+    // Groups are probed quadratically. Since items can't be erased there are no tombstones and a lookup
+    // stops at the first group with an empty slot. The set grows by a factor of 2 every time it's full.
+    //
+    // It performs best with:
+    // * larger sets (the minimum capacity is 16)
+    // * a high rate of successful lookups and a hash function whose high bits are good (like flat_set_hash_integer)
+    template<typename T, typename Traits, size_t MaxLoadPercent = 87>
+    struct swiss_flat_set
+    {
+        static_assert(MaxLoadPercent > 0 && MaxLoadPercent < 100);
+
+        swiss_flat_set() = default;
+
+        swiss_flat_set(const swiss_flat_set&) = delete;
+        swiss_flat_set& operator=(const swiss_flat_set&) = delete;
+
+        swiss_flat_set(swiss_flat_set&& other) noexcept :
+            _map{ std::move(other._map) },
+            _ctrl{ std::move(other._ctrl) },
+            _capacity{ std::exchange(other._capacity, 0) },
+            _size{ std::exchange(other._size, 0) },
+            _growthLimit{ std::exchange(other._growthLimit, 0) },
+            _shift{ std::exchange(other._shift, initialShift) },
+            _groupMask{ std::exchange(other._groupMask, 0) }
+        {
+        }
+
+        swiss_flat_set& operator=(swiss_flat_set&& other) noexcept
+        {
+            _map = std::move(other._map);
+            _ctrl = std::move(other._ctrl);
+            _capacity = std::exchange(other._capacity, 0);
+            _size = std::exchange(other._size, 0);
+            _growthLimit = std::exchange(other._growthLimit, 0);
+            _shift = std::exchange(other._shift, initialShift);
+            _groupMask = std::exchange(other._groupMask, 0);
+            return *this;
+        }
+
+        bool empty() const noexcept
+        {
+            return _size == 0;
+        }
+
+        size_t size() const noexcept
+        {
+            return _size;
+        }
+
+        std::span<T> container() const noexcept
+        {
+            return { _map.get(), _capacity };
+        }
+
+        void clear() noexcept
+        {
+            if (_map)
+            {
+                std::fill_n(_map.get(), _capacity, T{});
+                std::fill_n(_ctrl.get(), _capacity, details::swiss_flat_set_empty);
+                _size = 0;
+            }
+        }
+
+        template<typename U>
+        T* lookup(U&& key) const noexcept
+        {
+            if (!_map)
+            {
+                return nullptr;
+            }
+
+            const auto hash = Traits::hash(key);
+            const auto h2 = _h2(hash);
+
+            for (auto group = _group(hash), step = size_t{ 0 };; group = (group + ++step) & _groupMask)
+            {
+                const auto base = group * details::swiss_flat_set_group_size;
+                const auto ctrl = _ctrl.get() + base;
+
+                for (auto mask = details::swiss_flat_set_match(ctrl, h2); mask; mask &= mask - 1)
+                {
+                    auto& slot = _map[base + details::swiss_flat_set_index(mask)];
+                    if (Traits::equals(slot, key)) [[likely]]
+                    {
+                        return &slot;
+                    }
+                }
+
+                if (details::swiss_flat_set_match(ctrl, details::swiss_flat_set_empty))
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        // NOTE: It also does not initialize the returned slot.
+        // You must do that yourself in way that ensures that Traits::occupied(slot) now returns true.
+        // Use lookup() to check if the item already exists.
+        template<typename U>
+        std::pair<T*, bool> insert(U&& key)
+        {
+            if (_size >= _growthLimit) [[unlikely]]
+            {
+                _bumpSize();
+            }
+
+            const auto hash = Traits::hash(key);
+            const auto h2 = _h2(hash);
+
+            for (auto group = _group(hash), step = size_t{ 0 };; group = (group + ++step) & _groupMask)
+            {
+                const auto base = group * details::swiss_flat_set_group_size;
+                const auto ctrl = _ctrl.get() + base;
+
+                for (auto mask = details::swiss_flat_set_match(ctrl, h2); mask; mask &= mask - 1)
+                {
+                    auto& slot = _map[base + details::swiss_flat_set_index(mask)];
+                    if (Traits::equals(slot, key)) [[likely]]
+                    {
+                        return { &slot, false };
+                    }
+                }
+
+                if (const auto mask = details::swiss_flat_set_match(ctrl, details::swiss_flat_set_empty))
+                {
+                    const auto index = base + details::swiss_flat_set_index(mask);
+                    auto& slot = _map[index];
+                    _ctrl[index] = h2;
+                    _size++;
+                    Traits::assign(slot, key);
+                    return { &slot, true };
+                }
+            }
+        }
+
+    private:
+        // The top 7 bits of the hash go into the control bytes and the bits below them select the group.
+        // This way both parts are taken from the high bits, which are the good ones for a multiplicative hash.
+        static constexpr uint8_t _h2(size_t hash) noexcept
+        {
+            return static_cast<uint8_t>(hash >> (digits - 7));
+        }
+
+        size_t _group(size_t hash) const noexcept
+        {
+            return ((hash << 7) >> _shift) & _groupMask;
+        }
+
+        __declspec(noinline) void _bumpSize()
+        {
+            const auto newCapacity = _capacity ? _capacity * 2 : details::swiss_flat_set_group_size;
+            if (newCapacity <= _capacity || newCapacity > std::numeric_limits<size_t>::max() / 100)
+            {
+                throw std::bad_array_new_length{};
+            }
+
+            const auto newGroups = newCapacity / details::swiss_flat_set_group_size;
+            // The shift is capped at digits - 1, because shifting by the full width is undefined.
+            // This only matters for the first group, where the _groupMask of 0 makes the shift irrelevant.
+            const auto newShift = std::min<size_t>(digits - std::countr_zero(newGroups), digits - 1);
+            const auto newGroupMask = newGroups - 1;
+            auto newMap = std::make_unique<T[]>(newCapacity);
+            auto newCtrl = std::make_unique_for_overwrite<uint8_t[]>(newCapacity);
+            std::fill_n(newCtrl.get(), newCapacity, details::swiss_flat_set_empty);
+
+            // This mirrors the insert() function, but without the lookup part.
+            for (size_t i = 0; i < _capacity; ++i)
+            {
+                if (_ctrl[i] == details::swiss_flat_set_empty)
+                {
+                    continue;
+                }
+
+                auto& oldSlot = _map[i];
+                const auto hash = Traits::hash(oldSlot);
+
+                for (auto group = ((hash << 7) >> newShift) & newGroupMask, step = size_t{ 0 };; group = (group + ++step) & newGroupMask)
+                {
+                    const auto base = group * details::swiss_flat_set_group_size;
+                    if (const auto mask = details::swiss_flat_set_match(newCtrl.get() + base, details::swiss_flat_set_empty))
+                    {
+                        const auto index = base + details::swiss_flat_set_index(mask);
+                        newMap[index] = std::move_if_noexcept(oldSlot);
+                        newCtrl[index] = _ctrl[i];
+                        break;
+                    }
+                }
+            }
+
+            _map = std::move(newMap);
+            _ctrl = std::move(newCtrl);
+            _capacity = newCapacity;
+            _growthLimit = newCapacity * MaxLoadPercent / 100;
+            _shift = newShift;
+            _groupMask = newGroupMask;
+        }
+
+        static constexpr auto digits = std::numeric_limits<size_t>::digits;
+        static constexpr size_t initialShift = digits - 1;
+
+        std::unique_ptr<T[]> _map;
+        std::unique_ptr<uint8_t[]> _ctrl;
+        size_t _capacity = 0;
+        size_t _size = 0;
+        size_t _growthLimit = 0;
+        size_t _shift = initialShift;
+        size_t _groupMask = 0;
+    };
 }
 
 #pragma warning(pop)
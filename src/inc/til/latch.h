@@ -5,6 +5,8 @@
 
 #ifdef __cpp_lib_latch
 #include <latch>
+#else
+#include "atomic.h"
 #endif
 
 namespace til
@@ -36,7 +38,7 @@ namespace til
             const auto old = counter.fetch_sub(n, std::memory_order_release);
             if (old == n)
             {
-                WakeByAddressAll(&counter);
+                til::atomic_notify_all(counter);
                 return;
             }
 
@@ -59,7 +61,7 @@ namespace til
                 }
 
                 assert(current > 0);
-                WaitOnAddress(const_cast<decltype(counter)*>(&counter), &current, sizeof(counter), INFINITE);
+                til::atomic_wait(counter, current);
             }
         }
 
@@ -70,12 +72,12 @@ namespace til
             auto old = counter.fetch_sub(n, std::memory_order_acq_rel);
             if (old == n)
             {
-                WakeByAddressAll(&counter);
+                til::atomic_notify_all(counter);
                 return;
             }
 
             assert(old > n);
-            WaitOnAddress(&counter, &old, sizeof(counter), INFINITE);
+            til::atomic_wait(counter, old);
             wait();
         }
 
@@ -0,0 +1,493 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+// Opt-in instrumentation for til's locks (and any other lockable type). Build with TIL_LOCK_STATS=1
+// to record how long each call site waited for a lock and for how long it held it.
+// When it's disabled (the default) the guards below are plain std::unique_lock/std::shared_lock.
+#ifndef TIL_LOCK_STATS
+#define TIL_LOCK_STATS 0
+#endif
+
+#if TIL_LOCK_STATS
+#include <source_location>
+#endif
+
+namespace til::lock_stats
+{
+#if TIL_LOCK_STATS
+    // Identifies the call site of a lock acquisition.
+    // Pass it as a defaulted `site s = site::current()` parameter to tag your callers instead.
+    using site = std::source_location;
+    using clock = std::chrono::steady_clock;
+
+    struct histogram_snapshot
+    {
+        // Bucket 0 counts durations of 0ns and bucket N those in [2^(N-1), 2^N) ns. The last one counts everything above.
+        static constexpr size_t bucket_count = 32;
+
+        uint64_t buckets[bucket_count]{};
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+
+        // Returns the upper bound of the bucket containing the given percentile (0-100).
+        uint64_t percentile_ns(double percentile) const noexcept
+        {
+            const auto target = static_cast<uint64_t>(static_cast<double>(count) * percentile / 100.0);
+            uint64_t sum = 0;
+            for (size_t i = 0; i < bucket_count; ++i)
+            {
+                sum += buckets[i];
+                if (sum > target)
+                {
+                    return i == 0 ? 0 : std::min(max_ns, (uint64_t{ 1 } << i) - 1);
+                }
+            }
+            return max_ns;
+        }
+
+        histogram_snapshot& operator+=(const histogram_snapshot& other) noexcept
+        {
+            for (size_t i = 0; i < bucket_count; ++i)
+            {
+                buckets[i] += other.buckets[i];
+            }
+            count += other.count;
+            total_ns += other.total_ns;
+            max_ns = std::max(max_ns, other.max_ns);
+            return *this;
+        }
+    };
+
+    struct site_summary
+    {
+        const char* file = nullptr;
+        const char* function = nullptr;
+        uint32_t line = 0;
+        histogram_snapshot wait;
+        histogram_snapshot hold;
+    };
+
+    namespace details
+    {
+        // Each thread records into its own table of histograms, which only it writes to.
+        // That makes recording a matter of a few plain loads and stores, while report()
+        // can still read the tables of all threads (with relaxed atomics) at any time.
+        struct histogram
+        {
+            std::atomic<uint64_t> buckets[histogram_snapshot::bucket_count]{};
+            std::atomic<uint64_t> count{ 0 };
+            std::atomic<uint64_t> total_ns{ 0 };
+            std::atomic<uint64_t> max_ns{ 0 };
+
+            static void bump(std::atomic<uint64_t>& a, uint64_t value) noexcept
+            {
+                a.store(a.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+
+            void record(uint64_t ns) noexcept
+            {
+                const auto bucket = std::min<size_t>(std::bit_width(ns), histogram_snapshot::bucket_count - 1);
+                bump(buckets[bucket], 1);
+                bump(count, 1);
+                bump(total_ns, ns);
+                if (ns > max_ns.load(std::memory_order_relaxed))
+                {
+                    max_ns.store(ns, std::memory_order_relaxed);
+                }
+            }
+
+            histogram_snapshot snapshot() const noexcept
+            {
+                histogram_snapshot s;
+                for (size_t i = 0; i < histogram_snapshot::bucket_count; ++i)
+                {
+                    s.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+                }
+                s.count = count.load(std::memory_order_relaxed);
+                s.total_ns = total_ns.load(std::memory_order_relaxed);
+                s.max_ns = max_ns.load(std::memory_order_relaxed);
+                return s;
+            }
+        };
+
+        struct site_entry
+        {
+            // Published last with release semantics. A nullptr marks an unused entry.
+            std::atomic<const char*> file{ nullptr };
+            const char* function = nullptr;
+            uint32_t line = 0;
+            histogram wait;
+            histogram hold;
+        };
+
+        struct thread_table
+        {
+            // Must be a power of 2.
+            static constexpr size_t capacity = 64;
+
+            site_entry entries[capacity];
+            // Acquisitions that didn't fit into the table.
+            std::atomic<uint64_t> dropped{ 0 };
+            thread_table* next = nullptr;
+
+            site_entry* find_or_insert(const site& s) noexcept
+            {
+                const auto file = s.file_name();
+                const auto line = s.line();
+                auto index = (reinterpret_cast<uintptr_t>(file) >> 3) ^ (size_t{ line } * 0x9E3779B1);
+
+                for (size_t i = 0; i < capacity; ++i, ++index)
+                {
+                    auto& e = entries[index & (capacity - 1)];
+                    const auto f = e.file.load(std::memory_order_relaxed);
+
+                    if (!f)
+                    {
+                        e.function = s.function_name();
+                        e.line = line;
+                        e.file.store(file, std::memory_order_release);
+                        return &e;
+                    }
+                    if (e.line == line && (f == file || strcmp(f, file) == 0))
+                    {
+                        return &e;
+                    }
+                }
+
+                histogram::bump(dropped, 1);
+                return nullptr;
+            }
+        };
+
+        // The tables of all threads that ever recorded anything. They're intentionally never freed,
+        // so that the statistics of threads that exited (for instance threadpool threads) are retained.
+        inline std::atomic<thread_table*> tables{ nullptr };
+
+        inline thread_table& current_table()
+        {
+            static thread_local thread_table* table = nullptr;
+            if (!table)
+            {
+                table = new thread_table;
+                auto head = tables.load(std::memory_order_relaxed);
+                do
+                {
+                    table->next = head;
+                } while (!tables.compare_exchange_weak(head, table, std::memory_order_release, std::memory_order_relaxed));
+            }
+            return *table;
+        }
+
+        inline uint64_t elapsed_ns(clock::time_point begin, clock::time_point end) noexcept
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        }
+
+        inline void record_wait(const site& s, clock::time_point begin, clock::time_point end) noexcept
+        try
+        {
+            if (const auto e = current_table().find_or_insert(s))
+            {
+                e->wait.record(elapsed_ns(begin, end));
+            }
+        }
+        catch (...)
+        {
+        }
+
+        inline void record_hold(const site& s, clock::time_point begin, clock::time_point end) noexcept
+        try
+        {
+            if (const auto e = current_table().find_or_insert(s))
+            {
+                e->hold.record(elapsed_ns(begin, end));
+            }
+        }
+        catch (...)
+        {
+        }
+    }
+
+    // Tracks a lock that's acquired and released in separate function calls, like IRenderData::LockConsole().
+    // Since it only remembers a single holder, it's only suitable for exclusive locks.
+    // Call acquired() once the lock is held and released() right before unlocking it.
+    class exclusive_hold
+    {
+    public:
+        void acquired(const site& s, clock::time_point waitStart) noexcept
+        {
+            _acquired = clock::now();
+            _site = s;
+            _active = true;
+            details::record_wait(s, waitStart, _acquired);
+        }
+
+        void released() noexcept
+        {
+            if (_active)
+            {
+                _active = false;
+                details::record_hold(_site, _acquired, clock::now());
+            }
+        }
+
+    private:
+        site _site;
+        clock::time_point _acquired;
+        bool _active = false;
+    };
+
+    // The shared counterpart to exclusive_hold, like for IRenderData::LockConsoleShared().
+    // Any number of threads may hold the lock at once, so each thread tracks its own hold.
+    // Only the outermost acquisition should be reported and a thread may only track one at a time.
+    class shared_hold
+    {
+    public:
+        void acquired(const site& s, clock::time_point waitStart) noexcept
+        {
+            _current().acquired(s, waitStart);
+        }
+
+        void released() noexcept
+        {
+            _current().released();
+        }
+
+    private:
+        static exclusive_hold& _current() noexcept
+        {
+            thread_local exclusive_hold hold;
+            return hold;
+        }
+    };
+
+    // Aggregates the statistics of all threads by call site.
+    inline std::vector<site_summary> summarize()
+    {
+        std::vector<site_summary> summaries;
+
+        for (auto table = details::tables.load(std::memory_order_acquire); table; table = table->next)
+        {
+            for (const auto& e : table->entries)
+            {
+                const auto file = e.file.load(std::memory_order_acquire);
+                if (!file)
+                {
+                    continue;
+                }
+
+                auto it = std::find_if(summaries.begin(), summaries.end(), [&](const site_summary& s) {
+                    return s.line == e.line && strcmp(s.file, file) == 0;
+                });
+                if (it == summaries.end())
+                {
+                    it = summaries.insert(summaries.end(), site_summary{ .file = file, .function = e.function, .line = e.line, .wait = {}, .hold = {} });
+                }
+
+                it->wait += e.wait.snapshot();
+                it->hold += e.hold.snapshot();
+            }
+        }
+
+        return summaries;
+    }
+
+    enum class order
+    {
+        // Sorts call sites by the total time they held their locks, which is what blocks everyone else.
+        hold,
+        // Sorts call sites by the total time they spent waiting for their locks.
+        wait,
+    };
+
+    // Returns a human-readable table of the `top` worst offending call sites.
+    inline std::string report(size_t top = 10, order by = order::hold)
+    {
+        auto summaries = summarize();
+        const auto key = [by](const site_summary& s) {
+            return by == order::hold ? s.hold.total_ns : s.wait.total_ns;
+        };
+        std::sort(summaries.begin(), summaries.end(), [&](const site_summary& a, const site_summary& b) {
+            return key(a) > key(b);
+        });
+        summaries.resize(std::min(summaries.size(), top));
+
+        std::string out;
+        char buffer[1024];
+        const auto append = [&](auto&&... args) {
+            const auto len = snprintf(&buffer[0], std::size(buffer), args...);
+            if (len > 0)
+            {
+                out.append(&buffer[0], std::min(static_cast<size_t>(len), std::size(buffer) - 1));
+            }
+        };
+
+        append("%10s %10s %10s %10s %10s %10s %10s  %s\n", "count", "wait tot", "wait p99", "wait max", "hold tot", "hold p99", "hold max", "site");
+        for (const auto& s : summaries)
+        {
+            // All times are in microseconds.
+            append("%10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f  %s(%u): %s\n",
+                   static_cast<unsigned long long>(std::max(s.wait.count, s.hold.count)),
+                   s.wait.total_ns / 1e3,
+                   s.wait.percentile_ns(99) / 1e3,
+                   s.wait.max_ns / 1e3,
+                   s.hold.total_ns / 1e3,
+                   s.hold.percentile_ns(99) / 1e3,
+                   s.hold.max_ns / 1e3,
+                   s.file,
+                   s.line,
+                   s.function);
+        }
+
+        uint64_t dropped = 0;
+        for (auto table = details::tables.load(std::memory_order_acquire); table; table = table->next)
+        {
+            dropped += table->dropped.load(std::memory_order_relaxed);
+        }
+        if (dropped)
+        {
+            append("%llu acquisitions weren't recorded because their thread's table was full\n", static_cast<unsigned long long>(dropped));
+        }
+
+        return out;
+    }
+#else
+    // A stand-in for std::source_location that holds nothing and compiles away.
+    struct site
+    {
+        static constexpr site current() noexcept
+        {
+            return {};
+        }
+    };
+#endif
+
+    // A std::unique_lock which records the wait and hold time of the call site it was created at.
+    // The hold time is recorded when the lock is released through this class (either by unlock() or
+    // when it's destroyed), so don't release it through a reference to the std::unique_lock base.
+    template<typename Mutex>
+    class unique_lock : public std::unique_lock<Mutex>
+    {
+    public:
+#if TIL_LOCK_STATS
+        explicit unique_lock(Mutex& mutex, site s = site::current()) :
+            std::unique_lock<Mutex>{ mutex, std::defer_lock },
+            _site{ s }
+        {
+            lock();
+        }
+
+        unique_lock(unique_lock&&) = default;
+
+        unique_lock& operator=(unique_lock&& other)
+        {
+            _release();
+            std::unique_lock<Mutex>::operator=(std::move(other));
+            _site = other._site;
+            _acquired = other._acquired;
+            return *this;
+        }
+
+        ~unique_lock()
+        {
+            _release();
+        }
+
+        void lock()
+        {
+            const auto start = clock::now();
+            std::unique_lock<Mutex>::lock();
+            _acquired = clock::now();
+            details::record_wait(_site, start, _acquired);
+        }
+
+        void unlock()
+        {
+            _release();
+            std::unique_lock<Mutex>::unlock();
+        }
+
+    private:
+        void _release() noexcept
+        {
+            if (this->owns_lock())
+            {
+                details::record_hold(_site, _acquired, clock::now());
+            }
+        }
+
+        site _site;
+        clock::time_point _acquired;
+#else
+        explicit unique_lock(Mutex& mutex, site = site::current()) :
+            std::unique_lock<Mutex>{ mutex }
+        {
+        }
+#endif
+    };
+
+    // The std::shared_lock counterpart to unique_lock above.
+    template<typename Mutex>
+    class shared_lock : public std::shared_lock<Mutex>
+    {
+    public:
+#if TIL_LOCK_STATS
+        explicit shared_lock(Mutex& mutex, site s = site::current()) :
+            std::shared_lock<Mutex>{ mutex, std::defer_lock },
+            _site{ s }
+        {
+            lock();
+        }
+
+        shared_lock(shared_lock&&) = default;
+
+        shared_lock& operator=(shared_lock&& other)
+        {
+            _release();
+            std::shared_lock<Mutex>::operator=(std::move(other));
+            _site = other._site;
+            _acquired = other._acquired;
+            return *this;
+        }
+
+        ~shared_lock()
+        {
+            _release();
+        }
+
+        void lock()
+        {
+            const auto start = clock::now();
+            std::shared_lock<Mutex>::lock();
+            _acquired = clock::now();
+            details::record_wait(_site, start, _acquired);
+        }
+
+        void unlock()
+        {
+            _release();
+            std::shared_lock<Mutex>::unlock();
+        }
+
+    private:
+        void _release() noexcept
+        {
+            if (this->owns_lock())
+            {
+                details::record_hold(_site, _acquired, clock::now());
+            }
+        }
+
+        site _site;
+        clock::time_point _acquired;
+#else
+        explicit shared_lock(Mutex& mutex, site = site::current()) :
+            std::shared_lock<Mutex>{ mutex }
+        {
+        }
+#endif
+    };
+}
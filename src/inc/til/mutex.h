@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "lock_stats.h"
+
 namespace til
 {
     namespace details
@@ -12,9 +14,9 @@ namespace til
         {
         public:
 #pragma warning(suppress : 26447) // The function is declared 'noexcept' but calls function 'shared_mutex>()' which may throw exceptions (f.6).)
-            shared_mutex_guard(T& data, std::shared_mutex& mutex) noexcept :
+            shared_mutex_guard(T& data, std::shared_mutex& mutex, lock_stats::site site) noexcept :
                 _data{ data },
-                _lock{ mutex }
+                _lock{ mutex, site }
             {
             }
 
@@ -74,11 +76,11 @@ namespace til
     public:
         // An exclusive, read/write reference to a til::shared_mutex's underlying data.
         // If you drop the guard, the mutex is unlocked.
-        using guard = details::shared_mutex_guard<T, std::unique_lock<std::shared_mutex>>;
+        using guard = details::shared_mutex_guard<T, lock_stats::unique_lock<std::shared_mutex>>;
 
         // A shared, read-only reference to a til::shared_mutex's underlying data.
         // If you drop the shared_guard the mutex is unlocked.
-        using shared_guard = details::shared_mutex_guard<const T, std::shared_lock<std::shared_mutex>>;
+        using shared_guard = details::shared_mutex_guard<const T, lock_stats::shared_lock<std::shared_mutex>>;
 
         shared_mutex() = default;
 
@@ -91,17 +93,17 @@ namespace til
         // Acquire an exclusive, read/write reference to T.
         // For instance:
         //   .lock()->foo = bar;
-        [[nodiscard]] guard lock() const noexcept
+        [[nodiscard]] guard lock(lock_stats::site site = lock_stats::site::current()) const noexcept
         {
-            return { _data, _mutex };
+            return { _data, _mutex, site };
         }
 
         // Acquire a shared, read-only reference to T.
         // For instance:
         //   bar = .lock_shared()->foo;
-        [[nodiscard]] shared_guard lock_shared() const noexcept
+        [[nodiscard]] shared_guard lock_shared(lock_stats::site site = lock_stats::site::current()) const noexcept
         {
-            return { _data, _mutex };
+            return { _data, _mutex, site };
         }
 
     private:
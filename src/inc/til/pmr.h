@@ -70,4 +70,129 @@ namespace til::pmr
         return std::pmr::get_default_resource();
     }
 #endif
+
+    // A monotonic memory resource for allocations that all die at the same time,
+    // like the temporaries a renderer needs to draw a single frame: Allocations bump a pointer,
+    // deallocations do nothing and reset() frees everything at once.
+    //
+    // Unlike std::pmr::monotonic_buffer_resource, reset() keeps the newest and largest block around.
+    // Since each block is twice as large as all previous ones combined, a workload that repeats
+    // every cycle stops hitting the upstream resource after a cycle or two.
+    class monotonic_arena final : public std::pmr::memory_resource
+    {
+    public:
+        explicit monotonic_arena(std::pmr::memory_resource* upstream = get_default_resource()) noexcept :
+            _upstream{ upstream }
+        {
+        }
+
+        ~monotonic_arena() override
+        {
+            _release(_head);
+        }
+
+        monotonic_arena(const monotonic_arena&) = delete;
+        monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+        // Invalidates all previous allocations.
+        void reset() noexcept
+        {
+            _size = 0;
+
+            if (_head)
+            {
+                _release(_head->next);
+                _head->next = nullptr;
+                _capacity = _head->size;
+                _cursor = _data(_head);
+                _end = _cursor + _head->size;
+            }
+        }
+
+        // The number of bytes allocated since the last reset(), excluding padding for alignment.
+        size_t size() const noexcept
+        {
+            return _size;
+        }
+
+        // The number of bytes available across all blocks.
+        size_t capacity() const noexcept
+        {
+            return _capacity;
+        }
+
+    private:
+        struct alignas(std::max_align_t) block
+        {
+            block* next;
+            size_t size;
+        };
+
+        static constexpr size_t min_block_size = 4096;
+
+        static char* _data(block* b) noexcept
+        {
+            return reinterpret_cast<char*>(b + 1);
+        }
+
+        void* do_allocate(const size_t bytes, const size_t align) override
+        {
+            auto beg = _align(_cursor, align);
+            // Blocks aren't padded to any particular alignment, so aligning the cursor may move it past the end.
+            if (!_cursor || beg > _end || bytes > static_cast<size_t>(_end - beg))
+            {
+                _grow(bytes + align);
+                beg = _align(_cursor, align);
+            }
+
+            _cursor = beg + bytes;
+            _size += bytes;
+            return beg;
+        }
+
+        void do_deallocate(void*, size_t, size_t) noexcept override
+        {
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        static char* _align(char* ptr, const size_t align) noexcept
+        {
+            const auto addr = reinterpret_cast<uintptr_t>(ptr);
+            return ptr + ((align - (addr & (align - 1))) & (align - 1));
+        }
+
+        void _grow(const size_t minimum)
+        {
+            const auto size = std::max({ min_block_size, minimum, _capacity * 2 });
+            const auto b = static_cast<block*>(_upstream->allocate(sizeof(block) + size, alignof(block)));
+            b->next = _head;
+            b->size = size;
+
+            _head = b;
+            _capacity += size;
+            _cursor = _data(b);
+            _end = _cursor + size;
+        }
+
+        void _release(block* b) noexcept
+        {
+            while (b)
+            {
+                const auto next = b->next;
+                _upstream->deallocate(b, sizeof(block) + b->size, alignof(block));
+                b = next;
+            }
+        }
+
+        std::pmr::memory_resource* _upstream;
+        block* _head = nullptr;
+        char* _cursor = nullptr;
+        char* _end = nullptr;
+        size_t _size = 0;
+        size_t _capacity = 0;
+    };
 }
@@ -0,0 +1,230 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#pragma warning(push)
+#pragma warning(disable : 26446) // Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+
+namespace til // Terminal Implementation Library. Also: "Today I Learned"
+{
+    // A growable FIFO queue backed by a single power-of-2 sized allocation.
+    //
+    // Compared to std::deque, its contents are always split into at most 2 contiguous
+    // slices (before and after the wrap-around), which allows reading and writing
+    // them in bulk with just 2 memcpy()s. It only supports trivially copyable types,
+    // because that's what it's good at and it keeps the implementation simple.
+    template<typename T>
+    class ring_buffer
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using reference = T&;
+        using const_reference = const T&;
+
+        ring_buffer() = default;
+
+        ring_buffer(const ring_buffer&) = delete;
+        ring_buffer& operator=(const ring_buffer&) = delete;
+
+        ring_buffer(ring_buffer&& other) noexcept :
+            _data{ std::move(other._data) },
+            _capacity{ std::exchange(other._capacity, 0) },
+            _head{ std::exchange(other._head, 0) },
+            _size{ std::exchange(other._size, 0) }
+        {
+        }
+
+        ring_buffer& operator=(ring_buffer&& other) noexcept
+        {
+            _data = std::move(other._data);
+            _capacity = std::exchange(other._capacity, 0);
+            _head = std::exchange(other._head, 0);
+            _size = std::exchange(other._size, 0);
+            return *this;
+        }
+
+        ~ring_buffer() = default;
+
+        void swap(ring_buffer& other) noexcept
+        {
+            std::swap(_data, other._data);
+            std::swap(_capacity, other._capacity);
+            std::swap(_head, other._head);
+            std::swap(_size, other._size);
+        }
+
+        bool empty() const noexcept
+        {
+            return _size == 0;
+        }
+
+        size_t size() const noexcept
+        {
+            return _size;
+        }
+
+        size_t capacity() const noexcept
+        {
+            return _capacity;
+        }
+
+        T& operator[](size_t i) noexcept
+        {
+            assert(i < _size);
+            return _data[(_head + i) & (_capacity - 1)];
+        }
+
+        const T& operator[](size_t i) const noexcept
+        {
+            assert(i < _size);
+            return _data[(_head + i) & (_capacity - 1)];
+        }
+
+        T& front() noexcept
+        {
+            return (*this)[0];
+        }
+
+        const T& front() const noexcept
+        {
+            return (*this)[0];
+        }
+
+        T& back() noexcept
+        {
+            return (*this)[_size - 1];
+        }
+
+        const T& back() const noexcept
+        {
+            return (*this)[_size - 1];
+        }
+
+        void clear() noexcept
+        {
+            _head = 0;
+            _size = 0;
+        }
+
+        void reserve(size_t capacity)
+        {
+            if (capacity > _capacity)
+            {
+                _grow(capacity);
+            }
+        }
+
+        void push_back(const T& value)
+        {
+            reserve(_size + 1);
+            _data[(_head + _size) & (_capacity - 1)] = value;
+            _size++;
+        }
+
+        // Appends all of `values` with at most 2 memcpy()s.
+        void append(std::span<const T> values)
+        {
+            if (values.empty())
+            {
+                return;
+            }
+
+            reserve(_size + values.size());
+
+            const auto mask = _capacity - 1;
+            const auto tail = (_head + _size) & mask;
+            const auto first = std::min(values.size(), _capacity - tail);
+            memcpy(_data.get() + tail, values.data(), first * sizeof(T));
+            memcpy(_data.get(), values.data() + first, (values.size() - first) * sizeof(T));
+            _size += values.size();
+        }
+
+        // Returns the items in the range [offset, offset+count) as 2 contiguous slices.
+        // The second one is only non-empty if the range wraps around the end of the allocation.
+        // `count` is clamped to the number of items that are available past `offset`.
+        std::array<std::span<T>, 2> slices(size_t offset, size_t count) noexcept
+        {
+            offset = std::min(offset, _size);
+            count = std::min(count, _size - offset);
+
+            if (count == 0)
+            {
+                return {};
+            }
+
+            const auto beg = (_head + offset) & (_capacity - 1);
+            const auto first = std::min(count, _capacity - beg);
+            return { std::span{ _data.get() + beg, first }, std::span{ _data.get(), count - first } };
+        }
+
+        std::array<std::span<const T>, 2> slices(size_t offset, size_t count) const noexcept
+        {
+            const auto s = const_cast<ring_buffer*>(this)->slices(offset, count);
+            return { s[0], s[1] };
+        }
+
+        // Removes the first `count` items. This is O(1).
+        void pop_front(size_t count = 1) noexcept
+        {
+            count = std::min(count, _size);
+            _size -= count;
+            _head = _size == 0 ? 0 : (_head + count) & (_capacity - 1);
+        }
+
+        // Removes all items for which `pred` returns true, while preserving the order of the remaining ones.
+        template<typename Pred>
+        void remove_if(Pred&& pred)
+        {
+            size_t write = 0;
+
+            for (size_t read = 0; read < _size; ++read)
+            {
+                auto& item = (*this)[read];
+                if (!pred(std::as_const(item)))
+                {
+                    if (write != read)
+                    {
+                        (*this)[write] = item;
+                    }
+                    write++;
+                }
+            }
+
+            _size = write;
+            if (_size == 0)
+            {
+                _head = 0;
+            }
+        }
+
+    private:
+        void _grow(size_t required)
+        {
+            static constexpr size_t minCapacity = 16;
+
+            const auto capacity = std::bit_ceil(std::max({ required, _capacity * 2, minCapacity }));
+            auto data = std::make_unique_for_overwrite<T[]>(capacity);
+
+            // Unwrap the contents, so that they start at index 0 in the new allocation.
+            const auto s = slices(0, _size);
+            const auto it = std::copy(s[0].begin(), s[0].end(), data.get());
+            std::copy(s[1].begin(), s[1].end(), it);
+
+            _data = std::move(data);
+            _capacity = capacity;
+            _head = 0;
+        }
+
+        std::unique_ptr<T[]> _data;
+        size_t _capacity = 0;
+        size_t _head = 0;
+        size_t _size = 0;
+    };
+}
+
+#pragma warning(pop)
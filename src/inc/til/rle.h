@@ -310,14 +310,38 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         static_assert(std::is_unsigned_v<size_type>, "the run length S must be unsigned");
         static_assert(std::is_same_v<rle_type, typename Container::value_type>, "the value type of the Container must be rle_pair<T, S>");
 
+        // A range [begin, end) and the value it's supposed to be replaced with. See replace_ranges().
+        struct edit
+        {
+            size_type begin;
+            size_type end;
+            value_type value;
+        };
+
+        // Once an instance consists of this many runs, lookups start caching the prefix sums
+        // of the run lengths in _index, which turns them into a binary search. Below that
+        // the linear scan is just as fast and we don't need to allocate any memory.
+        static constexpr size_t index_threshold = 32;
+
         constexpr basic_rle() noexcept = default;
         ~basic_rle() = default;
 
-        basic_rle(const basic_rle& other) = default;
-        basic_rle& operator=(const basic_rle& other) = default;
+        // The index is just a cache and not copied, so that copying rows stays cheap.
+        basic_rle(const basic_rle& other) :
+            _runs(other._runs), _total_length(other._total_length)
+        {
+        }
+
+        basic_rle& operator=(const basic_rle& other)
+        {
+            _runs = other._runs;
+            _total_length = other._total_length;
+            _index.clear();
+            return *this;
+        }
 
         basic_rle(basic_rle&& other) noexcept :
-            _runs(std::move(other._runs)), _total_length(other._total_length)
+            _runs(std::move(other._runs)), _total_length(other._total_length), _index(std::move(other._index))
         {
             // C++ fun fact:
             // "std::move" actually doesn't actually promise to _really_ move stuff from A to B,
@@ -339,6 +363,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
             _runs = std::move(other._runs);
             _total_length = other._total_length;
+            _index = std::move(other._index);
 
             // See basic_rle(basic_rle&&) for why this is necessary.
             if (other._runs.empty())
@@ -380,6 +405,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
             std::swap(_runs, other._runs);
             std::swap(_total_length, other._total_length);
+            std::swap(_index, other._index);
         }
 
         bool empty() const noexcept
@@ -400,26 +426,24 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             return _runs;
         }
 
+        // Since the caller may modify the runs in any way, this drops the index.
         container& runs() noexcept
         {
+            _index.clear();
             return _runs;
         }
 
         // Get the value at the position
         const_reference at(size_type position) const
         {
-            const auto begin = _runs.begin();
-            const auto end = _runs.end();
+            const auto run = _seek(position).first;
 
-            rle_scanner scanner(begin, end);
-            auto it = scanner.scan(position).first;
-
-            if (it == end)
+            if (run >= _runs.size())
             {
                 throw std::out_of_range("position out of range");
             }
 
-            return it->value;
+            return _runs[run].value;
         }
 
         // Returns the range [start_index, end_index) as a new vector.
@@ -443,11 +467,11 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             //
             // --> It's safe to subtract 1 from end_index
 
-            rle_scanner scanner(_runs.begin(), _runs.end());
-            const auto [begin_run, start_run_pos] = scanner.scan(start_index);
-            const auto [end_run, end_run_pos] = scanner.scan(end_index - 1);
+            const auto [begin_run, start_run_pos] = _seek(start_index);
+            const auto [end_run, end_run_pos] = _seek(end_index - 1, begin_run, gsl::narrow_cast<size_type>(start_index - start_run_pos));
 
-            container slice{ begin_run, end_run + 1 };
+            const auto runs_begin = _runs.begin();
+            container slice{ runs_begin + begin_run, runs_begin + end_run + 1 };
             slice.back().length = end_run_pos + 1;
             slice.front().length -= start_run_pos;
 
@@ -491,6 +515,103 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             _replace_unchecked(start_index, end_index, replacements._runs);
         }
 
+        // Replaces each of the ranges [begin, end) with the value of its edit, in a single pass over the runs.
+        // The result is the same as calling replace() for each edit in order, but it takes O(runs + edits)
+        // instead of O(runs * edits), which matters for rows with lots of differently colored cells.
+        // The edits must be sorted by position and mustn't overlap. Their end is clamped to size().
+        void replace_ranges(const std::span<const edit> edits)
+        {
+            size_type previous_end = 0;
+            for (const auto& e : edits)
+            {
+                const auto end_index = std::min(e.end, _total_length);
+                if (e.begin > end_index)
+                {
+                    throw std::out_of_range("start_index <= end_index");
+                }
+                if (e.begin < previous_end)
+                {
+                    throw std::invalid_argument("edits must be sorted and mustn't overlap");
+                }
+                previous_end = end_index;
+            }
+
+            if (edits.empty())
+            {
+                return;
+            }
+
+            // The runs in front of the first edit stay as they are, except for the one right before it,
+            // which we might have to join with the first edit. Everything past that gets rebuilt into tail.
+            auto [first_run, first_run_pos] = _seek_and_index(edits.front().begin);
+            size_type pos = edits.front().begin - first_run_pos;
+            if (first_run != 0)
+            {
+                --first_run;
+                pos -= _runs[first_run].length;
+            }
+
+            container tail;
+            const auto append = [&](const value_type& value, const size_type length) {
+                if (length == 0)
+                {
+                    return;
+                }
+                if (!tail.empty() && tail.back().value == value)
+                {
+                    tail.back().length += length;
+                }
+                else
+                {
+                    tail.emplace_back(value, length);
+                }
+            };
+
+            const auto runs_end = _runs.end();
+            auto it = _runs.begin() + first_run;
+            // The position at which the run "it" points to starts.
+            auto it_pos = pos;
+
+            // Appends the existing runs in the range [pos, target) to tail.
+            const auto copy_until = [&](const size_type target) {
+                while (pos < target)
+                {
+                    const size_type it_end = it_pos + it->length;
+                    const auto copy_end = std::min(it_end, target);
+                    append(it->value, gsl::narrow_cast<size_type>(copy_end - pos));
+                    pos = copy_end;
+
+                    if (pos == it_end)
+                    {
+                        it_pos = it_end;
+                        ++it;
+                    }
+                }
+            };
+
+            for (const auto& e : edits)
+            {
+                const auto end_index = std::min(e.end, _total_length);
+
+                copy_until(e.begin);
+                append(e.value, gsl::narrow_cast<size_type>(end_index - e.begin));
+
+                // Skip the runs that were replaced by this edit.
+                while (it != runs_end && it_pos + it->length <= end_index)
+                {
+                    it_pos += it->length;
+                    ++it;
+                }
+                pos = end_index;
+            }
+
+            copy_until(_total_length);
+
+            _runs.erase(_runs.begin() + first_run, runs_end);
+            _runs.insert(_runs.end(), tail.begin(), tail.end());
+            _invalidate_index(first_run);
+        }
+
         // Replaces every instance of old_value in this vector with new_value.
         void replace_values(const value_type& old_value, const value_type& new_value)
         {
@@ -503,6 +624,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             }
 
             _compact();
+            _index.clear();
         }
 
         // Adjust the size of the vector.
@@ -513,15 +635,17 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             if (new_size == 0)
             {
                 _runs.clear();
+                _index.clear();
             }
             else if (new_size < _total_length)
             {
-                rle_scanner scanner(_runs.begin(), _runs.end());
-                auto [run, pos] = scanner.scan(new_size - 1);
+                const auto [run, pos] = _seek_and_index(new_size - 1);
+                const auto it = _runs.begin() + run;
 
-                run->length = ++pos;
+                it->length = pos + 1;
 
-                _runs.erase(++run, _runs.end());
+                _runs.erase(it + 1, _runs.end());
+                _invalidate_index(run);
             }
             else if (new_size > _total_length)
             {
@@ -529,6 +653,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                 auto& run = _runs.back();
 
                 run.length += new_size - _total_length;
+                _invalidate_index(_runs.size() - 1);
             }
 
             _total_length = new_size;
@@ -617,42 +742,79 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 #endif
 
     private:
-        template<typename It>
-        struct rle_scanner
+        basic_rle(container&& runs, size_type size) noexcept :
+            _runs(std::forward<container>(runs)),
+            _total_length(size)
         {
-            explicit rle_scanner(It begin, It end) noexcept :
-                it(std::move(begin)), end(std::move(end)) {}
+        }
+
+        // Returns the index of the run containing the given position and the position within that run.
+        // If the position is past the end, the run index is _runs.size().
+        // The scan starts at the given run (which must start at run_pos), unless _index lets us skip ahead.
+        //
+        // _index[i] caches the end position of run i and is always valid for the runs it covers.
+        // Positions inside the indexed range are found via binary search.
+        std::pair<size_t, size_type> _seek(const size_type position, size_t run = 0, size_type run_pos = 0) const
+        {
+            return _seek_impl(position, run, run_pos, nullptr);
+        }
 
-            std::pair<It, size_type> scan(size_type index) noexcept
+        // Same as _seek(), but extends the index on demand. Modifications truncate it to the runs they
+        // didn't touch and since most of them happen from left to right, finding the position of the next
+        // one tends to be cheap as well. Const methods don't extend the index, so that they remain safe
+        // to be called concurrently, for instance by multiple threads holding a shared lock.
+        std::pair<size_t, size_type> _seek_and_index(const size_type position, size_t run = 0, size_type run_pos = 0)
+        {
+            return _seek_impl(position, run, run_pos, &_index);
+        }
+
+        std::pair<size_t, size_type> _seek_impl(const size_type position, size_t run, size_type run_pos, std::vector<size_type>* index) const
+        {
+            if (!_index.empty() && position < _index.back())
             {
-                run_pos = 0;
+                const auto it = std::upper_bound(_index.begin(), _index.end(), position);
+                run = gsl::narrow_cast<size_t>(it - _index.begin());
+                run_pos = run ? _index[run - 1] : 0;
+                return { run, gsl::narrow_cast<size_type>(position - run_pos) };
+            }
 
-                for (; it != end; ++it)
-                {
-                    const size_type new_total = total + it->length;
-                    if (new_total > index)
-                    {
-                        run_pos = index - total;
-                        break;
-                    }
+            if (run <= _index.size())
+            {
+                run = _index.size();
+                run_pos = _index.empty() ? 0 : _index.back();
+            }
 
-                    total = new_total;
-                }
+            const auto count = _runs.size();
+            const auto record = index && run == _index.size() && count >= index_threshold;
+            if (record)
+            {
+                index->reserve(count);
+            }
 
-                return { it, run_pos };
+            for (; run < count; ++run)
+            {
+                const size_type run_end = run_pos + _runs[run].length;
+                if (record)
+                {
+                    index->push_back(run_end);
+                }
+                if (run_end > position)
+                {
+                    return { run, gsl::narrow_cast<size_type>(position - run_pos) };
+                }
+                run_pos = run_end;
             }
 
-        private:
-            It it;
-            const It end;
-            size_type run_pos = 0;
-            size_type total = 0;
-        };
+            return { count, 0 };
+        }
 
-        basic_rle(container&& runs, size_type size) noexcept :
-            _runs(std::forward<container>(runs)),
-            _total_length(size)
+        // Drops the cached end positions of the given run and all runs after it.
+        void _invalidate_index(const size_t run)
         {
+            if (run < _index.size())
+            {
+                _index.resize(run);
+            }
         }
 
         void _compact()
@@ -866,9 +1028,17 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             // TODO GH#10135: Ensure replacements contains no runs with .length == 0.
 
-            rle_scanner scanner{ _runs.begin(), _runs.end() };
-            auto [begin, begin_pos] = scanner.scan(start_index);
-            auto [end, end_pos] = scanner.scan(end_index);
+            const auto [begin_run, begin_run_pos] = _seek_and_index(start_index);
+            const auto [end_run, end_run_pos] = _seek_and_index(end_index, begin_run, gsl::narrow_cast<size_type>(start_index - begin_run_pos));
+
+            // Both the removal below and [Step1] may extend the run preceding start_index.
+            // Any run before that one remains untouched, and so do their index entries.
+            _invalidate_index(begin_run ? begin_run - 1 : 0);
+
+            auto begin = _runs.begin() + begin_run;
+            auto begin_pos = begin_run_pos;
+            auto end = _runs.begin() + end_run;
+            auto end_pos = end_run_pos;
 
             // This condition handles pure removals, where replacements.size() == 0.
             //
@@ -1023,13 +1193,12 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
         container _runs;
         S _total_length{ 0 };
+        // The prefix sums of the run lengths. See _seek() and _seek_and_index().
+        std::vector<size_type> _index;
 
 #ifdef UNIT_TESTING
         friend class ::RunLengthEncodingTests;
 #endif
-
-        template<typename It>
-        rle_scanner(It b, It e) -> rle_scanner<It>;
     };
 
     template<typename T, typename S = std::size_t>
@@ -3,18 +3,7 @@
 
 #pragma once
 
-// til::spsc::details::arc requires std::atomic<size_type>::wait() and ::notify_one() and at the time of writing no
-// STL supports these. Since both Windows and Linux offer a Futex implementation we can easily implement this though.
-// On other platforms we fall back to using a std::condition_variable.
-#if __cpp_lib_atomic_wait >= 201907
-#define _TIL_SPSC_DETAIL_POSITION_IMPL_NATIVE 1
-#elif defined(_WIN32_WINNT) && _WIN32_WINNT >= _WIN32_WINNT_WIN8
-#define _TIL_SPSC_DETAIL_POSITION_IMPL_WIN 1
-#elif __linux__
-#define _TIL_SPSC_DETAIL_POSITION_IMPL_LINUX 1
-#else
-#define _TIL_SPSC_DETAIL_POSITION_IMPL_FALLBACK 1
-#endif
+#include "atomic.h"
 
 // til: Terminal Implementation Library. Also: "Today I Learned".
 // spsc: Single Producer Single Consumer. A SPSC queue/channel sends data from exactly one sender to one receiver.
@@ -43,11 +32,12 @@ namespace til::spsc
         template<typename WaitPolicy>
         using enable_if_wait_policy_t = typename std::remove_reference_t<WaitPolicy>::_spsc_policy;
 
-#if _TIL_SPSC_DETAIL_POSITION_IMPL_NATIVE
-        using atomic_size_type = std::atomic<size_type>;
-#else
-        // atomic_size_type is a fallback if native std::atomic<size_type>::wait()
-        // and ::notify_one() methods are unavailable in the STL.
+        // atomic_size_type blocks via til::atomic_wait(), which is a futex on both Windows and Linux.
+        // Compared to std::atomic<size_type>::wait() this is slightly faster and works consistently across STLs.
+        //
+        // Waking a futex costs a syscall on Linux, even if nobody is waiting, which would dominate the cost of
+        // passing small batches through the queue. The waiting side thus announces itself in _waiters first.
+        // The two seq_cst fences ensure that either notify_one() sees the waiter, or the waiter sees the new value.
         struct atomic_size_type
         {
             size_type load(std::memory_order order) const noexcept
@@ -57,57 +47,36 @@ namespace til::spsc
 
             void store(size_type desired, std::memory_order order) noexcept
             {
-#if _TIL_SPSC_DETAIL_POSITION_IMPL_FALLBACK
-                // We must use a lock here to prevent us from modifying the value
-                // in between wait() reading the value and the thread being suspended.
-                std::lock_guard<std::mutex> lock{ _m };
-#endif
                 _value.store(desired, order);
             }
 
-            void wait(size_type old, [[maybe_unused]] std::memory_order order) const noexcept
+            void wait(size_type old, std::memory_order order) const noexcept
             {
-#if _TIL_SPSC_DETAIL_POSITION_IMPL_WIN
-#pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile
-                WaitOnAddress(const_cast<std::atomic<size_type>*>(&_value), &old, sizeof(_value), INFINITE);
-#elif _TIL_SPSC_DETAIL_POSITION_IMPL_LINUX
-                futex(FUTEX_WAIT_PRIVATE, old);
-#elif _TIL_SPSC_DETAIL_POSITION_IMPL_FALLBACK
-                std::unique_lock<std::mutex> lock{ _m };
-                _cv.wait(lock, [&]() { return _value.load(order) != old; });
-#endif
+                _waiters.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                // til::atomic_wait() may return spuriously.
+                while (_value.load(order) == old)
+                {
+                    til::atomic_wait(_value, old);
+                }
+
+                _waiters.fetch_sub(1, std::memory_order_relaxed);
             }
 
             void notify_one() noexcept
             {
-#if _TIL_SPSC_DETAIL_POSITION_IMPL_WIN
-                WakeByAddressSingle(&_value);
-#elif _TIL_SPSC_DETAIL_POSITION_IMPL_LINUX
-                futex(FUTEX_WAKE_PRIVATE, 1);
-#elif _TIL_SPSC_DETAIL_POSITION_IMPL_FALLBACK
-                _cv.notify_one();
-#endif
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (_waiters.load(std::memory_order_relaxed) != 0)
+                {
+                    til::atomic_notify_one(_value);
+                }
             }
 
         private:
-#if _TIL_SPSC_DETAIL_POSITION_IMPL_LINUX
-            inline void futex(int futex_op, size_type val) const noexcept
-            {
-                // See: https://man7.org/linux/man-pages/man2/futex.2.html
-                static_assert(sizeof(std::atomic<size_type>) == 4);
-                syscall(SYS_futex, &_value, futex_op, val, nullptr, nullptr, 0);
-            }
-#endif
-
             std::atomic<size_type> _value{ 0 };
-
-#if _TIL_SPSC_DETAIL_POSITION_IMPL_FALLBACK
-        private:
-            std::mutex _m;
-            std::condition_variable _cv;
-#endif
+            mutable std::atomic<size_type> _waiters{ 0 };
         };
-#endif
 
         template<typename T>
         inline T* alloc_raw_memory(size_t size)
@@ -162,6 +131,16 @@ namespace til::spsc
             }
         };
 
+        // Unlike an acquisition, a bulk_acquisition spans the entire writable/readable range, even if it
+        // wraps around the end of the ring buffer. It's [begin, begin + first) followed by [0, second).
+        struct bulk_acquisition
+        {
+            size_type begin;
+            size_type first;
+            size_type second;
+            bool alive;
+        };
+
         // The following assumes you know what ring/circular buffers are. You can read about them here:
         //   https://en.wikipedia.org/wiki/Circular_buffer
         //
@@ -278,6 +257,31 @@ namespace til::spsc
                 release(_consumer, acquisition);
             }
 
+            bulk_acquisition producer_acquire_bulk(size_type slots, bool blockForever) noexcept
+            {
+                return acquire_bulk(_producer, _consumer, revolution_flag, slots, blockForever);
+            }
+
+            void producer_advance(size_type count) noexcept
+            {
+                advance(_producer, count);
+            }
+
+            bulk_acquisition consumer_acquire_bulk(size_type slots, bool blockForever) noexcept
+            {
+                return acquire_bulk(_consumer, _producer, 0, slots, blockForever);
+            }
+
+            void consumer_advance(size_type count) noexcept
+            {
+                advance(_consumer, count);
+            }
+
+            size_type capacity() const noexcept
+            {
+                return _capacity;
+            }
+
             T* data() const noexcept
             {
                 return _data;
@@ -298,7 +302,8 @@ namespace til::spsc
                 // the flag to true and get false, causing us to return early.
                 // Only the second time we'll get true.
                 // --> The contents are only deleted when both sides have been dropped.
-                if (_eitherSideDropped.exchange(true, std::memory_order_relaxed))
+                // acq_rel ensures that the other side is done with the arc before we delete it.
+                if (_eitherSideDropped.exchange(true, std::memory_order_acq_rel))
                 {
                     delete this;
                 }
@@ -382,6 +387,64 @@ namespace til::spsc
                 mine.notify_one();
             }
 
+            // Same as acquire(), but returns both halves of a range that wraps around the end of the ring buffer.
+            // If blockForever is true, it waits until the full number of slots is available, or the other side is gone.
+            // NOTE: waitMask MUST be either 0 (consumer) or revolution_flag (producer).
+            bulk_acquisition acquire_bulk(const atomic_size_type& mine, const atomic_size_type& theirs, size_type waitMask, size_type slots, bool blockForever) const noexcept
+            {
+                const auto myPos = mine.load(std::memory_order_relaxed);
+                const auto begin = myPos & position_mask;
+
+                while (true)
+                {
+                    // This acquire read synchronizes with the release write in release() and advance().
+                    const auto theirPos = theirs.load(std::memory_order_acquire);
+                    const auto dropped = (theirPos & drop_flag) != 0;
+
+                    // See acquire() for the handling of the drop_flag.
+                    if (dropped && (waitMask != 0 || (myPos ^ theirPos) == drop_flag))
+                    {
+                        return { 0, 0, 0, false };
+                    }
+
+                    size_type available = 0;
+                    if (((myPos ^ theirPos) & ~drop_flag) != waitMask)
+                    {
+                        // If the other side's position is ahead of ours, the range is contiguous. Otherwise it wraps around.
+                        // If both are equal it's the full capacity: The queue is either empty (producer) or full (consumer).
+                        const auto end = theirPos & position_mask;
+                        available = end > begin ? end - begin : _capacity - begin + end;
+                    }
+
+                    if (available >= slots || (available != 0 && (!blockForever || dropped)))
+                    {
+                        available = std::min(available, slots);
+                        const auto first = std::min(available, _capacity - begin);
+                        return { begin, first, available - first, true };
+                    }
+
+                    theirs.wait(theirPos, std::memory_order_relaxed);
+                }
+            }
+
+            // Moves our position forward by count slots, which must have been returned by acquire_bulk().
+            void advance(atomic_size_type& mine, size_type count) noexcept
+            {
+                const auto myPos = mine.load(std::memory_order_relaxed);
+                auto revolution = myPos & revolution_flag;
+                auto next = (myPos & position_mask) + count;
+
+                if (next >= _capacity)
+                {
+                    next -= _capacity;
+                    revolution ^= revolution_flag;
+                }
+
+                // This release write synchronizes with the acquire read in acquire_bulk() and acquire().
+                mine.store(next | revolution, std::memory_order_release);
+                mine.notify_one();
+            }
+
             T* const _data;
             const size_type _capacity;
 
@@ -406,13 +469,35 @@ namespace til::spsc
     // Block until all items have been written into the sender / read from the receiver.
     inline constexpr details::block_forever_policy block_forever{};
 
+    // A part of the queue's ring buffer as returned by producer::reserve() and consumer::peek().
+    // If the part wraps around the end of the ring buffer, it's split into two spans.
+    // "second" is thus only ever non-empty if "first" is non-empty as well.
+    template<typename T>
+    struct reservation
+    {
+        std::span<T> first;
+        std::span<T> second;
+        // false, if the other side is gone. Both spans are empty in that case.
+        bool alive = true;
+
+        size_t size() const noexcept
+        {
+            return first.size() + second.size();
+        }
+
+        bool empty() const noexcept
+        {
+            return first.empty();
+        }
+    };
+
     template<typename T>
     struct producer
     {
         explicit producer(details::arc<T>* arc) noexcept :
             _arc(arc) {}
 
-        producer<T>(const producer<T>&) = delete;
+        producer(const producer<T>&) = delete;
         producer<T>& operator=(const producer<T>&) = delete;
 
         producer(producer<T>&& other) noexcept
@@ -513,6 +598,35 @@ namespace til::spsc
             return { count - remaining, ok };
         }
 
+        // reserve returns up to count writable slots at the end of the queue without consuming them.
+        // With block_initially it waits until at least 1 slot is free, with block_forever until count slots are.
+        // The slots are uninitialized. Once filled, commit() makes (a prefix of) them visible to the consumer.
+        // Only trivially copyable types are supported, since the slots are written to without being constructed first.
+        template<typename WaitPolicy, details::enable_if_wait_policy_t<WaitPolicy> = 0>
+        reservation<T> reserve(WaitPolicy&&, size_t count) const
+        {
+            static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+
+            count = std::min<size_t>(count, _arc->capacity());
+            const auto acquisition = _arc->producer_acquire_bulk(static_cast<size_type>(count), std::remove_reference_t<WaitPolicy>::_block_forever);
+            const auto data = _arc->data();
+            return {
+                { data + acquisition.begin, acquisition.first },
+                { data, acquisition.second },
+                acquisition.alive,
+            };
+        }
+
+        // commit publishes the first count slots of the last reserve() to the consumer with a single release store.
+        // count must not be larger than the size() of the reservation.
+        void commit(size_t count) const noexcept
+        {
+            if (count)
+            {
+                _arc->producer_advance(static_cast<size_type>(count));
+            }
+        }
+
     private:
         void drop()
         {
@@ -531,7 +645,7 @@ namespace til::spsc
         explicit consumer(details::arc<T>* arc) noexcept :
             _arc(arc) {}
 
-        consumer<T>(const consumer<T>&) = delete;
+        consumer(const consumer<T>&) = delete;
         consumer<T>& operator=(const consumer<T>&) = delete;
 
         consumer(consumer<T>&& other) noexcept
@@ -617,6 +731,35 @@ namespace til::spsc
             return { count - remaining, ok };
         }
 
+        // peek returns up to count readable items at the front of the queue without consuming them.
+        // With block_initially it waits until at least 1 item is available, with block_forever until count items are
+        // (or the producer is gone). consume() then releases (a prefix of) them back to the producer.
+        // Only trivially copyable types are supported, since consumed items aren't destroyed.
+        template<typename WaitPolicy, details::enable_if_wait_policy_t<WaitPolicy> = 0>
+        reservation<const T> peek(WaitPolicy&&, size_t count) const
+        {
+            static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+
+            count = std::min<size_t>(count, _arc->capacity());
+            const auto acquisition = _arc->consumer_acquire_bulk(static_cast<size_type>(count), std::remove_reference_t<WaitPolicy>::_block_forever);
+            const auto data = _arc->data();
+            return {
+                { data + acquisition.begin, acquisition.first },
+                { data, acquisition.second },
+                acquisition.alive,
+            };
+        }
+
+        // consume releases the first count items of the last peek() back to the producer with a single release store.
+        // count must not be larger than the size() of the reservation.
+        void consume(size_t count) const noexcept
+        {
+            if (count)
+            {
+                _arc->consumer_advance(static_cast<size_type>(count));
+            }
+        }
+
     private:
         void drop()
         {
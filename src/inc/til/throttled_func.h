@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "timer_service.h"
+
 namespace til
 {
     struct throttled_func_options
@@ -10,6 +12,7 @@ namespace til
         using filetime_duration = std::chrono::duration<int64_t, std::ratio<1, 10000000>>;
 
         filetime_duration delay{};
+        filetime_duration slack{};
         bool debounce = false;
         bool leading = false;
         bool trailing = false;
@@ -26,6 +29,8 @@ namespace til
         //
         // Options:
         // * delay: The minimum time between invocations
+        // * slack: How much later than `delay` the trailing invocation may occur,
+        //          so that it can share a wakeup with other timers (see til::timer_service)
         // * debounce: If true, resets the timer on each call
         // * leading: If true, `func` will be invoked immediately on first call
         // * trailing: If true, `func` will be invoked after the delay
@@ -33,26 +38,26 @@ namespace til
         // At least one of leading or trailing must be true.
         throttled_func(throttled_func_options opts, function func) :
             _func{ std::move(func) },
-            _timer{ _create_timer() },
+            _delay{ opts.delay },
+            _slack{ opts.slack },
             _debounce{ opts.debounce },
             _leading{ opts.leading },
-            _trailing{ opts.trailing }
+            _trailing{ opts.trailing },
+            _timer{ [this]() { _timer_callback(); } }
         {
             if (!_leading && !_trailing)
             {
                 throw std::invalid_argument("neither leading nor trailing");
             }
 
-            const auto d = -opts.delay.count();
-            if (d >= 0)
+            if (_delay.count() <= 0)
             {
                 throw std::invalid_argument("non-positive delay specified");
             }
-            memcpy(&_delay, &d, sizeof(d));
         }
 
         // throttled_func uses its `this` pointer when creating _timer.
-        // Since the timer cannot be recreated, instances cannot be moved either.
+        // Since the timer cannot be rebound, instances cannot be moved either.
         throttled_func(const throttled_func&) = delete;
         throttled_func& operator=(const throttled_func&) = delete;
         throttled_func(throttled_func&&) = delete;
@@ -95,25 +100,18 @@ namespace til
         //       could still be called concurrently.
         void flush()
         {
-            WaitForThreadpoolTimerCallbacks(_timer.get(), true);
-            _timer_callback(nullptr, this, nullptr);
+            _timer.cancel();
+            _timer_callback();
         }
 
     private:
-        static void __stdcall _timer_callback(PTP_CALLBACK_INSTANCE /*instance*/, PVOID context, PTP_TIMER /*timer*/) noexcept
+        void _timer_callback() noexcept
         try
         {
-            static_cast<throttled_func*>(context)->_trail();
+            _trail();
         }
         CATCH_LOG()
 
-        wil::unique_threadpool_timer _create_timer()
-        {
-            wil::unique_threadpool_timer timer{ CreateThreadpoolTimer(&_timer_callback, this, nullptr) };
-            THROW_LAST_ERROR_IF(!timer);
-            return timer;
-        }
-
         void _lead(std::tuple<Args...> args)
         {
             bool timerRunning = false;
@@ -142,7 +140,7 @@ namespace til
 
             if (!timerRunning || _debounce)
             {
-                SetThreadpoolTimer(_timer.get(), &_delay, 0, 0);
+                _timer.schedule(_delay, _slack);
             }
         }
 
@@ -164,8 +162,8 @@ namespace til
         }
 
         function _func;
-        wil::unique_threadpool_timer _timer;
-        FILETIME _delay;
+        filetime_duration _delay;
+        filetime_duration _slack;
 
         wil::srwlock _lock;
         std::optional<std::tuple<Args...>> _pendingRunArgs;
@@ -174,5 +172,8 @@ namespace til
         bool _debounce;
         bool _leading;
         bool _trailing;
+
+        // Declared last, so that it's destroyed (and any running callback finished) before the other members.
+        timer_service::timer _timer;
     };
 } // namespace til
@@ -7,6 +7,62 @@
 
 namespace til
 {
+    namespace details
+    {
+        // The ID of the calling thread. Never 0, which recursive_ticket_lock uses for "unowned".
+        inline uint32_t current_thread_id() noexcept
+        {
+#if _TIL_ATOMIC_WAIT_IMPL_WIN
+            return GetCurrentThreadId();
+#elif _TIL_ATOMIC_WAIT_IMPL_LINUX
+            return static_cast<uint32_t>(syscall(SYS_gettid));
+#else
+            return static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+#endif
+        }
+
+        // recursive_shared_ticket_lock needs to know how often the current thread holds
+        // a particular lock in shared mode. Threads rarely hold more than 1 or 2 such locks
+        // at a time, so a tiny per-thread table is a lot cheaper than a per-lock hash map.
+        struct shared_recursion_entry
+        {
+            const void* lock = nullptr;
+            uint32_t count = 0;
+        };
+
+        inline thread_local shared_recursion_entry shared_recursion_table[8]{};
+
+        // Returns the current thread's entry for the given lock, or nullptr if there's none.
+        inline shared_recursion_entry* find_shared_recursion(const void* lock) noexcept
+        {
+            for (auto& e : shared_recursion_table)
+            {
+                if (e.lock == lock)
+                {
+                    return &e;
+                }
+            }
+            return nullptr;
+        }
+
+        // Like find_shared_recursion(), but claims an empty entry if there's none yet.
+        inline shared_recursion_entry& acquire_shared_recursion(const void* lock) noexcept
+        {
+            if (const auto e = find_shared_recursion(lock))
+            {
+                return *e;
+            }
+            if (const auto e = find_shared_recursion(nullptr))
+            {
+                e->lock = lock;
+                return *e;
+            }
+            // A single thread holding more than 8 different shared locks at once is
+            // most likely a bug and there's no sensible way to continue from here.
+            std::terminate();
+        }
+    }
+
     // ticket_lock implements a classic fair lock.
     //
     // Compared to a SRWLOCK this implementation is significantly more unsafe to use:
@@ -97,7 +153,7 @@ namespace til
 
         void lock() noexcept
         {
-            const auto id = GetCurrentThreadId();
+            const auto id = details::current_thread_id();
 
             if (_owner.load(std::memory_order_relaxed) != id)
             {
@@ -119,7 +175,7 @@ namespace til
 
         [[nodiscard]] recursive_ticket_lock_suspension suspend() noexcept
         {
-            const auto id = GetCurrentThreadId();
+            const auto id = details::current_thread_id();
             uint32_t owner = 0;
             uint32_t recursion = 0;
 
@@ -137,7 +193,7 @@ namespace til
 
         uint32_t is_locked() const noexcept
         {
-            const auto id = GetCurrentThreadId();
+            const auto id = details::current_thread_id();
             return _owner.load(std::memory_order_relaxed) == id;
         }
 
@@ -153,4 +209,249 @@ namespace til
     };
 
     using recursive_ticket_lock_suspension = recursive_ticket_lock::recursive_ticket_lock_suspension;
+
+    // shared_ticket_lock is the reader-writer variant of ticket_lock and just as fair:
+    // Readers and writers alike draw a ticket and get served in order. Readers only hold onto
+    // their turn long enough to register themselves, so consecutive readers run concurrently.
+    // A writer on the other hand holds onto its turn until it's done, after waiting for the
+    // readers ahead of it to leave. Readers that arrive after a writer queue up behind it,
+    // which means that a steady stream of readers can't starve writers and vice versa.
+    //
+    // The same caveats as for ticket_lock apply. Unbalanced calls will lead to deadlocks.
+    //
+    // Unlike ticket_lock, this lock skips the (expensive) wake-up call if no one is queued up.
+    // Since readers frequently pass the lock around, this makes a large difference. It relies on the
+    // sequentially consistent ordering between taking a ticket and checking whether anyone else did.
+    struct shared_ticket_lock
+    {
+        void lock() noexcept
+        {
+            _wait_for_turn(_next_ticket.fetch_add(1));
+
+            // We're now at the front of the queue, but readers that came before us may still be active.
+            for (;;)
+            {
+                const auto readers = _readers.load();
+                if (readers == 0)
+                {
+                    break;
+                }
+
+                til::atomic_wait(_readers, readers);
+            }
+        }
+
+        void unlock() noexcept
+        {
+            const auto serving = _now_serving.fetch_add(1) + 1;
+            if (_next_ticket.load() != serving)
+            {
+                til::atomic_notify_all(_now_serving);
+            }
+        }
+
+        void lock_shared() noexcept
+        {
+            _wait_for_turn(_next_ticket.fetch_add(1));
+
+            // Register ourselves before passing the turn on, so that the next writer is guaranteed to see us.
+            _readers.fetch_add(1, std::memory_order_relaxed);
+            unlock();
+        }
+
+        void unlock_shared() noexcept
+        {
+            // A writer waiting for us holds the current turn, in which case _next_ticket is ahead of _now_serving.
+            if (_readers.fetch_sub(1) == 1 && _next_ticket.load() != _now_serving.load())
+            {
+                til::atomic_notify_all(_readers);
+            }
+        }
+
+    private:
+        void _wait_for_turn(uint32_t ticket) noexcept
+        {
+            for (;;)
+            {
+                const auto current = _now_serving.load(std::memory_order_acquire);
+                if (current == ticket)
+                {
+                    break;
+                }
+
+                til::atomic_wait(_now_serving, current);
+            }
+        }
+
+        std::atomic<uint32_t> _next_ticket{ 0 };
+        std::atomic<uint32_t> _now_serving{ 0 };
+        std::atomic<uint32_t> _readers{ 0 };
+    };
+
+    // The recursive version of shared_ticket_lock. In addition to recursive exclusive locks,
+    // the thread holding the exclusive lock may also lock it in shared mode, which is then treated like
+    // another exclusive recursion. Shared locks are recursive as well, which is important because a thread
+    // that's already reading mustn't queue up behind a waiting writer (which in turn waits for that thread).
+    //
+    // Upgrading a shared lock to an exclusive one is not supported and will deadlock.
+    struct recursive_shared_ticket_lock
+    {
+        struct recursive_shared_ticket_lock_suspension
+        {
+            constexpr recursive_shared_ticket_lock_suspension(recursive_shared_ticket_lock& lock, uint32_t owner, uint32_t recursion, uint32_t sharedRecursion) noexcept :
+                _lock{ lock },
+                _owner{ owner },
+                _recursion{ recursion },
+                _sharedRecursion{ sharedRecursion }
+            {
+            }
+
+            // When this class is destroyed it restores the recursive_shared_ticket_lock state,
+            // in the same mode it was held before. Just like recursive_ticket_lock_suspension.
+            recursive_shared_ticket_lock_suspension(const recursive_shared_ticket_lock_suspension&) = delete;
+            recursive_shared_ticket_lock_suspension& operator=(const recursive_shared_ticket_lock_suspension&) = delete;
+            recursive_shared_ticket_lock_suspension(recursive_shared_ticket_lock_suspension&&) = delete;
+            recursive_shared_ticket_lock_suspension& operator=(recursive_shared_ticket_lock_suspension&&) = delete;
+
+            ~recursive_shared_ticket_lock_suspension()
+            {
+                if (_owner)
+                {
+                    if (_lock._owner.load(std::memory_order_relaxed) != _owner)
+                    {
+                        _lock._lock.lock();
+                        _lock._owner.store(_owner, std::memory_order_relaxed);
+                    }
+                    _lock._recursion += _recursion;
+                }
+                else if (_sharedRecursion)
+                {
+                    for (uint32_t i = 0; i < _sharedRecursion; ++i)
+                    {
+                        _lock.lock_shared();
+                    }
+                }
+            }
+
+        private:
+            friend struct recursive_shared_ticket_lock;
+
+            recursive_shared_ticket_lock& _lock;
+            uint32_t _owner = 0;
+            uint32_t _recursion = 0;
+            uint32_t _sharedRecursion = 0;
+        };
+
+        void lock() noexcept
+        {
+            const auto id = details::current_thread_id();
+
+            if (_owner.load(std::memory_order_relaxed) != id)
+            {
+                // Upgrading a shared lock would wait for ourselves to leave.
+                assert(!details::find_shared_recursion(this));
+                _lock.lock();
+                _owner.store(id, std::memory_order_relaxed);
+            }
+
+            _recursion++;
+        }
+
+        void unlock() noexcept
+        {
+            if (--_recursion == 0)
+            {
+                _owner.store(0, std::memory_order_relaxed);
+                _lock.unlock();
+            }
+        }
+
+        void lock_shared() noexcept
+        {
+            if (_owner.load(std::memory_order_relaxed) == details::current_thread_id())
+            {
+                _recursion++;
+                return;
+            }
+
+            auto& e = details::acquire_shared_recursion(this);
+            if (e.count++ == 0)
+            {
+                _lock.lock_shared();
+            }
+        }
+
+        void unlock_shared() noexcept
+        {
+            if (_owner.load(std::memory_order_relaxed) == details::current_thread_id())
+            {
+                unlock();
+                return;
+            }
+
+            const auto e = details::find_shared_recursion(this);
+            assert(e && e->count);
+            if (--e->count == 0)
+            {
+                e->lock = nullptr;
+                _lock.unlock_shared();
+            }
+        }
+
+        [[nodiscard]] recursive_shared_ticket_lock_suspension suspend() noexcept
+        {
+            const auto id = details::current_thread_id();
+            uint32_t owner = 0;
+            uint32_t recursion = 0;
+            uint32_t sharedRecursion = 0;
+
+            if (_owner.load(std::memory_order_relaxed) == id)
+            {
+                owner = id;
+                recursion = _recursion;
+                _owner.store(0, std::memory_order_relaxed);
+                _recursion = 0;
+                _lock.unlock();
+            }
+            else if (const auto e = details::find_shared_recursion(this))
+            {
+                sharedRecursion = e->count;
+                e->lock = nullptr;
+                e->count = 0;
+                _lock.unlock_shared();
+            }
+
+            return { *this, owner, recursion, sharedRecursion };
+        }
+
+        // Returns true if the current thread holds the lock in exclusive mode.
+        uint32_t is_locked() const noexcept
+        {
+            const auto id = details::current_thread_id();
+            return _owner.load(std::memory_order_relaxed) == id;
+        }
+
+        // Returns true if the current thread holds the lock in either mode.
+        uint32_t is_locked_shared() const noexcept
+        {
+            return is_locked() || details::find_shared_recursion(this);
+        }
+
+        uint32_t recursion_depth() const noexcept
+        {
+            if (is_locked())
+            {
+                return _recursion;
+            }
+            const auto e = details::find_shared_recursion(this);
+            return e ? e->count : 0;
+        }
+
+    private:
+        shared_ticket_lock _lock;
+        std::atomic<uint32_t> _owner = 0;
+        uint32_t _recursion = 0;
+    };
+
+    using recursive_shared_ticket_lock_suspension = recursive_shared_ticket_lock::recursive_shared_ticket_lock_suspension;
 }
@@ -0,0 +1,236 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "atomic.h"
+#include "small_vector.h"
+#include "timer_wheel.h"
+
+namespace til
+{
+    // A process-wide (well, module-wide) timer service. All timers share a single timer_wheel and a single
+    // threadpool timer, instead of each of them waking up the CPU on their own. Timers with similar deadlines
+    // get batched into the same wakeup and while no timer is scheduled, no threadpool timer is armed at all.
+    //
+    // Expired callbacks run on the threadpool. Each one is submitted as its own work item,
+    // so that a slow callback doesn't hold up the others that expired at the same time.
+    class timer_service
+    {
+    public:
+        using duration = std::chrono::duration<int64_t, std::ratio<1, 10000000>>;
+
+        class timer : timer_wheel::entry
+        {
+        public:
+            using callback = std::function<void()>;
+
+            explicit timer(callback func, timer_service& service = timer_service::instance()) :
+                _service{ service },
+                _func{ std::move(func) }
+            {
+            }
+
+            // The service holds onto our address while we're scheduled.
+            timer(const timer&) = delete;
+            timer& operator=(const timer&) = delete;
+            timer(timer&&) = delete;
+            timer& operator=(timer&&) = delete;
+
+            ~timer()
+            {
+                cancel();
+            }
+
+            // Invokes the callback once after `delay`, or at most `slack` later than that
+            // if that allows it to share a wakeup with other timers (see timer_wheel::schedule).
+            // If the timer is already scheduled, this will reschedule it.
+            void schedule(duration delay, duration slack = {}) noexcept
+            {
+                _service._schedule(*this, delay, slack);
+            }
+
+            // Unschedules the timer and waits for running invocations of the callback to finish.
+            // You can call this from within the callback, in which case it won't wait for itself.
+            void cancel() noexcept
+            {
+                _service._cancel(*this);
+            }
+
+        private:
+            friend class timer_service;
+
+            timer_service& _service;
+            callback _func;
+            std::atomic<uint32_t> _inflight{ 0 };
+        };
+
+        static timer_service& instance()
+        {
+            static timer_service service;
+            return service;
+        }
+
+        timer_service() :
+            _wheel{ _now() },
+            _osTimer{ CreateThreadpoolTimer(&_s_timer_callback, this, nullptr) }
+        {
+            THROW_LAST_ERROR_IF(!_osTimer);
+        }
+
+        timer_service(const timer_service&) = delete;
+        timer_service& operator=(const timer_service&) = delete;
+
+    private:
+        // The timer_wheel ticks in milliseconds, or 10000 units of 100ns.
+        static constexpr int64_t _tick_length = 10000;
+
+        // QueryUnbiasedInterruptTime is what the threadpool timers are based on.
+        static int64_t _interrupt_time() noexcept
+        {
+            ULONGLONG now;
+            QueryUnbiasedInterruptTime(&now);
+            return static_cast<int64_t>(now);
+        }
+
+        static timer_wheel::tick _now() noexcept
+        {
+            return static_cast<timer_wheel::tick>(_interrupt_time() / _tick_length);
+        }
+
+        static void __stdcall _s_timer_callback(PTP_CALLBACK_INSTANCE /*instance*/, PVOID context, PTP_TIMER /*timer*/) noexcept
+        {
+            static_cast<timer_service*>(context)->_expire();
+        }
+
+        static void __stdcall _s_work_callback(PTP_CALLBACK_INSTANCE /*instance*/, PVOID context) noexcept
+        {
+            _run(*static_cast<timer*>(context));
+        }
+
+        void _schedule(timer& t, duration delay, duration slack) noexcept
+        {
+            // Round the deadline up, so that we never fire early, but the slack down.
+            const auto interruptTime = _interrupt_time();
+            const auto due = static_cast<timer_wheel::tick>((interruptTime + std::max<int64_t>(0, delay.count()) + _tick_length - 1) / _tick_length);
+            const auto slackTicks = static_cast<timer_wheel::tick>(std::max<int64_t>(0, slack.count() / _tick_length));
+            const auto now = static_cast<timer_wheel::tick>(interruptTime / _tick_length);
+
+            const auto guard = _lock.lock_exclusive();
+            _wheel.forward(now);
+            _wheel.schedule(t, due, slackTicks);
+            _arm(now);
+        }
+
+        void _cancel(timer& t) noexcept
+        {
+            {
+                const auto guard = _lock.lock_exclusive();
+                _wheel.cancel(t);
+                _arm(_now());
+            }
+
+            // If we're called from within the callback we mustn't wait for ourselves.
+            const uint32_t self = _s_current == &t ? 1 : 0;
+            for (;;)
+            {
+                const auto inflight = t._inflight.load(std::memory_order_acquire);
+                if (inflight <= self)
+                {
+                    break;
+                }
+                til::atomic_wait(t._inflight, inflight);
+            }
+        }
+
+        // Points the threadpool timer at the wheel's next expiry, or disarms it if there's none.
+        void _arm(timer_wheel::tick now) noexcept
+        {
+            const auto next = _wheel.next_expiry();
+            if (next == _armed)
+            {
+                return;
+            }
+
+            _armed = next;
+
+            if (next == timer_wheel::never)
+            {
+                SetThreadpoolTimer(_osTimer.get(), nullptr, 0, 0);
+                return;
+            }
+
+            // Negative values are relative due times in 100ns units.
+            const auto delay = next > now ? static_cast<int64_t>(next - now) : 0;
+            const auto due = -std::max<int64_t>(1, delay * _tick_length);
+            FILETIME ft;
+            memcpy(&ft, &due, sizeof(due));
+            SetThreadpoolTimer(_osTimer.get(), &ft, 0, 0);
+        }
+
+        void _expire() noexcept
+        {
+            const auto now = _now();
+            til::small_vector<timer*, 16> expired;
+
+            {
+                const auto guard = _lock.lock_exclusive();
+
+                // The threadpool timer fired and isn't armed anymore.
+                _armed = timer_wheel::never;
+
+                _wheel.expire(now, [&](timer_wheel::entry& e) {
+                    auto& t = static_cast<timer&>(e);
+                    // Incrementing this under the lock ensures that _cancel() either unscheduled
+                    // the timer before we got to it, or that it'll wait for the callback.
+                    t._inflight.fetch_add(1, std::memory_order_relaxed);
+                    expired.push_back(&t);
+                });
+
+                _arm(now);
+            }
+
+            if (expired.empty())
+            {
+                return;
+            }
+
+            // Hand off all but one of the callbacks to the threadpool and run the last one ourselves.
+            const auto last = expired.back();
+            expired.pop_back();
+
+            for (const auto t : expired)
+            {
+                if (!TrySubmitThreadpoolCallback(&_s_work_callback, t, nullptr))
+                {
+                    _run(*t);
+                }
+            }
+
+            _run(*last);
+        }
+
+        static void _run(timer& t) noexcept
+        {
+            const auto previous = std::exchange(_s_current, &t);
+            try
+            {
+                t._func();
+            }
+            CATCH_LOG();
+            _s_current = previous;
+
+            t._inflight.fetch_sub(1, std::memory_order_release);
+            til::atomic_notify_all(t._inflight);
+        }
+
+        // The timer whose callback the current thread is running, if any.
+        static inline thread_local timer* _s_current = nullptr;
+
+        wil::srwlock _lock;
+        timer_wheel _wheel;
+        timer_wheel::tick _armed = timer_wheel::never;
+        // Destroyed first, which waits for any running _s_timer_callback.
+        wil::unique_threadpool_timer _osTimer;
+    };
+}
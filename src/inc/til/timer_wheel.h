@@ -0,0 +1,306 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <bit>
+
+#pragma warning(push)
+#pragma warning(disable : 26446) // Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning(disable : 26482) // Only index into arrays using constant expressions (bounds.2).
+
+namespace til
+{
+    // A hierarchical timer wheel, modelled after the one in the Linux kernel (kernel/time/timer.c).
+    //
+    // Each level consists of 64 slots and each level is 4x coarser than the previous one:
+    // Level 0 holds deadlines up to 63 ticks away with a granularity of 1 tick, level 1 holds
+    // deadlines up to 252 ticks away with a granularity of 4 ticks and so on. Deadlines are rounded
+    // up to the granularity of the level they end up in and never cascade down into finer levels.
+    // This means that a timer may fire up to ~6% late, but in exchange all operations are O(1)
+    // and timers with similar deadlines share a slot and thus expire together.
+    //
+    // On top of that, schedule() accepts a "slack", which is how much later than the
+    // requested deadline the caller is fine with. The deadline is then rounded up to the
+    // coarsest power of 4 not exceeding the slack, which batches even more timers together.
+    //
+    // The wheel doesn't know what time it is. It uses abstract ticks (timer_service uses milliseconds)
+    // and the caller is responsible for synchronization, for calling expire() whenever the next_expiry()
+    // is reached and for keeping the entries alive and in place until they expired or got canceled.
+    class timer_wheel
+    {
+    public:
+        using tick = uint64_t;
+
+        // next_expiry() returns this if no entry is scheduled.
+        static constexpr tick never = UINT64_MAX;
+
+        struct entry
+        {
+            entry() = default;
+
+            entry(const entry&) = delete;
+            entry& operator=(const entry&) = delete;
+
+            bool scheduled() const noexcept
+            {
+                return _pprev != nullptr;
+            }
+
+            // The (coalesced) deadline passed to the last schedule() call.
+            tick due() const noexcept
+            {
+                return _due;
+            }
+
+        private:
+            friend class timer_wheel;
+
+            entry* _next = nullptr;
+            entry** _pprev = nullptr;
+            tick _due = 0;
+            uint32_t _slot = 0;
+        };
+
+        static constexpr uint32_t level_bits = 6;
+        static constexpr uint32_t level_size = 1 << level_bits;
+        static constexpr uint32_t level_clk_shift = 2;
+        static constexpr uint32_t level_count = 8;
+
+        explicit timer_wheel(tick now = 0) noexcept :
+            _clk{ now }
+        {
+        }
+
+        timer_wheel(const timer_wheel&) = delete;
+        timer_wheel& operator=(const timer_wheel&) = delete;
+
+        // Returns true if no entry is scheduled.
+        bool empty() const noexcept
+        {
+            for (const auto pending : _pending)
+            {
+                if (pending)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Returns the tick at which the next call to expire() would return at least one entry.
+        tick next_expiry() const noexcept
+        {
+            auto next = never;
+            auto clk = _clk;
+
+            for (uint32_t level = 0; level < level_count; ++level)
+            {
+                const auto lvlClk = clk & level_clk_mask;
+
+                if (const auto pending = _pending[level])
+                {
+                    // The distance from the current slot of this level to the next pending one.
+                    const auto pos = std::countr_zero(std::rotr(pending, static_cast<int>(clk & level_mask)));
+                    next = std::min(next, (clk + pos) << _level_shift(level));
+                }
+
+                // If the clock isn't at a boundary of the next level, its current slot has already
+                // been processed (or is just being processed) and we need to start with the next one.
+                clk >>= level_clk_shift;
+                clk += lvlClk != 0;
+            }
+
+            return next;
+        }
+
+        // Moves the wheel's clock forward without expiring anything.
+        // You should call this before scheduling new entries after the wheel has been idle for a while,
+        // because deadlines are bucketed relative to the clock and a stale one would make them coarser.
+        void forward(tick now) noexcept
+        {
+            if (now > _clk)
+            {
+                _clk = std::min(now, next_expiry());
+            }
+        }
+
+        // (Re)schedules the entry to expire at `due`, or at most `slack` ticks later if that allows
+        // it to share a slot with other entries. Deadlines in the past expire on the next expire() call.
+        void schedule(entry& e, tick due, tick slack = 0) noexcept
+        {
+            if (e.scheduled())
+            {
+                _unlink(e);
+            }
+
+            e._due = _coalesce(due, slack);
+            _insert(e);
+        }
+
+        // Unschedules the entry. Does nothing if it isn't scheduled.
+        void cancel(entry& e) noexcept
+        {
+            if (e.scheduled())
+            {
+                _unlink(e);
+            }
+        }
+
+        // Advances the wheel's clock to `now` and calls `func(entry&)` for all entries that expired
+        // until then, in no particular order. The entries are already unscheduled by the time `func`
+        // is called, but `func` must not otherwise modify the wheel. Collect the entries instead.
+        template<typename F>
+        void expire(tick now, F&& func)
+        {
+            for (;;)
+            {
+                const auto next = next_expiry();
+                if (next > now)
+                {
+                    break;
+                }
+
+                // Nothing expires between the current clock and `next`, so we can skip right to it.
+                _clk = next;
+                _collect(func);
+                ++_clk;
+            }
+
+            _clk = std::max(_clk, now);
+        }
+
+    private:
+        static constexpr tick level_mask = level_size - 1;
+        static constexpr tick level_clk_mask = (1 << level_clk_shift) - 1;
+
+        static constexpr uint32_t _level_shift(uint32_t level) noexcept
+        {
+            return level * level_clk_shift;
+        }
+
+        static constexpr tick _level_granularity(uint32_t level) noexcept
+        {
+            return tick{ 1 } << _level_shift(level);
+        }
+
+        // The minimum distance to the clock for a deadline to end up in the given level.
+        static constexpr tick _level_start(uint32_t level) noexcept
+        {
+            return level == 0 ? 0 : level_mask << _level_shift(level - 1);
+        }
+
+        static constexpr tick _coalesce(tick due, tick slack) noexcept
+        {
+            auto granularity = tick{ 1 };
+            while (granularity <= slack >> level_clk_shift)
+            {
+                granularity <<= level_clk_shift;
+            }
+
+            const auto rounded = (due + granularity - 1) & ~(granularity - 1);
+            // Guard against overflow for deadlines close to `never`.
+            return rounded < due ? due : rounded;
+        }
+
+        void _insert(entry& e) noexcept
+        {
+            auto expires = std::max(e._due, _clk);
+            uint32_t level = 0;
+
+            while (level < level_count && expires - _clk >= _level_start(level + 1))
+            {
+                ++level;
+            }
+
+            // Deadlines beyond the wheel's capacity are parked in the last slot we can represent.
+            // _collect() checks the deadline of each entry and reinserts those that aren't due yet.
+            if (level == level_count)
+            {
+                level = level_count - 1;
+                expires = _clk + _level_start(level_count) - 1;
+            }
+
+            // Round up to the granularity of the level, so that we never expire early.
+            const auto shift = _level_shift(level);
+            const auto bucket = (expires + _level_granularity(level) - 1) >> shift;
+            const auto slot = level * level_size + static_cast<uint32_t>(bucket & level_mask);
+
+            auto& head = _heads[slot];
+            e._next = head;
+            e._pprev = &head;
+            e._slot = slot;
+            if (head)
+            {
+                head->_pprev = &e._next;
+            }
+            head = &e;
+            _pending[level] |= uint64_t{ 1 } << (slot & level_mask);
+        }
+
+        void _unlink(entry& e) noexcept
+        {
+            *e._pprev = e._next;
+            if (e._next)
+            {
+                e._next->_pprev = e._pprev;
+            }
+            if (!_heads[e._slot])
+            {
+                _pending[e._slot / level_size] &= ~(uint64_t{ 1 } << (e._slot & level_mask));
+            }
+            e._next = nullptr;
+            e._pprev = nullptr;
+        }
+
+        // Collects the slots that expire at exactly _clk.
+        template<typename F>
+        void _collect(F& func)
+        {
+            auto clk = _clk;
+
+            for (uint32_t level = 0; level < level_count; ++level)
+            {
+                const auto idx = static_cast<uint32_t>(clk & level_mask);
+                const auto bit = uint64_t{ 1 } << idx;
+
+                if (_pending[level] & bit)
+                {
+                    _pending[level] &= ~bit;
+
+                    auto e = std::exchange(_heads[level * level_size + idx], nullptr);
+                    while (e)
+                    {
+                        const auto next = e->_next;
+                        e->_next = nullptr;
+                        e->_pprev = nullptr;
+
+                        if (e->_due > _clk)
+                        {
+                            _insert(*e);
+                        }
+                        else
+                        {
+                            func(*e);
+                        }
+
+                        e = next;
+                    }
+                }
+
+                // The slots of the next level only expire once the clock is at their granularity.
+                if (clk & level_clk_mask)
+                {
+                    break;
+                }
+                clk >>= level_clk_shift;
+            }
+        }
+
+        tick _clk = 0;
+        uint64_t _pending[level_count]{};
+        entry* _heads[level_count * level_size]{};
+    };
+}
+
+#pragma warning(pop)
@@ -25,7 +25,8 @@ static constexpr DWORD renderBackoffBaseTimeMilliseconds = 100;
 // - An instance of a Renderer.
 Renderer::Renderer(RenderSettings& renderSettings, IRenderData* pData) :
     _renderSettings(renderSettings),
-    _pData(pData)
+    _pData(pData),
+    _timerWakeup{ [this]() { NotifyPaintFrame(); } }
 {
     _cursorBlinker = RegisterTimer("cursor blink", [](Renderer& renderer, TimerHandle) {
         renderer._cursorBlinkerOn = !renderer._cursorBlinkerOn;
@@ -201,8 +202,7 @@ void Renderer::_startTimer(TimerHandle handle, TimerRepr delay, TimerRepr interv
 {
     // Nothing breaks if these assertions are violated, but you should still violate them.
     // A timer with a 1-hour delay is weird and indicative of a bug. It should have been
-    // a max-wait (TimerReprMax) instead, which turns into an INFINITE timeout
-    // for WaitOnAddress(), which in turn is less costly than one with timeout.
+    // a max-wait (TimerReprMax) instead, which doesn't schedule a wakeup at all.
 #ifndef NDEBUG
     constexpr TimerRepr one_min_in_100ns = 60 * 1000 * 10000;
     assert(delay > 0 && (delay < one_min_in_100ns || delay == TimerReprMax));
@@ -213,9 +213,7 @@ void Renderer::_startTimer(TimerHandle handle, TimerRepr delay, TimerRepr interv
     timer.interval = interval;
     timer.next = _timerSaturatingAdd(_timerInstant(), delay);
 
-    // Tickle _waitUntilCanRender() into calling _calculateTimerMaxWait() again.
-    // WaitOnAddress() will return with TRUE, even if the atomic didn't change.
-    til::atomic_notify_one(_redraw);
+    _scheduleTimerWakeup();
 }
 
 void Renderer::StopTimer(TimerHandle handle)
@@ -223,52 +221,49 @@ void Renderer::StopTimer(TimerHandle handle)
     auto& timer = _timers.at(handle.id);
     timer.interval = TimerReprMax;
     timer.next = TimerReprMax;
+
+    _scheduleTimerWakeup();
 }
 
-DWORD Renderer::_calculateTimerMaxWait() noexcept
+// Points _timerWakeup at the earliest of our timers. If none of them is
+// running we don't keep a timer around at all, so idle renderers cost nothing.
+void Renderer::_scheduleTimerWakeup() noexcept
 {
-    if (_timers.empty())
+    auto next = TimerReprMax;
+    auto slack = TimerReprMax;
+    for (const auto& timer : _timers)
     {
-        return INFINITE;
+        if (timer.next != TimerReprMax)
+        {
+            next = std::min(next, timer.next);
+            // Repeating timers (cursor and text blinking) don't need to be precise, so they may be late
+            // by 1/8th of their interval, if that lets them share a wakeup with other timers in the process.
+            // One-shot timers don't have an interval and fire on time.
+            slack = std::min(slack, timer.interval == TimerReprMax ? 0 : timer.interval / 8);
+        }
     }
 
-    const auto now = _timerInstant();
-    auto wait = TimerReprMax;
-
-    for (const auto& timer : _timers)
+    if (next == TimerReprMax)
     {
-        wait = std::min(wait, _timerSaturatingSub(timer.next, now));
+        _timerWakeup.cancel();
+        return;
     }
 
-    return _timerToMillis(wait);
+    const auto delay = _timerSaturatingSub(next, _timerInstant());
+    _timerWakeup.schedule(til::timer_service::duration{ gsl::narrow_cast<int64_t>(delay) }, til::timer_service::duration{ gsl::narrow_cast<int64_t>(slack) });
 }
 
 void Renderer::_waitUntilTimerOrRedraw() noexcept
 {
-    // Did we get an explicit rendering request? Yes? Exit.
+    // Did we get an explicit rendering request, or did a timer expire (see _timerWakeup)? Yes? Exit.
     //
     // We don't reset _redraw just yet because we can delay that until we
     // actually acquired the console lock. That's the main synchronization
     // point and the instant we know everyone else is blocked. See PaintFrame().
     while (!_redraw.load(std::memory_order_relaxed))
     {
-        // Otherwise calculate when the next timer expires.
-        const auto wait = _calculateTimerMaxWait();
-        if (wait == 0)
-        {
-            break;
-        }
-
-        // and wait until the timer expires, or we potentially got a rendering request.
         constexpr auto bad = false;
-        if (!til::atomic_wait(_redraw, bad, wait))
-        {
-            // The timer expired.
-            assert(GetLastError() == ERROR_TIMEOUT); // What else could it be?
-            break;
-        }
-
-        // If WaitOnAddress returned TRUE, we got signaled and retry.
+        til::atomic_wait(_redraw, bad);
     }
 }
 
@@ -298,6 +293,8 @@ void Renderer::_tickTimers() noexcept
 
         id++;
     }
+
+    _scheduleTimerWakeup();
 }
 
 ULONGLONG Renderer::_timerInstant() noexcept
@@ -328,11 +325,6 @@ TimerRepr Renderer::_timerSaturatingSub(TimerRepr a, TimerRepr b) noexcept
     return c;
 }
 
-DWORD Renderer::_timerToMillis(TimerRepr t) noexcept
-{
-    return gsl::narrow_cast<DWORD>(std::min<TimerRepr>(t / 10000, DWORD_MAX));
-}
-
 // Routine Description:
 // - Walks through the console data structures to compose a new frame based on the data that has changed since last call and outputs it to the connected rendering engine.
 // Arguments:
@@ -389,6 +381,9 @@ DWORD Renderer::_timerToMillis(TimerRepr t) noexcept
             _pData->UnlockConsole();
         });
 
+        // Everything allocated from the arena during the previous frame is dead by now.
+        _frameArena.reset();
+
         if (_isSynchronizingOutput)
         {
             _synchronizeWithOutput();
@@ -404,6 +399,7 @@ DWORD Renderer::_timerToMillis(TimerRepr t) noexcept
 
         // NOTE: _CheckViewportAndScroll() updates _viewport which is used by all other functions.
         _CheckViewportAndScroll();
+        _flushInvalidMap();
 
         _scheduleRenditionBlink();
 
@@ -639,10 +635,16 @@ void Renderer::TriggerRedraw(const Viewport& region)
     if (view.TrimToViewport(&srUpdateRegion))
     {
         view.ConvertToOrigin(&srUpdateRegion);
-        for (const auto pEngine : _engines)
+
+        // The engines would union this into a single dirty rect right away, which degrades into
+        // a full redraw if the damage is spread out. Collect it until the next frame instead.
+        const auto viewSize = view.Dimensions();
+        if (_invalidMap.size() != viewSize)
         {
-            LOG_IF_FAILED(pEngine->Invalidate(&srUpdateRegion));
+            _flushInvalidMap();
+            _invalidMap.resize(viewSize);
         }
+        _invalidMap.set(srUpdateRegion);
 
         NotifyPaintFrame();
     }
@@ -669,6 +671,9 @@ void Renderer::TriggerRedraw(const til::point* const pcoord)
 // - <none>
 void Renderer::TriggerRedrawAll(const bool backgroundChanged, const bool frameChanged)
 {
+    // Everything is getting redrawn anyway.
+    _invalidMap.reset_all();
+
     for (const auto pEngine : _engines)
     {
         LOG_IF_FAILED(pEngine->InvalidateAll());
@@ -743,7 +748,14 @@ try
     // included in (all) search highlights.
     const auto newHighlights = _pData->GetSearchHighlights();
 
-    if (oldHighlights.empty() && newHighlights.empty())
+    // Searching for a common word can yield thousands of highlights, but only the visible ones
+    // need to be invalidated. The engines clip them anyway, but only after walking all of them.
+    // We include the painted viewport, in case the new one hasn't been scrolled to yet.
+    const auto view = til::rect{ _viewport.ToExclusive() } | til::rect{ _pData->GetViewport().ToExclusive() };
+    const auto oldVisible = til::point_span_subspan_within_rect(oldHighlights, view);
+    const auto newVisible = til::point_span_subspan_within_rect(newHighlights, view);
+
+    if (oldVisible.empty() && newVisible.empty())
     {
         return;
     }
@@ -752,8 +764,8 @@ try
 
     for (const auto pEngine : _engines)
     {
-        LOG_IF_FAILED(pEngine->InvalidateHighlight(oldHighlights, buffer));
-        LOG_IF_FAILED(pEngine->InvalidateHighlight(newHighlights, buffer));
+        LOG_IF_FAILED(pEngine->InvalidateHighlight(oldVisible, buffer));
+        LOG_IF_FAILED(pEngine->InvalidateHighlight(newVisible, buffer));
     }
 
     NotifyPaintFrame();
@@ -1245,7 +1257,7 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
         // Retrieve the first color.
         auto color = it->TextAttr();
         // Retrieve the first pattern id
-        auto patternIds = _pData->GetPatternId(target);
+        auto patternIds = _pData->GetPatternId(target, &_frameArena);
         // Determine whether we're using a soft font.
         auto usingSoftFont = s_IsSoftFontChar(it->Chars(), _firstSoftFontChar, _lastSoftFontChar);
 
@@ -1293,7 +1305,7 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
             do
             {
                 til::point thisPoint{ screenPoint.x + cols, screenPoint.y };
-                const auto thisPointPatterns = _pData->GetPatternId(thisPoint);
+                const auto thisPointPatterns = _pData->GetPatternId(thisPoint, &_frameArena);
                 const auto thisUsingSoftFont = s_IsSoftFontChar(it->Chars(), _firstSoftFontChar, _lastSoftFontChar);
                 const auto changedPatternOrFont = patternIds != thisPointPatterns || usingSoftFont != thisUsingSoftFont;
                 if (color != it->TextAttr() || changedPatternOrFont)
@@ -1492,7 +1504,7 @@ bool Renderer::_isInHoveredInterval(const til::point coordTarget) const noexcept
 {
     return _hoveredInterval &&
            _hoveredInterval->start <= coordTarget && coordTarget <= _hoveredInterval->stop &&
-           _pData->GetPatternId(coordTarget).size() > 0;
+           _pData->HasPatternAt(coordTarget);
 }
 
 // Routine Description:
@@ -1842,10 +1854,36 @@ void Renderer::_ScrollPreviousSelection(const til::point delta)
             rc += delta;
         }
 
+        // The engines just moved their own invalid areas and this is the part they haven't seen yet.
+        _invalidMap.translate(delta);
+
         _currentCursorOptions.coordCursor += delta;
     }
 }
 
+// Routine Description:
+// - Hands the damage collected by TriggerRedraw() to the engines. Adjacent rows with
+//   the same damage are coalesced, so this is usually just a handful of Invalidate() calls.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_flushInvalidMap()
+{
+    if (_invalidMap.none())
+    {
+        return;
+    }
+
+    _invalidMap.for_each_rect([&](const til::rect& rect) {
+        for (const auto pEngine : _engines)
+        {
+            LOG_IF_FAILED(pEngine->Invalidate(&rect));
+        }
+    });
+    _invalidMap.reset_all();
+}
+
 // Method Description:
 // - Adds another Render engine to this renderer. Future rendering calls will
 //      also be sent to the new renderer.
@@ -7,6 +7,14 @@
 #include "../inc/IRenderEngine.hpp"
 #include "../inc/RenderSettings.hpp"
 
+#include <til/bitmap.h>
+#include <til/timer_service.h>
+
+namespace TerminalCoreUnitTests
+{
+    class RendererTest;
+};
+
 namespace Microsoft::Console::Render
 {
     enum class InhibitionSource
@@ -77,6 +85,9 @@ namespace Microsoft::Console::Render
         void UpdateLastHoveredInterval(const std::optional<interval_tree::IntervalTree<til::point, size_t>::interval>& newInterval);
 
     private:
+        // RendererTest drives PaintFrame() directly instead of spinning up the render thread.
+        friend class TerminalCoreUnitTests::RendererTest;
+
         struct TimerRoutine
         {
             const char* description = nullptr;
@@ -103,13 +114,12 @@ namespace Microsoft::Console::Render
 
         // Timer handling
         void _startTimer(TimerHandle handle, TimerRepr delay, TimerRepr interval);
-        DWORD _calculateTimerMaxWait() noexcept;
+        void _scheduleTimerWakeup() noexcept;
         void _waitUntilTimerOrRedraw() noexcept;
         void _tickTimers() noexcept;
         static TimerRepr _timerInstant() noexcept;
         static TimerRepr _timerSaturatingAdd(TimerRepr a, TimerRepr b) noexcept;
         static TimerRepr _timerSaturatingSub(TimerRepr a, TimerRepr b) noexcept;
-        static DWORD _timerToMillis(TimerRepr t) noexcept;
 
         // Actual rendering
         [[nodiscard]] HRESULT PaintFrame();
@@ -130,6 +140,7 @@ namespace Microsoft::Console::Render
         [[nodiscard]] HRESULT _UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextAttribute attr, const bool usingSoftFont, const bool isSettingDefaultBrushes);
         [[nodiscard]] HRESULT _PerformScrolling(_In_ IRenderEngine* const pEngine);
         void _ScrollPreviousSelection(const til::point delta);
+        void _flushInvalidMap();
         [[nodiscard]] HRESULT _PaintTitle(IRenderEngine* const pEngine);
         bool _isInHoveredInterval(til::point coordTarget) const noexcept;
         void _updateCursorInfo();
@@ -151,6 +162,9 @@ namespace Microsoft::Console::Render
         til::small_vector<IRenderEngine*, 2> _engines;
         til::small_vector<TimerRoutine, 4> _timers;
         size_t _nextTimerId = 0;
+        // Wakes up the render thread once the earliest of the _timers is due. It's scheduled into the
+        // shared til::timer_service, so that the blinkers of all panes wake up the CPU together.
+        til::timer_service::timer _timerWakeup;
 
         static constexpr size_t _firstSoftFontChar = 0xEF20;
         size_t _lastSoftFontChar = 0;
@@ -171,6 +185,9 @@ namespace Microsoft::Console::Render
         Microsoft::Console::Types::Viewport _viewport;
         std::optional<CompositionCache> _compositionCache;
         std::vector<Cluster> _clusterBuffer;
+        // Backs the temporary allocations made while painting a frame. It's reset at the start of
+        // each frame, so don't hold onto anything allocated from it across frames.
+        til::pmr::monotonic_arena _frameArena;
         std::function<void()> _pfnBackgroundColorChanged;
         std::function<void()> _pfnFrameColorChanged;
         std::function<void()> _pfnRendererEnteredErrorState;
@@ -180,5 +197,8 @@ namespace Microsoft::Console::Render
         til::point_span _lastSelectionPaintSpan{};
         size_t _lastSelectionPaintSize{};
         std::vector<til::rect> _lastSelectionRectsByViewport{};
+        // The cells invalidated by TriggerRedraw() since the last frame, relative to the viewport origin.
+        // See _flushInvalidMap().
+        til::bitmap _invalidMap;
     };
 }
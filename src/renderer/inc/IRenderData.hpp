@@ -7,6 +7,8 @@
 #include "../../renderer/inc/FontInfo.hpp"
 #include "../../types/inc/viewport.hpp"
 
+#include <til/lock_stats.h>
+
 class Cursor;
 class TextBuffer;
 
@@ -55,8 +57,13 @@ namespace Microsoft::Console::Render
         virtual std::span<const til::point_span> GetSearchHighlights() const noexcept = 0;
         virtual const til::point_span* GetSearchHighlightFocused() const noexcept = 0;
         virtual std::span<const til::point_span> GetSelectionSpans() const noexcept = 0;
-        virtual void LockConsole() noexcept = 0;
+        // The site parameter identifies the caller for til::lock_stats, if TIL_LOCK_STATS is enabled.
+        virtual void LockConsole(til::lock_stats::site site = til::lock_stats::site::current()) noexcept = 0;
         virtual void UnlockConsole() noexcept = 0;
+        // Like LockConsole(), but any number of readers may hold it at once. Only read from the
+        // IRenderData while holding it and don't call LockConsole() from inside, as that deadlocks.
+        virtual void LockConsoleShared(til::lock_stats::site site = til::lock_stats::site::current()) noexcept = 0;
+        virtual void UnlockConsoleShared() noexcept = 0;
 
         // This block used to be the original IRenderData.
         virtual TimerDuration GetBlinkInterval() noexcept = 0; // Return ::zero() or ::max() for no blink.
@@ -65,7 +72,10 @@ namespace Microsoft::Console::Render
         virtual std::wstring_view GetConsoleTitle() const noexcept = 0;
         virtual std::wstring GetHyperlinkUri(uint16_t id) const = 0;
         virtual std::wstring GetHyperlinkCustomId(uint16_t id) const = 0;
-        virtual std::vector<size_t> GetPatternId(const til::point location) const = 0;
+        // The result is allocated from the given resource, which for the renderer is its per-frame arena.
+        virtual std::pmr::vector<size_t> GetPatternId(const til::point location, std::pmr::memory_resource* resource) const = 0;
+        // The same as !GetPatternId().empty(), but without collecting the IDs.
+        virtual bool HasPatternAt(const til::point location) const noexcept = 0;
 
         // This block used to be IUiaData.
         virtual std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& attr) const noexcept = 0;
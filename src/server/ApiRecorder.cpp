@@ -0,0 +1,196 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "ApiRecorder.h"
+
+using namespace ApiRecording;
+
+ApiRecorder* ApiRecorder::s_instance = nullptr;
+
+template<typename T>
+static std::span<const BYTE> asBytes(const T& value) noexcept
+{
+    return { reinterpret_cast<const BYTE*>(&value), sizeof(T) };
+}
+
+// Routine Description:
+// - Wraps the given device comm in an ApiRecorder, if recording was requested via the
+//   CONSOLE_API_RECORDING environment variable. Takes ownership of the device comm in that case.
+// Arguments:
+// - deviceComm - The device comm that talks to the driver.
+// Return Value:
+// - The ApiRecorder or the given device comm, if there's nothing to record or the file couldn't be created.
+[[nodiscard]] IDeviceComm* ApiRecorder::s_Wrap(IDeviceComm* deviceComm)
+{
+    wchar_t directory[MAX_PATH];
+    const auto length = GetEnvironmentVariableW(L"CONSOLE_API_RECORDING", &directory[0], MAX_PATH);
+    if (length == 0 || length >= MAX_PATH || s_instance)
+    {
+        return deviceComm;
+    }
+
+    try
+    {
+        const auto path = fmt::format(FMT_COMPILE(L"{}\\conhost-{}.conapi"), std::wstring_view{ &directory[0], length }, GetCurrentProcessId());
+        wil::unique_hfile file{ CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+        THROW_LAST_ERROR_IF(!file);
+
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+
+        FileHeader header{};
+        memcpy(&header.magic[0], &Magic[0], sizeof(Magic));
+        header.pointerSize = sizeof(void*);
+        header.packetSize = gsl::narrow_cast<uint32_t>(PacketSize);
+        header.frequency = frequency.QuadPart;
+
+        DWORD written = 0;
+        THROW_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), &header, sizeof(header), &written, nullptr));
+
+        s_instance = new ApiRecorder{ deviceComm, std::move(file) };
+        return s_instance;
+    }
+    CATCH_LOG();
+
+    return deviceComm;
+}
+
+// Routine Description:
+// - Returns the active recorder, if there's one.
+ApiRecorder* ApiRecorder::s_Get() noexcept
+{
+    return s_instance;
+}
+
+ApiRecorder::ApiRecorder(IDeviceComm* inner, wil::unique_hfile file) noexcept :
+    _inner{ inner },
+    _file{ std::move(file) }
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    _start = now.QuadPart;
+}
+
+// Routine Description:
+// - Records a request that didn't arrive through ReadIo(), like the connect message that's handed to us by another console server.
+void ApiRecorder::RecordRequest(const CONSOLE_API_MSG& message) const noexcept
+{
+    _write(EventType::Request, message.Descriptor.Identifier, { { reinterpret_cast<const BYTE*>(&message.Descriptor), PacketSize } });
+}
+
+[[nodiscard]] HRESULT ApiRecorder::SetServerInformation(_In_ CD_IO_SERVER_INFORMATION* const pServerInfo) const
+{
+    return _inner->SetServerInformation(pServerInfo);
+}
+
+[[nodiscard]] HRESULT ApiRecorder::ReadIo(_In_opt_ PCONSOLE_API_MSG const pReplyMsg,
+                                          _Out_ CONSOLE_API_MSG* const pMessage) const
+{
+    if (pReplyMsg)
+    {
+        _recordCompletion(pReplyMsg->Complete);
+    }
+
+    const auto hr = _inner->ReadIo(pReplyMsg, pMessage);
+    if (SUCCEEDED(hr))
+    {
+        RecordRequest(*pMessage);
+    }
+    return hr;
+}
+
+[[nodiscard]] HRESULT ApiRecorder::CompleteIo(_In_ CD_IO_COMPLETE* const pCompletion) const
+{
+    _recordCompletion(*pCompletion);
+    return _inner->CompleteIo(pCompletion);
+}
+
+[[nodiscard]] HRESULT ApiRecorder::ReadInput(_In_ CD_IO_OPERATION* const pIoOperation) const
+{
+    const auto hr = _inner->ReadInput(pIoOperation);
+    if (SUCCEEDED(hr))
+    {
+        const InputEvent event{ pIoOperation->Buffer.Offset };
+        _write(EventType::Input,
+               pIoOperation->Identifier,
+               { asBytes(event), { static_cast<const BYTE*>(pIoOperation->Buffer.Data), pIoOperation->Buffer.Size } });
+    }
+    return hr;
+}
+
+[[nodiscard]] HRESULT ApiRecorder::WriteOutput(_In_ CD_IO_OPERATION* const pIoOperation) const
+{
+    return _inner->WriteOutput(pIoOperation);
+}
+
+[[nodiscard]] HRESULT ApiRecorder::AllowUIAccess() const
+{
+    return _inner->AllowUIAccess();
+}
+
+[[nodiscard]] ULONG_PTR ApiRecorder::PutHandle(const void* handle)
+{
+    return _inner->PutHandle(handle);
+}
+
+[[nodiscard]] void* ApiRecorder::GetHandle(ULONG_PTR handleId) const
+{
+    return _inner->GetHandle(handleId);
+}
+
+[[nodiscard]] HRESULT ApiRecorder::GetServerHandle(_Out_ HANDLE* pHandle) const
+{
+    return _inner->GetServerHandle(pHandle);
+}
+
+void ApiRecorder::_recordCompletion(const CD_IO_COMPLETE& completion) const noexcept
+{
+    const CompletionEvent event{ completion.IoStatus.Status, completion.IoStatus.Information };
+    const auto data = static_cast<const BYTE*>(completion.Write.Data);
+    const auto size = data ? completion.Write.Size : 0;
+    _write(EventType::Completion, completion.Identifier, { asBytes(event), { data, size } });
+}
+
+// Routine Description:
+// - Appends an event to the recording. Events may be written by any thread, because
+//   waits get completed by whoever satisfies them (for instance the input thread).
+// - If writing fails, for instance because the disk is full, the recording stops.
+void ApiRecorder::_write(EventType type, const LUID& identifier, std::initializer_list<std::span<const BYTE>> parts) const noexcept
+{
+    EventHeader header{};
+    header.type = type;
+    header.identifier = identifier;
+    for (const auto& part : parts)
+    {
+        header.size += gsl::narrow_cast<uint32_t>(part.size());
+    }
+
+    const auto lock = _lock.lock_exclusive();
+
+    if (!_file)
+    {
+        return;
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    header.timestamp = now.QuadPart - _start;
+
+    DWORD written = 0;
+    auto ok = WriteFile(_file.get(), &header, sizeof(header), &written, nullptr);
+
+    for (const auto& part : parts)
+    {
+        if (ok && !part.empty())
+        {
+            ok = WriteFile(_file.get(), part.data(), gsl::narrow_cast<DWORD>(part.size()), &written, nullptr);
+        }
+    }
+
+    if (!ok)
+    {
+        LOG_LAST_ERROR();
+        _file.reset();
+    }
+}
@@ -0,0 +1,110 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ApiRecorder.h
+
+Abstract:
+- Records the console API traffic of a session into a file, so that it can be replayed later.
+- The recorder sits between the IO thread and the actual IDeviceComm and logs the requests
+  read from the driver, the parts of their input payload the server read and how they completed.
+- Recording is enabled by pointing the CONSOLE_API_RECORDING environment variable at a directory.
+  Each console host then writes a conhost-<pid>.conapi file into it.
+- Host.ApiReplay (src/host/ft_replay) replays such a file against an in-process console.
+--*/
+
+#pragma once
+
+#include "DeviceComm.h"
+#include "ApiMessage.h"
+
+#include <wil/resource.h>
+
+namespace ApiRecording
+{
+    // A recording starts with a FileHeader, followed by any number of events. Each event is an
+    // EventHeader followed by EventHeader::size bytes, the meaning of which depends on its type:
+    // * Request: The CD_IO_DESCRIPTOR and the packet data that follows it in a CONSOLE_API_MSG.
+    // * Input: An InputEvent followed by the bytes the server read from the message's input.
+    // * Completion: A CompletionEvent followed by the CD_IO_COMPLETE::Write data, if any.
+    // Everything is stored in the native layout. A recording can only be replayed on the same architecture.
+    inline constexpr char Magic[8]{ 'C', 'O', 'N', 'A', 'P', 'I', 'R', '1' };
+
+    // The size of the packet data in a CONSOLE_API_MSG, starting at the Descriptor.
+    inline constexpr size_t PacketSize = sizeof(CONSOLE_API_MSG) - offsetof(CONSOLE_API_MSG, Descriptor);
+
+    enum class EventType : uint32_t
+    {
+        Request = 1,
+        Input = 2,
+        Completion = 3,
+    };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t pointerSize;
+        uint32_t packetSize;
+        // QueryPerformanceFrequency() of the machine that made the recording.
+        int64_t frequency;
+    };
+
+    struct EventHeader
+    {
+        EventType type;
+        uint32_t size;
+        // QueryPerformanceCounter() ticks since the recording started.
+        int64_t timestamp;
+        // The CD_IO_DESCRIPTOR::Identifier of the message this event belongs to.
+        LUID identifier;
+    };
+
+    struct InputEvent
+    {
+        ULONG offset;
+    };
+
+    struct CompletionEvent
+    {
+        NTSTATUS status;
+        ULONG_PTR information;
+    };
+}
+
+class ApiRecorder : public IDeviceComm
+{
+public:
+    [[nodiscard]] static IDeviceComm* s_Wrap(IDeviceComm* deviceComm);
+    static ApiRecorder* s_Get() noexcept;
+
+    void RecordRequest(const CONSOLE_API_MSG& message) const noexcept;
+
+    [[nodiscard]] HRESULT SetServerInformation(_In_ CD_IO_SERVER_INFORMATION* const pServerInfo) const override;
+    [[nodiscard]] HRESULT ReadIo(_In_opt_ PCONSOLE_API_MSG const pReplyMsg,
+                                 _Out_ CONSOLE_API_MSG* const pMessage) const override;
+    [[nodiscard]] HRESULT CompleteIo(_In_ CD_IO_COMPLETE* const pCompletion) const override;
+
+    [[nodiscard]] HRESULT ReadInput(_In_ CD_IO_OPERATION* const pIoOperation) const override;
+    [[nodiscard]] HRESULT WriteOutput(_In_ CD_IO_OPERATION* const pIoOperation) const override;
+
+    [[nodiscard]] HRESULT AllowUIAccess() const override;
+
+    [[nodiscard]] ULONG_PTR PutHandle(const void*) override;
+    [[nodiscard]] void* GetHandle(ULONG_PTR) const override;
+
+    [[nodiscard]] HRESULT GetServerHandle(_Out_ HANDLE* pHandle) const override;
+
+private:
+    ApiRecorder(IDeviceComm* inner, wil::unique_hfile file) noexcept;
+
+    void _recordCompletion(const CD_IO_COMPLETE& completion) const noexcept;
+    void _write(ApiRecording::EventType type, const LUID& identifier, std::initializer_list<std::span<const BYTE>> parts) const noexcept;
+
+    static ApiRecorder* s_instance;
+
+    std::unique_ptr<IDeviceComm> _inner;
+    mutable wil::unique_hfile _file;
+    mutable wil::srwlock _lock;
+    int64_t _start = 0;
+};
@@ -6,6 +6,7 @@
 #include "ApiSorter.h"
 
 #include "ApiDispatchers.h"
+#include "ApiStats.h"
 
 #include "../host/tracing.hpp"
 
@@ -168,6 +169,7 @@ PCONSOLE_API_MSG ApiSorter::ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Mess
     Message->State.WriteOffset = Message->msgHeader.ApiDescriptorSize;
     Message->State.ReadOffset = Message->msgHeader.ApiDescriptorSize + sizeof(CONSOLE_MSG_HEADER);
 
+    const auto begin = ApiStats::s_Now();
     HRESULT hr = S_OK;
     try
     {
@@ -192,6 +194,13 @@ PCONSOLE_API_MSG ApiSorter::ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Mess
         Status = NTSTATUS_FROM_HRESULT(Status);
     }
 
+    // Pending calls account for their output once the wait completes (see ConsoleWaitBlock::Notify).
+    ApiStats::s_RecordApi(Message->msgHeader.ApiNumber,
+                          Descriptor->TraceName,
+                          Message->Descriptor.InputSize,
+                          ReplyPending ? 0 : Message->Complete.IoStatus.Information,
+                          begin);
+
     if (!ReplyPending)
     {
         Message->SetReplyStatus(Status);
@@ -200,3 +209,16 @@ PCONSOLE_API_MSG ApiSorter::ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Mess
 
     return nullptr;
 }
+
+PCSTR ApiSorter::GetApiName(const ULONG ApiNumber) noexcept
+{
+    const auto LayerNumber = (ApiNumber >> 24) - 1;
+    const auto Number = ApiNumber & 0xffffff;
+
+    if ((LayerNumber >= std::size(ConsoleApiLayerTable)) || (Number >= ConsoleApiLayerTable[LayerNumber].Count))
+    {
+        return nullptr;
+    }
+
+    return ConsoleApiLayerTable[LayerNumber].Descriptor[Number].TraceName;
+}
@@ -0,0 +1,342 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "ApiStats.h"
+
+#include <TraceLoggingProvider.h>
+
+TRACELOGGING_DECLARE_PROVIDER(g_hConhostV2EventTraceProvider);
+
+#if CONSOLE_API_STATS
+
+namespace
+{
+    // The equivalent of TraceKeywords::API in host/tracing.cpp.
+    constexpr ULONGLONG ApiStatsKeyword = 0x400;
+
+    // A log-linear histogram in the spirit of HdrHistogram: values are grouped by their power of 2,
+    // each of which is split into 8 linear sub-buckets. This bounds the error of a bucket to 12.5%
+    // of its value, while recording a value costs no more than a bit scan and an increment.
+    struct Histogram
+    {
+        static constexpr int subBucketBits = 3;
+        static constexpr uint64_t subBucketCount = uint64_t{ 1 } << subBucketBits;
+        // 2^36 ticks are almost 2 hours at the usual QPC frequency of 10 MHz. Longer values get clamped.
+        static constexpr int maxExponent = 36;
+        static constexpr size_t bucketCount = (maxExponent - subBucketBits + 2) * subBucketCount;
+
+        static size_t s_Index(uint64_t value) noexcept
+        {
+            value = std::min(value, (uint64_t{ 2 } << maxExponent) - 1);
+            if (value < subBucketCount)
+            {
+                return gsl::narrow_cast<size_t>(value);
+            }
+
+            const auto shift = static_cast<int>(std::bit_width(value)) - 1 - subBucketBits;
+            return gsl::narrow_cast<size_t>((shift + 1) * subBucketCount + ((value >> shift) & (subBucketCount - 1)));
+        }
+
+        static uint64_t s_LowerBound(size_t index) noexcept
+        {
+            if (index < subBucketCount)
+            {
+                return index;
+            }
+
+            const auto shift = index / subBucketCount - 1;
+            return (subBucketCount + index % subBucketCount) << shift;
+        }
+
+        void Record(uint64_t value) noexcept
+        {
+            til::at(buckets, s_Index(value)).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::array<std::atomic<uint32_t>, bucketCount> buckets{};
+    };
+
+    struct Histograms
+    {
+        Histogram latency;
+        Histogram wait;
+    };
+
+    struct Slot
+    {
+        // Most APIs are never called and each histogram is a few KB large.
+        // They're thus allocated on first use and then live until the process exits.
+        Histograms* GetHistograms() noexcept
+        {
+            auto h = histograms.load(std::memory_order_acquire);
+            if (!h)
+            {
+                const auto fresh = new (std::nothrow) Histograms{};
+                if (!fresh)
+                {
+                    return nullptr;
+                }
+                if (histograms.compare_exchange_strong(h, fresh, std::memory_order_acq_rel))
+                {
+                    h = fresh;
+                }
+                else
+                {
+                    delete fresh;
+                }
+            }
+            return h;
+        }
+
+        std::atomic<PCSTR> name{ nullptr };
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> waits{ 0 };
+        std::atomic<uint64_t> inputBytes{ 0 };
+        std::atomic<uint64_t> outputBytes{ 0 };
+        std::atomic<Histograms*> histograms{ nullptr };
+    };
+
+    // A snapshot of the non-empty buckets of a Histogram, converted to nanoseconds.
+    struct Summary
+    {
+        Summary(const Histogram& histogram, uint64_t frequency) noexcept
+        {
+            uint64_t total = 0;
+
+            for (size_t i = 0; i < Histogram::bucketCount; ++i)
+            {
+                const auto count = til::at(histogram.buckets, i).load(std::memory_order_relaxed);
+                if (count != 0)
+                {
+                    til::at(bounds, used) = s_TicksToNs(Histogram::s_LowerBound(i), frequency);
+                    til::at(counts, used) = count;
+                    used++;
+                    total += count;
+                }
+            }
+
+            if (used != 0)
+            {
+                p50 = _percentile(total, 50);
+                p90 = _percentile(total, 90);
+                p99 = _percentile(total, 99);
+                max = til::at(bounds, used - 1);
+            }
+        }
+
+        static uint64_t s_TicksToNs(uint64_t ticks, uint64_t frequency) noexcept
+        {
+            // Split into 2 halves, because ticks * 1e9 would overflow after just ~30 minutes.
+            return ticks / frequency * 1'000'000'000 + ticks % frequency * 1'000'000'000 / frequency;
+        }
+
+        std::array<uint64_t, Histogram::bucketCount> bounds{};
+        std::array<uint32_t, Histogram::bucketCount> counts{};
+        uint16_t used = 0;
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+        uint64_t max = 0;
+
+    private:
+        uint64_t _percentile(uint64_t total, uint64_t percent) const noexcept
+        {
+            const auto rank = std::max<uint64_t>(1, (total * percent + 99) / 100);
+            uint64_t seen = 0;
+            for (uint16_t i = 0; i < used; ++i)
+            {
+                seen += til::at(counts, i);
+                if (seen >= rank)
+                {
+                    return til::at(bounds, i);
+                }
+            }
+            return max;
+        }
+    };
+
+    // API numbers are split into a 1-based layer and a 0-based index (see ConsoleApiLayerTable in ApiSorter.cpp).
+    constexpr ULONG apiLayerCount = 3;
+    constexpr ULONG apisPerLayer = 64;
+    Slot apiSlots[apiLayerCount][apisPerLayer];
+
+    // Driver IO functions that aren't dispatched by ApiSorter.
+    // CONSOLE_IO_USER_DEFINED isn't part of this, because those are accounted for per API.
+    constexpr std::pair<ULONG, PCSTR> ioFunctions[] = {
+        { CONSOLE_IO_CONNECT, "Connect" },
+        { CONSOLE_IO_DISCONNECT, "Disconnect" },
+        { CONSOLE_IO_CREATE_OBJECT, "CreateObject" },
+        { CONSOLE_IO_CLOSE_OBJECT, "CloseObject" },
+        { CONSOLE_IO_RAW_WRITE, "RawWrite" },
+        { CONSOLE_IO_RAW_READ, "RawRead" },
+        { CONSOLE_IO_RAW_FLUSH, "RawFlush" },
+    };
+    Slot ioSlots[std::size(ioFunctions)];
+
+    Slot* apiSlot(ULONG apiNumber) noexcept
+    {
+        const auto layer = (apiNumber >> 24) - 1;
+        const auto api = apiNumber & 0xffffff;
+        if (layer >= apiLayerCount || api >= apisPerLayer)
+        {
+            return nullptr;
+        }
+        return &apiSlots[layer][api];
+    }
+
+    void record(Slot& slot, ULONG inputBytes, ULONG_PTR outputBytes, ApiStats::Timestamp begin) noexcept
+    {
+        const auto elapsed = ApiStats::s_Now() - begin;
+
+        slot.calls.fetch_add(1, std::memory_order_relaxed);
+        slot.inputBytes.fetch_add(inputBytes, std::memory_order_relaxed);
+        slot.outputBytes.fetch_add(outputBytes, std::memory_order_relaxed);
+
+        if (const auto h = slot.GetHistograms())
+        {
+            h->latency.Record(gsl::narrow_cast<uint64_t>(std::max<int64_t>(0, elapsed)));
+        }
+    }
+
+    void trace(const Slot& slot, ULONG apiNumber, PCSTR name, uint64_t frequency) noexcept
+    {
+        const auto calls = slot.calls.load(std::memory_order_relaxed);
+        const auto waits = slot.waits.load(std::memory_order_relaxed);
+        const auto h = slot.histograms.load(std::memory_order_acquire);
+        if (!h || (calls == 0 && waits == 0))
+        {
+            return;
+        }
+
+        const Summary latency{ h->latency, frequency };
+        const Summary wait{ h->wait, frequency };
+
+        TraceLoggingWrite(
+            g_hConhostV2EventTraceProvider,
+            "ApiStats",
+            TraceLoggingString(name ? name : "", "Api"),
+            TraceLoggingHexUInt32(apiNumber, "ApiNumber"),
+            TraceLoggingUInt64(calls, "Calls"),
+            TraceLoggingUInt64(slot.inputBytes.load(std::memory_order_relaxed), "InputBytes"),
+            TraceLoggingUInt64(slot.outputBytes.load(std::memory_order_relaxed), "OutputBytes"),
+            TraceLoggingUInt64(latency.p50, "LatencyP50Ns"),
+            TraceLoggingUInt64(latency.p90, "LatencyP90Ns"),
+            TraceLoggingUInt64(latency.p99, "LatencyP99Ns"),
+            TraceLoggingUInt64(latency.max, "LatencyMaxNs"),
+            TraceLoggingUInt64Array(latency.bounds.data(), latency.used, "LatencyBucketsNs"),
+            TraceLoggingUInt32Array(latency.counts.data(), latency.used, "LatencyCounts"),
+            TraceLoggingUInt64(waits, "Waits"),
+            TraceLoggingUInt64(wait.p50, "WaitP50Ns"),
+            TraceLoggingUInt64(wait.p90, "WaitP90Ns"),
+            TraceLoggingUInt64(wait.p99, "WaitP99Ns"),
+            TraceLoggingUInt64(wait.max, "WaitMaxNs"),
+            TraceLoggingUInt64Array(wait.bounds.data(), wait.used, "WaitBucketsNs"),
+            TraceLoggingUInt32Array(wait.counts.data(), wait.used, "WaitCounts"),
+            TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+            TraceLoggingKeyword(TIL_KEYWORD_TRACE),
+            TraceLoggingKeyword(ApiStatsKeyword));
+    }
+}
+
+ApiStats::Timestamp ApiStats::s_Now() noexcept
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+// Routine Description:
+// - Accounts for a call that went through ApiSorter.
+// Arguments:
+// - apiNumber - The API number from the message header.
+// - name - The name of the API. Must be a string literal.
+// - inputBytes - The size of the request, including the message header.
+// - outputBytes - The reply information, which is usually the number of bytes written back to the client.
+// - begin - The s_Now() value from before the call was dispatched.
+void ApiStats::s_RecordApi(ULONG apiNumber, PCSTR name, ULONG inputBytes, ULONG_PTR outputBytes, Timestamp begin) noexcept
+{
+    if (const auto slot = apiSlot(apiNumber))
+    {
+        slot->name.store(name, std::memory_order_relaxed);
+        record(*slot, inputBytes, outputBytes, begin);
+    }
+}
+
+// Routine Description:
+// - Same as s_RecordApi, but for driver IO functions other than CONSOLE_IO_USER_DEFINED.
+void ApiStats::s_RecordIo(ULONG function, ULONG inputBytes, ULONG_PTR outputBytes, Timestamp begin) noexcept
+{
+    for (size_t i = 0; i < std::size(ioFunctions); ++i)
+    {
+        if (til::at(ioFunctions, i).first == function)
+        {
+            record(til::at(ioSlots, i), inputBytes, outputBytes, begin);
+            return;
+        }
+    }
+}
+
+// Routine Description:
+// - Accounts for a message that had to wait in a ConsoleWaitQueue and has now been completed.
+// Arguments:
+// - apiNumber - The API number the message was dispatched as.
+// - outputBytes - The reply information the wait was completed with.
+// - begin - The s_Now() value from when the wait was created.
+void ApiStats::s_RecordWait(ULONG apiNumber, ULONG_PTR outputBytes, Timestamp begin) noexcept
+{
+    if (const auto slot = apiSlot(apiNumber))
+    {
+        const auto elapsed = s_Now() - begin;
+
+        slot->waits.fetch_add(1, std::memory_order_relaxed);
+        slot->outputBytes.fetch_add(outputBytes, std::memory_order_relaxed);
+
+        if (const auto h = slot->GetHistograms())
+        {
+            h->wait.Record(gsl::narrow_cast<uint64_t>(std::max<int64_t>(0, elapsed)));
+        }
+    }
+}
+
+// Routine Description:
+// - Writes an "ApiStats" event for each API and IO function that has been used so far.
+// - The counters are read without synchronization with the dispatch loop,
+//   so the numbers of a single event may be off by the calls that happened meanwhile.
+void ApiStats::s_Trace() noexcept
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    const auto f = gsl::narrow_cast<uint64_t>(frequency.QuadPart);
+
+    for (ULONG layer = 0; layer < apiLayerCount; ++layer)
+    {
+        for (ULONG api = 0; api < apisPerLayer; ++api)
+        {
+            const auto& slot = apiSlots[layer][api];
+            trace(slot, ((layer + 1) << 24) | api, slot.name.load(std::memory_order_relaxed), f);
+        }
+    }
+
+    for (size_t i = 0; i < std::size(ioFunctions); ++i)
+    {
+        trace(til::at(ioSlots, i), 0, til::at(ioFunctions, i).second, f);
+    }
+}
+
+#endif // CONSOLE_API_STATS
+
+void NTAPI ApiStats::s_TraceProviderCallback(LPCGUID /*sourceId*/,
+                                             ULONG isEnabled,
+                                             UCHAR /*level*/,
+                                             ULONGLONG /*matchAnyKeyword*/,
+                                             ULONGLONG /*matchAllKeyword*/,
+                                             PEVENT_FILTER_DESCRIPTOR /*filterData*/,
+                                             PVOID /*callbackContext*/) noexcept
+{
+    if (isEnabled == EVENT_CONTROL_CODE_CAPTURE_STATE)
+    {
+        s_Trace();
+    }
+}
@@ -0,0 +1,54 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ApiStats.h
+
+Abstract:
+- Low-overhead per-API instrumentation of the console server dispatch loop.
+- For every API number (and every driver IO function that isn't an API call) it counts the calls,
+  the bytes that went in and out and keeps log-linear latency histograms of both the dispatch itself
+  and the time the message spent waiting in a ConsoleWaitQueue, if it had to wait.
+- The statistics are written to the host's TraceLogging provider as one "ApiStats" event per API
+  whenever a trace session requests a capture state (e.g. "wpr -capturestateondemand").
+- Define CONSOLE_API_STATS to 0 to compile all of it out of the dispatch path.
+--*/
+
+#pragma once
+
+#include <evntprov.h>
+
+#ifndef CONSOLE_API_STATS
+#define CONSOLE_API_STATS 1
+#endif
+
+class ApiStats
+{
+public:
+    // A point in time in QueryPerformanceCounter ticks, as returned by s_Now().
+    using Timestamp = int64_t;
+
+#if CONSOLE_API_STATS
+    static Timestamp s_Now() noexcept;
+    static void s_RecordApi(ULONG apiNumber, PCSTR name, ULONG inputBytes, ULONG_PTR outputBytes, Timestamp begin) noexcept;
+    static void s_RecordIo(ULONG function, ULONG inputBytes, ULONG_PTR outputBytes, Timestamp begin) noexcept;
+    static void s_RecordWait(ULONG apiNumber, ULONG_PTR outputBytes, Timestamp begin) noexcept;
+    static void s_Trace() noexcept;
+#else
+    static Timestamp s_Now() noexcept { return 0; }
+    static void s_RecordApi(ULONG, PCSTR, ULONG, ULONG_PTR, Timestamp) noexcept {}
+    static void s_RecordIo(ULONG, ULONG, ULONG_PTR, Timestamp) noexcept {}
+    static void s_RecordWait(ULONG, ULONG_PTR, Timestamp) noexcept {}
+    static void s_Trace() noexcept {}
+#endif
+
+    // Suitable for TraceLoggingRegisterEx(). Calls s_Trace() on EVENT_CONTROL_CODE_CAPTURE_STATE.
+    static void NTAPI s_TraceProviderCallback(LPCGUID sourceId,
+                                              ULONG isEnabled,
+                                              UCHAR level,
+                                              ULONGLONG matchAnyKeyword,
+                                              ULONGLONG matchAllKeyword,
+                                              PEVENT_FILTER_DESCRIPTOR filterData,
+                                              PVOID callbackContext) noexcept;
+};
@@ -9,6 +9,7 @@
 #include "ApiDispatchers.h"
 
 #include "ApiSorter.h"
+#include "ApiStats.h"
 
 #include "../host/globals.h"
 
@@ -21,6 +22,7 @@ void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
     NTSTATUS Status;
     HRESULT hr;
     auto ReplyPending = FALSE;
+    const auto begin = ApiStats::s_Now();
 
     ZeroMemory(&pMsg->State, sizeof(pMsg->State));
     ZeroMemory(&pMsg->Complete, sizeof(CD_IO_COMPLETE));
@@ -97,4 +99,13 @@ void IoSorter::ServiceIoOperation(_In_ CONSOLE_API_MSG* const pMsg,
         pMsg->SetReplyStatus(STATUS_UNSUCCESSFUL);
         *ReplyMsg = pMsg;
     }
+
+    // User defined IO is accounted for per API by ApiSorter.
+    if (pMsg->Descriptor.Function != CONSOLE_IO_USER_DEFINED)
+    {
+        ApiStats::s_RecordIo(pMsg->Descriptor.Function,
+                             pMsg->Descriptor.InputSize,
+                             *ReplyMsg ? pMsg->Complete.IoStatus.Information : 0,
+                             begin);
+    }
 }
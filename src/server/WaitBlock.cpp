@@ -237,6 +237,8 @@ bool ConsoleWaitBlock::Notify(const WaitTerminationReason TerminationReason)
             a->NumBytes = gsl::narrow<ULONG>(NumBytes);
         }
 
+        ApiStats::s_RecordWait(_WaitReplyMessage.msgHeader.ApiNumber, _WaitReplyMessage.Complete.IoStatus.Information, _created);
+
         _WaitReplyMessage.ReleaseMessageBuffers();
 
         // This call fails when the server pipe is closed on us,
@@ -18,6 +18,7 @@ Revision History:
 #pragma once
 
 #include "../host/conapi.h"
+#include "ApiStats.h"
 #include "IWaitRoutine.h"
 #include "WaitTerminationReason.h"
 
@@ -51,4 +52,6 @@ private:
     CONSOLE_API_MSG _WaitReplyMessage;
 
     IWaitRoutine* const _pWaiter;
+
+    const ApiStats::Timestamp _created = ApiStats::s_Now();
 };
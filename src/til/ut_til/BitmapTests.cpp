@@ -0,0 +1,365 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/bitmap.h>
+#include <til/rand.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class BitmapTests
+{
+    TEST_CLASS(BitmapTests);
+
+    // A cell-by-cell reference implementation that's too simple to be wrong.
+    struct model
+    {
+        til::CoordType width = 0;
+        til::CoordType height = 0;
+        std::vector<bool> cells;
+
+        explicit model(til::size size) :
+            width{ size.width }, height{ size.height }, cells(size.area<size_t>())
+        {
+        }
+
+        bool test(til::point pt) const
+        {
+            return pt.x >= 0 && pt.y >= 0 && pt.x < width && pt.y < height && cells[static_cast<size_t>(pt.y * width + pt.x)];
+        }
+
+        void fill(const til::rect& rc, bool value)
+        {
+            for (auto y = std::max(0, rc.top); y < std::min(height, rc.bottom); ++y)
+            {
+                for (auto x = std::max(0, rc.left); x < std::min(width, rc.right); ++x)
+                {
+                    cells[static_cast<size_t>(y * width + x)] = value;
+                }
+            }
+        }
+    };
+
+    static til::CoordType random(til::CoordType min, til::CoordType max)
+    {
+        return min + static_cast<til::CoordType>(til::gen_random<uint32_t>() % static_cast<uint32_t>(max - min + 1));
+    }
+
+    // Random rectangles that may be empty, inverted or hang over the edges.
+    static til::rect randomRect(til::size size)
+    {
+        return { random(-5, size.width + 5), random(-5, size.height + 5), random(-5, size.width + 5), random(-5, size.height + 5) };
+    }
+
+    static void verify(const til::bitmap& bitmap, const model& expected)
+    {
+        size_t count = 0;
+        til::rect bounds;
+
+        for (til::CoordType y = 0; y < expected.height; ++y)
+        {
+            for (til::CoordType x = 0; x < expected.width; ++x)
+            {
+                const auto set = expected.test({ x, y });
+                VERIFY_ARE_EQUAL(set, bitmap.test({ x, y }));
+                if (set)
+                {
+                    ++count;
+                    bounds |= til::rect{ x, y, x + 1, y + 1 };
+                }
+            }
+        }
+
+        VERIFY_ARE_EQUAL(count, bitmap.count());
+        VERIFY_ARE_EQUAL(count == 0, bitmap.none());
+        VERIFY_ARE_EQUAL(bounds, bitmap.bounding_rect());
+
+        // Runs must be maximal and, just like the coalesced rectangles, cover each set cell exactly once.
+        model covered{ bitmap.size() };
+        size_t runCount = 0;
+        bitmap.for_each_run([&](const til::rect& rc) {
+            VERIFY_ARE_EQUAL(1, rc.height());
+            VERIFY_IS_FALSE(expected.test({ rc.left - 1, rc.top }));
+            VERIFY_IS_FALSE(expected.test({ rc.right, rc.top }));
+            for (const auto pt : rc)
+            {
+                VERIFY_IS_TRUE(expected.test(pt));
+                VERIFY_IS_FALSE(covered.test(pt));
+                covered.fill({ pt, til::size{ 1, 1 } }, true);
+                ++runCount;
+            }
+        });
+        VERIFY_ARE_EQUAL(count, runCount);
+
+        covered = model{ bitmap.size() };
+        size_t rectCount = 0;
+        bitmap.for_each_rect([&](const til::rect& rc) {
+            VERIFY_IS_FALSE(rc.empty());
+            for (const auto pt : rc)
+            {
+                VERIFY_IS_TRUE(expected.test(pt));
+                VERIFY_IS_FALSE(covered.test(pt));
+                covered.fill({ pt, til::size{ 1, 1 } }, true);
+                ++rectCount;
+            }
+        });
+        VERIFY_ARE_EQUAL(count, rectCount);
+    }
+
+    TEST_METHOD(Empty)
+    {
+        til::bitmap bitmap;
+        VERIFY_IS_TRUE(bitmap.none());
+        VERIFY_ARE_EQUAL(til::rect{}, bitmap.bounding_rect());
+
+        bitmap.set(til::rect{ 0, 0, 10, 10 });
+        bitmap.translate({ 1, 1 });
+        bitmap.for_each_rect([](const til::rect&) { VERIFY_FAIL(); });
+        VERIFY_ARE_EQUAL(0u, bitmap.count());
+    }
+
+    TEST_METHOD(SetAcrossWords)
+    {
+        // 130 columns are 3 words, the last one of which is only partially used.
+        til::bitmap bitmap{ til::size{ 130, 3 } };
+
+        bitmap.set(til::rect{ 60, 1, 129, 2 });
+        VERIFY_ARE_EQUAL(69u, bitmap.count());
+        VERIFY_ARE_EQUAL((til::rect{ 60, 1, 129, 2 }), bitmap.bounding_rect());
+
+        bitmap.reset(til::rect{ 64, 0, 128, 3 });
+        std::vector<til::rect> runs;
+        bitmap.for_each_run([&](const til::rect& rc) { runs.emplace_back(rc); });
+        VERIFY_ARE_EQUAL(2u, runs.size());
+        VERIFY_ARE_EQUAL((til::rect{ 60, 1, 64, 2 }), runs[0]);
+        VERIFY_ARE_EQUAL((til::rect{ 128, 1, 129, 2 }), runs[1]);
+
+        bitmap.set_all();
+        VERIFY_ARE_EQUAL(390u, bitmap.count());
+        VERIFY_ARE_EQUAL((til::rect{ 0, 0, 130, 3 }), bitmap.bounding_rect());
+    }
+
+    TEST_METHOD(Translate)
+    {
+        til::bitmap bitmap{ til::size{ 200, 10 } };
+        bitmap.set(til::rect{ 120, 2, 190, 4 });
+
+        // Bits moved past the right edge must be dropped and not end up in the row padding.
+        bitmap.translate({ 50, -1 });
+        VERIFY_ARE_EQUAL((til::rect{ 170, 1, 200, 3 }), bitmap.bounding_rect());
+        VERIFY_ARE_EQUAL(60u, bitmap.count());
+
+        bitmap.translate({ -170, 0 });
+        VERIFY_ARE_EQUAL((til::rect{ 0, 1, 30, 3 }), bitmap.bounding_rect());
+        bitmap.translate({ 170, 0 });
+        VERIFY_ARE_EQUAL((til::rect{ 170, 1, 200, 3 }), bitmap.bounding_rect());
+
+        bitmap.translate({ 0, 10 });
+        VERIFY_IS_TRUE(bitmap.none());
+    }
+
+    TEST_METHOD(ForEachRectCoalesces)
+    {
+        til::bitmap bitmap{ til::size{ 80, 24 } };
+        bitmap.set(til::rect{ 0, 0, 80, 10 });
+        bitmap.set(til::rect{ 5, 12, 10, 20 });
+        bitmap.set(til::rect{ 20, 12, 30, 20 });
+
+        std::vector<til::rect> rects;
+        bitmap.for_each_rect([&](const til::rect& rc) { rects.emplace_back(rc); });
+        VERIFY_ARE_EQUAL(3u, rects.size());
+        VERIFY_ARE_EQUAL((til::rect{ 0, 0, 80, 10 }), rects[0]);
+        VERIFY_ARE_EQUAL((til::rect{ 5, 12, 10, 20 }), rects[1]);
+        VERIFY_ARE_EQUAL((til::rect{ 20, 12, 30, 20 }), rects[2]);
+    }
+
+    TEST_METHOD(SizeMismatch)
+    {
+        til::bitmap a{ til::size{ 3, 3 } };
+        const til::bitmap b{ til::size{ 4, 3 } };
+        VERIFY_THROWS(a |= b, std::invalid_argument);
+        VERIFY_THROWS(a &= b, std::invalid_argument);
+    }
+
+    // Applies random operations to a bitmap and the reference model and compares them after each step.
+    // The widths are chosen to hit all the interesting cases around the word and 128-bit boundaries.
+    TEST_METHOD(Fuzz)
+    {
+        for (const auto width : { 0, 1, 5, 63, 64, 65, 127, 128, 129, 300 })
+        {
+            for (const auto height : { 0, 1, 7, 30 })
+            {
+                const til::size size{ width, height };
+                til::bitmap bitmap{ size };
+                model expected{ size };
+
+                for (auto step = 0; step < 200; ++step)
+                {
+                    switch (random(0, 5))
+                    {
+                    case 0:
+                    case 1:
+                    {
+                        const auto rc = randomRect(size);
+                        bitmap.set(rc);
+                        expected.fill(rc, true);
+                        break;
+                    }
+                    case 2:
+                    {
+                        const auto rc = randomRect(size);
+                        bitmap.reset(rc);
+                        expected.fill(rc, false);
+                        break;
+                    }
+                    case 3:
+                    {
+                        const til::point delta{ random(-width - 2, width + 2) / random(1, 8), random(-height - 2, height + 2) / random(1, 4) };
+                        bitmap.translate(delta);
+                        model moved{ size };
+                        for (til::CoordType y = 0; y < height; ++y)
+                        {
+                            for (til::CoordType x = 0; x < width; ++x)
+                            {
+                                moved.cells[static_cast<size_t>(y * width + x)] = expected.test({ x - delta.x, y - delta.y });
+                            }
+                        }
+                        expected = std::move(moved);
+                        break;
+                    }
+                    default:
+                    {
+                        til::bitmap other{ size };
+                        model otherExpected{ size };
+                        for (auto i = 0; i < 3; ++i)
+                        {
+                            const auto rc = randomRect(size);
+                            other.set(rc);
+                            otherExpected.fill(rc, true);
+                        }
+
+                        const auto unite = random(0, 1) != 0;
+                        if (unite)
+                        {
+                            bitmap |= other;
+                        }
+                        else
+                        {
+                            bitmap &= other;
+                        }
+                        for (size_t i = 0; i < expected.cells.size(); ++i)
+                        {
+                            expected.cells[i] = unite ? expected.cells[i] || otherExpected.cells[i] : expected.cells[i] && otherExpected.cells[i];
+                        }
+                        break;
+                    }
+                    }
+
+                    verify(bitmap, expected);
+                }
+            }
+        }
+    }
+
+    // The bitmap operations on single rectangles must agree with the til::rect operators.
+    TEST_METHOD(RectSemantics)
+    {
+        for (const auto width : { 1, 64, 129, 300 })
+        {
+            const til::size size{ width, 40 };
+            const til::rect bounds{ size };
+
+            for (auto i = 0; i < 500; ++i)
+            {
+                const auto a = randomRect(size);
+                const auto b = randomRect(size);
+                const til::point delta{ random(-10, 10), random(-10, 10) };
+
+                til::bitmap bitmapA{ size };
+                til::bitmap bitmapB{ size };
+                bitmapA.set(a);
+                bitmapB.set(b);
+                VERIFY_ARE_EQUAL(a & bounds, bitmapA.bounding_rect());
+
+                auto intersection = bitmapA;
+                intersection &= bitmapB;
+                VERIFY_ARE_EQUAL(a & b & bounds, intersection.bounding_rect());
+
+                auto united = bitmapA;
+                united |= bitmapB;
+                VERIFY_ARE_EQUAL((a & bounds) | (b & bounds), united.bounding_rect());
+
+                auto moved = bitmapA;
+                moved.translate(delta);
+                VERIFY_ARE_EQUAL(((a & bounds) + delta) & bounds, moved.bounding_rect());
+            }
+        }
+    }
+
+    // Simulates a frame with lots of small invalidations spread across a tall viewport, which is what you'd
+    // get from a TUI updating a couple of cells in each row. Compares how much the renderer would have to
+    // redraw with a single dirty rectangle versus the bitmap, and how long it takes to collect them.
+    BEGIN_TEST_METHOD(InvalidationBenchmark)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD()
+
+    void InvalidationBenchmark()
+    {
+        static constexpr auto frames = 1000;
+        static constexpr auto invalidationsPerFrame = 2000;
+        static constexpr til::size viewport{ 240, 80 };
+
+        std::vector<til::rect> invalidations;
+        for (auto i = 0; i < invalidationsPerFrame; ++i)
+        {
+            const auto x = random(0, viewport.width - 4);
+            const auto y = random(0, viewport.height - 1);
+            // Cluster the invalidations into a few columns, like a status line in each row.
+            const auto column = (x / 60) * 60;
+            invalidations.emplace_back(column, y, column + random(1, 4), y + 1);
+        }
+
+        til::rect dirtyRect;
+        const auto rectBegin = std::chrono::steady_clock::now();
+        for (auto frame = 0; frame < frames; ++frame)
+        {
+            dirtyRect = {};
+            for (const auto& rc : invalidations)
+            {
+                dirtyRect |= rc;
+            }
+        }
+        const auto rectEnd = std::chrono::steady_clock::now();
+
+        til::bitmap bitmap{ viewport };
+        size_t rects = 0;
+        int64_t area = 0;
+        for (auto frame = 0; frame < frames; ++frame)
+        {
+            for (const auto& rc : invalidations)
+            {
+                bitmap.set(rc);
+            }
+
+            rects = 0;
+            area = 0;
+            bitmap.for_each_rect([&](const til::rect& rc) {
+                ++rects;
+                area += rc.width() * rc.height();
+            });
+            bitmap.reset_all();
+        }
+        const auto bitmapEnd = std::chrono::steady_clock::now();
+
+        VERIFY_IS_LESS_THAN(area, static_cast<int64_t>(dirtyRect.width()) * dirtyRect.height());
+
+        const auto us = [](auto d) {
+            return std::chrono::duration<double, std::micro>(d).count() / frames;
+        };
+        Log::Comment(NoThrowString().Format(L"til::rect:   %.2f us/frame, %d cells dirty", us(rectEnd - rectBegin), dirtyRect.width() * dirtyRect.height()));
+        Log::Comment(NoThrowString().Format(L"til::bitmap: %.2f us/frame, %lld cells dirty in %zu rects", us(bitmapEnd - rectEnd), area, rects));
+    }
+};
@@ -86,4 +86,85 @@ class EnvTests
             VERIFY_ARE_EQUAL(L"Foo%ENV", environment.expand_environment_strings(L"Foo%ENV"));
         }
     }
+
+    TEST_METHOD(SnapshotFind)
+    {
+        static constexpr wchar_t block[] = L"b=Banana\0A=Apple\0C=Cassowary\0";
+        const auto snapshot = til::env_snapshot::from_block(&block[0]);
+
+        VERIFY_ARE_EQUAL(3u, snapshot->size());
+        VERIFY_ARE_EQUAL(L"A", snapshot->key(0));
+        VERIFY_ARE_EQUAL(L"b", snapshot->key(1));
+        VERIFY_ARE_EQUAL(L"Banana", snapshot->find(L"B").value_or(L""));
+        VERIFY_IS_FALSE(snapshot->find(L"D").has_value());
+
+        // The same block returns the cached snapshot.
+        VERIFY_ARE_EQUAL(snapshot, til::env_snapshot::from_block(&block[0]));
+    }
+
+    TEST_METHOD(OverlayToString)
+    {
+        til::env environment;
+        environment.as_map().insert_or_assign(L"A", L"Apple");
+        environment.as_map().insert_or_assign(L"Path", L"C:\\Windows");
+        environment.as_map().insert_or_assign(L"C", L"Cassowary");
+
+        til::env_overlay overlay{ std::make_shared<const til::env_snapshot>(environment) };
+        overlay.set(L"B", L"Banana");
+        overlay.set(L"PATH", L"C:\\Tools");
+        overlay.set_user_environment_var(L"D", L"%A%%B%");
+        overlay.set_user_environment_var(L"E", L"");
+
+        // Overridden variables retain their original name, just like with std::map::insert_or_assign().
+        static constexpr wchar_t expectedArray[] = L"A=Apple\0B=Banana\0C=Cassowary\0D=AppleBanana\0Path=C:\\Tools\0";
+        static constexpr std::wstring_view expected{ expectedArray, std::size(expectedArray) };
+        VERIFY_ARE_EQUAL(expected, overlay.to_string());
+    }
+
+    // Compares building a child process environment block the way ConptyConnection used to
+    // (copying a til::env and serializing it) with a cached snapshot and an overlay.
+    BEGIN_TEST_METHOD(BlockBuildBenchmark)
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD()
+
+    void BlockBuildBenchmark()
+    {
+        static constexpr auto iterations = 1000;
+
+        // Warm up the snapshot cache, which is what every tab after the first one hits.
+        til::env_snapshot::from_current_environment();
+
+        const auto guid = L"{00000000-0000-0000-0000-000000000000}";
+        std::wstring expected;
+        std::wstring actual;
+
+        const auto mapBegin = std::chrono::steady_clock::now();
+        for (auto i = 0; i < iterations; ++i)
+        {
+            auto copy = til::env::from_current_environment();
+            copy.as_map().insert_or_assign(L"WT_SESSION", guid);
+            copy.as_map().insert_or_assign(L"WT_PROFILE_ID", guid);
+            copy.as_map().insert_or_assign(L"WSLENV", L"WT_SESSION:WT_PROFILE_ID:");
+            expected = copy.to_string();
+        }
+        const auto mapEnd = std::chrono::steady_clock::now();
+
+        for (auto i = 0; i < iterations; ++i)
+        {
+            til::env_overlay overlay{ til::env_snapshot::from_current_environment() };
+            overlay.set(L"WT_SESSION", guid);
+            overlay.set(L"WT_PROFILE_ID", guid);
+            overlay.set(L"WSLENV", L"WT_SESSION:WT_PROFILE_ID:");
+            actual = overlay.to_string();
+        }
+        const auto overlayEnd = std::chrono::steady_clock::now();
+
+        VERIFY_ARE_EQUAL(expected, actual);
+
+        const auto us = [](auto d) {
+            return std::chrono::duration<double, std::micro>(d).count() / iterations;
+        };
+        Log::Comment(NoThrowString().Format(L"til::env:    %.2f us/block", us(mapEnd - mapBegin)));
+        Log::Comment(NoThrowString().Format(L"env_overlay: %.2f us/block", us(overlayEnd - mapEnd)));
+    }
 };
@@ -62,4 +62,53 @@ class FlatSetTests
         VERIFY_ARE_EQUAL(entry1, entry2);
         VERIFY_ARE_EQUAL(123u, entry2->value);
     }
+
+    TEST_METHOD(SwissBasic)
+    {
+        til::swiss_flat_set<Data, DataHashTrait> set;
+
+        VERIFY_IS_NULL(set.lookup(123));
+
+        const auto [entry1, inserted1] = set.insert(123);
+        VERIFY_IS_TRUE(inserted1);
+
+        const auto [entry2, inserted2] = set.insert(123);
+        VERIFY_IS_FALSE(inserted2);
+
+        VERIFY_ARE_EQUAL(entry1, entry2);
+        VERIFY_ARE_EQUAL(entry1, set.lookup(123));
+        VERIFY_ARE_EQUAL(123u, entry2->value);
+        VERIFY_ARE_EQUAL(1u, set.size());
+    }
+
+    TEST_METHOD(SwissGrowth)
+    {
+        til::swiss_flat_set<Data, DataHashTrait> set;
+
+        // Enough items to grow the set a couple times and fill multiple groups beyond 80%.
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            VERIFY_IS_TRUE(set.insert(i * 7).second);
+        }
+        VERIFY_ARE_EQUAL(1000u, set.size());
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            const auto entry = set.lookup(i * 7);
+            VERIFY_IS_NOT_NULL(entry);
+            VERIFY_ARE_EQUAL(i * 7, entry->value);
+            VERIFY_IS_NULL(set.lookup(i * 7 + 1));
+        }
+
+        size_t occupied = 0;
+        for (const auto& slot : set.container())
+        {
+            occupied += DataHashTrait::occupied(slot);
+        }
+        VERIFY_ARE_EQUAL(1000u, occupied);
+
+        set.clear();
+        VERIFY_IS_TRUE(set.empty());
+        VERIFY_IS_NULL(set.lookup(7));
+    }
 };
@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/lock_stats.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+// The whole test binary is built with TIL_LOCK_STATS=1 (see the .vcxproj and sources), because
+// mixing translation units with and without it would violate the ODR for til::lock_stats::site.
+static_assert(TIL_LOCK_STATS, "til.unit.tests must be built with TIL_LOCK_STATS=1");
+
+class LockStatsTests
+{
+    BEGIN_TEST_CLASS(LockStatsTests)
+        TEST_CLASS_PROPERTY(L"TestTimeout", L"0:0:10") // 10s timeout
+    END_TEST_CLASS()
+
+    static const til::lock_stats::site_summary* findSite(const std::vector<til::lock_stats::site_summary>& summaries, const til::lock_stats::site& s)
+    {
+        for (const auto& summary : summaries)
+        {
+            if (summary.line == s.line() && strcmp(summary.file, s.file_name()) == 0)
+            {
+                return &summary;
+            }
+        }
+        return nullptr;
+    }
+
+    TEST_METHOD(SummarizeAndReport)
+    {
+        // The statistics are process-global and other tests record into them as well,
+        // so this test only looks at the two call sites it creates itself.
+        const auto shortSite = til::lock_stats::site::current();
+        const auto longSite = til::lock_stats::site::current();
+        static constexpr uint64_t shortIterations = 100;
+        static constexpr uint64_t longIterations = 10;
+
+        std::shared_mutex mutex;
+        std::thread shortThread{ [&]() {
+            for (uint64_t i = 0; i < shortIterations; ++i)
+            {
+                til::lock_stats::shared_lock lock{ mutex, shortSite };
+            }
+        } };
+        std::thread longThread{ [&]() {
+            for (uint64_t i = 0; i < longIterations; ++i)
+            {
+                til::lock_stats::unique_lock lock{ mutex, longSite };
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        } };
+        shortThread.join();
+        longThread.join();
+
+        const auto summaries = til::lock_stats::summarize();
+        const auto shortSummary = findSite(summaries, shortSite);
+        const auto longSummary = findSite(summaries, longSite);
+        VERIFY_IS_NOT_NULL(shortSummary);
+        VERIFY_IS_NOT_NULL(longSummary);
+
+        VERIFY_ARE_EQUAL(shortIterations, shortSummary->wait.count);
+        VERIFY_ARE_EQUAL(shortIterations, shortSummary->hold.count);
+        VERIFY_ARE_EQUAL(longIterations, longSummary->wait.count);
+        VERIFY_ARE_EQUAL(longIterations, longSummary->hold.count);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(longSummary->hold.total_ns, longIterations * 2'000'000);
+        VERIFY_IS_GREATER_THAN(longSummary->hold.total_ns, shortSummary->hold.total_ns);
+
+        const auto report = til::lock_stats::report(summaries.size(), til::lock_stats::order::hold);
+        Log::Comment(NoThrowString().Format(L"%hs", report.c_str()));
+
+        // The report starts with a header, followed by one line per site, sorted by the total hold time.
+        VERIFY_ARE_EQUAL(size_t{ 0 }, report.find("     count"));
+        const auto shortPos = report.find(fmt::format(FMT_COMPILE("{}({}):"), shortSite.file_name(), shortSite.line()));
+        const auto longPos = report.find(fmt::format(FMT_COMPILE("{}({}):"), longSite.file_name(), longSite.line()));
+        VERIFY_ARE_NOT_EQUAL(std::string::npos, shortPos);
+        VERIFY_ARE_NOT_EQUAL(std::string::npos, longPos);
+        VERIFY_IS_LESS_THAN(longPos, shortPos);
+
+        // `top` limits the number of reported sites to the header plus that many lines.
+        const auto top1 = til::lock_stats::report(1, til::lock_stats::order::hold);
+        VERIFY_ARE_EQUAL(std::ptrdiff_t{ 2 }, std::count(top1.begin(), top1.end(), '\n'));
+    }
+};
@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/pmr.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class PmrTests
+{
+    TEST_CLASS(PmrTests);
+
+    // Forwards to the default resource and keeps track of what's outstanding.
+    struct counting_resource : std::pmr::memory_resource
+    {
+        size_t allocations = 0;
+        size_t outstanding = 0;
+        std::vector<std::span<char>> blocks;
+
+        void* do_allocate(size_t bytes, size_t align) override
+        {
+            ++allocations;
+            ++outstanding;
+            const auto ptr = til::pmr::get_default_resource()->allocate(bytes, align);
+            blocks.emplace_back(static_cast<char*>(ptr), bytes);
+            return ptr;
+        }
+
+        bool contains(const void* ptr, size_t bytes) const noexcept
+        {
+            const auto beg = static_cast<const char*>(ptr);
+            return std::any_of(blocks.begin(), blocks.end(), [&](const std::span<char>& b) {
+                return beg >= b.data() && beg <= b.data() + b.size() && bytes <= static_cast<size_t>(b.data() + b.size() - beg);
+            });
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t align) noexcept override
+        {
+            --outstanding;
+            til::pmr::get_default_resource()->deallocate(ptr, bytes, align);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    TEST_METHOD(MonotonicArenaAlignment)
+    {
+        til::pmr::monotonic_arena arena;
+
+        for (const size_t align : { 1, 2, 4, 8, 16, 64, 256 })
+        {
+            const auto ptr = arena.allocate(3, align);
+            VERIFY_ARE_EQUAL(0u, reinterpret_cast<uintptr_t>(ptr) % align);
+        }
+
+        // Larger than the default block size.
+        const auto ptr = arena.allocate(100000, 64);
+        VERIFY_ARE_EQUAL(0u, reinterpret_cast<uintptr_t>(ptr) % 64);
+        VERIFY_IS_TRUE(arena.capacity() >= 100000);
+
+        // The first block is 5009 bytes large and thus ends unaligned. Aligning the cursor
+        // for the last allocation moves it past the end of the block, which must not be
+        // mistaken for plenty of space left.
+        counting_resource upstream;
+        til::pmr::monotonic_arena unaligned{ &upstream };
+        for (const auto [bytes, align] : { std::pair<size_t, size_t>{ 5001, 8 }, { 8, 1 }, { 8, 8 } })
+        {
+            const auto p = unaligned.allocate(bytes, align);
+            VERIFY_ARE_EQUAL(0u, reinterpret_cast<uintptr_t>(p) % align);
+            VERIFY_IS_TRUE(upstream.contains(p, bytes));
+        }
+        VERIFY_ARE_EQUAL(2u, upstream.allocations);
+    }
+
+    TEST_METHOD(MonotonicArenaReset)
+    {
+        counting_resource upstream;
+
+        {
+            til::pmr::monotonic_arena arena{ &upstream };
+
+            const auto workload = [&]() {
+                std::pmr::vector<int> ints{ &arena };
+                std::pmr::wstring str{ &arena };
+                for (auto i = 0; i < 10000; ++i)
+                {
+                    ints.push_back(i);
+                    str.push_back(L'a');
+                }
+            };
+
+            workload();
+            VERIFY_IS_TRUE(upstream.allocations > 1);
+            VERIFY_IS_TRUE(arena.size() > 0);
+
+            // Repeating the same workload after a couple of resets mustn't allocate anymore.
+            arena.reset();
+            workload();
+            arena.reset();
+            VERIFY_ARE_EQUAL(0u, arena.size());
+            VERIFY_ARE_EQUAL(1u, upstream.outstanding);
+
+            const auto allocations = upstream.allocations;
+            for (auto i = 0; i < 5; ++i)
+            {
+                workload();
+                arena.reset();
+            }
+            VERIFY_ARE_EQUAL(allocations, upstream.allocations);
+        }
+
+        VERIFY_ARE_EQUAL(0u, upstream.outstanding);
+    }
+};
@@ -0,0 +1,180 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/ring_buffer.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+template<>
+class WEX::TestExecution::VerifyOutputTraits<std::vector<int>>
+{
+public:
+    static WEX::Common::NoThrowString ToString(const std::vector<int>& vec)
+    {
+        WEX::Common::NoThrowString str;
+        str.Append(L"{ ");
+        for (size_t i = 0; i < vec.size(); ++i)
+        {
+            str.AppendFormat(i == 0 ? L"%d" : L", %d", vec[i]);
+        }
+        str.Append(L" }");
+        return str;
+    }
+};
+
+class RingBufferTests
+{
+    TEST_CLASS(RingBufferTests);
+
+    static std::vector<int> contents(const til::ring_buffer<int>& rb)
+    {
+        std::vector<int> vec;
+        for (const auto& slice : rb.slices(0, rb.size()))
+        {
+            vec.insert(vec.end(), slice.begin(), slice.end());
+        }
+        return vec;
+    }
+
+    TEST_METHOD(PushAndPop)
+    {
+        til::ring_buffer<int> rb;
+        VERIFY_IS_TRUE(rb.empty());
+
+        for (auto i = 0; i < 10; ++i)
+        {
+            rb.push_back(i);
+            VERIFY_ARE_EQUAL(i, rb.back());
+        }
+
+        VERIFY_ARE_EQUAL(10u, rb.size());
+        VERIFY_ARE_EQUAL(0, rb.front());
+
+        rb.pop_front(3);
+        VERIFY_ARE_EQUAL(7u, rb.size());
+        VERIFY_ARE_EQUAL(3, rb.front());
+        VERIFY_ARE_EQUAL(9, rb.back());
+
+        rb.pop_front(100);
+        VERIFY_IS_TRUE(rb.empty());
+    }
+
+    TEST_METHOD(WrapAround)
+    {
+        til::ring_buffer<int> rb;
+        rb.reserve(16);
+        const auto capacity = rb.capacity();
+
+        // Move the head towards the end of the allocation, so that the next append wraps around.
+        for (auto i = 0; i < 12; ++i)
+        {
+            rb.push_back(i);
+        }
+        rb.pop_front(10);
+
+        const std::vector<int> values{ 12, 13, 14, 15, 16, 17, 18, 19 };
+        rb.append(values);
+
+        // The append must not have reallocated, otherwise we didn't test the wrap-around.
+        VERIFY_ARE_EQUAL(capacity, rb.capacity());
+
+        const auto slices = rb.slices(0, rb.size());
+        VERIFY_IS_FALSE(slices[0].empty());
+        VERIFY_IS_FALSE(slices[1].empty());
+
+        const std::vector<int> expected{ 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 };
+        VERIFY_ARE_EQUAL(expected, contents(rb));
+
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i], rb[i]);
+        }
+    }
+
+    TEST_METHOD(GrowWhileWrapped)
+    {
+        til::ring_buffer<int> rb;
+        std::vector<int> expected;
+
+        for (auto i = 0; i < 12; ++i)
+        {
+            rb.push_back(i);
+        }
+        rb.pop_front(10);
+        expected = { 10, 11 };
+
+        // Appending this many items forces a reallocation which needs to unwrap the contents.
+        std::vector<int> values(100);
+        std::iota(values.begin(), values.end(), 12);
+        rb.append(values);
+        expected.insert(expected.end(), values.begin(), values.end());
+
+        VERIFY_ARE_EQUAL(expected, contents(rb));
+    }
+
+    TEST_METHOD(Slices)
+    {
+        til::ring_buffer<int> rb;
+        for (auto i = 0; i < 8; ++i)
+        {
+            rb.push_back(i);
+        }
+
+        const auto slices = rb.slices(2, 3);
+        VERIFY_ARE_EQUAL(3u, slices[0].size() + slices[1].size());
+        VERIFY_ARE_EQUAL(2, slices[0].front());
+
+        // The count gets clamped to the available items.
+        const auto clamped = rb.slices(6, 100);
+        VERIFY_ARE_EQUAL(2u, clamped[0].size() + clamped[1].size());
+
+        const auto none = rb.slices(100, 1);
+        VERIFY_IS_TRUE(none[0].empty());
+        VERIFY_IS_TRUE(none[1].empty());
+    }
+
+    TEST_METHOD(RemoveIf)
+    {
+        til::ring_buffer<int> rb;
+        for (auto i = 0; i < 12; ++i)
+        {
+            rb.push_back(i);
+        }
+        rb.pop_front(6);
+        for (auto i = 12; i < 20; ++i)
+        {
+            rb.push_back(i);
+        }
+
+        rb.remove_if([](int v) { return v % 2 != 0; });
+
+        const std::vector<int> expected{ 6, 8, 10, 12, 14, 16, 18 };
+        VERIFY_ARE_EQUAL(expected, contents(rb));
+
+        rb.remove_if([](int) { return true; });
+        VERIFY_IS_TRUE(rb.empty());
+    }
+
+    TEST_METHOD(MoveAndSwap)
+    {
+        til::ring_buffer<int> a;
+        a.push_back(1);
+        a.push_back(2);
+
+        til::ring_buffer<int> b{ std::move(a) };
+        VERIFY_IS_TRUE(a.empty());
+        VERIFY_ARE_EQUAL(2u, b.size());
+
+        a.swap(b);
+        VERIFY_ARE_EQUAL(2u, a.size());
+        VERIFY_IS_TRUE(b.empty());
+
+        b = std::move(a);
+        VERIFY_IS_TRUE(a.empty());
+        VERIFY_ARE_EQUAL(2, b.back());
+    }
+};
@@ -453,6 +453,129 @@ class RunLengthEncodingTests
         }
     }
 
+    TEST_METHOD(ReplaceRanges)
+    {
+        rle_vector rle{ rle_encode("1|3 3|2|1 1 1|5 5"sv) };
+
+        // no edits
+        rle.replace_ranges({});
+        VERIFY_ARE_EQUAL("1|3 3|2|1 1 1|5 5"sv, rle);
+
+        // within a run, between runs, joining with neighbors and clamping the end
+        const std::array<rle_vector::edit, 4> edits{ {
+            { 0, 1, 3 },
+            { 4, 4, 7 },
+            { 5, 6, 6 },
+            { 7, 100, 1 },
+        } };
+        rle.replace_ranges(edits);
+        VERIFY_ARE_EQUAL("3 3 3|2|1|6|1 1 1"sv, rle);
+
+        // invalid ranges
+        const std::array<rle_vector::edit, 1> reversed{ { { 3, 2, 1 } } };
+        VERIFY_THROWS(rle.replace_ranges(reversed), std::out_of_range);
+        const std::array<rle_vector::edit, 2> overlapping{ { { 0, 3, 1 }, { 2, 4, 1 } } };
+        VERIFY_THROWS(rle.replace_ranges(overlapping), std::invalid_argument);
+
+        // The result must be identical to calling replace() for each edit.
+        // This uses enough runs for the index to get involved.
+        uint32_t seed = 1;
+        const auto random = [&](uint32_t max) {
+            seed = seed * 1664525 + 1013904223;
+            return (seed >> 16) % max;
+        };
+
+        for (auto iteration = 0; iteration < 100; ++iteration)
+        {
+            basic_container data;
+            for (auto i = 0; i < 300; ++i)
+            {
+                data.push_back(gsl::narrow_cast<value_type>(random(4)));
+            }
+
+            rle_vector actual{ rle_encode(data) };
+            rle_vector expected{ rle_encode(data) };
+            std::vector<rle_vector::edit> batch;
+
+            for (size_type pos = gsl::narrow_cast<size_type>(random(8)); pos < data.size();)
+            {
+                // replace() would insert empty runs for empty ranges, which replace_ranges() skips.
+                const auto end = gsl::narrow_cast<size_type>(pos + 1 + random(6));
+                const auto value = gsl::narrow_cast<value_type>(random(4));
+                batch.push_back({ pos, end, value });
+                expected.replace(pos, end, value);
+                pos = gsl::narrow_cast<size_type>(end + random(8));
+            }
+
+            // Warm up the index to ensure that it doesn't go stale. Lookups don't fill it,
+            // but modifications do, up to the run they touch. This one is a no-op at the very end.
+            const auto last = gsl::narrow_cast<size_type>(data.size() - 1);
+            actual.replace(last, last + 1, data.back());
+            VERIFY_IS_FALSE(actual._index.empty());
+
+            actual.replace_ranges(batch);
+            VERIFY_ARE_EQUAL(expected, actual);
+            VERIFY_IS_TRUE(data.size() == actual.size());
+        }
+    }
+
+    TEST_METHOD(Index)
+    {
+        // The index is only used for vectors with lots of runs, so we need a couple of those.
+        basic_container expected;
+        for (auto i = 0; i < 200; ++i)
+        {
+            expected.append(i % 3 + 1, gsl::narrow_cast<value_type>(i % 2));
+        }
+
+        rle_vector rle{ rle_encode(expected) };
+        VERIFY_IS_TRUE(std::as_const(rle).runs().size() >= rle_vector::index_threshold);
+
+        const auto verify = [&]() {
+            for (size_type i = 0; i < expected.size(); ++i)
+            {
+                VERIFY_ARE_EQUAL(expected[i], rle.at(i));
+            }
+            VERIFY_IS_TRUE(expected == rle_decode(std::as_const(rle).runs()));
+        };
+
+        // Lookups only use the index, so that const methods remain safe to call concurrently.
+        verify();
+        VERIFY_IS_TRUE(rle._index.empty());
+
+        // Modifications fill it from the front, as far as they need to.
+        rle.replace(150, 151, 1);
+        expected[150] = 1;
+        VERIFY_IS_FALSE(rle._index.empty());
+        VERIFY_IS_TRUE(rle._index.size() < rle._runs.size());
+        verify();
+
+        // Modifications must only keep the part of the index in front of them.
+        rle.replace(100, 105, 7);
+        expected.replace(100, 5, 5, 7);
+        VERIFY_IS_TRUE(rle._index.size() < rle._runs.size());
+        verify();
+
+        rle.resize_trailing_extent(250);
+        expected.resize(250);
+        verify();
+
+        rle.resize_trailing_extent(300);
+        expected.resize(300, expected.back());
+        verify();
+
+        VERIFY_IS_TRUE(expected.substr(17, 200) == rle_decode(rle.slice(17, 217).runs()));
+
+        // Copies don't inherit the index, but must work just the same.
+        auto copy{ rle };
+        VERIFY_IS_TRUE(copy._index.empty());
+        VERIFY_ARE_EQUAL(rle, copy);
+
+        rle.replace_values(7, 8);
+        std::ranges::replace(expected, 7, 8);
+        verify();
+    }
+
     TEST_METHOD(Comparison)
     {
         rle_vector rle1{ { { 1, 1 }, { 3, 2 }, { 2, 1 } } };
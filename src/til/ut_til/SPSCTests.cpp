@@ -56,6 +56,7 @@ class SPSCTests
     TEST_METHOD(DropEmptyTest);
     TEST_METHOD(DropSameRevolutionTest);
     TEST_METHOD(DropDifferentRevolutionTest);
+    TEST_METHOD(ReservationTest);
     TEST_METHOD(IntegrationTest);
 };
 
@@ -185,6 +186,48 @@ void SPSCTests::DropDifferentRevolutionTest()
     VERIFY_ARE_EQUAL(counter, 8);
 }
 
+void SPSCTests::ReservationTest()
+{
+    auto [tx, rx] = til::spsc::channel<int>(5);
+
+    // An empty queue can be reserved in full, but not more than that.
+    auto w = tx.reserve(til::spsc::block_initially, 7);
+    VERIFY_ARE_EQUAL(5u, w.first.size());
+    VERIFY_ARE_EQUAL(0u, w.second.size());
+    std::iota(w.first.begin(), w.first.end(), 0);
+    tx.commit(4);
+
+    auto r = rx.peek(til::spsc::block_initially, 3);
+    VERIFY_ARE_EQUAL(3u, r.size());
+    VERIFY_ARE_EQUAL(0, r.first[0]);
+    VERIFY_ARE_EQUAL(2, r.first[2]);
+    rx.consume(3);
+
+    // The writable range is now [4, 5) followed by [0, 3).
+    w = tx.reserve(til::spsc::block_forever, 4);
+    VERIFY_ARE_EQUAL(1u, w.first.size());
+    VERIFY_ARE_EQUAL(3u, w.second.size());
+    w.first[0] = 4;
+    std::iota(w.second.begin(), w.second.end(), 5);
+    tx.commit(4);
+
+    // Items written with reserve() can be read with pop() and vice versa.
+    VERIFY_ARE_EQUAL(3, rx.pop());
+
+    r = rx.peek(til::spsc::block_initially, 10);
+    VERIFY_ARE_EQUAL(1u, r.first.size());
+    VERIFY_ARE_EQUAL(3u, r.second.size());
+    VERIFY_ARE_EQUAL(4, r.first[0]);
+    VERIFY_ARE_EQUAL(7, r.second[2]);
+    rx.consume(r.size());
+
+    drop(tx);
+
+    r = rx.peek(til::spsc::block_initially, 1);
+    VERIFY_IS_TRUE(r.empty());
+    VERIFY_IS_FALSE(r.alive);
+}
+
 void SPSCTests::IntegrationTest()
 {
     auto [tx, rx] = til::spsc::channel<int>(7);
@@ -0,0 +1,129 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/latch.h>
+#include <til/ticket_lock.h>
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class TicketLockTests
+{
+    BEGIN_TEST_CLASS(TicketLockTests)
+        TEST_CLASS_PROPERTY(L"TestTimeout", L"0:0:10") // 10s timeout
+    END_TEST_CLASS()
+
+    TEST_METHOD(SharedRecursion)
+    {
+        til::recursive_shared_ticket_lock lock;
+
+        {
+            std::shared_lock a{ lock };
+            std::shared_lock b{ lock };
+            VERIFY_IS_TRUE(lock.is_locked_shared());
+            VERIFY_IS_FALSE(lock.is_locked());
+            VERIFY_ARE_EQUAL(2u, lock.recursion_depth());
+        }
+
+        VERIFY_IS_FALSE(lock.is_locked_shared());
+
+        {
+            // The exclusive owner may lock it in shared mode as well.
+            std::unique_lock a{ lock };
+            std::shared_lock b{ lock };
+            VERIFY_IS_TRUE(lock.is_locked());
+            VERIFY_ARE_EQUAL(2u, lock.recursion_depth());
+        }
+
+        VERIFY_IS_FALSE(lock.is_locked_shared());
+    }
+
+    TEST_METHOD(Suspend)
+    {
+        til::recursive_shared_ticket_lock lock;
+
+        {
+            std::shared_lock a{ lock };
+            std::shared_lock b{ lock };
+            {
+                const auto suspension = lock.suspend();
+                VERIFY_IS_FALSE(lock.is_locked_shared());
+
+                // Another thread can lock it exclusively in the meantime.
+                std::thread{ [&]() { std::unique_lock c{ lock }; } }.join();
+            }
+            VERIFY_IS_TRUE(lock.is_locked_shared());
+            VERIFY_IS_FALSE(lock.is_locked());
+            VERIFY_ARE_EQUAL(2u, lock.recursion_depth());
+        }
+
+        {
+            std::unique_lock a{ lock };
+            {
+                const auto suspension = lock.suspend();
+                VERIFY_IS_FALSE(lock.is_locked());
+            }
+            VERIFY_IS_TRUE(lock.is_locked());
+        }
+
+        VERIFY_IS_FALSE(lock.is_locked_shared());
+    }
+
+    TEST_METHOD(ConcurrentReaders)
+    {
+        til::recursive_shared_ticket_lock lock;
+        til::latch inside{ 2 };
+
+        // Both threads only get past the latch if they hold the lock at the same time.
+        const auto reader = [&]() {
+            std::shared_lock guard{ lock };
+            inside.arrive_and_wait();
+        };
+
+        std::thread a{ reader };
+        std::thread b{ reader };
+        a.join();
+        b.join();
+    }
+
+    TEST_METHOD(WriterExcludesReaders)
+    {
+        til::recursive_shared_ticket_lock lock;
+        std::atomic<int> writers{ 0 };
+        std::atomic<bool> torn{ false };
+        std::atomic<bool> done{ false };
+        std::vector<std::thread> readers;
+
+        for (auto i = 0; i < 3; ++i)
+        {
+            readers.emplace_back([&]() {
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    std::shared_lock guard{ lock };
+                    if (writers.load(std::memory_order_relaxed) != 0)
+                    {
+                        torn = true;
+                    }
+                }
+            });
+        }
+
+        for (auto i = 0; i < 10000; ++i)
+        {
+            std::unique_lock guard{ lock };
+            writers.fetch_add(1, std::memory_order_relaxed);
+            writers.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        done = true;
+        for (auto& r : readers)
+        {
+            r.join();
+        }
+
+        VERIFY_IS_FALSE(torn.load());
+    }
+};
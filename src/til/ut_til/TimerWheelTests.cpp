@@ -0,0 +1,181 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/latch.h>
+#include <til/rand.h>
+#include <til/timer_service.h>
+
+using namespace std::chrono_literals;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class TimerWheelTests
+{
+    BEGIN_TEST_CLASS(TimerWheelTests)
+        TEST_CLASS_PROPERTY(L"TestTimeout", L"0:0:10") // 10s timeout
+    END_TEST_CLASS()
+
+    using tick = til::timer_wheel::tick;
+
+    struct test_entry : til::timer_wheel::entry
+    {
+        tick requested = 0;
+        tick scheduledAt = 0;
+        bool live = false;
+    };
+
+    static std::vector<test_entry*> expire(til::timer_wheel& wheel, tick now)
+    {
+        std::vector<test_entry*> expired;
+        wheel.expire(now, [&](til::timer_wheel::entry& e) {
+            expired.push_back(static_cast<test_entry*>(&e));
+        });
+        return expired;
+    }
+
+    TEST_METHOD(Empty)
+    {
+        til::timer_wheel wheel{ 1234 };
+        VERIFY_IS_TRUE(wheel.empty());
+        VERIFY_ARE_EQUAL(til::timer_wheel::never, wheel.next_expiry());
+        VERIFY_ARE_EQUAL(0u, expire(wheel, 1000000).size());
+    }
+
+    TEST_METHOD(ScheduleAndCancel)
+    {
+        til::timer_wheel wheel{ 1000 };
+        test_entry a, b;
+
+        wheel.schedule(a, 1010);
+        wheel.schedule(b, 1020);
+        VERIFY_IS_TRUE(a.scheduled());
+        VERIFY_ARE_EQUAL(1010u, wheel.next_expiry());
+
+        // Nothing expires early.
+        VERIFY_ARE_EQUAL(0u, expire(wheel, 1009).size());
+
+        // Rescheduling moves the entry.
+        wheel.schedule(a, 1030);
+        VERIFY_ARE_EQUAL(1020u, wheel.next_expiry());
+
+        wheel.cancel(b);
+        VERIFY_IS_FALSE(b.scheduled());
+        VERIFY_ARE_EQUAL(1030u, wheel.next_expiry());
+
+        const auto expired = expire(wheel, 1030);
+        VERIFY_ARE_EQUAL(1u, expired.size());
+        VERIFY_ARE_EQUAL(&a, expired[0]);
+        VERIFY_IS_FALSE(a.scheduled());
+        VERIFY_IS_TRUE(wheel.empty());
+    }
+
+    TEST_METHOD(Coalescing)
+    {
+        til::timer_wheel wheel{ 1000 };
+        test_entry a, b, c;
+
+        // With a slack of 32 ticks, these get rounded up to the same multiple of 16.
+        wheel.schedule(a, 1537, 32);
+        wheel.schedule(b, 1541, 32);
+        wheel.schedule(c, 1547, 32);
+        VERIFY_ARE_EQUAL(1552u, a.due());
+        VERIFY_ARE_EQUAL(1552u, b.due());
+        VERIFY_ARE_EQUAL(1552u, c.due());
+
+        VERIFY_ARE_EQUAL(1552u, wheel.next_expiry());
+        VERIFY_ARE_EQUAL(3u, expire(wheel, wheel.next_expiry()).size());
+    }
+
+    TEST_METHOD(Forward)
+    {
+        til::timer_wheel wheel{ 0 };
+        test_entry a;
+
+        // After being idle for a while, forward() ensures that deadlines are bucketed finely again.
+        wheel.forward(10000000);
+        wheel.schedule(a, 10000010);
+        VERIFY_ARE_EQUAL(10000010u, wheel.next_expiry());
+    }
+
+    TEST_METHOD(Fuzz)
+    {
+        til::timer_wheel wheel{ 5000 };
+        std::array<test_entry, 128> entries;
+        tick now = 5000;
+
+        for (auto step = 0; step < 100000; ++step)
+        {
+            const auto r = til::gen_random<uint32_t>() % 100;
+            auto& e = til::at(entries, til::gen_random<uint32_t>() % entries.size());
+
+            if (r < 3)
+            {
+                // Include deadlines beyond what the wheel can represent directly (~17 minutes).
+                static constexpr std::array<tick, 4> limits{ 64, 1000, 100000, 3000000 };
+                const auto delta = til::gen_random<uint64_t>() % til::at(limits, til::gen_random<uint32_t>() % limits.size());
+                const auto slack = r == 0 ? til::gen_random<uint64_t>() % 100 : 0;
+                wheel.schedule(e, now + delta, slack);
+                e.requested = now + delta;
+                e.scheduledAt = now;
+                e.live = true;
+            }
+            else if (r < 4)
+            {
+                wheel.cancel(e);
+                e.live = false;
+            }
+
+            now++;
+
+            for (const auto x : expire(wheel, now))
+            {
+                VERIFY_IS_TRUE(x->live);
+                VERIFY_IS_FALSE(x->scheduled());
+                // Never early...
+                VERIFY_IS_GREATER_THAN_OR_EQUAL(now, x->requested);
+                // ...and only late by the slack and ~6% of the delay.
+                const auto delta = x->due() - x->scheduledAt;
+                if (delta < 1000000)
+                {
+                    VERIFY_IS_LESS_THAN_OR_EQUAL(now - x->due(), std::max<tick>(1, delta / 15));
+                }
+                x->live = false;
+            }
+        }
+
+        // Everything that's still scheduled expires eventually.
+        for (const auto x : expire(wheel, now + 100000000))
+        {
+            VERIFY_IS_TRUE(x->live);
+            x->live = false;
+        }
+        for (const auto& e : entries)
+        {
+            VERIFY_IS_FALSE(e.live);
+        }
+        VERIFY_IS_TRUE(wheel.empty());
+    }
+
+    TEST_METHOD(Service)
+    {
+        til::latch latch{ 3 };
+        std::atomic<int> canceledCalls{ 0 };
+
+        til::timer_service::timer a{ [&]() { latch.count_down(); } };
+        til::timer_service::timer b{ [&]() { latch.count_down(); } };
+        til::timer_service::timer c{ [&]() { latch.count_down(); } };
+        til::timer_service::timer canceled{ [&]() { canceledCalls++; } };
+
+        a.schedule(10ms, 10ms);
+        b.schedule(12ms, 10ms);
+        c.schedule(1ms);
+        canceled.schedule(5ms);
+        canceled.cancel();
+
+        latch.wait();
+        VERIFY_ARE_EQUAL(0, canceledCalls.load());
+    }
+};
@@ -0,0 +1,593 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Contention benchmarks for til's blocking primitives, which all wait via til::atomic_wait().
+// This file only depends on the STL and the til headers, so that it can be built on Linux as well:
+//   g++ -std=c++20 -O2 -pthread -I src/inc src/tools/tilbench/main.cpp -o tilbench
+//
+// Usage: tilbench [iterations] [spsc|latch|ticket_lock|rw_lock|flat_set]
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#define __declspec(x) __attribute__((x))
+#endif
+
+// The same as in til.h, which we can't include here.
+#if (defined(_M_IX86) || defined(_M_X64) || __i386__ || __x86_64__) && !defined(_M_HYBRID_X86_ARM64) && !defined(_M_ARM64EC)
+#define TIL_SSE_INTRINSICS
+#include <emmintrin.h>
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(_M_HYBRID_X86_ARM64) || defined(_M_ARM64EC) || __arm__ || __aarch64__
+#define TIL_ARM_NEON_INTRINSICS
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <til/flat_set.h>
+#include <til/latch.h>
+#include <til/spsc.h>
+#include <til/ticket_lock.h>
+
+using clock_type = std::chrono::steady_clock;
+
+static constexpr unsigned threadCounts[]{ 2, 4, 8 };
+
+static double elapsedNs(clock_type::time_point begin, clock_type::time_point end) noexcept
+{
+    return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+// N/2 producer/consumer pairs each send `iterations` items through their own channel.
+// Reports the aggregate throughput of all channels.
+static void benchSpsc(unsigned threads, uint32_t iterations)
+{
+    static constexpr uint32_t capacity = 256;
+    static constexpr size_t batch = 64;
+
+    const auto pairs = threads / 2;
+    std::vector<std::thread> workers;
+    til::latch start{ static_cast<ptrdiff_t>(threads) + 1 };
+    std::atomic<uint64_t> checksum{ 0 };
+
+    for (unsigned i = 0; i < pairs; ++i)
+    {
+        auto [tx, rx] = til::spsc::channel<uint32_t>(capacity);
+
+        workers.emplace_back([&start, tx = std::move(tx), iterations]() {
+            std::vector<uint32_t> items(batch);
+            start.arrive_and_wait();
+            for (uint32_t n = 0; n < iterations;)
+            {
+                const auto count = std::min<size_t>(batch, iterations - n);
+                for (size_t j = 0; j < count; ++j)
+                {
+                    items[j] = n + static_cast<uint32_t>(j);
+                }
+                tx.push_n(items.begin(), count);
+                n += static_cast<uint32_t>(count);
+            }
+        });
+
+        workers.emplace_back([&start, &checksum, rx = std::move(rx)]() {
+            std::vector<uint32_t> items(batch);
+            uint64_t sum = 0;
+            start.arrive_and_wait();
+            for (;;)
+            {
+                const auto [count, ok] = rx.pop_n(til::spsc::block_initially, items.begin(), batch);
+                for (size_t j = 0; j < count; ++j)
+                {
+                    sum += items[j];
+                }
+                if (!ok)
+                {
+                    break;
+                }
+            }
+            checksum.fetch_add(sum, std::memory_order_relaxed);
+        });
+    }
+
+    start.arrive_and_wait();
+    const auto begin = clock_type::now();
+    for (auto& w : workers)
+    {
+        w.join();
+    }
+    const auto end = clock_type::now();
+
+    const auto expected = uint64_t{ pairs } * (uint64_t{ iterations } * (iterations - 1) / 2);
+    if (checksum.load() != expected)
+    {
+        fprintf(stderr, "spsc: checksum mismatch\n");
+        exit(1);
+    }
+
+    const auto items = double(pairs) * iterations;
+    const auto seconds = elapsedNs(begin, end) / 1e9;
+    printf("spsc          %2u threads  %10.2f Mitems/s  %8.2f ns/item\n", threads, items / seconds / 1e6, elapsedNs(begin, end) / items);
+}
+
+// Streams bytes from one thread to another, once in chunks with push_n()/pop_n()
+// and once in place with reserve()/commit() and peek()/consume().
+// The producer copies from a source buffer (like a pipe read would) and the consumer sums up the bytes.
+static void benchSpscBytes(uint32_t iterations)
+{
+    static constexpr uint32_t capacity = 64 * 1024;
+    static constexpr size_t chunk = 4096;
+    // Every byte is its position modulo 251, which catches reordered and lost chunks.
+    static constexpr size_t patternSize = 251 * 1024;
+
+    const auto total = uint64_t{ iterations } * 256;
+    std::vector<uint8_t> pattern(patternSize);
+    for (size_t i = 0; i < patternSize; ++i)
+    {
+        pattern[i] = static_cast<uint8_t>(i % 251);
+    }
+
+    uint64_t expected = 0;
+    for (uint64_t i = 0; i < total; ++i)
+    {
+        expected += i % 251;
+    }
+
+    // Writes the pattern bytes [pos, pos + span.size()) into span.
+    const auto read = [&](std::span<uint8_t> span, uint64_t pos) {
+        while (!span.empty())
+        {
+            const auto offset = static_cast<size_t>(pos % patternSize);
+            const auto count = std::min(span.size(), patternSize - offset);
+            memcpy(span.data(), pattern.data() + offset, count);
+            span = span.subspan(count);
+            pos += count;
+        }
+    };
+    const auto sum = [](std::span<const uint8_t> span) {
+        uint64_t s = 0;
+        for (const auto b : span)
+        {
+            s += b;
+        }
+        return s;
+    };
+
+    const auto run = [&](const char* name, auto&& produce, auto&& consume) {
+        auto [tx, rx] = til::spsc::channel<uint8_t>(capacity);
+
+        const auto begin = clock_type::now();
+        std::thread producer{ [&, tx = std::move(tx)]() { produce(tx); } };
+        const uint64_t checksum = consume(rx);
+        producer.join();
+        const auto end = clock_type::now();
+
+        if (checksum != expected)
+        {
+            fprintf(stderr, "%s: checksum mismatch\n", name);
+            exit(1);
+        }
+
+        printf("%-26s %10.2f GB/s\n", name, double(total) / (elapsedNs(begin, end) / 1e9) / 1e9);
+    };
+
+    run(
+        "spsc bytes push_n/pop_n",
+        [&](const til::spsc::producer<uint8_t>& tx) {
+            std::vector<uint8_t> buffer(chunk);
+            for (uint64_t pos = 0; pos < total;)
+            {
+                const auto count = static_cast<size_t>(std::min<uint64_t>(chunk, total - pos));
+                read({ buffer.data(), count }, pos);
+                tx.push_n(buffer.begin(), count);
+                pos += count;
+            }
+        },
+        [&](const til::spsc::consumer<uint8_t>& rx) {
+            std::vector<uint8_t> buffer(chunk);
+            uint64_t s = 0;
+            for (;;)
+            {
+                const auto [count, ok] = rx.pop_n(til::spsc::block_initially, buffer.begin(), chunk);
+                s += sum({ buffer.data(), count });
+                if (!ok)
+                {
+                    return s;
+                }
+            }
+        });
+
+    run(
+        "spsc bytes reserve/peek",
+        [&](const til::spsc::producer<uint8_t>& tx) {
+            for (uint64_t pos = 0; pos < total;)
+            {
+                const auto w = tx.reserve(til::spsc::block_initially, static_cast<size_t>(std::min<uint64_t>(chunk, total - pos)));
+                read(w.first, pos);
+                read(w.second, pos + w.first.size());
+                tx.commit(w.size());
+                pos += w.size();
+            }
+        },
+        [&](const til::spsc::consumer<uint8_t>& rx) {
+            uint64_t s = 0;
+            for (;;)
+            {
+                const auto r = rx.peek(til::spsc::block_initially, chunk);
+                if (r.empty())
+                {
+                    return s;
+                }
+                s += sum(r.first) + sum(r.second);
+                rx.consume(r.size());
+            }
+        });
+}
+
+// Shaped like BackendD3D's AtlasGlyphEntry.
+struct GlyphEntry
+{
+    uint32_t glyphIndex;
+    uint8_t occupied;
+    uint8_t shadingType;
+    uint16_t overlapSplit;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t texcoord;
+};
+
+struct GlyphEntryHashTrait
+{
+    static constexpr bool occupied(const GlyphEntry& entry) noexcept
+    {
+        return entry.occupied != 0;
+    }
+
+    static constexpr size_t hash(const uint16_t glyphIndex) noexcept
+    {
+        return til::flat_set_hash_integer(glyphIndex);
+    }
+
+    static constexpr size_t hash(const GlyphEntry& entry) noexcept
+    {
+        return til::flat_set_hash_integer(entry.glyphIndex);
+    }
+
+    static constexpr bool equals(const GlyphEntry& entry, uint16_t glyphIndex) noexcept
+    {
+        return entry.glyphIndex == glyphIndex;
+    }
+
+    static constexpr void assign(GlyphEntry& entry, uint16_t glyphIndex) noexcept
+    {
+        entry.glyphIndex = glyphIndex;
+        entry.occupied = 1;
+    }
+};
+
+// A glyph cache workload: A set of `glyphs` random u16 glyph indices is cached and then looked up with a 90% hit rate.
+// The best of 5 runs is reported, as well as the load factor of the set, which depends on where the glyph count
+// falls relative to the set's growth steps. Misses aren't inserted, so that the load stays the same during the run.
+template<typename Set>
+static void benchFlatSet(const char* name, size_t glyphs, uint32_t iterations)
+{
+    std::mt19937 rng{ 42 };
+    std::uniform_int_distribution<uint32_t> dist{ 0, 65535 };
+
+    std::vector<uint16_t> cached;
+    std::vector<uint16_t> uncached;
+    {
+        std::vector<bool> used(65536);
+        while (cached.size() < glyphs)
+        {
+            const auto g = dist(rng);
+            if (!used[g])
+            {
+                used[g] = true;
+                cached.push_back(static_cast<uint16_t>(g));
+            }
+        }
+        for (uint32_t g = 0; g < 65536; ++g)
+        {
+            if (!used[g])
+            {
+                uncached.push_back(static_cast<uint16_t>(g));
+            }
+        }
+    }
+
+    std::vector<uint16_t> queries(iterations);
+    uint64_t expected = 0;
+    for (auto& q : queries)
+    {
+        if (dist(rng) % 10 == 0)
+        {
+            q = uncached[dist(rng) % uncached.size()];
+        }
+        else
+        {
+            q = cached[dist(rng) % cached.size()];
+            expected += q;
+        }
+    }
+
+    Set set;
+    for (const auto g : cached)
+    {
+        set.insert(g).first->size = g;
+    }
+
+    auto best = std::numeric_limits<double>::max();
+    for (auto run = 0; run < 5; ++run)
+    {
+        uint64_t checksum = 0;
+        const auto begin = clock_type::now();
+        for (const auto q : queries)
+        {
+            if (const auto entry = set.lookup(q))
+            {
+                checksum += entry->size;
+            }
+        }
+        const auto end = clock_type::now();
+
+        if (checksum != expected)
+        {
+            fprintf(stderr, "%s: checksum mismatch\n", name);
+            exit(1);
+        }
+
+        best = std::min(best, elapsedNs(begin, end));
+    }
+
+    const auto load = double(set.size()) / double(set.container().size()) * 100.0;
+    printf("%-26s %6zu glyphs  %8.2f ns/lookup  %5.1f%% load\n", name, glyphs, best / iterations, load);
+}
+
+// N-1 threads block on a latch, which the main thread releases. Reports how long it takes
+// from the count_down() until the waiters are running again (average over all waiters and the slowest one).
+static void benchLatch(unsigned threads, uint32_t iterations)
+{
+    const auto waiters = threads - 1;
+    const auto rounds = std::max<uint32_t>(iterations / 10000, 10);
+
+    double total = 0;
+    double slowest = 0;
+
+    for (uint32_t round = 0; round < rounds; ++round)
+    {
+        til::latch ready{ static_cast<ptrdiff_t>(waiters) };
+        til::latch go{ 1 };
+        std::atomic<clock_type::time_point> released{};
+        std::vector<double> latencies(waiters);
+        std::vector<std::thread> workers;
+
+        for (unsigned i = 0; i < waiters; ++i)
+        {
+            workers.emplace_back([&, i]() {
+                ready.count_down();
+                go.wait();
+                latencies[i] = elapsedNs(released.load(std::memory_order_acquire), clock_type::now());
+            });
+        }
+
+        ready.wait();
+        // Give the waiters a moment to actually go to sleep inside go.wait().
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+        released.store(clock_type::now(), std::memory_order_release);
+        go.count_down();
+
+        for (auto& w : workers)
+        {
+            w.join();
+        }
+
+        for (const auto l : latencies)
+        {
+            total += l;
+            slowest = std::max(slowest, l);
+        }
+    }
+
+    printf("latch         %2u threads  %10.2f us avg    %8.2f us max\n", threads, total / (double(rounds) * waiters) / 1e3, slowest / 1e3);
+}
+
+// N threads take turns acquiring a ticket_lock. Reports the time per lock/unlock pair.
+// Since the lock is fair, almost every acquisition is a handoff to a different thread.
+static void benchTicketLock(unsigned threads, uint32_t iterations)
+{
+    const auto perThread = iterations / threads;
+
+    til::ticket_lock lock;
+    uint64_t counter = 0;
+    til::latch start{ static_cast<ptrdiff_t>(threads) + 1 };
+    std::vector<std::thread> workers;
+
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&]() {
+            start.arrive_and_wait();
+            for (uint32_t n = 0; n < perThread; ++n)
+            {
+                std::lock_guard guard{ lock };
+                counter++;
+            }
+        });
+    }
+
+    start.arrive_and_wait();
+    const auto begin = clock_type::now();
+    for (auto& w : workers)
+    {
+        w.join();
+    }
+    const auto end = clock_type::now();
+
+    if (counter != uint64_t{ perThread } * threads)
+    {
+        fprintf(stderr, "ticket_lock: counter mismatch\n");
+        exit(1);
+    }
+
+    printf("ticket_lock   %2u threads  %10.2f Mops/s    %8.2f ns/op\n", threads, double(counter) / (elapsedNs(begin, end) / 1e9) / 1e6, elapsedNs(begin, end) / double(counter));
+}
+
+// 1 writer and N readers contend for the lock, similar to the Terminal's output thread and its UI-thread readers.
+// The writer performs `iterations` writes while the readers read in a loop until it's done.
+// With the exclusive recursive_ticket_lock the readers also take the lock exclusively.
+template<typename Lock>
+static void benchReadWriteLock(const char* name, unsigned readers, uint32_t iterations)
+{
+    Lock lock;
+    std::array<uint64_t, 64> data{};
+    std::atomic<bool> done{ false };
+    std::atomic<uint64_t> reads{ 0 };
+    til::latch start{ static_cast<ptrdiff_t>(readers) + 2 };
+    std::vector<std::thread> workers;
+
+    for (unsigned i = 0; i < readers; ++i)
+    {
+        workers.emplace_back([&]() {
+            uint64_t n = 0;
+            start.arrive_and_wait();
+            while (!done.load(std::memory_order_relaxed))
+            {
+                uint64_t sum = 0;
+                {
+                    std::shared_lock guard{ lock };
+                    for (const auto v : data)
+                    {
+                        sum += v;
+                    }
+                }
+                // Every write adds the same amount to every element.
+                if (sum % data.size() != 0)
+                {
+                    fprintf(stderr, "%s: torn read\n", name);
+                    exit(1);
+                }
+                n++;
+            }
+            reads.fetch_add(n, std::memory_order_relaxed);
+        });
+    }
+
+    clock_type::time_point begin;
+    clock_type::time_point end;
+    workers.emplace_back([&]() {
+        start.arrive_and_wait();
+        begin = clock_type::now();
+        for (uint32_t n = 0; n < iterations; ++n)
+        {
+            std::lock_guard guard{ lock };
+            for (auto& v : data)
+            {
+                v++;
+            }
+        }
+        end = clock_type::now();
+        done.store(true, std::memory_order_relaxed);
+    });
+
+    start.arrive_and_wait();
+    for (auto& w : workers)
+    {
+        w.join();
+    }
+
+    const auto elapsed = elapsedNs(begin, end);
+    printf("%-28s 1+%u threads  %8.2f ns/write  %10.2f Mreads/s\n", name, readers, elapsed / iterations, double(reads.load()) / (elapsed / 1e9) / 1e6);
+}
+
+// recursive_ticket_lock has no shared mode, which makes std::shared_lock fall back to an exclusive lock.
+struct exclusive_recursive_ticket_lock : til::recursive_ticket_lock
+{
+    void lock_shared() noexcept
+    {
+        lock();
+    }
+
+    void unlock_shared() noexcept
+    {
+        unlock();
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    uint32_t iterations = 1'000'000;
+    if (argc > 1)
+    {
+        iterations = static_cast<uint32_t>(std::max(1ul, strtoul(argv[1], nullptr, 10)));
+    }
+
+    // Only runs the benchmarks whose name starts with the filter, if one was given.
+    const std::string_view filter = argc > 2 ? argv[2] : "";
+    const auto enabled = [&](std::string_view name) {
+        return name.starts_with(filter);
+    };
+
+    if (enabled("spsc"))
+    {
+        for (const auto threads : threadCounts)
+        {
+            benchSpsc(threads, iterations);
+        }
+        benchSpscBytes(iterations);
+    }
+    if (enabled("latch"))
+    {
+        for (const auto threads : threadCounts)
+        {
+            benchLatch(threads, iterations);
+        }
+    }
+    if (enabled("ticket_lock"))
+    {
+        for (const auto threads : threadCounts)
+        {
+            benchTicketLock(threads, iterations);
+        }
+    }
+    if (enabled("rw_lock"))
+    {
+        for (const auto readers : { 1u, 3u, 7u })
+        {
+            benchReadWriteLock<exclusive_recursive_ticket_lock>("recursive_ticket_lock", readers, iterations);
+            benchReadWriteLock<til::recursive_shared_ticket_lock>("recursive_shared_ticket_lock", readers, iterations);
+        }
+    }
+    if (enabled("flat_set"))
+    {
+        for (const auto glyphs : { 100, 200, 1500, 3500, 14000, 28000 })
+        {
+            benchFlatSet<til::linear_flat_set<GlyphEntry, GlyphEntryHashTrait>>("linear_flat_set", glyphs, iterations);
+            benchFlatSet<til::swiss_flat_set<GlyphEntry, GlyphEntryHashTrait>>("swiss_flat_set", glyphs, iterations);
+        }
+    }
+
+    return 0;
+}
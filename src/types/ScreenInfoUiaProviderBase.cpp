@@ -360,11 +360,12 @@ Viewport ScreenInfoUiaProviderBase::_getViewport() const noexcept
 void ScreenInfoUiaProviderBase::_LockConsole() noexcept
 {
     // TODO GitHub #2141: Lock and Unlock in conhost should decouple Ctrl+C dispatch and use smarter handling
-    _pData->LockConsole();
+    // GetSelection() and GetVisibleRanges() only read, so they don't need to block other readers.
+    _pData->LockConsoleShared();
 }
 
 void ScreenInfoUiaProviderBase::_UnlockConsole() noexcept
 {
     // TODO GitHub #2141: Lock and Unlock in conhost should decouple Ctrl+C dispatch and use smarter handling
-    _pData->UnlockConsole();
+    _pData->UnlockConsoleShared();
 }
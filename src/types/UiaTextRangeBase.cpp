@@ -22,9 +22,9 @@ try
     RETURN_HR_IF_NULL(E_INVALIDARG, pProvider);
     RETURN_HR_IF_NULL(E_INVALIDARG, pData);
 
-    pData->LockConsole();
+    pData->LockConsoleShared();
     const auto unlock = wil::scope_exit([&]() noexcept {
-        pData->UnlockConsole();
+        pData->UnlockConsoleShared();
     });
 
     _pProvider = pProvider;
@@ -49,9 +49,9 @@ try
     RETURN_HR_IF_NULL(E_INVALIDARG, pProvider);
     RETURN_HR_IF_NULL(E_INVALIDARG, pData);
 
-    pData->LockConsole();
+    pData->LockConsoleShared();
     const auto unlock = wil::scope_exit([&]() noexcept {
-        pData->UnlockConsole();
+        pData->UnlockConsoleShared();
     });
 
     _pProvider = pProvider;
@@ -108,10 +108,10 @@ void UiaTextRangeBase::Initialize(_In_ const UiaPoint point)
     _TranslatePointFromScreen(clientPoint);
 
     // convert the point to screen buffer coordinates
-    _pData->LockConsole();
+    _pData->LockConsoleShared();
     const auto currentFontSize = _getScreenFontSize();
     const auto viewport = _pData->GetViewport().ToInclusive();
-    _pData->UnlockConsole();
+    _pData->UnlockConsoleShared();
 
     _start = { clientPoint.x / currentFontSize.width + viewport.left,
                clientPoint.y / currentFontSize.height + viewport.top };
@@ -189,9 +189,9 @@ bool UiaTextRangeBase::IsDegenerate() const noexcept
 
 IFACEMETHODIMP UiaTextRangeBase::Compare(_In_opt_ ITextRangeProvider* pRange, _Out_ BOOL* pRetVal) noexcept
 {
-    _pData->LockConsole();
+    _pData->LockConsoleShared();
     auto Unlock = wil::scope_exit([&]() noexcept {
-        _pData->UnlockConsole();
+        _pData->UnlockConsoleShared();
     });
 
     RETURN_HR_IF(E_INVALIDARG, pRetVal == nullptr);
@@ -216,9 +216,9 @@ try
     RETURN_HR_IF_NULL(E_INVALIDARG, pRetVal);
     *pRetVal = 0;
 
-    _pData->LockConsole();
+    _pData->LockConsoleShared();
     auto Unlock = wil::scope_exit([&]() noexcept {
-        _pData->UnlockConsole();
+        _pData->UnlockConsoleShared();
     });
     RETURN_HR_IF(E_FAIL, !_pData->IsUiaDataInitialized());
 
@@ -248,6 +248,8 @@ CATCH_RETURN();
 
 IFACEMETHODIMP UiaTextRangeBase::ExpandToEnclosingUnit(_In_ TextUnit unit) noexcept
 {
+    // Unlike the read-only methods above, this and the other methods that modify the range
+    // take the lock exclusively, because that's what serializes concurrent calls on the range.
     _pData->LockConsole();
     auto Unlock = wil::scope_exit([&]() noexcept {
         _pData->UnlockConsole();
@@ -444,9 +446,9 @@ try
     RETURN_HR_IF(E_INVALIDARG, ppRetVal == nullptr);
     *ppRetVal = nullptr;
 
-    _pData->LockConsole();
+    _pData->LockConsoleShared();
     auto Unlock = wil::scope_exit([&]() noexcept {
-        _pData->UnlockConsole();
+        _pData->UnlockConsoleShared();
     });
     RETURN_HR_IF(E_FAIL, !_pData->IsUiaDataInitialized());
 
@@ -750,9 +752,9 @@ try
     RETURN_HR_IF(E_INVALIDARG, pRetVal == nullptr);
     VariantInit(pRetVal);
 
-    _pData->LockConsole();
+    _pData->LockConsoleShared();
     auto Unlock = wil::scope_exit([&]() noexcept {
-        _pData->UnlockConsole();
+        _pData->UnlockConsoleShared();
     });
     RETURN_HR_IF(E_FAIL, !_pData->IsUiaDataInitialized());
 
@@ -847,9 +849,9 @@ IFACEMETHODIMP UiaTextRangeBase::GetBoundingRectangles(_Outptr_result_maybenull_
     RETURN_HR_IF(E_INVALIDARG, ppRetVal == nullptr);
     *ppRetVal = nullptr;
 
-    _pData->LockConsole();
+    _pData->LockConsoleShared();
     auto Unlock = wil::scope_exit([&]() noexcept {
-        _pData->UnlockConsole();
+        _pData->UnlockConsoleShared();
     });
     RETURN_HR_IF(E_FAIL, !_pData->IsUiaDataInitialized());
 
@@ -948,9 +950,9 @@ try
     RETURN_HR_IF(E_INVALIDARG, maxLength < -1);
     *pRetVal = nullptr;
 
-    _pData->LockConsole();
+    _pData->LockConsoleShared();
     auto Unlock = wil::scope_exit([&]() noexcept {
-        _pData->UnlockConsole();
+        _pData->UnlockConsoleShared();
     });
     RETURN_HR_IF(E_FAIL, !_pData->IsUiaDataInitialized());
 